@@ -535,6 +535,19 @@ typedef struct {
   VTermColor fg, bg;
 } VTermScreenCell;
 
+/* Compact copy of a screen cell for bulk consumers such as scrollback
+ * storage. Only the first character of the cell is kept. attrs holds the
+ * VTERM_ATTR_*_MASK bits of the boolean attributes, with reverse already
+ * combined with the screen-wide reverse mode; width is as reported by
+ * vterm_screen_get_cell().
+ */
+typedef struct {
+  uint32_t   ch;
+  VTermColor fg, bg;
+  uint16_t   attrs;
+  uint8_t    width;
+} VTermPackedCell;
+
 typedef struct {
   int (*damage)(VTermRect rect, void *user);
   int (*moverect)(VTermRect dest, VTermRect src, void *user);
@@ -547,6 +560,11 @@ typedef struct {
   int (*sb_clear)(void* user);
   /* ABI-compat this is only used if vterm_screen_callbacks_has_pushline4() is called */
   int (*sb_pushline4)(int cols, const VTermScreenCell *cells, bool continuation, void *user);
+  /* ABI-compat this is only used if vterm_screen_callbacks_has_pushline_packed() is called.
+   * Takes precedence over sb_pushline and sb_pushline4. Trailing blank cells
+   * in the default background are not passed; cols counts the cells that
+   * remain (0 for an empty line) and width is the full line width */
+  int (*sb_pushline_packed)(int cols, int width, const VTermPackedCell *cells, bool continuation, void *user);
 } VTermScreenCallbacks;
 
 VTermScreen *vterm_obtain_screen(VTerm *vt);
@@ -555,6 +573,7 @@ void  vterm_screen_set_callbacks(VTermScreen *screen, const VTermScreenCallbacks
 void *vterm_screen_get_cbdata(VTermScreen *screen);
 
 void vterm_screen_callbacks_has_pushline4(VTermScreen *screen);
+void vterm_screen_callbacks_has_pushline_packed(VTermScreen *screen);
 
 void  vterm_screen_set_unrecognised_fallbacks(VTermScreen *screen, const VTermStateFallbacks *fallbacks, void *user);
 void *vterm_screen_get_unrecognised_fbdata(VTermScreen *screen);
@@ -565,6 +584,8 @@ void vterm_screen_enable_reflow(VTermScreen *screen, bool reflow);
 #define vterm_screen_set_reflow  vterm_screen_enable_reflow
 
 void vterm_screen_enable_altscreen(VTermScreen *screen, int altscreen);
+/* Whether the alternate screen buffer is the one currently displayed */
+int vterm_screen_is_altscreen(const VTermScreen *screen);
 
 typedef enum {
   VTERM_DAMAGE_CELL,    /* every cell */
@@ -619,6 +640,43 @@ void vterm_screen_convert_color_to_rgb(const VTermScreen *screen, VTermColor *co
  */
 void vterm_screen_set_default_colors(VTermScreen *screen, const VTermColor *default_fg, const VTermColor *default_bg);
 
+/**
+ * Complete emulator state reachable from the screen (parser, state and
+ * screen layers, including partially-parsed sequences) as a versioned binary
+ * blob in host byte order. Callbacks, allocators and pending output are not
+ * part of it.
+ *
+ * Returns the number of bytes the checkpoint needs; the buffer is only
+ * written when len is at least that much.
+ */
+#define VTERM_CHECKPOINT_VERSION 1
+
+size_t vterm_screen_checkpoint(const VTermScreen *screen, void *buf, size_t len);
+
+/**
+ * Terminal size recorded in a checkpoint. Returns 0 if buf does not hold a
+ * checkpoint of this version and byte order.
+ */
+int vterm_screen_checkpoint_size(const void *buf, size_t len, int *rowsp, int *colsp);
+
+/**
+ * Like vterm_screen_checkpoint_size(), but also checks the payload checksum
+ * and decodes the payload into a scratch terminal, range-checking every
+ * field, so a corrupted or forged checkpoint is rejected before the caller
+ * resizes anything. vterm_screen_restore() does not fail after passing this.
+ */
+int vterm_screen_checkpoint_validate(const void *buf, size_t len, int *rowsp, int *colsp);
+
+/**
+ * Replace the complete emulator state with a checkpoint. The terminal must
+ * already have the checkpoint's size. Damages the whole screen and reports
+ * the cursor through the usual callbacks. Returns 0 if the checkpoint is
+ * invalid; one failing the header or checksum checks leaves the terminal
+ * untouched, otherwise it is reset. Call vterm_screen_checkpoint_validate()
+ * first to keep the terminal untouched in every case.
+ */
+int vterm_screen_restore(VTermScreen *screen, const void *buf, size_t len);
+
 // ---------
 // Utilities
 // ---------
@@ -228,3 +228,14 @@ VTermEncoding *vterm_lookup_encoding(VTermEncodingType type, char designation)
       return encodings[i].enc;
   return NULL;
 }
+
+INTERNAL int vterm_lookup_designation(const VTermEncoding *enc, VTermEncodingType *type, char *designation)
+{
+  for(int i = 0; encodings[i].designation; i++)
+    if(encodings[i].enc == enc) {
+      *type = encodings[i].type;
+      *designation = encodings[i].designation;
+      return 1;
+    }
+  return 0;
+}
@@ -400,3 +400,95 @@ void vterm_parser_set_emit_nul(VTerm *vt, bool emit)
 {
   vt->parser.emit_nul = emit;
 }
+
+INTERNAL void vterm_parser_checkpoint(const VTerm *vt, VTermCheckpointWriter *w)
+{
+  vterm_checkpoint_put_int(w, vt->mode.utf8);
+  vterm_checkpoint_put_int(w, vt->mode.ctrl8bit);
+
+  vterm_checkpoint_put_int(w, vt->parser.state);
+  vterm_checkpoint_put_int(w, vt->parser.in_esc);
+  vterm_checkpoint_put_int(w, vt->parser.intermedlen);
+  vterm_checkpoint_put(w, vt->parser.intermed, INTERMED_MAX);
+
+  /* Only the union member belonging to the current state is live */
+  switch(vt->parser.state) {
+  case CSI_LEADER:
+  case CSI_ARGS:
+  case CSI_INTERMED:
+    vterm_checkpoint_put_int(w, vt->parser.v.csi.leaderlen);
+    vterm_checkpoint_put(w, vt->parser.v.csi.leader, CSI_LEADER_MAX);
+    vterm_checkpoint_put_int(w, vt->parser.v.csi.argi);
+    for(int i = 0; i < CSI_ARGS_MAX; i++) {
+      int64_t arg = vt->parser.v.csi.args[i];
+      vterm_checkpoint_put(w, &arg, sizeof(arg));
+    }
+    break;
+  case OSC_COMMAND:
+  case OSC:
+    vterm_checkpoint_put_int(w, vt->parser.v.osc.command);
+    break;
+  case DCS_COMMAND:
+  case DCS:
+    vterm_checkpoint_put_int(w, vt->parser.v.dcs.commandlen);
+    vterm_checkpoint_put(w, vt->parser.v.dcs.command, CSI_LEADER_MAX);
+    break;
+  default:
+    break;
+  }
+
+  vterm_checkpoint_put_int(w, vt->parser.string_initial);
+  vterm_checkpoint_put_int(w, vt->parser.emit_nul);
+}
+
+INTERNAL int vterm_parser_restore(VTerm *vt, VTermCheckpointReader *r)
+{
+  vt->mode.utf8     = vterm_checkpoint_get_int(r);
+  vt->mode.ctrl8bit = vterm_checkpoint_get_int(r);
+
+  int state = vterm_checkpoint_get_int(r);
+  if(state < NORMAL || state > SOS)
+    return 0;
+  vt->parser.state = state;
+  vt->parser.in_esc = vterm_checkpoint_get_int(r);
+  vt->parser.intermedlen = vterm_checkpoint_get_int(r);
+  if(vt->parser.intermedlen < 0 || vt->parser.intermedlen >= INTERMED_MAX)
+    return 0;
+  vterm_checkpoint_get(r, vt->parser.intermed, INTERMED_MAX);
+
+  switch(vt->parser.state) {
+  case CSI_LEADER:
+  case CSI_ARGS:
+  case CSI_INTERMED:
+    vt->parser.v.csi.leaderlen = vterm_checkpoint_get_int(r);
+    vterm_checkpoint_get(r, vt->parser.v.csi.leader, CSI_LEADER_MAX);
+    vt->parser.v.csi.argi = vterm_checkpoint_get_int(r);
+    for(int i = 0; i < CSI_ARGS_MAX; i++) {
+      int64_t arg;
+      vterm_checkpoint_get(r, &arg, sizeof(arg));
+      vt->parser.v.csi.args[i] = arg;
+    }
+    if(vt->parser.v.csi.leaderlen < 0 || vt->parser.v.csi.leaderlen >= CSI_LEADER_MAX ||
+       vt->parser.v.csi.argi < 0 || vt->parser.v.csi.argi > CSI_ARGS_MAX)
+      return 0;
+    break;
+  case OSC_COMMAND:
+  case OSC:
+    vt->parser.v.osc.command = vterm_checkpoint_get_int(r);
+    break;
+  case DCS_COMMAND:
+  case DCS:
+    vt->parser.v.dcs.commandlen = vterm_checkpoint_get_int(r);
+    vterm_checkpoint_get(r, vt->parser.v.dcs.command, CSI_LEADER_MAX);
+    if(vt->parser.v.dcs.commandlen < 0 || vt->parser.v.dcs.commandlen > CSI_LEADER_MAX)
+      return 0;
+    break;
+  default:
+    break;
+  }
+
+  vt->parser.string_initial = vterm_checkpoint_get_int(r);
+  vt->parser.emit_nul       = vterm_checkpoint_get_int(r);
+
+  return !r->error;
+}
@@ -1,5 +1,6 @@
 #include "vterm_internal.h"
 
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -49,6 +50,7 @@ struct VTermScreen
   const VTermScreenCallbacks *callbacks;
   void *cbdata;
   bool callbacks_has_pushline4;
+  bool callbacks_has_pushline_packed;
 
   VTermDamageSize damage_merge;
   /* start_row == -1 => no damage */
@@ -70,6 +72,7 @@ struct VTermScreen
 
   /* buffer for a single screen row used in scrollback storage callbacks */
   VTermScreenCell *sb_buffer;
+  VTermPackedCell *sb_packed;
 
   ScreenPen pen;
 };
@@ -206,8 +209,54 @@ static int putglyph(VTermGlyphInfo *info, VTermPos pos, void *user)
   return 1;
 }
 
+static bool sb_pushline_wanted(const VTermScreen *screen)
+{
+  const VTermScreenCallbacks *cb = screen->callbacks;
+  return cb && (cb->sb_pushline ||
+      (screen->callbacks_has_pushline4 && cb->sb_pushline4) ||
+      (screen->callbacks_has_pushline_packed && cb->sb_pushline_packed));
+}
+
+/* Packs straight from the internal cells, skipping vterm_screen_get_cell() */
+static void sb_pushline_packed_from_row(VTermScreen *screen, int row, bool continuation)
+{
+  const ScreenCell *cells = screen->buffer + screen->cols * row;
+  VTermPackedCell *out = screen->sb_packed;
+  int end = 0;
+
+  for(int col = 0; col < screen->cols; col++) {
+    const ScreenPen *pen = &cells[col].pen;
+    unsigned int reverse = pen->reverse ^ screen->global_reverse;
+
+    out[col].ch = cells[col].chars[0];
+    out[col].fg = pen->fg;
+    out[col].bg = pen->bg;
+    out[col].attrs = (pen->bold      ? VTERM_ATTR_BOLD_MASK      : 0) |
+                     (pen->underline ? VTERM_ATTR_UNDERLINE_MASK : 0) |
+                     (pen->italic    ? VTERM_ATTR_ITALIC_MASK    : 0) |
+                     (pen->blink     ? VTERM_ATTR_BLINK_MASK     : 0) |
+                     (reverse        ? VTERM_ATTR_REVERSE_MASK   : 0) |
+                     (pen->strike    ? VTERM_ATTR_STRIKE_MASK    : 0) |
+                     (pen->conceal   ? VTERM_ATTR_CONCEAL_MASK   : 0) |
+                     (pen->small     ? VTERM_ATTR_SMALL_MASK     : 0);
+    out[col].width = (col < screen->cols - 1 && cells[col + 1].chars[0] == (uint32_t)-1) ? 2 : 1;
+
+    /* An erased cell only shows its background, reverse or line decoration */
+    if(cells[col].chars[0] || !VTERM_COLOR_IS_DEFAULT_BG(&pen->bg) ||
+       reverse || pen->underline || pen->strike)
+      end = col + 1;
+  }
+
+  (screen->callbacks->sb_pushline_packed)(end, screen->cols, out, continuation, screen->cbdata);
+}
+
 static void sb_pushline_from_row(VTermScreen *screen, int row, bool continuation)
 {
+  if(screen->callbacks_has_pushline_packed && screen->callbacks->sb_pushline_packed) {
+    sb_pushline_packed_from_row(screen, row, continuation);
+    return;
+  }
+
   VTermPos pos = { .row = row };
   for(pos.col = 0; pos.col < screen->cols; pos.col++)
     vterm_screen_get_cell(screen, pos, screen->sb_buffer + pos.col);
@@ -222,8 +271,7 @@ static int premove(VTermRect rect, void *user)
 {
   VTermScreen *screen = user;
 
-  if(((screen->callbacks && screen->callbacks->sb_pushline) ||
-        (screen->callbacks_has_pushline4 && screen->callbacks && screen->callbacks->sb_pushline4)) &&
+  if(sb_pushline_wanted(screen) &&
      rect.start_row == 0 && rect.start_col == 0 &&        // starts top-left corner
      rect.end_col == screen->cols &&                      // full width
      screen->buffer == screen->buffers[BUFIDX_PRIMARY]) { // not altscreen
@@ -516,6 +564,12 @@ static int line_popcount(ScreenCell *buffer, int row, int rows, int cols)
   return col + 1;
 }
 
+static void clear_cells(const VTermScreen *screen, ScreenCell *cells, int count)
+{
+  for(int i = 0; i < count; i++)
+    clearcell(screen, &cells[i]);
+}
+
 static void resize_buffer(VTermScreen *screen, int bufidx, int new_rows, int new_cols, bool active, VTermStateFields *statefields)
 {
   int old_rows = screen->rows;
@@ -533,6 +587,16 @@ static void resize_buffer(VTermScreen *screen, int bufidx, int new_rows, int new
   VTermPos old_cursor = statefields->pos;
   VTermPos new_cursor = { -1, -1 };
 
+  /* Precompute the used width of every old row once, so the backwards walk
+   * over logical lines below doesn't rescan rows for trailing blanks */
+  int *old_linelen = vterm_allocator_malloc(screen->vt, sizeof(old_linelen[0]) * old_rows);
+  for(int row = 0; row < old_rows; row++) {
+    if(screen->reflow && row < (old_rows - 1) && old_lineinfo[row + 1].continuation)
+      old_linelen[row] = old_cols;
+    else
+      old_linelen[row] = line_popcount(old_buffer, row, old_rows, old_cols);
+  }
+
 #ifdef DEBUG_REFLOW
   fprintf(stderr, "Resizing from %dx%d to %dx%d; cursor was at (%d,%d)\n",
       old_cols, old_rows, new_cols, new_rows, old_cursor.col, old_cursor.row);
@@ -546,17 +610,13 @@ static void resize_buffer(VTermScreen *screen, int bufidx, int new_rows, int new
   while(old_row >= 0) {
     int old_row_end = old_row;
     /* TODO: Stop if dwl or dhl */
-    while(screen->reflow && old_lineinfo && old_row >= 0 && old_lineinfo[old_row].continuation)
+    while(screen->reflow && old_lineinfo && old_row > 0 && old_lineinfo[old_row].continuation)
       old_row--;
     int old_row_start = old_row;
 
     int width = 0;
-    for(int row = old_row_start; row <= old_row_end; row++) {
-      if(screen->reflow && row < (old_rows - 1) && old_lineinfo[row + 1].continuation)
-        width += old_cols;
-      else
-        width += line_popcount(old_buffer, row, old_rows, old_cols);
-    }
+    for(int row = old_row_start; row <= old_row_end; row++)
+      width += old_linelen[row];
 
     if(final_blank_row == (new_row + 1) && width == 0)
       final_blank_row = new_row;
@@ -608,7 +668,7 @@ static void resize_buffer(VTermScreen *screen, int bufidx, int new_rows, int new
 #endif
 
     if(new_row_start < 0) {
-      if(old_row_start <= old_cursor.row && old_cursor.row < old_row_end) {
+      if(old_row_start <= old_cursor.row && old_cursor.row <= old_row_end) {
         new_cursor.row = 0;
         new_cursor.col = old_cursor.col;
         if(new_cursor.col >= new_cols)
@@ -624,25 +684,27 @@ static void resize_buffer(VTermScreen *screen, int bufidx, int new_rows, int new
       int new_col = 0;
 
       while(count) {
-        /* TODO: This could surely be done a lot faster by memcpy()'ing the entire range */
-        new_buffer[new_row * new_cols + new_col] = old_buffer[old_row * old_cols + old_col];
+        /* Copy the longest span that stays within both the old and new row */
+        int span = old_cols - old_col;
+        if(span > count)
+          span = count;
+
+        memcpy(&new_buffer[new_row * new_cols + new_col], &old_buffer[old_row * old_cols + old_col], span * sizeof(ScreenCell));
 
-        if(old_cursor.row == old_row && old_cursor.col == old_col)
-          new_cursor.row = new_row, new_cursor.col = new_col;
+        if(old_cursor.row == old_row && old_cursor.col >= old_col && old_cursor.col < old_col + span)
+          new_cursor.row = new_row, new_cursor.col = new_col + (old_cursor.col - old_col);
+
+        old_col += span;
+        new_col += span;
+        count -= span;
 
-        old_col++;
         if(old_col == old_cols) {
           old_row++;
 
-          if(!screen->reflow) {
-            new_col++;
+          if(!screen->reflow)
             break;
-          }
           old_col = 0;
         }
-
-        new_col++;
-        count--;
       }
 
       if(old_cursor.row == old_row && old_cursor.col >= old_col) {
@@ -651,10 +713,7 @@ static void resize_buffer(VTermScreen *screen, int bufidx, int new_rows, int new
           new_cursor.col = new_cols-1;
       }
 
-      while(new_col < new_cols) {
-        clearcell(screen, &new_buffer[new_row * new_cols + new_col]);
-        new_col++;
-      }
+      clear_cells(screen, &new_buffer[new_row * new_cols + new_col], new_cols - new_col);
 
       new_lineinfo[new_row].continuation = (new_row > new_row_start);
     }
@@ -679,8 +738,7 @@ static void resize_buffer(VTermScreen *screen, int bufidx, int new_rows, int new
 
   if(old_row >= 0 && bufidx == BUFIDX_PRIMARY) {
     /* Push spare lines to scrollback buffer */
-    if((screen->callbacks && screen->callbacks->sb_pushline) ||
-          (screen->callbacks_has_pushline4 && screen->callbacks && screen->callbacks->sb_pushline4))
+    if(sb_pushline_wanted(screen))
       for(int row = 0; row <= old_row; row++) {
         const VTermLineInfo *lineinfo = old_lineinfo + row;
         sb_pushline_from_row(screen, row, lineinfo->continuation);
@@ -739,13 +797,13 @@ static void resize_buffer(VTermScreen *screen, int bufidx, int new_rows, int new
 
     new_cursor.row -= (new_row + 1);
 
-    for(new_row = moverows; new_row < new_rows; new_row++) {
-      for(int col = 0; col < new_cols; col++)
-        clearcell(screen, &new_buffer[new_row * new_cols + col]);
+    clear_cells(screen, &new_buffer[moverows * new_cols], (new_rows - moverows) * new_cols);
+    for(new_row = moverows; new_row < new_rows; new_row++)
       new_lineinfo[new_row] = (VTermLineInfo){ 0 };
-    }
   }
 
+  vterm_allocator_free(screen->vt, old_linelen);
+
   vterm_allocator_free(screen->vt, old_buffer);
   screen->buffers[bufidx] = new_buffer;
 
@@ -773,12 +831,24 @@ static int resize(int new_rows, int new_cols, VTermStateFields *fields, void *us
       vterm_allocator_free(screen->vt, screen->sb_buffer);
 
     screen->sb_buffer = vterm_allocator_malloc(screen->vt, sizeof(VTermScreenCell) * new_cols);
+
+    if(screen->sb_packed)
+      vterm_allocator_free(screen->vt, screen->sb_packed);
+
+    screen->sb_packed = vterm_allocator_malloc(screen->vt, sizeof(VTermPackedCell) * new_cols);
   }
 
   resize_buffer(screen, 0, new_rows, new_cols, !altscreen_active, fields);
-  if(screen->buffers[BUFIDX_ALTSCREEN])
+  if(altscreen_active)
     resize_buffer(screen, 1, new_rows, new_cols, altscreen_active, fields);
-  else if(new_rows != old_rows) {
+  else if(screen->buffers[BUFIDX_ALTSCREEN]) {
+    /* An inactive altscreen is erased on every switch into it, so there is
+     * nothing worth reflowing; just replace it with a blank one */
+    vterm_allocator_free(screen->vt, screen->buffers[BUFIDX_ALTSCREEN]);
+    screen->buffers[BUFIDX_ALTSCREEN] = alloc_buffer(screen, new_rows, new_cols);
+  }
+
+  if(!altscreen_active && (screen->buffers[BUFIDX_ALTSCREEN] || new_rows != old_rows)) {
     /* We don't need a full resize of the altscreen because it isn't enabled
      * but we should at least keep the lineinfo the right size */
     vterm_allocator_free(screen->vt, fields->lineinfos[BUFIDX_ALTSCREEN]);
@@ -800,6 +870,11 @@ static int resize(int new_rows, int new_cols, VTermStateFields *fields, void *us
       vterm_allocator_free(screen->vt, screen->sb_buffer);
 
     screen->sb_buffer = vterm_allocator_malloc(screen->vt, sizeof(VTermScreenCell) * new_cols);
+
+    if(screen->sb_packed)
+      vterm_allocator_free(screen->vt, screen->sb_packed);
+
+    screen->sb_packed = vterm_allocator_malloc(screen->vt, sizeof(VTermPackedCell) * new_cols);
   }
 
   /* TODO: Maaaaybe we can optimise this if there's no reflow happening */
@@ -893,12 +968,14 @@ static VTermScreen *screen_new(VTerm *vt)
   screen->callbacks = NULL;
   screen->cbdata    = NULL;
   screen->callbacks_has_pushline4 = false;
+  screen->callbacks_has_pushline_packed = false;
 
   screen->buffers[BUFIDX_PRIMARY] = alloc_buffer(screen, rows, cols);
 
   screen->buffer = screen->buffers[BUFIDX_PRIMARY];
 
   screen->sb_buffer = vterm_allocator_malloc(screen->vt, sizeof(VTermScreenCell) * cols);
+  screen->sb_packed = vterm_allocator_malloc(screen->vt, sizeof(VTermPackedCell) * cols);
 
   vterm_state_set_callbacks(screen->state, &state_cbs, screen);
   vterm_state_callbacks_has_premove(screen->state);
@@ -913,6 +990,7 @@ INTERNAL void vterm_screen_free(VTermScreen *screen)
     vterm_allocator_free(screen->vt, screen->buffers[BUFIDX_ALTSCREEN]);
 
   vterm_allocator_free(screen->vt, screen->sb_buffer);
+  vterm_allocator_free(screen->vt, screen->sb_packed);
 
   vterm_allocator_free(screen->vt, screen);
 }
@@ -1068,6 +1146,12 @@ void vterm_screen_enable_altscreen(VTermScreen *screen, int altscreen)
   }
 }
 
+int vterm_screen_is_altscreen(const VTermScreen *screen)
+{
+  return screen->buffers[BUFIDX_ALTSCREEN] &&
+         screen->buffer == screen->buffers[BUFIDX_ALTSCREEN];
+}
+
 void vterm_screen_set_callbacks(VTermScreen *screen, const VTermScreenCallbacks *callbacks, void *user)
 {
   screen->callbacks = callbacks;
@@ -1084,6 +1168,11 @@ void vterm_screen_callbacks_has_pushline4(VTermScreen *screen)
   screen->callbacks_has_pushline4 = true;
 }
 
+void vterm_screen_callbacks_has_pushline_packed(VTermScreen *screen)
+{
+  screen->callbacks_has_pushline_packed = true;
+}
+
 void vterm_screen_set_unrecognised_fallbacks(VTermScreen *screen, const VTermStateFallbacks *fallbacks, void *user)
 {
   vterm_state_set_unrecognised_fallbacks(screen->state, fallbacks, user);
@@ -1212,3 +1301,306 @@ void vterm_screen_set_default_colors(VTermScreen *screen, const VTermColor *defa
   if(screen->buffers[1])
     reset_default_colours(screen, screen->buffers[1]);
 }
+
+/* Checkpoint layout: a fixed header of 32-bit words, then the parser, state
+ * and screen sections. The checksum covers everything after the header.
+ */
+#define CHECKPOINT_MAGIC     0x50435456 /* "VTCP" */
+#define CHECKPOINT_BYTEORDER 0x01020304
+
+enum {
+  HDR_MAGIC,
+  HDR_VERSION,
+  HDR_BYTEORDER,
+  HDR_ROWS,
+  HDR_COLS,
+  HDR_PAYLOAD,
+  HDR_CHECKSUM,
+  HDR_WORDS,
+};
+
+#define CHECKPOINT_HEADER_SIZE (HDR_WORDS * sizeof(uint32_t))
+
+/* Set on a cell followed by a count and its combining characters */
+#define CELLBIT_MORECHARS (1U << 31)
+
+static uint32_t checkpoint_checksum(const unsigned char *bytes, size_t len)
+{
+  /* FNV-1a over 64-bit words; this only needs to catch truncation and
+   * corruption, and has to stay well under the cost of the copy itself */
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  size_t i = 0;
+  for(; i + 8 <= len; i += 8) {
+    uint64_t word;
+    memcpy(&word, bytes + i, 8);
+    hash = (hash ^ word) * 0x100000001b3ULL;
+  }
+  for(; i < len; i++)
+    hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+  return (uint32_t)(hash ^ (hash >> 32));
+}
+
+static uint32_t pack_screenpen(const ScreenPen *pen)
+{
+  return pen->bold                |
+         pen->underline      << 1  |
+         pen->italic         << 3  |
+         pen->blink          << 4  |
+         pen->reverse        << 5  |
+         pen->conceal        << 6  |
+         pen->strike         << 7  |
+         pen->font           << 8  |
+         pen->small          << 12 |
+         pen->baseline       << 13 |
+         pen->protected_cell << 15 |
+         pen->dwl            << 16 |
+         pen->dhl            << 17;
+}
+
+static void unpack_screenpen(ScreenPen *pen, uint32_t bits)
+{
+  pen->bold           = bits;
+  pen->underline      = bits >> 1;
+  pen->italic         = bits >> 3;
+  pen->blink          = bits >> 4;
+  pen->reverse        = bits >> 5;
+  pen->conceal        = bits >> 6;
+  pen->strike         = bits >> 7;
+  pen->font           = bits >> 8;
+  pen->small          = bits >> 12;
+  pen->baseline       = bits >> 13;
+  pen->protected_cell = bits >> 15;
+  pen->dwl            = bits >> 16;
+  pen->dhl            = bits >> 17;
+}
+
+static void checkpoint_buffer(const VTermScreen *screen, const ScreenCell *buffer, VTermCheckpointWriter *w)
+{
+  for(int i = 0; i < screen->rows * screen->cols; i++) {
+    const ScreenCell *cell = &buffer[i];
+
+    int nchars = 1;
+    while(nchars < VTERM_MAX_CHARS_PER_CELL && cell->chars[nchars])
+      nchars++;
+    if(!cell->chars[0])
+      nchars = 1;
+
+    /* Fixed 16 bytes: first char, fg, bg, pen bits */
+    uint32_t fixed[4];
+    VTermCheckpointWriter colours = { .buf = (unsigned char *)&fixed[1], .len = 8 };
+    fixed[0] = cell->chars[0];
+    vterm_checkpoint_put_color(&colours, &cell->pen.fg);
+    vterm_checkpoint_put_color(&colours, &cell->pen.bg);
+    fixed[3] = pack_screenpen(&cell->pen) | (nchars > 1 ? CELLBIT_MORECHARS : 0);
+    vterm_checkpoint_put(w, fixed, sizeof(fixed));
+
+    if(nchars > 1) {
+      vterm_checkpoint_put_int(w, nchars - 1);
+      vterm_checkpoint_put(w, &cell->chars[1], (nchars - 1) * sizeof(uint32_t));
+    }
+  }
+}
+
+static int restore_buffer(VTermScreen *screen, ScreenCell *buffer, VTermCheckpointReader *r)
+{
+  for(int i = 0; i < screen->rows * screen->cols; i++) {
+    ScreenCell *cell = &buffer[i];
+    uint32_t bits;
+
+    memset(cell->chars, 0, sizeof(cell->chars));
+    vterm_checkpoint_get(r, &cell->chars[0], sizeof(uint32_t));
+    vterm_checkpoint_get_color(r, &cell->pen.fg);
+    vterm_checkpoint_get_color(r, &cell->pen.bg);
+    vterm_checkpoint_get(r, &bits, sizeof(bits));
+    unpack_screenpen(&cell->pen, bits);
+
+    if(bits & CELLBIT_MORECHARS) {
+      int more = vterm_checkpoint_get_int(r);
+      if(more < 1 || more >= VTERM_MAX_CHARS_PER_CELL)
+        return 0;
+      vterm_checkpoint_get(r, &cell->chars[1], more * sizeof(uint32_t));
+    }
+  }
+
+  return !r->error;
+}
+
+static void screen_checkpoint(const VTermScreen *screen, VTermCheckpointWriter *w)
+{
+  vterm_checkpoint_put_int(w, screen->global_reverse);
+  vterm_checkpoint_put_color(w, &screen->pen.fg);
+  vterm_checkpoint_put_color(w, &screen->pen.bg);
+  vterm_checkpoint_put_int(w, pack_screenpen(&screen->pen));
+
+  /* An inactive altscreen is erased on every switch into it, so its
+   * contents are dead and not worth saving */
+  int altscreen_active = screen->buffer == screen->buffers[BUFIDX_ALTSCREEN];
+  vterm_checkpoint_put_int(w, altscreen_active);
+  vterm_checkpoint_put_int(w, 1);
+  checkpoint_buffer(screen, screen->buffers[BUFIDX_PRIMARY], w);
+  vterm_checkpoint_put_int(w, altscreen_active);
+  if(altscreen_active)
+    checkpoint_buffer(screen, screen->buffers[BUFIDX_ALTSCREEN], w);
+}
+
+static int screen_restore(VTermScreen *screen, VTermCheckpointReader *r)
+{
+  screen->global_reverse = vterm_checkpoint_get_int(r);
+  vterm_checkpoint_get_color(r, &screen->pen.fg);
+  vterm_checkpoint_get_color(r, &screen->pen.bg);
+  unpack_screenpen(&screen->pen, vterm_checkpoint_get_int(r));
+
+  int altscreen_active = vterm_checkpoint_get_int(r);
+  for(int bufidx = BUFIDX_PRIMARY; bufidx <= BUFIDX_ALTSCREEN; bufidx++) {
+    if(!vterm_checkpoint_get_int(r)) {
+      if(bufidx == BUFIDX_PRIMARY || altscreen_active)
+        return 0;
+      if(screen->buffers[bufidx])
+        for(int i = 0; i < screen->rows * screen->cols; i++)
+          clearcell(screen, &screen->buffers[bufidx][i]);
+      continue;
+    }
+    if(!screen->buffers[bufidx])
+      screen->buffers[bufidx] = alloc_buffer(screen, screen->rows, screen->cols);
+    if(!restore_buffer(screen, screen->buffers[bufidx], r))
+      return 0;
+  }
+
+  screen->buffer = screen->buffers[altscreen_active ? BUFIDX_ALTSCREEN : BUFIDX_PRIMARY];
+
+  return !r->error;
+}
+
+size_t vterm_screen_checkpoint(const VTermScreen *screen, void *buf, size_t len)
+{
+  VTermCheckpointWriter w = {
+    .buf = buf,
+    .len = len,
+    .pos = CHECKPOINT_HEADER_SIZE,
+  };
+
+  vterm_parser_checkpoint(screen->vt, &w);
+  vterm_state_checkpoint(screen->state, &w);
+  screen_checkpoint(screen, &w);
+
+  if(w.pos > len || w.pos - CHECKPOINT_HEADER_SIZE > UINT32_MAX)
+    return w.pos;
+
+  uint32_t header[HDR_WORDS] = {
+    [HDR_MAGIC]     = CHECKPOINT_MAGIC,
+    [HDR_VERSION]   = VTERM_CHECKPOINT_VERSION,
+    [HDR_BYTEORDER] = CHECKPOINT_BYTEORDER,
+    [HDR_ROWS]      = screen->rows,
+    [HDR_COLS]      = screen->cols,
+    [HDR_PAYLOAD]   = w.pos - CHECKPOINT_HEADER_SIZE,
+    [HDR_CHECKSUM]  = checkpoint_checksum(w.buf + CHECKPOINT_HEADER_SIZE, w.pos - CHECKPOINT_HEADER_SIZE),
+  };
+  memcpy(buf, header, CHECKPOINT_HEADER_SIZE);
+
+  return w.pos;
+}
+
+static int read_header(const void *buf, size_t len, uint32_t header[HDR_WORDS])
+{
+  if(len < CHECKPOINT_HEADER_SIZE)
+    return 0;
+  memcpy(header, buf, CHECKPOINT_HEADER_SIZE);
+
+  return header[HDR_MAGIC] == CHECKPOINT_MAGIC &&
+         header[HDR_VERSION] == VTERM_CHECKPOINT_VERSION &&
+         header[HDR_BYTEORDER] == CHECKPOINT_BYTEORDER &&
+         header[HDR_PAYLOAD] == len - CHECKPOINT_HEADER_SIZE;
+}
+
+int vterm_screen_checkpoint_size(const void *buf, size_t len, int *rowsp, int *colsp)
+{
+  uint32_t header[HDR_WORDS];
+  if(!read_header(buf, len, header))
+    return 0;
+
+  if(rowsp)
+    *rowsp = header[HDR_ROWS];
+  if(colsp)
+    *colsp = header[HDR_COLS];
+  return 1;
+}
+
+static int check_payload(const void *buf, size_t len, uint32_t header[HDR_WORDS])
+{
+  if(!read_header(buf, len, header) ||
+     checkpoint_checksum((const unsigned char *)buf + CHECKPOINT_HEADER_SIZE,
+                         header[HDR_PAYLOAD]) != header[HDR_CHECKSUM])
+    return 0;
+
+  /* Every cell takes at least 8 bytes, which bounds what a forged header
+   * can make the caller allocate */
+  uint64_t rows = header[HDR_ROWS], cols = header[HDR_COLS];
+  return rows > 0 && rows <= INT_MAX && cols > 0 && cols <= INT_MAX &&
+         rows * cols <= header[HDR_PAYLOAD] / 8;
+}
+
+static int restore_sections(VTermScreen *screen, const void *buf, size_t len)
+{
+  VTermCheckpointReader r = {
+    .buf = (const unsigned char *)buf + CHECKPOINT_HEADER_SIZE,
+    .len = len - CHECKPOINT_HEADER_SIZE,
+  };
+
+  return vterm_parser_restore(screen->vt, &r) &&
+         vterm_state_restore(screen->state, &r) &&
+         screen_restore(screen, &r) &&
+         r.pos == r.len;
+}
+
+int vterm_screen_checkpoint_validate(const void *buf, size_t len, int *rowsp, int *colsp)
+{
+  uint32_t header[HDR_WORDS];
+  if(!check_payload(buf, len, header))
+    return 0;
+
+  /* The checksum only catches accidental damage. Decode into a scratch
+   * terminal too, so a blob with forged fields is refused before the
+   * caller resizes or resets anything */
+  VTerm *vt = vterm_new(header[HDR_ROWS], header[HDR_COLS]);
+  if(!vt)
+    return 0;
+  VTermScreen *scratch = vterm_obtain_screen(vt);
+  vterm_screen_reset(scratch, 1);
+  int ok = restore_sections(scratch, buf, len);
+  vterm_free(vt);
+  if(!ok)
+    return 0;
+
+  if(rowsp)
+    *rowsp = header[HDR_ROWS];
+  if(colsp)
+    *colsp = header[HDR_COLS];
+  return 1;
+}
+
+int vterm_screen_restore(VTermScreen *screen, const void *buf, size_t len)
+{
+  uint32_t header[HDR_WORDS];
+  if(!check_payload(buf, len, header) ||
+     (int)header[HDR_ROWS] != screen->rows || (int)header[HDR_COLS] != screen->cols)
+    return 0;
+
+  /* Fields are only range-checked while they are read, so a blob that
+   * vterm_screen_checkpoint_validate() would refuse can fail half way;
+   * don't leave a half-restored terminal behind */
+  if(!restore_sections(screen, buf, len)) {
+    screen->vt->parser.state = NORMAL;
+    vterm_screen_reset(screen, 1);
+    return 0;
+  }
+
+  screen->damaged.start_row = -1;
+  screen->pending_scrollrect.start_row = -1;
+  damagescreen(screen);
+  vterm_screen_flush_damage(screen);
+
+  VTermState *state = screen->state;
+  movecursor(state->pos, state->pos, state->mode.cursor_visible, screen);
+
+  return 1;
+}
@@ -1517,8 +1517,8 @@ static int on_csi(const char *leader, const long args[], int argcount, const cha
     else
       UBOUND(state->scrollregion_right, state->cols);
 
-    if(state->scrollregion_right > -1 &&
-       state->scrollregion_right <= state->scrollregion_left) {
+    if((state->scrollregion_right > -1 ? state->scrollregion_right : state->cols) <=
+       state->scrollregion_left) {
       // Invalid
       state->scrollregion_left  = 0;
       state->scrollregion_right = -1;
@@ -2012,6 +2012,27 @@ static int on_resize(int rows, int cols, void *user)
   if(state->scrollregion_right > -1)
     UBOUND(state->scrollregion_right, state->cols);
 
+  /* Keep every position inside the new grid so a checkpoint of a live
+   * terminal always passes vterm_state_restore()'s range checks. A margin
+   * left empty by the shrink is dropped, as DECSTBM would refuse it */
+  if(state->scrollregion_top >= SCROLLREGION_BOTTOM(state)) {
+    state->scrollregion_top = 0;
+    state->scrollregion_bottom = -1;
+  }
+  if(state->scrollregion_left >= (state->scrollregion_right > -1 ? state->scrollregion_right : state->cols)) {
+    state->scrollregion_left = 0;
+    state->scrollregion_right = -1;
+  }
+  UBOUND(state->saved.pos.row, rows - 1);
+  UBOUND(state->saved.pos.col, cols - 1);
+  UBOUND(state->mouse_row, rows - 1);
+  UBOUND(state->mouse_col, cols - 1);
+  if(state->combine_pos.row >= rows || state->combine_pos.col >= cols) {
+    state->combine_chars[0] = 0;
+    state->combine_pos.row = 0;
+    state->combine_pos.col = 0;
+  }
+
   VTermStateFields fields = {
     .pos       = state->pos,
     .lineinfos = { [0] = state->lineinfos[0], [1] = state->lineinfos[1] },
@@ -2378,3 +2399,288 @@ void vterm_state_send_selection(VTermState *state, VTermSelectionMask mask, VTer
       vterm_push_output_sprintf_str(vt, 0, true, "");
   }
 }
+
+static uint32_t pack_pen(const struct VTermPen *pen)
+{
+  return pen->bold           |
+         pen->underline << 1 |
+         pen->italic    << 3 |
+         pen->blink     << 4 |
+         pen->reverse   << 5 |
+         pen->conceal   << 6 |
+         pen->strike    << 7 |
+         pen->font      << 8 |
+         pen->small     << 12 |
+         pen->baseline  << 13;
+}
+
+static void unpack_pen(struct VTermPen *pen, uint32_t bits)
+{
+  pen->bold      = bits;
+  pen->underline = bits >> 1;
+  pen->italic    = bits >> 3;
+  pen->blink     = bits >> 4;
+  pen->reverse   = bits >> 5;
+  pen->conceal   = bits >> 6;
+  pen->strike    = bits >> 7;
+  pen->font      = bits >> 8;
+  pen->small     = bits >> 12;
+  pen->baseline  = bits >> 13;
+}
+
+static void put_pen(VTermCheckpointWriter *w, const struct VTermPen *pen)
+{
+  vterm_checkpoint_put_color(w, &pen->fg);
+  vterm_checkpoint_put_color(w, &pen->bg);
+  vterm_checkpoint_put_int(w, pack_pen(pen));
+}
+
+static void get_pen(VTermCheckpointReader *r, struct VTermPen *pen)
+{
+  vterm_checkpoint_get_color(r, &pen->fg);
+  vterm_checkpoint_get_color(r, &pen->bg);
+  unpack_pen(pen, vterm_checkpoint_get_int(r));
+}
+
+static void put_encoding(VTermCheckpointWriter *w, const VTermEncodingInstance *encoding)
+{
+  VTermEncodingType type = 0;
+  char designation = 0;
+  if(encoding->enc)
+    vterm_lookup_designation(encoding->enc, &type, &designation);
+  vterm_checkpoint_put_int(w, type);
+  vterm_checkpoint_put_int(w, designation);
+  vterm_checkpoint_put(w, encoding->data, sizeof(encoding->data));
+}
+
+static int get_encoding(VTermCheckpointReader *r, VTermEncodingInstance *encoding)
+{
+  VTermEncodingType type = vterm_checkpoint_get_int(r);
+  char designation = vterm_checkpoint_get_int(r);
+  vterm_checkpoint_get(r, encoding->data, sizeof(encoding->data));
+  encoding->enc = designation ? vterm_lookup_encoding(type, designation) : NULL;
+  return !designation || encoding->enc;
+}
+
+INTERNAL void vterm_state_checkpoint(const VTermState *state, VTermCheckpointWriter *w)
+{
+  vterm_checkpoint_put_int(w, state->rows);
+  vterm_checkpoint_put_int(w, state->cols);
+
+  vterm_checkpoint_put_int(w, state->pos.row);
+  vterm_checkpoint_put_int(w, state->pos.col);
+  vterm_checkpoint_put_int(w, state->at_phantom);
+
+  vterm_checkpoint_put_int(w, state->scrollregion_top);
+  vterm_checkpoint_put_int(w, state->scrollregion_bottom);
+  vterm_checkpoint_put_int(w, state->scrollregion_left);
+  vterm_checkpoint_put_int(w, state->scrollregion_right);
+
+  vterm_checkpoint_put(w, state->tabstops, (state->cols + 7) / 8);
+
+  for(int bufidx = BUFIDX_PRIMARY; bufidx <= BUFIDX_ALTSCREEN; bufidx++) {
+    const VTermLineInfo *lineinfo = state->lineinfos[bufidx];
+    vterm_checkpoint_put_int(w, lineinfo != NULL);
+    if(!lineinfo)
+      continue;
+    for(int row = 0; row < state->rows; row++) {
+      unsigned char bits = lineinfo[row].doublewidth |
+                           lineinfo[row].doubleheight << 1 |
+                           lineinfo[row].continuation << 3;
+      vterm_checkpoint_put(w, &bits, 1);
+    }
+  }
+
+  vterm_checkpoint_put_int(w, state->mouse_col);
+  vterm_checkpoint_put_int(w, state->mouse_row);
+  vterm_checkpoint_put_int(w, state->mouse_buttons);
+  vterm_checkpoint_put_int(w, state->mouse_flags);
+  vterm_checkpoint_put_int(w, state->mouse_protocol);
+
+  int ncombine = 0;
+  while((size_t)ncombine < state->combine_chars_size && state->combine_chars[ncombine])
+    ncombine++;
+  vterm_checkpoint_put_int(w, ncombine);
+  vterm_checkpoint_put(w, state->combine_chars, ncombine * sizeof(state->combine_chars[0]));
+  vterm_checkpoint_put_int(w, state->combine_width);
+  vterm_checkpoint_put_int(w, state->combine_pos.row);
+  vterm_checkpoint_put_int(w, state->combine_pos.col);
+
+  vterm_checkpoint_put_int(w, state->mode.keypad                |
+                              state->mode.cursor          << 1  |
+                              state->mode.autowrap        << 2  |
+                              state->mode.insert          << 3  |
+                              state->mode.newline         << 4  |
+                              state->mode.cursor_visible  << 5  |
+                              state->mode.cursor_blink    << 6  |
+                              state->mode.cursor_shape    << 7  |
+                              state->mode.alt_screen      << 9  |
+                              state->mode.origin          << 10 |
+                              state->mode.screen          << 11 |
+                              state->mode.leftrightmargin << 12 |
+                              state->mode.bracketpaste    << 13 |
+                              state->mode.report_focus    << 14);
+
+  for(int i = 0; i < 4; i++)
+    put_encoding(w, &state->encoding[i]);
+  put_encoding(w, &state->encoding_utf8);
+  vterm_checkpoint_put_int(w, state->gl_set);
+  vterm_checkpoint_put_int(w, state->gr_set);
+  vterm_checkpoint_put_int(w, state->gsingle_set);
+
+  put_pen(w, &state->pen);
+  vterm_checkpoint_put_color(w, &state->default_fg);
+  vterm_checkpoint_put_color(w, &state->default_bg);
+  for(int i = 0; i < 16; i++)
+    vterm_checkpoint_put_color(w, &state->colors[i]);
+  vterm_checkpoint_put_int(w, state->bold_is_highbright);
+  vterm_checkpoint_put_int(w, state->protected_cell);
+
+  vterm_checkpoint_put_int(w, state->saved.pos.row);
+  vterm_checkpoint_put_int(w, state->saved.pos.col);
+  put_pen(w, &state->saved.pen);
+  vterm_checkpoint_put_int(w, state->saved.mode.cursor_visible     |
+                              state->saved.mode.cursor_blink << 1 |
+                              state->saved.mode.cursor_shape << 2);
+
+  /* DECRQSS / OSC 52 scratch belongs to a string the parser may be inside */
+  vterm_checkpoint_put_int(w, sizeof(state->tmp));
+  vterm_checkpoint_put(w, &state->tmp, sizeof(state->tmp));
+}
+
+static int pos_in_grid(const VTermState *state, VTermPos pos)
+{
+  return pos.row >= 0 && pos.row < state->rows &&
+         pos.col >= 0 && pos.col < state->cols;
+}
+
+/* first is inclusive, end exclusive or -1 for the edge of the screen */
+static int margins_valid(int first, int end, int size)
+{
+  return first >= 0 && first < size &&
+         (end == -1 || (end > first && end <= size));
+}
+
+INTERNAL int vterm_state_restore(VTermState *state, VTermCheckpointReader *r)
+{
+  if(vterm_checkpoint_get_int(r) != state->rows ||
+     vterm_checkpoint_get_int(r) != state->cols)
+    return 0;
+
+  state->pos.row    = vterm_checkpoint_get_int(r);
+  state->pos.col    = vterm_checkpoint_get_int(r);
+  state->at_phantom = vterm_checkpoint_get_int(r);
+
+  state->scrollregion_top    = vterm_checkpoint_get_int(r);
+  state->scrollregion_bottom = vterm_checkpoint_get_int(r);
+  state->scrollregion_left   = vterm_checkpoint_get_int(r);
+  state->scrollregion_right  = vterm_checkpoint_get_int(r);
+
+  vterm_checkpoint_get(r, state->tabstops, (state->cols + 7) / 8);
+
+  for(int bufidx = BUFIDX_PRIMARY; bufidx <= BUFIDX_ALTSCREEN; bufidx++) {
+    if(!vterm_checkpoint_get_int(r)) {
+      if(state->lineinfos[bufidx])
+        memset(state->lineinfos[bufidx], 0, state->rows * sizeof(VTermLineInfo));
+      continue;
+    }
+    if(!state->lineinfos[bufidx])
+      state->lineinfos[bufidx] = vterm_allocator_malloc(state->vt, state->rows * sizeof(VTermLineInfo));
+    VTermLineInfo *lineinfo = state->lineinfos[bufidx];
+    for(int row = 0; row < state->rows; row++) {
+      unsigned char bits;
+      vterm_checkpoint_get(r, &bits, 1);
+      lineinfo[row] = (VTermLineInfo){
+        .doublewidth  = bits,
+        .doubleheight = bits >> 1,
+        .continuation = bits >> 3,
+      };
+    }
+  }
+
+  state->mouse_col      = vterm_checkpoint_get_int(r);
+  state->mouse_row      = vterm_checkpoint_get_int(r);
+  state->mouse_buttons  = vterm_checkpoint_get_int(r);
+  state->mouse_flags    = vterm_checkpoint_get_int(r);
+  state->mouse_protocol = vterm_checkpoint_get_int(r);
+
+  int ncombine = vterm_checkpoint_get_int(r);
+  if(ncombine < 0 || (size_t)ncombine > r->len - r->pos)
+    return 0;
+  if((size_t)ncombine >= state->combine_chars_size) {
+    vterm_allocator_free(state->vt, state->combine_chars);
+    state->combine_chars_size = ncombine + 1;
+    state->combine_chars = vterm_allocator_malloc(state->vt, state->combine_chars_size * sizeof(state->combine_chars[0]));
+  }
+  vterm_checkpoint_get(r, state->combine_chars, ncombine * sizeof(state->combine_chars[0]));
+  state->combine_chars[ncombine] = 0;
+  state->combine_width   = vterm_checkpoint_get_int(r);
+  state->combine_pos.row = vterm_checkpoint_get_int(r);
+  state->combine_pos.col = vterm_checkpoint_get_int(r);
+
+  uint32_t mode = vterm_checkpoint_get_int(r);
+  state->mode.keypad          = mode;
+  state->mode.cursor          = mode >> 1;
+  state->mode.autowrap        = mode >> 2;
+  state->mode.insert          = mode >> 3;
+  state->mode.newline         = mode >> 4;
+  state->mode.cursor_visible  = mode >> 5;
+  state->mode.cursor_blink    = mode >> 6;
+  state->mode.cursor_shape    = mode >> 7;
+  state->mode.alt_screen      = mode >> 9;
+  state->mode.origin          = mode >> 10;
+  state->mode.screen          = mode >> 11;
+  state->mode.leftrightmargin = mode >> 12;
+  state->mode.bracketpaste    = mode >> 13;
+  state->mode.report_focus    = mode >> 14;
+
+  for(int i = 0; i < 4; i++)
+    if(!get_encoding(r, &state->encoding[i]))
+      return 0;
+  if(!get_encoding(r, &state->encoding_utf8) || !state->encoding_utf8.enc)
+    return 0;
+  state->gl_set      = vterm_checkpoint_get_int(r);
+  state->gr_set      = vterm_checkpoint_get_int(r);
+  state->gsingle_set = vterm_checkpoint_get_int(r);
+  if(state->gl_set < 0 || state->gl_set > 3 ||
+     state->gr_set < 0 || state->gr_set > 3 ||
+     state->gsingle_set < 0 || state->gsingle_set > 3)
+    return 0;
+
+  get_pen(r, &state->pen);
+  vterm_checkpoint_get_color(r, &state->default_fg);
+  vterm_checkpoint_get_color(r, &state->default_bg);
+  for(int i = 0; i < 16; i++)
+    vterm_checkpoint_get_color(r, &state->colors[i]);
+  state->bold_is_highbright = vterm_checkpoint_get_int(r);
+  state->protected_cell     = vterm_checkpoint_get_int(r);
+
+  state->saved.pos.row = vterm_checkpoint_get_int(r);
+  state->saved.pos.col = vterm_checkpoint_get_int(r);
+  get_pen(r, &state->saved.pen);
+  uint32_t savedmode = vterm_checkpoint_get_int(r);
+  state->saved.mode.cursor_visible = savedmode;
+  state->saved.mode.cursor_blink   = savedmode >> 1;
+  state->saved.mode.cursor_shape   = savedmode >> 2;
+
+  if(vterm_checkpoint_get_int(r) != sizeof(state->tmp))
+    return 0;
+  vterm_checkpoint_get(r, &state->tmp, sizeof(state->tmp));
+
+  if(state->mode.alt_screen && !state->lineinfos[BUFIDX_ALTSCREEN])
+    return 0;
+  state->lineinfo = state->lineinfos[state->mode.alt_screen ? BUFIDX_ALTSCREEN : BUFIDX_PRIMARY];
+
+  /* The checksum only catches accidental damage; anything that indexes the
+   * grid must be inside it, or the next scroll or print writes out of bounds */
+  if(!pos_in_grid(state, state->pos) ||
+     !pos_in_grid(state, state->saved.pos) ||
+     !pos_in_grid(state, state->combine_pos) ||
+     state->mouse_row < 0 || state->mouse_row >= state->rows ||
+     state->mouse_col < 0 || state->mouse_col >= state->cols ||
+     !margins_valid(state->scrollregion_top, state->scrollregion_bottom, state->rows) ||
+     !margins_valid(state->scrollregion_left, state->scrollregion_right, state->cols))
+    return 0;
+
+  return !r->error;
+}
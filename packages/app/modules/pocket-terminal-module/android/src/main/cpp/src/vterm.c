@@ -412,6 +412,62 @@ void vterm_copy_cells(VTermRect dest,
     }
 }
 
+INTERNAL void vterm_checkpoint_put(VTermCheckpointWriter *w, const void *data, size_t len)
+{
+  if(w->pos + len <= w->len)
+    memcpy(w->buf + w->pos, data, len);
+  w->pos += len;
+}
+
+INTERNAL void vterm_checkpoint_put_int(VTermCheckpointWriter *w, int32_t val)
+{
+  vterm_checkpoint_put(w, &val, sizeof(val));
+}
+
+INTERNAL void vterm_checkpoint_put_color(VTermCheckpointWriter *w, const VTermColor *col)
+{
+  /* Written whole so indexed colours don't carry stale rgb bytes */
+  unsigned char bytes[4] = { col->type, 0, 0, 0 };
+  if(VTERM_COLOR_IS_INDEXED(col))
+    bytes[1] = col->indexed.idx;
+  else {
+    bytes[1] = col->rgb.red;
+    bytes[2] = col->rgb.green;
+    bytes[3] = col->rgb.blue;
+  }
+  vterm_checkpoint_put(w, bytes, sizeof(bytes));
+}
+
+INTERNAL void vterm_checkpoint_get(VTermCheckpointReader *r, void *data, size_t len)
+{
+  if(r->error || len > r->len - r->pos) {
+    r->error = 1;
+    memset(data, 0, len);
+    return;
+  }
+  memcpy(data, r->buf + r->pos, len);
+  r->pos += len;
+}
+
+INTERNAL int32_t vterm_checkpoint_get_int(VTermCheckpointReader *r)
+{
+  int32_t val;
+  vterm_checkpoint_get(r, &val, sizeof(val));
+  return val;
+}
+
+INTERNAL void vterm_checkpoint_get_color(VTermCheckpointReader *r, VTermColor *col)
+{
+  unsigned char bytes[4];
+  vterm_checkpoint_get(r, bytes, sizeof(bytes));
+  if((bytes[0] & VTERM_COLOR_TYPE_MASK) == VTERM_COLOR_INDEXED)
+    vterm_color_indexed(col, bytes[1]);
+  else
+    vterm_color_rgb(col, bytes[1], bytes[2], bytes[3]);
+  /* Keep the DEFAULT_FG/BG flags */
+  col->type = bytes[0];
+}
+
 void vterm_check_version(int major, int minor)
 {
   if(major != VTERM_VERSION_MAJOR) {
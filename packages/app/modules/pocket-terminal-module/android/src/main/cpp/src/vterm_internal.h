@@ -291,6 +291,40 @@ void vterm_state_push_output_sprintf_CSI(VTermState *vts, const char *format, ..
 void vterm_screen_free(VTermScreen *screen);
 
 VTermEncoding *vterm_lookup_encoding(VTermEncodingType type, char designation);
+int vterm_lookup_designation(const VTermEncoding *enc, VTermEncodingType *type, char *designation);
+
+/* Checkpoint serialization, used by vterm_screen_checkpoint() and
+ * vterm_screen_restore(). Fields are written in host byte order.
+ *
+ * The writer never fails; once pos runs past len it only counts, so a
+ * writer over a short buffer yields the size required. The reader zero-fills
+ * and sets error on overrun, so callers may read a whole section and check
+ * error once at the end.
+ */
+typedef struct {
+  unsigned char *buf;
+  size_t len;
+  size_t pos;
+} VTermCheckpointWriter;
+
+typedef struct {
+  const unsigned char *buf;
+  size_t len;
+  size_t pos;
+  int error;
+} VTermCheckpointReader;
+
+void    vterm_checkpoint_put(VTermCheckpointWriter *w, const void *data, size_t len);
+void    vterm_checkpoint_put_int(VTermCheckpointWriter *w, int32_t val);
+void    vterm_checkpoint_put_color(VTermCheckpointWriter *w, const VTermColor *col);
+void    vterm_checkpoint_get(VTermCheckpointReader *r, void *data, size_t len);
+int32_t vterm_checkpoint_get_int(VTermCheckpointReader *r);
+void    vterm_checkpoint_get_color(VTermCheckpointReader *r, VTermColor *col);
+
+void vterm_parser_checkpoint(const VTerm *vt, VTermCheckpointWriter *w);
+int  vterm_parser_restore(VTerm *vt, VTermCheckpointReader *r);
+void vterm_state_checkpoint(const VTermState *state, VTermCheckpointWriter *w);
+int  vterm_state_restore(VTermState *state, VTermCheckpointReader *r);
 
 int vterm_unicode_width(uint32_t codepoint);
 int vterm_unicode_is_combining(uint32_t codepoint);
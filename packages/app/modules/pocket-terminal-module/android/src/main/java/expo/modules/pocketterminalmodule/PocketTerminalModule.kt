@@ -3,6 +3,7 @@ package expo.modules.pocketterminalmodule
 import expo.modules.kotlin.modules.Module
 import expo.modules.kotlin.modules.ModuleDefinition
 import com.facebook.react.bridge.ReactApplicationContext
+import com.facebook.react.turbomodule.core.CallInvokerHolderImpl
 import java.net.URL
 import java.io.File
 import java.io.FileOutputStream
@@ -17,9 +18,17 @@ class PocketTerminalModule : Module() {
     init {
       System.loadLibrary("pocket_terminal_module")
     }
+
+    /**
+     * 把只读的终端帧访问器 (global.getTerminalFrame / getTerminalSessions)
+     * 装进另一个 JS 运行时，例如 Reanimated / Skia 的 UI 线程 worklet 运行时。
+     * 必须在该运行时所属的线程上调用；jsiPtr 为 jsi::Runtime 指针。
+     */
+    @JvmStatic
+    external fun installFrameAccessor(jsiPtr: Long)
   }
 
-  private external fun installJSI(jsiPtr: Long)
+  private external fun installJSI(jsiPtr: Long, callInvokerHolder: CallInvokerHolderImpl?)
 
   // ── Background process management ──────────────────────────────────────────
   private val bgProcesses = ConcurrentHashMap<Int, Process>()
@@ -36,7 +45,9 @@ class PocketTerminalModule : Module() {
     Function("install") {
       val reactCtx = appContext.reactContext as? ReactApplicationContext
       val jsiPtr = reactCtx?.javaScriptContextHolder?.get() ?: 0L
-      if (jsiPtr != 0L) { installJSI(jsiPtr); true } else { false }
+      // CallInvoker 用于把 execNative 的结果从原生 I/O 线程送回 JS 线程
+      val callInvoker = reactCtx?.jsCallInvokerHolder as? CallInvokerHolderImpl
+      if (jsiPtr != 0L) { installJSI(jsiPtr, callInvoker); true } else { false }
     }
 
     // 暴露原生库路径（保留接口）
@@ -0,0 +1,302 @@
+#include "automation_driver.h"
+#include <algorithm>
+#include <cerrno>
+
+namespace pocket {
+namespace terminal {
+
+// 等待匹配的输出窗口上限；超出后丢弃最旧的部分
+static const size_t kMaxPendingText = 64 * 1024;
+// 随结果返回的最近输出
+static const size_t kRecentBytes = 4096;
+
+// ============== AutomationTask ==============
+
+AutomationTask &AutomationTask::operator=(AutomationTask &&other) noexcept {
+  if (this != &other) {
+    if (m_handle)
+      m_handle.destroy();
+    m_handle = std::exchange(other.m_handle, nullptr);
+  }
+  return *this;
+}
+
+AutomationTask::~AutomationTask() {
+  if (m_handle)
+    m_handle.destroy();
+}
+
+// ============== Automation ==============
+
+Automation::Automation(PocketTerminal &terminal, Script script,
+                       Completion completion)
+    : m_terminal(terminal), m_script(std::move(script)),
+      m_completion(std::move(completion)) {}
+
+bool Automation::start(PocketTerminal &terminal, Script script,
+                       Completion completion) {
+  std::shared_ptr<Automation> automation(
+      new Automation(terminal, std::move(script), std::move(completion)));
+  return terminal.setOutputObserver(
+      [automation](ObserverEvent event, const char *data, size_t len) {
+        return automation->onEvent(event, data, len);
+      });
+}
+
+int Automation::onEvent(ObserverEvent event, const char *data, size_t len) {
+  if (m_done)
+    return -1;
+
+  if (event == ObserverEvent::Output) {
+    appendOutput(data, len);
+    m_lastOutput = Clock::now();
+  } else if (event == ObserverEvent::Closed) {
+    m_closed = true;
+  }
+
+  if (!m_started) {
+    // 首次回调 (安装后的 Tick) 时才创建协程，脚本从头到尾都在读线程上
+    m_started = true;
+    m_startTime = Clock::now();
+    m_lastOutput = m_startTime;
+    m_task = m_script(*this);
+    m_waiter = m_task.handle();
+  }
+
+  if (m_waiter && checkWait())
+    resumeWaiter();
+
+  if (m_task.handle().done() || m_closed)
+    finish();
+  return m_done ? -1 : nextTickMs();
+}
+
+void Automation::appendOutput(const char *data, size_t len) {
+  size_t begin = m_text.size();
+  for (size_t i = 0; i < len; ++i) {
+    unsigned char c = static_cast<unsigned char>(data[i]);
+    switch (m_escState) {
+    case EscState::Normal:
+      if (c == 0x1b)
+        m_escState = EscState::Esc;
+      else if (c == '\n' || c == '\t' || (c >= 0x20 && c != 0x7f))
+        m_text.push_back(static_cast<char>(c));
+      break;
+    case EscState::Esc:
+      if (c == '[')
+        m_escState = EscState::Csi;
+      else if (c == ']' || c == 'P' || c == '_' || c == '^' || c == 'X')
+        m_escState = EscState::Str;
+      else if (c < 0x20 || c > 0x2f) // 0x20-0x2f 为中间字节，如 ESC ( B
+        m_escState = EscState::Normal;
+      break;
+    case EscState::Csi:
+      if (c >= 0x40 && c <= 0x7e)
+        m_escState = EscState::Normal;
+      break;
+    case EscState::Str:
+      if (c == 0x07)
+        m_escState = EscState::Normal;
+      else if (c == 0x1b)
+        m_escState = EscState::StrEsc;
+      break;
+    case EscState::StrEsc:
+      m_escState = c == '\\' ? EscState::Normal : EscState::Str;
+      break;
+    }
+  }
+
+  m_recent.append(m_text, begin, std::string::npos);
+  if (m_recent.size() > kRecentBytes)
+    m_recent.erase(0, m_recent.size() - kRecentBytes);
+  if (m_text.size() > kMaxPendingText)
+    m_text.erase(0, m_text.size() - kMaxPendingText);
+}
+
+bool Automation::tryMatch() {
+  if (m_regex) {
+    std::smatch match;
+    if (!std::regex_search(m_text, match, *m_regex))
+      return false;
+    m_match.matched = true;
+    m_match.text = match.str(0);
+    for (size_t i = 1; i < match.size(); ++i)
+      m_match.groups.push_back(match.str(i));
+    m_text.erase(0, match.position(0) + match.length(0));
+    return true;
+  }
+
+  size_t pos = m_text.find(m_pattern);
+  if (pos == std::string::npos)
+    return false;
+  m_match.matched = true;
+  m_match.text = m_pattern;
+  m_text.erase(0, pos + m_pattern.size());
+  return true;
+}
+
+// 当前等待是否已有结论 (满足、超时或终端关闭)
+bool Automation::checkWait() {
+  Clock::time_point now = Clock::now();
+  switch (m_wait) {
+  case WaitKind::None:
+    return true;
+  case WaitKind::Expect:
+    if (tryMatch())
+      break;
+    if (m_closed)
+      fail("terminal closed");
+    else if (now < m_deadline)
+      return false;
+    m_match = ExpectMatch{};
+    break;
+  case WaitKind::Settled:
+    if (now - std::max(m_lastOutput, m_waitStart) >= m_quiet) {
+      m_settledOk = true;
+      break;
+    }
+    if (m_closed)
+      fail("terminal closed");
+    else if (now < m_deadline)
+      return false;
+    m_settledOk = false;
+    break;
+  }
+  m_wait = WaitKind::None;
+  return true;
+}
+
+void Automation::resumeWaiter() {
+  std::coroutine_handle<> waiter = std::exchange(m_waiter, nullptr);
+  waiter.resume();
+}
+
+int Automation::nextTickMs() const {
+  if (m_wait == WaitKind::None)
+    return -1;
+  Clock::time_point at = m_deadline;
+  if (m_wait == WaitKind::Settled)
+    at = std::min(at, std::max(m_lastOutput, m_waitStart) + m_quiet);
+  if (at == Clock::time_point::max())
+    return -1;
+  auto ms = std::chrono::ceil<std::chrono::milliseconds>(at - Clock::now());
+  return static_cast<int>(std::max<int64_t>(ms.count(), 0));
+}
+
+Automation::ExpectAwaiter Automation::expect(std::string pattern,
+                                             int timeoutMs, bool regex) {
+  Clock::time_point now = Clock::now();
+  m_wait = WaitKind::Expect;
+  m_pattern = std::move(pattern);
+  m_regex.reset();
+  m_match = ExpectMatch{};
+  m_waitStart = now;
+  m_deadline = timeoutMs > 0 ? now + std::chrono::milliseconds(timeoutMs)
+                             : Clock::time_point::max();
+  if (regex) {
+    try {
+      m_regex.emplace(m_pattern, std::regex::ECMAScript);
+    } catch (const std::regex_error &) {
+      fail("invalid regex: " + m_pattern);
+      m_wait = WaitKind::None;
+    }
+  }
+  return ExpectAwaiter(*this);
+}
+
+Automation::SettledAwaiter Automation::settled(int quietMs, int timeoutMs) {
+  Clock::time_point now = Clock::now();
+  m_wait = WaitKind::Settled;
+  m_quiet = std::chrono::milliseconds(std::max(quietMs, 0));
+  m_waitStart = now;
+  m_deadline = timeoutMs > 0 ? now + std::chrono::milliseconds(timeoutMs)
+                             : Clock::time_point::max();
+  m_settledOk = false;
+  return SettledAwaiter(*this);
+}
+
+bool Automation::send(std::string_view bytes) {
+  while (!bytes.empty()) {
+    ssize_t n = static_cast<ssize_t>(
+        m_terminal.writeInput(bytes.data(), bytes.size()));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0) {
+      fail("write to terminal failed");
+      return false;
+    }
+    bytes.remove_prefix(n);
+  }
+  return true;
+}
+
+void Automation::fail(std::string error) {
+  // 只保留第一个错误，后续的多是它的连带结果
+  if (!m_result.error.empty())
+    return;
+  m_result.error = std::move(error);
+  m_result.failedStep = m_step;
+}
+
+void Automation::finish() {
+  m_done = true;
+  if (m_task.handle() && m_task.handle().done()) {
+    if (std::exception_ptr exception = m_task.handle().promise().exception) {
+      try {
+        std::rethrow_exception(exception);
+      } catch (const std::exception &e) {
+        fail(std::string("script threw: ") + e.what());
+      } catch (...) {
+        fail("script threw");
+      }
+    }
+  } else {
+    fail("terminal closed");
+  }
+
+  m_result.ok = m_result.error.empty();
+  m_result.output = m_recent;
+  m_result.durationMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            Clock::now() - m_startTime)
+                            .count();
+  // 先卸载观察者，completion 触发的下一个脚本才能安装
+  m_terminal.setOutputObserver(nullptr);
+  if (m_completion)
+    m_completion(m_result);
+}
+
+// ============== 声明式步骤 ==============
+
+AutomationTask runSteps(Automation &automation,
+                        std::vector<AutomationStep> steps) {
+  for (size_t i = 0; i < steps.size(); ++i) {
+    const AutomationStep &step = steps[i];
+    automation.setStep(static_cast<int>(i));
+    switch (step.kind) {
+    case AutomationStep::Kind::Send:
+      if (!automation.send(step.text))
+        co_return;
+      break;
+    case AutomationStep::Kind::Expect: {
+      ExpectMatch match =
+          co_await automation.expect(step.text, step.timeoutMs, step.regex);
+      if (!match.matched) {
+        automation.fail("timed out waiting for \"" + step.text + "\"");
+        co_return;
+      }
+      automation.recordMatch(std::move(match.text));
+      break;
+    }
+    case AutomationStep::Kind::Settled:
+      if (!co_await automation.settled(step.quietMs, step.timeoutMs)) {
+        automation.fail("output did not settle within " +
+                        std::to_string(step.timeoutMs) + "ms");
+        co_return;
+      }
+      break;
+    }
+  }
+}
+
+} // namespace terminal
+} // namespace pocket
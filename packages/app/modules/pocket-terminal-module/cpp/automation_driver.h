@@ -0,0 +1,200 @@
+#pragma once
+
+#include "pocket_terminal.h"
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace pocket {
+namespace terminal {
+
+class Automation;
+
+/**
+ * 自动化脚本协程的返回类型。创建后先挂起，由 Automation 在 PTY 读线程上
+ * 开始执行；之后每次 co_await 都在读线程上恢复。
+ */
+class AutomationTask {
+public:
+  struct promise_type {
+    std::exception_ptr exception;
+
+    AutomationTask get_return_object() {
+      return AutomationTask(
+          std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { exception = std::current_exception(); }
+  };
+
+  AutomationTask() = default;
+  AutomationTask(AutomationTask &&other) noexcept
+      : m_handle(std::exchange(other.m_handle, nullptr)) {}
+  AutomationTask &operator=(AutomationTask &&other) noexcept;
+  ~AutomationTask();
+
+  AutomationTask(const AutomationTask &) = delete;
+  AutomationTask &operator=(const AutomationTask &) = delete;
+
+  std::coroutine_handle<promise_type> handle() const { return m_handle; }
+
+private:
+  explicit AutomationTask(std::coroutine_handle<promise_type> handle)
+      : m_handle(handle) {}
+
+  std::coroutine_handle<promise_type> m_handle;
+};
+
+struct ExpectMatch {
+  bool matched{false};
+  std::string text;                // 整个匹配
+  std::vector<std::string> groups; // 正则捕获组
+};
+
+struct AutomationResult {
+  bool ok{false};
+  int failedStep{-1};
+  std::string error;
+  // 每个成功的 expect 匹配到的文本，按顺序
+  std::vector<std::string> matches;
+  // 去掉控制序列后的最近输出
+  std::string output;
+  uint64_t durationMs{0};
+};
+
+/**
+ * send / expect 自动化驱动：脚本是 PocketTerminal 上的协程，
+ * 作为 OutputObserver 跑在 PTY 读线程上，输出一到就判断是否匹配，
+ * 不经过 JS 往返，也不靠固定延时猜测 shell 是否就绪。
+ *
+ *   co_await a.expect("$ ", 5000);
+ *   a.send("ls\n");
+ *   co_await a.settled(100, 5000);
+ *
+ * expect 在去掉 CSI / OSC 等控制序列和 CR 的输出流上匹配，匹配成功后
+ * 消费到匹配末尾 (与 Tcl expect 相同)。同一终端同时只能运行一个脚本。
+ */
+class Automation {
+public:
+  using Clock = std::chrono::steady_clock;
+  using Script = std::function<AutomationTask(Automation &automation)>;
+  using Completion = std::function<void(AutomationResult &result)>;
+
+  // 在 terminal 上启动脚本；终端已有观察者时返回 false。
+  // completion 在读线程上调用，terminal 须在完成前保持存活
+  static bool start(PocketTerminal &terminal, Script script,
+                    Completion completion);
+
+  class ExpectAwaiter {
+  public:
+    explicit ExpectAwaiter(Automation &automation) : m_automation(automation) {}
+    bool await_ready() { return m_automation.checkWait(); }
+    void await_suspend(std::coroutine_handle<> handle) {
+      m_automation.m_waiter = handle;
+    }
+    ExpectMatch await_resume() { return std::move(m_automation.m_match); }
+
+  private:
+    Automation &m_automation;
+  };
+
+  class SettledAwaiter {
+  public:
+    explicit SettledAwaiter(Automation &automation)
+        : m_automation(automation) {}
+    bool await_ready() { return m_automation.checkWait(); }
+    void await_suspend(std::coroutine_handle<> handle) {
+      m_automation.m_waiter = handle;
+    }
+    bool await_resume() { return m_automation.m_settledOk; }
+
+  private:
+    Automation &m_automation;
+  };
+
+  // 等待输出中出现 pattern (regex 为 true 时按 ECMAScript 正则)；
+  // timeoutMs <= 0 不限时。超时、终端关闭或正则非法时 matched 为 false
+  ExpectAwaiter expect(std::string pattern, int timeoutMs, bool regex = false);
+
+  // 等待输出静默 quietMs；timeoutMs 内一直有输出则返回 false
+  SettledAwaiter settled(int quietMs, int timeoutMs);
+
+  // 写入 PTY (在读线程上同步写，适合命令行大小的输入)；失败时记录错误
+  bool send(std::string_view bytes);
+
+  // 脚本报告失败；协程随后应 co_return
+  void fail(std::string error);
+  void setStep(int step) { m_step = step; }
+  void recordMatch(std::string text) {
+    m_result.matches.push_back(std::move(text));
+  }
+
+private:
+  enum class WaitKind { None, Expect, Settled };
+
+  Automation(PocketTerminal &terminal, Script script, Completion completion);
+
+  int onEvent(ObserverEvent event, const char *data, size_t len);
+  void appendOutput(const char *data, size_t len);
+  bool checkWait();
+  bool tryMatch();
+  void resumeWaiter();
+  void finish();
+  int nextTickMs() const;
+
+  PocketTerminal &m_terminal;
+  Script m_script;
+  Completion m_completion;
+  AutomationTask m_task;
+  std::coroutine_handle<> m_waiter;
+  bool m_started{false};
+  bool m_done{false};
+  bool m_closed{false};
+  Clock::time_point m_startTime;
+
+  // 当前等待
+  WaitKind m_wait{WaitKind::None};
+  std::string m_pattern;
+  std::optional<std::regex> m_regex;
+  Clock::time_point m_deadline{Clock::time_point::max()};
+  Clock::time_point m_waitStart;
+  std::chrono::milliseconds m_quiet{0};
+  ExpectMatch m_match;
+  bool m_settledOk{false};
+
+  // 去掉控制序列后尚未被 expect 消费的输出
+  std::string m_text;
+  std::string m_recent;
+  Clock::time_point m_lastOutput;
+  enum class EscState { Normal, Esc, Csi, Str, StrEsc } m_escState{
+      EscState::Normal};
+
+  int m_step{-1};
+  AutomationResult m_result;
+};
+
+// 声明式步骤，供 JS 侧描述脚本
+struct AutomationStep {
+  enum class Kind { Send, Expect, Settled } kind{Kind::Send};
+  std::string text; // send 的字节或 expect 的模式
+  bool regex{false};
+  int timeoutMs{10000};
+  int quietMs{100};
+};
+
+// 逐条执行 steps，任一 expect / settled 失败即终止
+AutomationTask runSteps(Automation &automation,
+                        std::vector<AutomationStep> steps);
+
+} // namespace terminal
+} // namespace pocket
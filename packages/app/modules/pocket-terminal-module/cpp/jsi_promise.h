@@ -0,0 +1,30 @@
+#pragma once
+
+#include <functional>
+#include <jsi/jsi.h>
+#include <memory>
+
+namespace pocket {
+namespace terminal {
+
+namespace jsi = facebook::jsi;
+
+// 创建一个 Promise。start 在 JS 线程上同步调用，拿到 resolve 函数；
+// resolve 只能在 JS 线程上调用和析构 (经 CallInvoker::invokeAsync 转回)
+inline jsi::Value
+createPromise(jsi::Runtime &rt,
+              std::function<void(std::shared_ptr<jsi::Value> resolve)> start) {
+  jsi::Function promiseCtor = rt.global().getPropertyAsFunction(rt, "Promise");
+  auto executor = [start = std::move(start)](
+                      jsi::Runtime &runtime, const jsi::Value &,
+                      const jsi::Value *args, size_t) -> jsi::Value {
+    start(std::make_shared<jsi::Value>(runtime, args[0]));
+    return jsi::Value::undefined();
+  };
+  return promiseCtor.callAsConstructor(
+      rt, jsi::Function::createFromHostFunction(
+              rt, jsi::PropNameID::forAscii(rt, "executor"), 2, executor));
+}
+
+} // namespace terminal
+} // namespace pocket
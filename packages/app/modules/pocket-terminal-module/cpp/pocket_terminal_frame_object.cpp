@@ -0,0 +1,165 @@
+#include "pocket_terminal_frame_object.h"
+#include "session_registry.h"
+#include <algorithm>
+#include <cstring>
+
+namespace pocket {
+namespace terminal {
+
+static jsi::Object createArrayBuffer(jsi::Runtime &rt, size_t byteLength) {
+  jsi::Function arrayBufferCtor =
+      rt.global().getPropertyAsFunction(rt, "ArrayBuffer");
+  return arrayBufferCtor.callAsConstructor(rt, static_cast<double>(byteLength))
+      .getObject(rt);
+}
+
+PocketTerminalFrameObject::PocketTerminalFrameObject(
+    std::weak_ptr<PocketTerminal> terminal)
+    : m_terminal(std::move(terminal)) {}
+
+jsi::Value PocketTerminalFrameObject::get(jsi::Runtime &rt,
+                                          const jsi::PropNameID &name) {
+  auto propName = name.utf8(rt);
+
+  if (propName == "isAlive") {
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      return jsi::Value(!m_terminal.expired());
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 0, func);
+  } else if (propName == "getRows" || propName == "getCols" ||
+             propName == "getCursorX" || propName == "getCursorY" ||
+             propName == "getFrameSeq" || propName == "getPaletteVersion") {
+    auto func = [this, propName](jsi::Runtime &rt, const jsi::Value &thisValue,
+                                 const jsi::Value *args,
+                                 size_t count) -> jsi::Value {
+      std::shared_ptr<PocketTerminal> term = m_terminal.lock();
+      if (!term)
+        return jsi::Value(0);
+      if (propName == "getRows")
+        return jsi::Value(term->getRows());
+      if (propName == "getCols")
+        return jsi::Value(term->getCols());
+      if (propName == "getCursorX")
+        return jsi::Value(term->getCursorX());
+      if (propName == "getCursorY")
+        return jsi::Value(term->getCursorY());
+      if (propName == "getFrameSeq")
+        return jsi::Value(static_cast<double>(term->getFrameSeq()));
+      return jsi::Value(static_cast<double>(term->getPaletteVersion()));
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 0, func);
+  } else if (propName == "getBuffer") {
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      std::shared_ptr<PocketTerminal> term = m_terminal.lock();
+      if (!term)
+        return jsi::Value::null();
+      // 尺寸、格子与行号在同一次加锁内取出，一一对应
+      term->snapshot(m_snapshot);
+      size_t byteLength = m_snapshot.cells.size() * sizeof(TerminalCell);
+      jsi::Object arrayBufferObj = createArrayBuffer(rt, byteLength);
+      std::memcpy(arrayBufferObj.getArrayBuffer(rt).data(rt),
+                  m_snapshot.cells.data(), byteLength);
+      jsi::Array lineIds(rt, m_snapshot.lineIds.size());
+      for (size_t i = 0; i < m_snapshot.lineIds.size(); ++i)
+        lineIds.setValueAtIndex(rt, i,
+                                static_cast<double>(m_snapshot.lineIds[i]));
+      jsi::Object result(rt);
+      result.setProperty(rt, "buffer", arrayBufferObj);
+      result.setProperty(rt, "lineIds", lineIds);
+      result.setProperty(rt, "rows", m_snapshot.rows);
+      result.setProperty(rt, "cols", m_snapshot.cols);
+      return result;
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 0, func);
+  } else if (propName == "copyBuffer") {
+    // copyBuffer(target: ArrayBuffer) => 复制的格数。每帧复用同一块缓冲，
+    // UI 线程上不产生垃圾；缓冲不够大时只复制放得下的部分
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      std::shared_ptr<PocketTerminal> term = m_terminal.lock();
+      if (!term || count < 1 || !args[0].isObject() ||
+          !args[0].getObject(rt).isArrayBuffer(rt))
+        return jsi::Value(0);
+      jsi::ArrayBuffer target = args[0].getObject(rt).getArrayBuffer(rt);
+      size_t cells = std::min(target.size(rt) / sizeof(TerminalCell),
+                              static_cast<size_t>(term->getRows()) *
+                                  term->getCols());
+      term->copyBufferOut(reinterpret_cast<TerminalCell *>(target.data(rt)),
+                          cells * sizeof(TerminalCell));
+      return jsi::Value(static_cast<double>(cells));
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 1, func);
+  } else if (propName == "getViewportBuffer") {
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      std::shared_ptr<PocketTerminal> term = m_terminal.lock();
+      if (!term)
+        return jsi::Value::null();
+      std::vector<TerminalCell> cells(static_cast<size_t>(term->getRows()) *
+                                      term->getCols());
+      size_t copied = term->copyViewportOut(
+          cells.data(), cells.size() * sizeof(TerminalCell));
+      size_t byteLength = copied * sizeof(TerminalCell);
+      jsi::Object arrayBufferObj = createArrayBuffer(rt, byteLength);
+      std::memcpy(arrayBufferObj.getArrayBuffer(rt).data(rt), cells.data(),
+                  byteLength);
+      return arrayBufferObj;
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 0, func);
+  } else if (propName == "getPalette") {
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      std::shared_ptr<PocketTerminal> term = m_terminal.lock();
+      if (!term)
+        return jsi::Value::null();
+      ColorPalette palette;
+      term->copyPaletteOut(palette);
+      jsi::Object arrayBufferObj =
+          createArrayBuffer(rt, sizeof(palette.colors));
+      std::memcpy(arrayBufferObj.getArrayBuffer(rt).data(rt), palette.colors,
+                  sizeof(palette.colors));
+      return arrayBufferObj;
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 0, func);
+  }
+
+  return jsi::Value::undefined();
+}
+
+void installFrameAccessor(jsi::Runtime &rt) {
+  // getTerminalFrame(sessionId) => 帧访问器，会话不存在时为 null
+  auto frameFunc = [](jsi::Runtime &runtime, const jsi::Value &thisValue,
+                      const jsi::Value *args, size_t count) -> jsi::Value {
+    if (count < 1 || !args[0].isNumber())
+      return jsi::Value::null();
+    std::shared_ptr<PocketTerminal> term = SessionRegistry::instance().find(
+        static_cast<uint32_t>(args[0].asNumber()));
+    if (!term)
+      return jsi::Value::null();
+    return jsi::Object::createFromHostObject(
+        runtime, std::make_shared<PocketTerminalFrameObject>(term));
+  };
+  rt.global().setProperty(
+      rt, "getTerminalFrame",
+      jsi::Function::createFromHostFunction(
+          rt, jsi::PropNameID::forAscii(rt, "getTerminalFrame"), 1, frameFunc));
+
+  auto sessionsFunc = [](jsi::Runtime &runtime, const jsi::Value &thisValue,
+                         const jsi::Value *args, size_t count) -> jsi::Value {
+    std::vector<uint32_t> ids = SessionRegistry::instance().ids();
+    jsi::Array out(runtime, ids.size());
+    for (size_t i = 0; i < ids.size(); ++i)
+      out.setValueAtIndex(runtime, i, static_cast<double>(ids[i]));
+    return out;
+  };
+  rt.global().setProperty(
+      rt, "getTerminalSessions",
+      jsi::Function::createFromHostFunction(
+          rt, jsi::PropNameID::forAscii(rt, "getTerminalSessions"), 0,
+          sessionsFunc));
+}
+
+} // namespace terminal
+} // namespace pocket
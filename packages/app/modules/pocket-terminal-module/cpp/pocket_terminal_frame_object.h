@@ -0,0 +1,36 @@
+#pragma once
+
+#include "pocket_terminal.h"
+#include <jsi/jsi.h>
+#include <memory>
+
+namespace pocket {
+namespace terminal {
+
+namespace jsi = facebook::jsi;
+
+/**
+ * 只读的帧访问器，可以装进主 JS 运行时以外的运行时 (Reanimated / Skia
+ * 的 UI 线程 worklet 运行时)，JS 线程忙时照样取帧绘制。
+ *
+ * 只持有会话的弱引用：会话注销后各方法返回空值，不延长终端的生命周期。
+ * 没有写入、调整大小等操作，这些仍然只走主运行时的 HostObject
+ */
+class PocketTerminalFrameObject : public jsi::HostObject {
+public:
+  explicit PocketTerminalFrameObject(std::weak_ptr<PocketTerminal> terminal);
+
+  jsi::Value get(jsi::Runtime &rt, const jsi::PropNameID &name) override;
+
+private:
+  std::weak_ptr<PocketTerminal> m_terminal;
+  // getBuffer 的中转快照，每帧复用
+  ScreenSnapshot m_snapshot;
+};
+
+// 在 rt 的 global 上挂载 getTerminalFrame(sessionId) 与 getTerminalSessions()。
+// 调用方保证在 rt 所属的线程上调用，之后也只在那个线程上使用
+void installFrameAccessor(jsi::Runtime &rt);
+
+} // namespace terminal
+} // namespace pocket
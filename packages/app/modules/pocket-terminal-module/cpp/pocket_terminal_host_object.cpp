@@ -1,15 +1,96 @@
 #include "pocket_terminal_host_object.h"
+#include "automation_driver.h"
+#include "jsi_promise.h"
+#include "session_registry.h"
 #include <iostream>
 
 namespace pocket {
 namespace terminal {
 
-PocketTerminalHostObject::PocketTerminalHostObject(int rows, int cols) {
-  m_terminal = std::make_unique<PocketTerminal>(rows, cols);
+PocketTerminalHostObject::PocketTerminalHostObject(
+    int rows, int cols, std::shared_ptr<facebook::react::CallInvoker> callInvoker)
+    : m_callInvoker(std::move(callInvoker)) {
+  m_terminal = std::make_shared<PocketTerminal>(rows, cols);
+  m_sessionId = SessionRegistry::instance().add(m_terminal);
+}
+
+// runScript 的步骤：{ send } | { expect, regex?, timeoutMs? } |
+// { settled: quietMs, timeoutMs? }
+static std::vector<AutomationStep> readSteps(jsi::Runtime &rt,
+                                             const jsi::Value &value) {
+  std::vector<AutomationStep> steps;
+  if (!value.isObject() || !value.getObject(rt).isArray(rt))
+    return steps;
+  jsi::Array array = value.getObject(rt).getArray(rt);
+  for (size_t i = 0; i < array.size(rt); ++i) {
+    jsi::Value item = array.getValueAtIndex(rt, i);
+    if (!item.isObject())
+      continue;
+    jsi::Object obj = item.getObject(rt);
+    AutomationStep step;
+    jsi::Value send = obj.getProperty(rt, "send");
+    jsi::Value expect = obj.getProperty(rt, "expect");
+    jsi::Value settled = obj.getProperty(rt, "settled");
+    if (send.isString()) {
+      step.kind = AutomationStep::Kind::Send;
+      step.text = send.getString(rt).utf8(rt);
+    } else if (expect.isString()) {
+      step.kind = AutomationStep::Kind::Expect;
+      step.text = expect.getString(rt).utf8(rt);
+      jsi::Value regex = obj.getProperty(rt, "regex");
+      step.regex = regex.isBool() && regex.getBool();
+    } else if (settled.isNumber()) {
+      step.kind = AutomationStep::Kind::Settled;
+      step.quietMs = static_cast<int>(settled.asNumber());
+    } else {
+      continue;
+    }
+    jsi::Value timeoutMs = obj.getProperty(rt, "timeoutMs");
+    if (timeoutMs.isNumber())
+      step.timeoutMs = static_cast<int>(timeoutMs.asNumber());
+    steps.push_back(std::move(step));
+  }
+  return steps;
+}
+
+static jsi::Object exportProgressToJs(jsi::Runtime &rt,
+                                      const ExportProgress &progress) {
+  jsi::Object obj(rt);
+  obj.setProperty(rt, "linesDone", static_cast<double>(progress.linesDone));
+  obj.setProperty(rt, "linesTotal", static_cast<double>(progress.linesTotal));
+  obj.setProperty(rt, "linesSkipped",
+                  static_cast<double>(progress.linesSkipped));
+  obj.setProperty(rt, "bytesWritten",
+                  static_cast<double>(progress.bytesWritten));
+  if (progress.done) {
+    obj.setProperty(rt, "ok", progress.error.empty());
+    if (!progress.error.empty())
+      obj.setProperty(rt, "error",
+                      jsi::String::createFromUtf8(rt, progress.error));
+  }
+  return obj;
+}
+
+static jsi::Object automationResultToJs(jsi::Runtime &rt,
+                                        const AutomationResult &result) {
+  jsi::Object obj(rt);
+  obj.setProperty(rt, "ok", result.ok);
+  obj.setProperty(rt, "failedStep", result.failedStep);
+  if (!result.error.empty())
+    obj.setProperty(rt, "error", jsi::String::createFromUtf8(rt, result.error));
+  jsi::Array matches(rt, result.matches.size());
+  for (size_t i = 0; i < result.matches.size(); ++i)
+    matches.setValueAtIndex(rt, i,
+                            jsi::String::createFromUtf8(rt, result.matches[i]));
+  obj.setProperty(rt, "matches", matches);
+  obj.setProperty(rt, "output", jsi::String::createFromUtf8(rt, result.output));
+  obj.setProperty(rt, "durationMs", static_cast<double>(result.durationMs));
+  return obj;
 }
 
 PocketTerminalHostObject::~PocketTerminalHostObject() {
-  // 释放到底座
+  // 注销会话；其他运行时正在用的帧访问器只持弱引用，之后取帧得到空
+  SessionRegistry::instance().remove(m_sessionId);
 }
 
 jsi::Value PocketTerminalHostObject::get(jsi::Runtime &rt,
@@ -50,12 +131,25 @@ jsi::Value PocketTerminalHostObject::get(jsi::Runtime &rt,
       return jsi::Value(m_terminal->getCursorY());
     };
     return jsi::Function::createFromHostFunction(rt, name, 0, func);
+  } else if (propName == "getSessionId") {
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      return jsi::Value(static_cast<double>(m_sessionId));
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 0, func);
+  } else if (propName == "getFrameSeq") {
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      return jsi::Value(static_cast<double>(m_terminal->getFrameSeq()));
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 0, func);
   } else if (propName == "getBuffer") {
     auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
                        const jsi::Value *args, size_t count) -> jsi::Value {
-      size_t rows = m_terminal->getRows();
-      size_t cols = m_terminal->getCols();
-      size_t byteLength = rows * cols * sizeof(TerminalCell);
+      // Size, cells and line ids come from one locked snapshot, so a resize
+      // between calls can't leave them disagreeing
+      m_terminal->snapshot(m_snapshot);
+      size_t byteLength = m_snapshot.cells.size() * sizeof(TerminalCell);
 
       // Create a JS ArrayBuffer
       jsi::Function arrayBufferCtor =
@@ -64,13 +158,23 @@ jsi::Value PocketTerminalHostObject::get(jsi::Runtime &rt,
           arrayBufferCtor.callAsConstructor(rt, static_cast<double>(byteLength))
               .getObject(rt);
       jsi::ArrayBuffer arrayBuffer = arrayBufferObj.getArrayBuffer(rt);
+      std::memcpy(arrayBuffer.data(rt), m_snapshot.cells.data(), byteLength);
 
-      // Copy cells data to JS reachable ArrayBuffer memory using thread-safe
-      // method
-      m_terminal->copyBufferOut(
-          reinterpret_cast<TerminalCell *>(arrayBuffer.data(rt)), byteLength);
+      jsi::Array jsLineIds(rt, m_snapshot.lineIds.size());
+      for (size_t i = 0; i < m_snapshot.lineIds.size(); ++i) {
+        jsLineIds.setValueAtIndex(
+            rt, i, static_cast<double>(m_snapshot.lineIds[i]));
+      }
 
-      return arrayBufferObj;
+      // Return composite object:
+      // { buffer: ArrayBuffer, lineIds: [number], rows: int, cols: int }
+      jsi::Object result(rt);
+      result.setProperty(rt, "buffer", arrayBufferObj);
+      result.setProperty(rt, "lineIds", jsLineIds);
+      result.setProperty(rt, "rows", m_snapshot.rows);
+      result.setProperty(rt, "cols", m_snapshot.cols);
+
+      return result;
     };
     return jsi::Function::createFromHostFunction(rt, name, 0, func);
   } else if (propName == "startPty") {
@@ -92,7 +196,8 @@ jsi::Value PocketTerminalHostObject::get(jsi::Runtime &rt,
                        const jsi::Value *args, size_t count) -> jsi::Value {
       std::vector<TerminalCell> cells;
       std::vector<int> rowLengths;
-      m_terminal->pullScrollback(cells, rowLengths);
+      std::vector<uint64_t> lineIds;
+      m_terminal->pullScrollback(cells, rowLengths, &lineIds);
 
       if (cells.empty()) {
         return jsi::Value::null();
@@ -117,15 +222,423 @@ jsi::Value PocketTerminalHostObject::get(jsi::Runtime &rt,
       for (size_t i = 0; i < rowLengths.size(); ++i) {
         jsRowLengths.setValueAtIndex(rt, i, static_cast<double>(rowLengths[i]));
       }
+      jsi::Array jsLineIds(rt, lineIds.size());
+      for (size_t i = 0; i < lineIds.size(); ++i) {
+        jsLineIds.setValueAtIndex(rt, i, static_cast<double>(lineIds[i]));
+      }
 
-      // Return composite object: { buffer: ArrayBuffer, rowLengths: [int] }
+      // Return composite object:
+      // { buffer: ArrayBuffer, rowLengths: [int], lineIds: [number] }
       jsi::Object result(rt);
       result.setProperty(rt, "buffer", arrayBufferObj);
       result.setProperty(rt, "rowLengths", jsRowLengths);
+      result.setProperty(rt, "lineIds", jsLineIds);
+
+      return result;
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 0, func);
+  } else if (propName == "runScript") {
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      // runScript(steps) => Promise<result>，脚本在 PTY 读线程上执行
+      std::vector<AutomationStep> steps =
+          count > 0 ? readSteps(rt, args[0]) : std::vector<AutomationStep>{};
+      std::shared_ptr<facebook::react::CallInvoker> invoker = m_callInvoker;
+      return createPromise(rt, [&](std::shared_ptr<jsi::Value> resolve) {
+        auto settle = [invoker](std::shared_ptr<jsi::Value> resolve,
+                                AutomationResult result) {
+          invoker->invokeAsync(
+              [resolve = std::move(resolve),
+               result = std::move(result)](jsi::Runtime &jsRt) {
+                resolve->asObject(jsRt).asFunction(jsRt).call(
+                    jsRt, automationResultToJs(jsRt, result));
+              });
+        };
+        if (!invoker) {
+          AutomationResult result;
+          result.error = "runScript requires a CallInvoker";
+          resolve->asObject(rt).asFunction(rt).call(
+              rt, automationResultToJs(rt, result));
+          return;
+        }
+        // 没有读线程就没有 Tick，脚本永远不会结束
+        if (!m_terminal->isPtyRunning()) {
+          AutomationResult closed;
+          closed.error = "terminal is not running";
+          settle(std::move(resolve), std::move(closed));
+          return;
+        }
+        bool started = Automation::start(
+            *m_terminal,
+            [steps = std::move(steps)](Automation &automation) {
+              return runSteps(automation, steps);
+            },
+            [settle, resolve](AutomationResult &result) mutable {
+              settle(std::move(resolve), std::move(result));
+            });
+        if (!started) {
+          AutomationResult busy;
+          busy.error = "another script is running";
+          settle(std::move(resolve), std::move(busy));
+        }
+      });
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 1, func);
+  } else if (propName == "exportHistory") {
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      // exportHistory(path, 'text' | 'ansi' | 'html', onProgress?) => Promise
+      std::string path =
+          count > 0 && args[0].isString() ? args[0].getString(rt).utf8(rt) : "";
+      std::string formatName =
+          count > 1 && args[1].isString() ? args[1].getString(rt).utf8(rt)
+                                          : "text";
+      ExportFormat format = ExportFormat::Text;
+      if (formatName == "ansi")
+        format = ExportFormat::Ansi;
+      else if (formatName == "html")
+        format = ExportFormat::Html;
+      std::shared_ptr<jsi::Value> onProgress;
+      if (count > 2 && args[2].isObject() &&
+          args[2].getObject(rt).isFunction(rt))
+        onProgress = std::make_shared<jsi::Value>(rt, args[2]);
+
+      std::shared_ptr<facebook::react::CallInvoker> invoker = m_callInvoker;
+      return createPromise(rt, [&](std::shared_ptr<jsi::Value> resolve) {
+        auto fail = [&](const std::string &error) {
+          ExportProgress progress;
+          progress.done = true;
+          progress.error = error;
+          resolve->asObject(rt).asFunction(rt).call(
+              rt, exportProgressToJs(rt, progress));
+        };
+        if (!invoker)
+          return fail("exportHistory requires a CallInvoker");
+        if (path.empty())
+          return fail("path is required");
+
+        // 导出线程上的回调：进度转给 onProgress，完成时 resolve。
+        // 最后一次把两个 jsi::Value 的引用一起交给 JS 线程析构
+        bool started = m_terminal->exportHistory(
+            path, format,
+            [invoker, resolve,
+             onProgress](const ExportProgress &progress) mutable {
+              if (!progress.done) {
+                if (onProgress)
+                  invoker->invokeAsync(
+                      [onProgress, progress](jsi::Runtime &jsRt) {
+                        onProgress->asObject(jsRt).asFunction(jsRt).call(
+                            jsRt, exportProgressToJs(jsRt, progress));
+                      });
+                return;
+              }
+              invoker->invokeAsync([resolve = std::move(resolve),
+                                    onProgress = std::move(onProgress),
+                                    progress](jsi::Runtime &jsRt) {
+                resolve->asObject(jsRt).asFunction(jsRt).call(
+                    jsRt, exportProgressToJs(jsRt, progress));
+              });
+            });
+        if (!started)
+          fail("another export is running");
+      });
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 3, func);
+  } else if (propName == "exportSummary") {
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      // exportSummary({ maxBytes?, lastCommands?, lastLines? })
+      SummaryOptions options;
+      if (count > 0 && args[0].isObject()) {
+        jsi::Object opts = args[0].getObject(rt);
+        jsi::Value maxBytes = opts.getProperty(rt, "maxBytes");
+        if (maxBytes.isNumber())
+          options.maxBytes = static_cast<size_t>(maxBytes.asNumber());
+        jsi::Value lastCommands = opts.getProperty(rt, "lastCommands");
+        if (lastCommands.isNumber())
+          options.lastCommands = static_cast<int>(lastCommands.asNumber());
+        jsi::Value lastLines = opts.getProperty(rt, "lastLines");
+        if (lastLines.isNumber())
+          options.lastLines = static_cast<int>(lastLines.asNumber());
+      }
+      std::string text = m_terminal->exportSummary(options);
+      return jsi::String::createFromUtf8(rt, text);
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 1, func);
+  } else if (propName == "getOverview") {
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      size_t buckets = 100;
+      if (count > 0 && args[0].isNumber() && args[0].asNumber() > 0)
+        buckets = static_cast<size_t>(args[0].asNumber());
+      std::vector<OverviewBucket> overview;
+      m_terminal->getOverview(buckets, overview);
+
+      jsi::Array result(rt, overview.size());
+      for (size_t i = 0; i < overview.size(); ++i) {
+        const OverviewBucket &b = overview[i];
+        jsi::Object item(rt);
+        item.setProperty(rt, "startLine", static_cast<double>(b.startLine));
+        item.setProperty(rt, "lineCount", static_cast<double>(b.lineCount));
+        item.setProperty(rt, "density", b.density);
+        item.setProperty(rt, "dominantColor",
+                         static_cast<double>(b.dominantColor));
+        item.setProperty(rt, "errorLines", static_cast<double>(b.errorLines));
+        item.setProperty(rt, "warningLines",
+                         static_cast<double>(b.warningLines));
+        item.setProperty(rt, "promptMarks", static_cast<double>(b.promptMarks));
+        result.setValueAtIndex(rt, i, item);
+      }
+      return result;
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 1, func);
+  } else if (propName == "getImagePlacements") {
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      std::vector<ImagePlacementInfo> placements;
+      m_terminal->getImagePlacements(placements);
+
+      jsi::Array result(rt, placements.size());
+      for (size_t i = 0; i < placements.size(); ++i) {
+        const ImagePlacementInfo &p = placements[i];
+        jsi::Object item(rt);
+        item.setProperty(rt, "id", static_cast<double>(p.id));
+        item.setProperty(rt, "row", p.row);
+        item.setProperty(rt, "col", p.col);
+        item.setProperty(rt, "rows", p.rows);
+        item.setProperty(rt, "cols", p.cols);
+        result.setValueAtIndex(rt, i, item);
+      }
+      return result;
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 0, func);
+  } else if (propName == "getImage") {
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      if (count < 1 || !args[0].isNumber()) {
+        return jsi::Value::null();
+      }
+      ImageRef image = m_terminal->getImage(
+          static_cast<uint32_t>(args[0].asNumber()));
+      if (!image) {
+        return jsi::Value::null();
+      }
+
+      size_t byteLength = image->data.size();
+      jsi::Function arrayBufferCtor =
+          rt.global().getPropertyAsFunction(rt, "ArrayBuffer");
+      jsi::Object arrayBufferObj =
+          arrayBufferCtor
+              .callAsConstructor(rt,
+                                 jsi::Value(static_cast<double>(byteLength)))
+              .getObject(rt);
+      jsi::ArrayBuffer arrayBuffer = arrayBufferObj.getArrayBuffer(rt);
+      std::memcpy(arrayBuffer.data(rt), image->data.data(), byteLength);
+
+      // { id, width, height, format: 'rgba' | 'png', buffer }
+      jsi::Object result(rt);
+      result.setProperty(rt, "id", static_cast<double>(image->id));
+      result.setProperty(rt, "width", image->width);
+      result.setProperty(rt, "height", image->height);
+      result.setProperty(
+          rt, "format",
+          jsi::String::createFromAscii(
+              rt, image->format == ImageFormat::Png ? "png" : "rgba"));
+      result.setProperty(rt, "buffer", arrayBufferObj);
+      return result;
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 1, func);
+  } else if (propName == "checkpoint") {
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      m_terminal->checkpoint(m_checkpoint);
+      jsi::Function arrayBufferCtor =
+          rt.global().getPropertyAsFunction(rt, "ArrayBuffer");
+      jsi::Object arrayBufferObj =
+          arrayBufferCtor
+              .callAsConstructor(
+                  rt, jsi::Value(static_cast<double>(m_checkpoint.size())))
+              .getObject(rt);
+      jsi::ArrayBuffer arrayBuffer = arrayBufferObj.getArrayBuffer(rt);
+      std::memcpy(arrayBuffer.data(rt), m_checkpoint.data(),
+                  m_checkpoint.size());
+      return arrayBufferObj;
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 0, func);
+  } else if (propName == "restore") {
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      if (count < 1 || !args[0].isObject() ||
+          !args[0].getObject(rt).isArrayBuffer(rt))
+        return false;
+      jsi::ArrayBuffer buffer = args[0].getObject(rt).getArrayBuffer(rt);
+      return m_terminal->restore(buffer.data(rt), buffer.size(rt));
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 1, func);
+  } else if (propName == "setCellPixelSize") {
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      if (count >= 2 && args[0].isNumber() && args[1].isNumber()) {
+        m_terminal->setCellPixelSize(static_cast<int>(args[0].asNumber()),
+                                     static_cast<int>(args[1].asNumber()));
+      }
+      return jsi::Value::undefined();
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 2, func);
+  } else if (propName == "setMemoryBudget") {
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      if (count > 0 && args[0].isNumber()) {
+        m_terminal->setMemoryBudget(static_cast<size_t>(args[0].asNumber()));
+      }
+      return jsi::Value::undefined();
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 1, func);
+  } else if (propName == "setProcessSampling") {
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      if (count > 0 && args[0].isNumber()) {
+        m_terminal->setProcessSampling(static_cast<int>(args[0].asNumber()));
+      }
+      return jsi::Value::undefined();
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 1, func);
+  } else if (propName == "getProcessStats") {
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      ProcessTreeStats stats;
+      if (!m_terminal->getProcessStats(stats)) {
+        return jsi::Value::null();
+      }
+
+      auto toObject = [&rt](const ProcessUsage &usage) {
+        jsi::Object obj(rt);
+        obj.setProperty(rt, "pid", static_cast<double>(usage.pid));
+        obj.setProperty(rt, "name",
+                        jsi::String::createFromUtf8(rt, usage.name));
+        obj.setProperty(rt, "cpuTimeMs", static_cast<double>(usage.cpuTimeMs));
+        obj.setProperty(rt, "cpuPercent", static_cast<double>(usage.cpuPercent));
+        obj.setProperty(rt, "rssBytes", static_cast<double>(usage.rssBytes));
+        obj.setProperty(rt, "threads", usage.threads);
+        return obj;
+      };
 
+      jsi::Array top(rt, stats.top.size());
+      for (size_t i = 0; i < stats.top.size(); ++i) {
+        top.setValueAtIndex(rt, i, toObject(stats.top[i]));
+      }
+
+      jsi::Object result(rt);
+      result.setProperty(rt, "sampleTimeMs",
+                         static_cast<double>(stats.sampleTimeMs));
+      result.setProperty(rt, "sequence", static_cast<double>(stats.sequence));
+      result.setProperty(rt, "processCount", stats.processCount);
+      result.setProperty(rt, "tree", toObject(stats.tree));
+      result.setProperty(rt, "foregroundPgid",
+                         static_cast<double>(stats.foregroundPgid));
+      result.setProperty(rt, "foreground", toObject(stats.foreground));
+      result.setProperty(rt, "top", top);
       return result;
     };
     return jsi::Function::createFromHostFunction(rt, name, 0, func);
+  } else if (propName == "getMemoryUsage") {
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      return jsi::Value(static_cast<double>(m_terminal->getMemoryUsage()));
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 0, func);
+  } else if (propName == "getPaletteVersion") {
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      return jsi::Value(static_cast<double>(m_terminal->getPaletteVersion()));
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 0, func);
+  } else if (propName == "getPalette") {
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      // getPalette() => ArrayBuffer，kPaletteSize 个 ARGB (Uint32Array)
+      ColorPalette palette;
+      m_terminal->copyPaletteOut(palette);
+      size_t byteLength = sizeof(palette.colors);
+      jsi::Function arrayBufferCtor =
+          rt.global().getPropertyAsFunction(rt, "ArrayBuffer");
+      jsi::Object arrayBufferObj =
+          arrayBufferCtor
+              .callAsConstructor(rt,
+                                 jsi::Value(static_cast<double>(byteLength)))
+              .getObject(rt);
+      jsi::ArrayBuffer arrayBuffer = arrayBufferObj.getArrayBuffer(rt);
+      std::memcpy(arrayBuffer.data(rt), palette.colors, byteLength);
+      return arrayBufferObj;
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 0, func);
+  } else if (propName == "setDefaultColors") {
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      if (count > 1 && args[0].isNumber() && args[1].isNumber()) {
+        m_terminal->setDefaultColors(
+            static_cast<uint32_t>(args[0].asNumber()),
+            static_cast<uint32_t>(args[1].asNumber()));
+      }
+      return jsi::Value::undefined();
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 2, func);
+  } else if (propName == "setPaletteColor") {
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      if (count > 1 && args[0].isNumber() && args[1].isNumber()) {
+        m_terminal->setPaletteColor(static_cast<int>(args[0].asNumber()),
+                                    static_cast<uint32_t>(args[1].asNumber()));
+      }
+      return jsi::Value::undefined();
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 2, func);
+  } else if (propName == "setViewport") {
+    // setViewport(row, col, rows, cols, margin?)
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      if (count < 4)
+        return jsi::Value::undefined();
+      int rect[4];
+      for (int i = 0; i < 4; ++i) {
+        if (!args[i].isNumber())
+          return jsi::Value::undefined();
+        rect[i] = static_cast<int>(args[i].asNumber());
+      }
+      int margin = count > 4 && args[4].isNumber()
+                       ? static_cast<int>(args[4].asNumber())
+                       : PocketTerminal::kViewportMargin;
+      m_terminal->setViewport(rect[0], rect[1], rect[2], rect[3], margin);
+      return jsi::Value::undefined();
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 5, func);
+  } else if (propName == "clearViewport") {
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      m_terminal->clearViewport();
+      return jsi::Value::undefined();
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 0, func);
+  } else if (propName == "getViewportBuffer") {
+    auto func = [this](jsi::Runtime &rt, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+      // 区域不超过整屏，先按整屏复制再裁到实际格数
+      std::vector<TerminalCell> cells(
+          static_cast<size_t>(m_terminal->getRows()) * m_terminal->getCols());
+      size_t copied = m_terminal->copyViewportOut(
+          cells.data(), cells.size() * sizeof(TerminalCell));
+
+      size_t byteLength = copied * sizeof(TerminalCell);
+      jsi::Function arrayBufferCtor =
+          rt.global().getPropertyAsFunction(rt, "ArrayBuffer");
+      jsi::Object arrayBufferObj =
+          arrayBufferCtor.callAsConstructor(rt, static_cast<double>(byteLength))
+              .getObject(rt);
+      jsi::ArrayBuffer arrayBuffer = arrayBufferObj.getArrayBuffer(rt);
+      std::memcpy(arrayBuffer.data(rt), cells.data(), byteLength);
+      return arrayBufferObj;
+    };
+    return jsi::Function::createFromHostFunction(rt, name, 0, func);
   }
 
   return jsi::Value::undefined();
@@ -142,6 +655,7 @@ void PocketTerminalHostObject::writeOutput(const std::string &text) {
 }
 
 void *PocketTerminalHostObject::getRawBufferAddress() const {
+  m_terminal->syncCells();
   return const_cast<TerminalCell *>(m_terminal->getBuffer());
 }
 
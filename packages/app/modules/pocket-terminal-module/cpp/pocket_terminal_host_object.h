@@ -1,9 +1,11 @@
 #pragma once
 
 #include "pocket_terminal.h"
+#include <ReactCommon/CallInvoker.h>
 #include <jsi/jsi.h>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace pocket {
 namespace terminal {
@@ -15,7 +17,10 @@ namespace jsi = facebook::jsi;
  */
 class PocketTerminalHostObject : public jsi::HostObject {
 public:
-  PocketTerminalHostObject(int rows, int cols);
+  // callInvoker 用于异步方法 (runScript) 回到 JS 线程，可以为空
+  PocketTerminalHostObject(
+      int rows, int cols,
+      std::shared_ptr<facebook::react::CallInvoker> callInvoker = nullptr);
   ~PocketTerminalHostObject();
 
   // 当 JSI 尝试访问 JS 侧属 (如 myTerm.rows) 时触发
@@ -31,8 +36,17 @@ public:
   // (远期扩展结构) 获取 DirectBuffer 的映射地址等
   void *getRawBufferAddress() const;
 
+  // 会话在 SessionRegistry 中的 id，其他运行时凭它取只读帧访问器
+  uint32_t sessionId() const { return m_sessionId; }
+
 private:
-  std::unique_ptr<PocketTerminal> m_terminal;
+  std::shared_ptr<PocketTerminal> m_terminal;
+  uint32_t m_sessionId{0};
+  std::shared_ptr<facebook::react::CallInvoker> m_callInvoker;
+  // checkpoint 的中转缓冲，定期快照时复用
+  std::vector<uint8_t> m_checkpoint;
+  // getBuffer 的中转快照，每帧复用
+  ScreenSnapshot m_snapshot;
 };
 
 } // namespace terminal
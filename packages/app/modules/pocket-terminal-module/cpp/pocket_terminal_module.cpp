@@ -1,19 +1,173 @@
+#include "exec_engine.h"
+#include "jsi_promise.h"
 #include "pocket_terminal.h"
+#include "pocket_terminal_frame_object.h"
 #include "pocket_terminal_host_object.h"
+#include <ReactCommon/CallInvokerHolder.h>
+#include <fbjni/fbjni.h>
 #include <jsi/jsi.h>
 
 #include <jni.h>
 
+namespace {
+
+using namespace pocket::terminal;
+namespace jsi = facebook::jsi;
+
+// 进程内共用一个执行引擎 (一个 I/O 线程)，JS 重载后仍然复用
+ExecEngine &execEngine() {
+  static ExecEngine engine;
+  return engine;
+}
+
+void readStringArray(jsi::Runtime &rt, const jsi::Value &value,
+                     std::vector<std::string> &out) {
+  if (!value.isObject() || !value.getObject(rt).isArray(rt))
+    return;
+  jsi::Array array = value.getObject(rt).getArray(rt);
+  for (size_t i = 0; i < array.size(rt); ++i) {
+    jsi::Value item = array.getValueAtIndex(rt, i);
+    if (item.isString())
+      out.push_back(item.getString(rt).utf8(rt));
+  }
+}
+
+// execNative 的第二个参数：{ cwd?, env?, stdin?, timeoutMs?, killGraceMs?,
+// headBytes?, tailBytes?, shell? }
+ExecOptions readExecOptions(jsi::Runtime &rt, const jsi::Value *args,
+                            size_t count) {
+  ExecOptions options;
+  if (count > 0 && args[0].isString())
+    options.command = args[0].getString(rt).utf8(rt);
+  else if (count > 0)
+    readStringArray(rt, args[0], options.argv);
+
+  if (count < 2 || !args[1].isObject())
+    return options;
+  jsi::Object opts = args[1].getObject(rt);
+  auto readString = [&](const char *key, std::string &out) {
+    jsi::Value v = opts.getProperty(rt, key);
+    if (v.isString())
+      out = v.getString(rt).utf8(rt);
+  };
+  auto readNumber = [&](const char *key, auto &out) {
+    jsi::Value v = opts.getProperty(rt, key);
+    if (v.isNumber() && v.asNumber() >= 0)
+      out = static_cast<std::decay_t<decltype(out)>>(v.asNumber());
+  };
+  readString("cwd", options.cwd);
+  readString("stdin", options.stdinData);
+  readString("shell", options.shell);
+  readNumber("timeoutMs", options.timeoutMs);
+  readNumber("killGraceMs", options.killGraceMs);
+  readNumber("headBytes", options.headBytes);
+  readNumber("tailBytes", options.tailBytes);
+
+  jsi::Value env = opts.getProperty(rt, "env");
+  if (env.isObject()) {
+    jsi::Object envObj = env.getObject(rt);
+    jsi::Array keys = envObj.getPropertyNames(rt);
+    for (size_t i = 0; i < keys.size(rt); ++i) {
+      std::string key = keys.getValueAtIndex(rt, i).getString(rt).utf8(rt);
+      jsi::Value v = envObj.getProperty(rt, key.c_str());
+      if (v.isString())
+        options.env.push_back(key + "=" + v.getString(rt).utf8(rt));
+    }
+  }
+  return options;
+}
+
+jsi::Object execResultToJs(jsi::Runtime &rt, const ExecResult &result) {
+  jsi::Object obj(rt);
+  obj.setProperty(rt, "id", static_cast<double>(result.id));
+  obj.setProperty(rt, "exitCode", result.exitCode);
+  obj.setProperty(rt, "signal", result.signal);
+  obj.setProperty(rt, "timedOut", result.timedOut);
+  obj.setProperty(rt, "cancelled", result.cancelled);
+  if (!result.error.empty())
+    obj.setProperty(rt, "error", jsi::String::createFromUtf8(rt, result.error));
+  obj.setProperty(rt, "durationMs", static_cast<double>(result.durationMs));
+  obj.setProperty(rt, "stdout",
+                  jsi::String::createFromUtf8(rt, result.out.text()));
+  obj.setProperty(rt, "stderr",
+                  jsi::String::createFromUtf8(rt, result.err.text()));
+  obj.setProperty(rt, "stdoutBytes",
+                  static_cast<double>(result.out.totalBytes()));
+  obj.setProperty(rt, "stderrBytes",
+                  static_cast<double>(result.err.totalBytes()));
+  obj.setProperty(rt, "stdoutDropped",
+                  static_cast<double>(result.out.droppedBytes()));
+  obj.setProperty(rt, "stderrDropped",
+                  static_cast<double>(result.err.droppedBytes()));
+  return obj;
+}
+
+// global.execNative(command | argv, options?) => Promise<result>，
+// global.cancelExec(id)。命令在 ExecEngine 的 I/O 线程上运行，
+// 结果经 CallInvoker 回到 JS 线程再 resolve
+void installExec(jsi::Runtime &rt,
+                 std::shared_ptr<facebook::react::CallInvoker> invoker) {
+  auto execFunc = [invoker](jsi::Runtime &runtime, const jsi::Value &thisValue,
+                            const jsi::Value *args,
+                            size_t count) -> jsi::Value {
+    ExecOptions options = readExecOptions(runtime, args, count);
+    uint64_t runId = 0;
+    jsi::Object promise =
+        createPromise(runtime, [&](std::shared_ptr<jsi::Value> resolve) {
+          runId = execEngine().start(
+              std::move(options),
+              [invoker, resolve](ExecResult &result) mutable {
+                // 把 resolve 的唯一引用交给 JS 线程，保证 jsi::Value 在那里析构
+                auto shared = std::make_shared<ExecResult>(std::move(result));
+                invoker->invokeAsync(
+                    [resolve = std::move(resolve), shared](jsi::Runtime &rt) {
+                      resolve->asObject(rt).asFunction(rt).call(
+                          rt, execResultToJs(rt, *shared));
+                    });
+              });
+        }).asObject(runtime);
+    // promise.id 可传给 cancelExec
+    promise.setProperty(runtime, "id", static_cast<double>(runId));
+    return promise;
+  };
+  rt.global().setProperty(
+      rt, "execNative",
+      jsi::Function::createFromHostFunction(
+          rt, jsi::PropNameID::forAscii(rt, "execNative"), 2, execFunc));
+
+  auto cancelFunc = [](jsi::Runtime &runtime, const jsi::Value &thisValue,
+                       const jsi::Value *args, size_t count) -> jsi::Value {
+    if (count < 1 || !args[0].isNumber())
+      return false;
+    return execEngine().cancel(static_cast<uint64_t>(args[0].asNumber()));
+  };
+  rt.global().setProperty(
+      rt, "cancelExec",
+      jsi::Function::createFromHostFunction(
+          rt, jsi::PropNameID::forAscii(rt, "cancelExec"), 1, cancelFunc));
+}
+
+} // namespace
+
 // JNI 动态加载与 JSI 沙盒植入入口
 extern "C" JNIEXPORT void JNICALL
 Java_expo_modules_pocketterminalmodule_PocketTerminalModule_installJSI(
-    JNIEnv *env, jobject thiz, jlong jsiPtr) {
+    JNIEnv *env, jobject thiz, jlong jsiPtr, jobject callInvokerHolder) {
   if (jsiPtr == 0)
     return;
   auto *rt = reinterpret_cast<facebook::jsi::Runtime *>(jsiPtr);
   using namespace pocket::terminal;
   namespace jsi = facebook::jsi;
 
+  // 原生线程上完成的异步操作经 CallInvoker 回到 JS 线程
+  std::shared_ptr<facebook::react::CallInvoker> invoker;
+  if (callInvokerHolder != nullptr) {
+    using facebook::react::CallInvokerHolder;
+    facebook::jni::alias_ref<CallInvokerHolder::javaobject> holder{
+        static_cast<CallInvokerHolder::javaobject>(callInvokerHolder)};
+    invoker = holder->cthis()->getCallInvoker();
+  }
+
   // 向 JS 侧全局挂载一个构造函数 `createTerminalCore`
   auto createFunc = [=](jsi::Runtime &runtime, const jsi::Value &thisValue,
                         const jsi::Value *args, size_t count) -> jsi::Value {
@@ -26,7 +180,8 @@ Java_expo_modules_pocketterminalmodule_PocketTerminalModule_installJSI(
     }
 
     // 分配 HostObject
-    auto hostObj = std::make_shared<PocketTerminalHostObject>(rows, cols);
+    auto hostObj =
+        std::make_shared<PocketTerminalHostObject>(rows, cols, invoker);
     return jsi::Object::createFromHostObject(runtime, hostObj);
   };
 
@@ -37,4 +192,20 @@ Java_expo_modules_pocketterminalmodule_PocketTerminalModule_installJSI(
   // 挂载到 JavaScript 的 global 对象上，以便可以通过 global.createTerminalCore
   // 访问
   rt->global().setProperty(*rt, "createTerminalCore", jsiFunc);
+  // 主运行时也能用帧访问器，与其他运行时的用法一致
+  installFrameAccessor(*rt);
+
+  if (invoker)
+    installExec(*rt, invoker);
+}
+
+// 把只读帧访问器装进另一个运行时 (UI 线程的 worklet 运行时等)。宿主在
+// 该运行时所属的线程上调用，见 PocketTerminalModule.installFrameAccessor
+extern "C" JNIEXPORT void JNICALL
+Java_expo_modules_pocketterminalmodule_PocketTerminalModule_installFrameAccessor(
+    JNIEnv *env, jclass clazz, jlong jsiPtr) {
+  if (jsiPtr == 0)
+    return;
+  pocket::terminal::installFrameAccessor(
+      *reinterpret_cast<facebook::jsi::Runtime *>(jsiPtr));
 }
@@ -9,38 +9,282 @@ export interface NativeTerminalCore {
   write(data: string): void;
   getRows(): number;
   getCols(): number;
-  getBuffer(): ArrayBuffer;
+  // 一帧屏幕：尺寸、格子与每行的行号在同一次加锁内取出，彼此一致。
+  // 行随滚动移动、进入历史时行号不变，新出现的行用新号，
+  // 可以作为列表的稳定 key
+  getBuffer(): ScreenSnapshot;
+  // 会话在原生会话表中的 id，其他运行时凭它调用 getTerminalFrame
+  getSessionId(): number;
+  // 屏幕或光标每变化一次递增，没变就不必重取帧
+  getFrameSeq(): number;
   getCursorX(): number;
   getCursorY(): number;
   startPty(): boolean;
   stopPty(): void;
   resize(rows: number, cols: number): void;
-  // 获取刚刚被挤出屏幕的历史行数组
-  pullScrollback(): { buffer: ArrayBuffer; rowLengths: number[] } | null;
+  // 获取刚刚被挤出屏幕的历史行数组，lineIds 为各行在屏幕上时的行号
+  pullScrollback(): {
+    buffer: ArrayBuffer;
+    rowLengths: number[];
+    lineIds: number[];
+  } | null;
+  // 压缩后的纯文本导出 (历史 + 屏幕)，用于 AI 上下文
+  exportSummary(options?: SummaryOptions): string;
+  // 在原生后台线程把历史 + 屏幕流式写入文件，不经过 JS 内存
+  exportHistory(
+    path: string,
+    format?: ExportFormat,
+    onProgress?: (progress: ExportProgress) => void
+  ): Promise<ExportProgress>;
+  // 历史概览 (滚动条小地图)，最多 buckets 格，与历史总行数无关
+  getOverview(buckets: number): OverviewBucket[];
+  // 完整模拟器状态快照 (不含历史与图像)，用于进程被杀后恢复或录像跳转；
+  // restore 在快照无效时返回 false，终端不变
+  checkpoint(): ArrayBuffer;
+  restore(checkpoint: ArrayBuffer): boolean;
+  // 内联图像 (sixel / kitty)：单元格 flags 第 31 位为图像标记，ch 为图像 id
+  getImagePlacements(): ImagePlacement[];
+  getImage(id: number): TerminalImage | null;
+  setCellPixelSize(width: number, height: number): void;
+  // 会话内存预算 (字节)，屏幕、历史与图像缓存合计
+  setMemoryBudget(bytes: number): void;
+  getMemoryUsage(): number;
+  // 格子颜色为调色板表下标或直接 RGB (见 resolveColor)；主题切换只换表，
+  // 版本号变化时重取 getPalette 即可，历史与屏幕格子不变
+  getPalette(): ArrayBuffer;
+  getPaletteVersion(): number;
+  setDefaultColors(fg: number, bg: number): void;
+  setPaletteColor(index: number, argb: number): void;
+  // 可见区域 (缩放、键盘遮挡)：取帧只转换区域外扩 margin 格内的格子，
+  // 期间 getBuffer 只保证区域内是最新的。getViewportBuffer 按行连续返回
+  // 区域内的格子 (裁到屏幕)，没有登记区域时为整屏
+  setViewport(
+    row: number,
+    col: number,
+    rows: number,
+    cols: number,
+    margin?: number
+  ): void;
+  clearViewport(): void;
+  getViewportBuffer(): ArrayBuffer;
+  // PTY 子进程树资源采样，间隔毫秒，0 关闭
+  setProcessSampling(intervalMs: number): void;
+  getProcessStats(): ProcessTreeStats | null;
+  // 原生 send / expect 脚本，在 PTY 读线程上执行，完成后 resolve 一次
+  runScript(steps: AutomationStep[]): Promise<AutomationResult>;
 }
 
+/**
+ * 只读帧访问器 (global.getTerminalFrame(sessionId))。可由原生侧装进 UI 线程的
+ * worklet 运行时 (PocketTerminalModule.installFrameAccessor)，JS 线程忙时
+ * 照样取帧绘制。只持有会话的弱引用：会话关闭后 isAlive() 为 false，
+ * 取帧方法返回 null / 0
+ */
+export interface TerminalFrameAccessor {
+  isAlive(): boolean;
+  getRows(): number;
+  getCols(): number;
+  getCursorX(): number;
+  getCursorY(): number;
+  getFrameSeq(): number;
+  getBuffer(): ScreenSnapshot | null;
+  // 复制到调用方的缓冲 (每帧复用，不产生垃圾)，返回复制的格数
+  copyBuffer(target: ArrayBuffer): number;
+  getViewportBuffer(): ArrayBuffer | null;
+  getPalette(): ArrayBuffer | null;
+  getPaletteVersion(): number;
+}
+
+/** 屏幕快照：buffer 为 rows * cols 格，每格 4 个 uint32；lineIds 每行一个 */
+export interface ScreenSnapshot {
+  buffer: ArrayBuffer;
+  lineIds: number[];
+  rows: number;
+  cols: number;
+}
+
+/** 格子颜色编码：0x010000nn 为调色板表第 n 项，其余为 0xFFRRGGBB */
+export const COLOR_INDEXED = 0x01000000;
+/** 调色板表：0-255 为 256 色，256 / 257 为默认前景 / 背景 */
+export const PALETTE_SIZE = 258;
+export const COLOR_DEFAULT_FG = COLOR_INDEXED | 256;
+export const COLOR_DEFAULT_BG = COLOR_INDEXED | 257;
+
+/** 把格子颜色解析为 0xRRGGBB */
+export function resolveColor(code: number, palette: Uint32Array): number {
+  const argb = (code >>> 24) === 0x01 ? palette[code & 0xffff] ?? 0 : code;
+  return argb & 0xffffff;
+}
+
+/**
+ * runScript 步骤。expect 在去掉控制序列和 CR 的输出上匹配，
+ * 匹配后消费到匹配末尾；settled 为要求的静默毫秒数。timeoutMs 默认 10000
+ */
+export type AutomationStep =
+  | { send: string }
+  | { expect: string; regex?: boolean; timeoutMs?: number }
+  | { settled: number; timeoutMs?: number };
+
+export interface AutomationResult {
+  ok: boolean;
+  /** 失败的步骤下标，成功时为 -1 */
+  failedStep: number;
+  error?: string;
+  /** 每个 expect 匹配到的文本 */
+  matches: string[];
+  /** 去掉控制序列后的最近输出 */
+  output: string;
+  durationMs: number;
+}
+
+/** 单个进程或一组进程合计的资源占用；cpuPercent 为 100 表示占满一个核 */
+export interface ProcessUsage {
+  pid: number;
+  name: string;
+  cpuTimeMs: number;
+  cpuPercent: number;
+  rssBytes: number;
+  threads: number;
+}
+
+/** PTY 子进程树的一次采样 */
+export interface ProcessTreeStats {
+  sampleTimeMs: number;
+  sequence: number;
+  processCount: number;
+  tree: ProcessUsage;
+  foregroundPgid: number;
+  foreground: ProcessUsage;
+  top: ProcessUsage[];
+}
+
+/**
+ * exportSummary 参数。lastCommands 依赖 shell 输出 OSC 133;A 提示符标记；
+ * 两者都不传时导出全部原生历史
+ */
+export interface SummaryOptions {
+  /** 输出字节上限，默认 4096 */
+  maxBytes?: number;
+  lastCommands?: number;
+  lastLines?: number;
+}
+
+export type ExportFormat = 'text' | 'ansi' | 'html';
+
+/** 导出进度；完成时 (Promise 结果) 带 ok / error，失败时不留下文件 */
+export interface ExportProgress {
+  linesDone: number;
+  linesTotal: number;
+  /** 导出期间被挤出原生历史上限、没能写出的行 */
+  linesSkipped: number;
+  bytesWritten: number;
+  ok?: boolean;
+  error?: string;
+}
+
+/**
+ * 历史概览的一格，startLine 为绝对行号 (与 pullScrollback 累积的历史下标一致)。
+ * 覆盖的行不足 buckets 个整桶 (64 行) 时返回的格数更少
+ */
+export interface OverviewBucket {
+  startLine: number;
+  lineCount: number;
+  /** 非空白格占比 0..1 */
+  density: number;
+  /** 主前景色 ARGB，无内容时为 0 */
+  dominantColor: number;
+  errorLines: number;
+  warningLines: number;
+  /** OSC 133;A 提示符数 */
+  promptMarks: number;
+}
+
+/** 图像在可视区的放置，row 为负数表示已滚入历史 */
+export interface ImagePlacement {
+  id: number;
+  row: number;
+  col: number;
+  rows: number;
+  cols: number;
+}
+
+/** 解码后的图像；png 格式需由平台解码器再解码 */
+export interface TerminalImage {
+  id: number;
+  width: number;
+  height: number;
+  format: 'rgba' | 'png';
+  buffer: ArrayBuffer;
+}
+
+/** execNative 选项；输出只保留前 headBytes 与后 tailBytes */
+export interface ExecOptions {
+  cwd?: string;
+  /** 追加到当前环境，同名覆盖 */
+  env?: Record<string, string>;
+  stdin?: string;
+  /** 0 表示不限时；超时后对整棵进程树 SIGTERM，killGraceMs 后 SIGKILL */
+  timeoutMs?: number;
+  killGraceMs?: number;
+  headBytes?: number;
+  tailBytes?: number;
+  /** 字符串命令使用的 shell，默认 /system/bin/sh */
+  shell?: string;
+}
+
+export interface ExecResult {
+  id: number;
+  /** 被信号终止时为 -1 */
+  exitCode: number;
+  signal: number;
+  timedOut: boolean;
+  cancelled: boolean;
+  /** 启动失败 (exec/chdir) 的原因 */
+  error?: string;
+  durationMs: number;
+  /** 超出上限时中间部分替换为 "[... N bytes dropped ...]" */
+  stdout: string;
+  stderr: string;
+  stdoutBytes: number;
+  stderrBytes: number;
+  stdoutDropped: number;
+  stderrDropped: number;
+}
+
+/** 附带运行 id 的 Promise，id 可传给 cancelExec */
+export type ExecPromise = Promise<ExecResult> & { id?: number };
+
 // 声明全局挂载构造函数 (由 pocket_terminal_module.cpp 注入)
 declare const global: {
   createTerminalCore?: (rows: number, cols: number) => NativeTerminalCore;
+  execNative?: (command: string | string[], options?: ExecOptions) => ExecPromise;
+  cancelExec?: (id: number) => boolean;
+  getTerminalFrame?: (sessionId: number) => TerminalFrameAccessor | null;
+  getTerminalSessions?: () => number[];
 } & typeof globalThis;
 
+function ensureInstalled() {
+  if (typeof global.createTerminalCore === 'function') {
+    return;
+  }
+  try {
+    const NativeModule = requireNativeModule('PocketTerminalModule');
+    const installed = NativeModule.install();
+    if (!installed) {
+      console.warn(
+        "PocketTerminalModule's JSI methods failed to install. Ensure the module is properly linked."
+      );
+    }
+  } catch (e) {
+    console.warn("Error installing PocketTerminalModule JSI: ", e);
+  }
+}
+
 export class PocketTerminal {
   private _core: NativeTerminalCore | null = null;
 
   constructor(public readonly rows: number = 24, public readonly cols: number = 80) {
-    if (typeof global.createTerminalCore !== 'function') {
-      try {
-        const NativeModule = requireNativeModule('PocketTerminalModule');
-        const installed = NativeModule.install();
-        if (!installed) {
-          console.warn(
-            "PocketTerminalModule's JSI methods failed to install. Ensure the module is properly linked."
-          );
-        }
-      } catch (e) {
-        console.warn("Error installing PocketTerminalModule JSI: ", e);
-      }
-    }
+    ensureInstalled();
 
     if (typeof global.createTerminalCore === 'function') {
       this._core = global.createTerminalCore(rows, cols);
@@ -62,8 +306,22 @@ export class PocketTerminal {
   }
 
   public getBuffer() {
-    // Falls back to an empty ArrayBuffer if the core isn't injected yet.
-    return this._core?.getBuffer() ?? new ArrayBuffer(0);
+    // Falls back to an empty snapshot if the core isn't injected yet.
+    const empty: ScreenSnapshot = {
+      buffer: new ArrayBuffer(0),
+      lineIds: [],
+      rows: 0,
+      cols: 0,
+    };
+    return this._core?.getBuffer() ?? empty;
+  }
+
+  public getSessionId() {
+    return this._core?.getSessionId() ?? 0;
+  }
+
+  public getFrameSeq() {
+    return this._core?.getFrameSeq() ?? 0;
   }
 
   public getCursorX() {
@@ -89,6 +347,108 @@ export class PocketTerminal {
   public pullScrollback() {
     return this._core?.pullScrollback() ?? null;
   }
+
+  public exportSummary(options?: SummaryOptions) {
+    return this._core?.exportSummary(options) ?? '';
+  }
+
+  public runScript(steps: AutomationStep[]): Promise<AutomationResult> {
+    if (!this._core) {
+      return Promise.resolve({
+        ok: false, failedStep: -1, error: 'terminal core unavailable',
+        matches: [], output: '', durationMs: 0,
+      });
+    }
+    return this._core.runScript(steps);
+  }
+
+  public exportHistory(
+    path: string,
+    format: ExportFormat = 'text',
+    onProgress?: (progress: ExportProgress) => void
+  ): Promise<ExportProgress> {
+    if (!this._core) {
+      return Promise.resolve({
+        linesDone: 0, linesTotal: 0, linesSkipped: 0, bytesWritten: 0,
+        ok: false, error: 'terminal core unavailable',
+      });
+    }
+    return this._core.exportHistory(path, format, onProgress);
+  }
+
+  public getOverview(buckets: number = 100) {
+    return this._core?.getOverview(buckets) ?? [];
+  }
+
+  public checkpoint() {
+    return this._core?.checkpoint() ?? null;
+  }
+
+  public restore(checkpoint: ArrayBuffer) {
+    return this._core?.restore(checkpoint) ?? false;
+  }
+
+  public getImagePlacements() {
+    return this._core?.getImagePlacements() ?? [];
+  }
+
+  public getImage(id: number) {
+    return this._core?.getImage(id) ?? null;
+  }
+
+  public setCellPixelSize(width: number, height: number) {
+    this._core?.setCellPixelSize(width, height);
+  }
+
+  public setMemoryBudget(bytes: number) {
+    this._core?.setMemoryBudget(bytes);
+  }
+
+  public getMemoryUsage() {
+    return this._core?.getMemoryUsage() ?? 0;
+  }
+
+  public getPalette() {
+    return new Uint32Array(this._core?.getPalette() ?? new ArrayBuffer(0));
+  }
+
+  public getPaletteVersion() {
+    return this._core?.getPaletteVersion() ?? 0;
+  }
+
+  public setDefaultColors(fg: number, bg: number) {
+    this._core?.setDefaultColors(fg, bg);
+  }
+
+  public setPaletteColor(index: number, argb: number) {
+    this._core?.setPaletteColor(index, argb);
+  }
+
+  public setViewport(
+    row: number,
+    col: number,
+    rows: number,
+    cols: number,
+    margin?: number
+  ) {
+    this._core?.setViewport(row, col, rows, cols, margin);
+  }
+
+  public clearViewport() {
+    this._core?.clearViewport();
+  }
+
+  public getViewportBuffer() {
+    return this._core?.getViewportBuffer() ?? new ArrayBuffer(0);
+  }
+
+  public setProcessSampling(intervalMs: number) {
+    this._core?.setProcessSampling(intervalMs);
+  }
+
+  public getProcessStats() {
+    return this._core?.getProcessStats() ?? null;
+  }
 }
 
 /** 无交互式本地命令执行，供 AI 工具调用 */
@@ -100,6 +460,41 @@ export async function runLocalCommand(
   return module.runLocalCommand(command, workdir);
 }
 
+/**
+ * 原生批量执行：不经过 PTY，多条命令共用一个原生 I/O 线程并发运行，
+ * 输出有界 (头 + 尾)。返回的 Promise 附带 id，可传给 cancelExec
+ */
+export function execNative(
+  command: string | string[],
+  options: ExecOptions = {}
+): ExecPromise {
+  ensureInstalled();
+  if (typeof global.execNative !== 'function') {
+    return Promise.reject(new Error('execNative is not available'));
+  }
+  return global.execNative(command, options);
+}
+
+export function cancelExec(id: number): boolean {
+  return global.cancelExec?.(id) ?? false;
+}
+
+/**
+ * 在当前 (主) 运行时取会话的只读帧访问器；worklet 里直接调用
+ * global.getTerminalFrame
+ */
+export function getTerminalFrame(
+  sessionId: number
+): TerminalFrameAccessor | null {
+  ensureInstalled();
+  return global.getTerminalFrame?.(sessionId) ?? null;
+}
+
+export function getTerminalSessions(): number[] {
+  ensureInstalled();
+  return global.getTerminalSessions?.() ?? [];
+}
+
 /** 获取原生私有 lib 路径 */
 export function getNativeLibDir(): string | null {
   const module = requireNativeModule('PocketTerminalModule');
@@ -9,7 +9,12 @@ import {
     Platform,
     Dimensions,
 } from "react-native";
-import { PocketTerminal, getNativeLibDir } from "pocket-terminal-module";
+import {
+    PocketTerminal,
+    getNativeLibDir,
+    resolveColor,
+    COLOR_DEFAULT_BG,
+} from "pocket-terminal-module";
 import KeyboardToolbar from "./KeyboardToolbar";
 import RuntimeSetup from "../RuntimeSetup";
 import { getRuntimeStatus } from "../../services/runtimeManager";
@@ -17,14 +22,23 @@ import { getRuntimeStatus } from "../../services/runtimeManager";
 // ── Types ──────────────────────────────────────
 interface TextSpan {
     text: string;
-    fg: string;
-    bg: string;
+    // Color codes as stored natively (palette index or RGB); resolved against
+    // the current palette at render time so theme switches recolor history
+    fg: number;
+    bg: number;
     bold: boolean;
     underline: boolean;
     italic: boolean;
     reverse: boolean;
 }
 
+// One logical row; id is the native line id, stable while the row scrolls
+// on screen and into history, so it doubles as the list key
+interface TermRow {
+    id: number;
+    spans: TextSpan[];
+}
+
 // ── Config ─────────────────────────────────────
 const FONT_SIZE = 13;
 const CHAR_WIDTH = 7.8;
@@ -48,13 +62,6 @@ function parseCells(view: Uint32Array, offset: number, count: number): TextSpan[
         const bgCode = view[idx++];
         const flags = view[idx++];
 
-        let fgHex = "#" + ("000000" + (fgCode & 0xffffff).toString(16)).slice(-6);
-        let bgHex = "#" + ("000000" + (bgCode & 0xffffff).toString(16)).slice(-6);
-
-        if (fgHex === "#000000" && bgHex === "#000000") {
-            fgHex = "#FFFFFF";
-        }
-
         const bold = (flags & (1 << 0)) !== 0;
         const underline = (flags & (1 << 1)) !== 0;
         const italic = (flags & (1 << 2)) !== 0;
@@ -62,10 +69,10 @@ function parseCells(view: Uint32Array, offset: number, count: number): TextSpan[
         const char = chCode === 0 ? " " : String.fromCodePoint(chCode);
 
         if (!currentSpan) {
-            currentSpan = { text: char, fg: fgHex, bg: bgHex, bold, underline, italic, reverse };
+            currentSpan = { text: char, fg: fgCode, bg: bgCode, bold, underline, italic, reverse };
         } else if (
-            currentSpan.fg === fgHex &&
-            currentSpan.bg === bgHex &&
+            currentSpan.fg === fgCode &&
+            currentSpan.bg === bgCode &&
             currentSpan.bold === bold &&
             currentSpan.underline === underline &&
             currentSpan.italic === italic &&
@@ -74,13 +81,94 @@ function parseCells(view: Uint32Array, offset: number, count: number): TextSpan[
             currentSpan.text += char;
         } else {
             rowSpans.push(currentSpan);
-            currentSpan = { text: char, fg: fgHex, bg: bgHex, bold, underline, italic, reverse };
+            currentSpan = { text: char, fg: fgCode, bg: bgCode, bold, underline, italic, reverse };
         }
     }
     if (currentSpan) rowSpans.push(currentSpan);
     return rowSpans;
 }
 
+function sameSpans(a: TextSpan[], b: TextSpan[]): boolean {
+    if (a.length !== b.length) return false;
+    for (let i = 0; i < a.length; i++) {
+        const x = a[i];
+        const y = b[i];
+        if (
+            x.text !== y.text ||
+            x.fg !== y.fg ||
+            x.bg !== y.bg ||
+            x.bold !== y.bold ||
+            x.underline !== y.underline ||
+            x.italic !== y.italic ||
+            x.reverse !== y.reverse
+        ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Reuse the previous row object when the line id and content are unchanged,
+// so the memoized row below skips re-rendering it
+function reuseRow(prev: Map<number, TermRow>, id: number, spans: TextSpan[]): TermRow {
+    const old = prev.get(id);
+    return old && sameSpans(old.spans, spans) ? old : { id, spans };
+}
+
+function toHex(code: number, palette: Uint32Array): string {
+    return "#" + ("000000" + resolveColor(code, palette).toString(16)).slice(-6);
+}
+
+// ── Row ─────────────────────────────────────────
+interface TermRowViewProps {
+    row: TermRow;
+    palette: Uint32Array;
+    // Cursor column on this row, -1 when the cursor is elsewhere
+    cursorX: number;
+    blink: boolean;
+}
+
+const TermRowView = React.memo(function TermRowView({ row, palette, cursorX, blink }: TermRowViewProps) {
+    return (
+        <View style={styles.termRow}>
+            {row.spans.map((span: TextSpan, sIdx: number) => {
+                const fg = toHex(span.reverse ? span.bg : span.fg, palette);
+                const bgCode = span.reverse ? span.fg : span.bg;
+                const bg = toHex(bgCode, palette);
+                return (
+                    <Text
+                        key={sIdx}
+                        style={{
+                            fontFamily: Platform.OS === "ios" ? "Courier" : "monospace",
+                            color: fg,
+                            backgroundColor: bgCode === COLOR_DEFAULT_BG ? "transparent" : bg,
+                            fontSize: FONT_SIZE,
+                            lineHeight: LINE_HEIGHT,
+                            fontWeight: span.bold ? "bold" : "normal",
+                            fontStyle: span.italic ? "italic" : "normal",
+                            textDecorationLine: span.underline ? "underline" : "none",
+                        }}
+                    >
+                        {span.text}
+                    </Text>
+                );
+            })}
+            {/* Cursor */}
+            {cursorX >= 0 && (
+                <View
+                    style={[
+                        styles.cursor,
+                        {
+                            left: cursorX * CHAR_WIDTH,
+                            opacity: blink ? 0.75 : 0,
+                        },
+                    ]}
+                />
+            )}
+        </View>
+    );
+});
+
 // ── TerminalScreen ──────────────────────────────
 export interface TerminalScreenHandle {
     write: (data: string) => void;
@@ -92,9 +180,10 @@ interface TerminalScreenProps {
 }
 
 export default function TerminalScreen({ onClose }: TerminalScreenProps) {
-    const [historyData, setHistoryData] = useState<TextSpan[][]>([]);
-    const [rowsData, setRowsData] = useState<TextSpan[][]>([]);
+    const [historyData, setHistoryData] = useState<TermRow[]>([]);
+    const [rowsData, setRowsData] = useState<TermRow[]>([]);
     const [cursor, setCursor] = useState({ x: 0, y: 0 });
+    const [palette, setPalette] = useState<Uint32Array>(new Uint32Array(0));
     const [blink, setBlink] = useState(true);
     const [cols, setCols] = useState(calcCols());
     // RuntimeSetup: null = checking, true = show setup, false = go to terminal
@@ -121,6 +210,11 @@ export default function TerminalScreen({ onClose }: TerminalScreenProps) {
     const prootLaunchedRef = useRef(false);
     // Adaptive poll interval: fast when user is typing, slow otherwise
     const lastInputRef = useRef(Date.now());
+    // Palette table version last fetched; refetch only when it changes
+    const paletteVersionRef = useRef(-1);
+    // Screen rows of the last tick by line id; rows that scroll into history
+    // or stay unchanged keep their object (and rendered output)
+    const screenRowsRef = useRef<Map<number, TermRow>>(new Map());
 
     // ── proot auto-launch helper ────────────────────
     // Checks rootfs status and writes the proot entry command to the terminal.
@@ -138,15 +232,19 @@ export default function TerminalScreen({ onClose }: TerminalScreenProps) {
             const prootLoaderBin = `${nativeLibDir}/libproot-loader.so`;
             const rootfsPath = Paths.document.uri.replace('file://', '') + 'rootfs';
             const tmpDir = Paths.cache.uri.replace('file://', '') + 'proot-tmp';
-            // Wait for shell to initialize, then clean line and send command.
+            // Wait for the shell prompt natively, then clean line and send command.
             // Use export to pass PROOT_LOADER (app_lib_file SELinux context = executable),
             // bypassing extract_loader() which fails on Android 10+ W^X restriction.
             // Launch with -l (login shell) so Alpine's /etc/profile sets correct PATH.
             // Do NOT bind Android system binaries — they need bionic libc.
-            setTimeout(() => {
-                const cmd = `\x15mkdir -p "${tmpDir}" && export PROOT_TMP_DIR="${tmpDir}" && export PROOT_LOADER="${prootLoaderBin}" && "${prootBin}" -0 --rootfs="${rootfsPath}" --bind=/dev --bind=/proc --bind=/sys -w /root /bin/sh -l\n`;
-                term.write(cmd);
-            }, 400);
+            const cmd = `\x15mkdir -p "${tmpDir}" && export PROOT_TMP_DIR="${tmpDir}" && export PROOT_LOADER="${prootLoaderBin}" && "${prootBin}" -0 --rootfs="${rootfsPath}" --bind=/dev --bind=/proc --bind=/sys -w /root /bin/sh -l\n`;
+            return term.runScript([
+                { expect: '[$#] $', regex: true, timeoutMs: 5000 },
+                { send: cmd },
+            ]).then((result) => {
+                // Prompt never matched (custom PS1 etc.): send anyway, as before
+                if (!result.ok && result.failedStep === 0) term.write(cmd);
+            });
         }).catch(() => {/* ignore */});
     }
 
@@ -175,35 +273,51 @@ export default function TerminalScreen({ onClose }: TerminalScreenProps) {
             const timeSinceInput = Date.now() - lastInputRef.current;
             pollInterval = timeSinceInput < 2000 ? 80 : 400;
 
-            const buffer = term.getBuffer();
+            const { buffer, lineIds, rows, cols: termCols } = term.getBuffer();
             const sbResult = term.pullScrollback();
+            const paletteVersion = term.getPaletteVersion();
+            if (paletteVersion !== paletteVersionRef.current) {
+                paletteVersionRef.current = paletteVersion;
+                setPalette(term.getPalette());
+            }
 
             // Parse scrollback
+            const prevScreen = screenRowsRef.current;
             if (sbResult?.buffer && sbResult.rowLengths) {
                 const sbView = new Uint32Array(sbResult.buffer);
                 let ptr = 0;
-                const newRows: TextSpan[][] = [];
-                for (const length of sbResult.rowLengths) {
-                    newRows.push(parseCells(sbView, ptr, length));
+                const newRows: TermRow[] = [];
+                sbResult.rowLengths.forEach((length, i) => {
+                    const spans = parseCells(sbView, ptr, length);
+                    newRows.push(reuseRow(prevScreen, sbResult.lineIds[i], spans));
                     ptr += length * 4;
-                }
+                });
                 if (newRows.length > 0) {
                     setHistoryData((prev) => [...prev, ...newRows]);
                 }
             }
 
-            // Parse screen
-            if (buffer && buffer.byteLength > 0) {
+            // Parse screen. Size, cells and line ids come from one native
+            // snapshot, so a resize between polls can't misalign them
+            if (rows > 0 && termCols > 0) {
                 const view = new Uint32Array(buffer);
-                const rows = term.getRows();
-                const termCols = term.getCols();
-                const newRowsData: TextSpan[][] = [];
+                const newRowsData: TermRow[] = [];
+                const screenRows = new Map<number, TermRow>();
                 let idx = 0;
                 for (let r = 0; r < rows; r++) {
-                    newRowsData.push(parseCells(view, idx, termCols));
+                    const row = reuseRow(prevScreen, lineIds[r], parseCells(view, idx, termCols));
+                    newRowsData.push(row);
+                    screenRows.set(row.id, row);
                     idx += termCols * 4;
                 }
-                setRowsData(newRowsData);
+                screenRowsRef.current = screenRows;
+                // Nothing changed on screen: keep the old array so allRows and
+                // the list stay as they are
+                setRowsData((prev) =>
+                    prev.length === rows && prev.every((row, i) => row === newRowsData[i])
+                        ? prev
+                        : newRowsData
+                );
                 setCursor({ x: term.getCursorX(), y: term.getCursorY() });
             }
 
@@ -275,47 +389,20 @@ export default function TerminalScreen({ onClose }: TerminalScreenProps) {
                 <FlatList
                     ref={flatListRef}
                     data={allRows}
-                    keyExtractor={(_, idx) => idx.toString()}
+                    keyExtractor={(item) => item.id.toString()}
                     contentContainerStyle={styles.termContent}
                     onContentSizeChange={() => flatListRef.current?.scrollToEnd({ animated: false })}
                     renderItem={({ item, index }) => {
+                        // Only the cursor row sees cursor / blink changes; the
+                        // others keep their props and skip re-rendering
                         const isCursorRow = index === historyData.length + cursor.y;
                         return (
-                            <View style={styles.termRow}>
-                                {item.map((span: TextSpan, sIdx: number) => {
-                                    const fg = span.reverse ? span.bg : span.fg;
-                                    const bg = span.reverse ? span.fg : span.bg;
-                                    return (
-                                        <Text
-                                            key={sIdx}
-                                            style={{
-                                                fontFamily: Platform.OS === "ios" ? "Courier" : "monospace",
-                                                color: fg,
-                                                backgroundColor: bg === "#000000" ? "transparent" : bg,
-                                                fontSize: FONT_SIZE,
-                                                lineHeight: LINE_HEIGHT,
-                                                fontWeight: span.bold ? "bold" : "normal",
-                                                fontStyle: span.italic ? "italic" : "normal",
-                                                textDecorationLine: span.underline ? "underline" : "none",
-                                            }}
-                                        >
-                                            {span.text}
-                                        </Text>
-                                    );
-                                })}
-                                {/* Cursor */}
-                                {isCursorRow && (
-                                    <View
-                                        style={[
-                                            styles.cursor,
-                                            {
-                                                left: cursor.x * CHAR_WIDTH,
-                                                opacity: blink ? 0.75 : 0,
-                                            },
-                                        ]}
-                                    />
-                                )}
-                            </View>
+                            <TermRowView
+                                row={item}
+                                palette={palette}
+                                cursorX={isCursorRow ? cursor.x : -1}
+                                blink={isCursorRow && blink}
+                            />
                         );
                     }}
                 />
@@ -0,0 +1,199 @@
+// 流式压缩基准：各类终端字节流的压缩率与吞吐。
+//
+// 内置语料模拟常见会话 (编译日志、shell 交互、进度条、全屏 TUI 重绘)，
+// 另可用 --file 传入真实的 PTY 录像 (原始字节流)。每份语料分两种用法：
+//   recording   录像：16KiB 一块编码
+//   interactive 交互传输：按 PTY 读的大小 (1-512 字节) 写入，每次后 idle()
+//
+//   bench_codec [--file path]... [--repeat N]
+#include "bench_util.h"
+#include "stream_codec.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+using namespace pocket::bench;
+using pocket::terminal::StreamCodecOptions;
+using pocket::terminal::StreamCompressor;
+using pocket::terminal::StreamDecompressor;
+
+namespace {
+
+struct Corpus {
+  std::string name;
+  std::string bytes;
+};
+
+std::string shellSession(int commands) {
+  std::string out;
+  uint32_t x = 7;
+  for (int i = 0; i < commands; ++i) {
+    out += "\x1b]133;A\x07\x1b[01;32mroot@localhost\x1b[00m:\x1b[01;34m~/proj"
+           "\x1b[00m# \x1b]133;B\x07ls -l src\r\n\x1b]133;C\x07";
+    out += "total " + std::to_string(40 + i % 7) + "\r\n";
+    for (int f = 0; f < 12; ++f) {
+      x = x * 1103515245u + 12345u;
+      out += "-rw-r--r-- 1 root root " +
+             std::to_string(1000 + (x >> 12) % 90000) + " Oct 18 12:" +
+             std::to_string(10 + f) + " \x1b[0mfile_" + std::to_string(f) +
+             ".cpp\r\n";
+    }
+    out += "\x1b]133;D;0\x07";
+  }
+  return out;
+}
+
+std::string progressBars(int updates) {
+  std::string out;
+  for (int i = 0; i < updates; ++i) {
+    int percent = i % 101;
+    out += "\r\x1b[K\x1b[32m[";
+    out += std::string(percent / 5, '=') + ">" +
+           std::string(20 - percent / 5, ' ');
+    out += "]\x1b[0m " + std::to_string(percent) + "% " +
+           std::to_string(i * 37 % 1000) + " KB/s eta 0:0" +
+           std::to_string(i % 10);
+    if (percent == 100)
+      out += "\r\n";
+  }
+  return out;
+}
+
+// top 一类的全屏刷新：每帧重绘所有行，只有数字在变
+std::string tuiRedraw(int frames, int rows, int cols) {
+  std::string out = "\x1b[?1049h\x1b[?25l";
+  uint32_t x = 3;
+  for (int frame = 0; frame < frames; ++frame) {
+    out += "\x1b[H\x1b[7m PID USER      PR  NI    VIRT    RES  %CPU  COMMAND";
+    out += std::string(std::max(cols - 52, 0), ' ') + "\x1b[0m";
+    for (int row = 2; row <= rows; ++row) {
+      x = x * 1103515245u + 12345u;
+      char line[160];
+      std::snprintf(line, sizeof(line),
+                    "\x1b[%d;1H%5d root      20   0 %7u %6u "
+                    "\x1b[1m%5.1f\x1b[0m  proc_%02d\x1b[K",
+                    row, 100 + row, 100000 + (x >> 10) % 900000,
+                    1000 + (x >> 4) % 90000, ((x >> 16) % 1000) / 10.0, row);
+      out += line;
+    }
+  }
+  return out + "\x1b[?25h\x1b[?1049l";
+}
+
+std::string buildLog(int lines) {
+  std::string out = makeColoredLog(lines / 2, 120);
+  uint32_t x = 11;
+  for (int i = 0; i < lines / 2; ++i) {
+    x = x * 1103515245u + 12345u;
+    out += "[" + std::to_string(i * 100 / (lines / 2)) +
+           "%] \x1b[32mBuilding CXX object src/CMakeFiles/core.dir/module_" +
+           std::to_string((x >> 8) % 300) + ".cpp.o\x1b[0m\r\n";
+    if ((x >> 20) % 16 == 0)
+      out += "\x1b[1m/src/module.cpp:" + std::to_string((x >> 4) % 900) +
+             ":12: \x1b[35mwarning: \x1b[0munused variable 'tmp'\r\n";
+  }
+  return out;
+}
+
+std::string randomBytes(size_t len) {
+  std::string out(len, '\0');
+  uint32_t x = 5;
+  for (char &c : out) {
+    x = x * 1103515245u + 12345u;
+    c = static_cast<char>(x >> 16);
+  }
+  return out;
+}
+
+struct Result {
+  size_t packed;
+  double compressMBs;
+  double decompressMBs;
+  bool ok;
+};
+
+Result run(const std::string &input, bool interactive, int repeat) {
+  StreamCodecOptions options;
+  options.flushOnIdle = interactive;
+  Result result{0, 0, 0, true};
+  uint64_t compressNs = 0, decompressNs = 0;
+  for (int r = 0; r < repeat; ++r) {
+    StreamCompressor compressor(options);
+    std::string packed;
+    packed.reserve(input.size() / 2);
+    uint32_t x = 9;
+    uint64_t start = nowNs();
+    if (interactive) {
+      for (size_t pos = 0; pos < input.size();) {
+        x = x * 1103515245u + 12345u;
+        size_t len = std::min<size_t>(input.size() - pos, 1 + (x >> 8) % 512);
+        compressor.write(input.data() + pos, len, packed);
+        compressor.idle(packed);
+        pos += len;
+      }
+    } else {
+      compressor.write(input.data(), input.size(), packed);
+    }
+    compressor.flush(packed);
+    compressNs += nowNs() - start;
+
+    StreamDecompressor decompressor;
+    std::string out;
+    out.reserve(input.size());
+    start = nowNs();
+    result.ok = decompressor.write(packed.data(), packed.size(), out) &&
+                out == input && result.ok;
+    decompressNs += nowNs() - start;
+    result.packed = packed.size();
+  }
+  double mb = static_cast<double>(input.size()) * repeat / (1 << 20);
+  result.compressMBs = mb / (compressNs / 1e9);
+  result.decompressMBs = mb / (decompressNs / 1e9);
+  return result;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::vector<Corpus> corpora = {
+      {"build_log", buildLog(40000)},
+      {"shell_session", shellSession(2000)},
+      {"progress_bars", progressBars(40000)},
+      {"tui_redraw", tuiRedraw(300, 50, 160)},
+      {"random", randomBytes(4 << 20)},
+  };
+  int repeat = 3;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!std::strcmp(argv[i], "--repeat")) {
+      repeat = std::max(std::atoi(argv[i + 1]), 1);
+    } else if (!std::strcmp(argv[i], "--file")) {
+      std::ifstream file(argv[i + 1], std::ios::binary);
+      if (!file) {
+        std::fprintf(stderr, "cannot open %s\n", argv[i + 1]);
+        return 1;
+      }
+      std::ostringstream bytes;
+      bytes << file.rdbuf();
+      corpora.push_back({argv[i + 1], bytes.str()});
+    }
+  }
+
+  std::printf("%-16s %-12s %10s %10s %8s %10s %10s\n", "corpus", "mode",
+              "bytes", "packed", "ratio", "comp MB/s", "decomp MB/s");
+  bool ok = true;
+  for (const Corpus &corpus : corpora) {
+    for (bool interactive : {false, true}) {
+      Result r = run(corpus.bytes, interactive, repeat);
+      ok = ok && r.ok;
+      std::printf("%-16s %-12s %10zu %10zu %7.1f%% %10.1f %10.1f%s\n",
+                  corpus.name.c_str(),
+                  interactive ? "interactive" : "recording",
+                  corpus.bytes.size(), r.packed,
+                  100.0 * r.packed / std::max<size_t>(corpus.bytes.size(), 1),
+                  r.compressMBs, r.decompressMBs, r.ok ? "" : "  MISMATCH");
+    }
+  }
+  return ok ? 0 : 1;
+}
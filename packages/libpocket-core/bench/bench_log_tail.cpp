@@ -0,0 +1,81 @@
+// 历史推入吞吐基准：模拟 tail -f 一份带颜色级别的服务日志，
+// 每行都会滚出屏幕进入原生历史。按 16ms 一帧的节奏 pullScrollback，
+// 与 JS 侧取历史的方式一致
+#include "bench_util.h"
+#include "pocket_terminal.h"
+#include <cstdio>
+
+using namespace pocket::bench;
+using pocket::terminal::PocketTerminal;
+using pocket::terminal::TerminalCell;
+
+namespace {
+
+struct Size {
+  int rows;
+  int cols;
+};
+
+const Size kSizes[] = {{24, 80}, {50, 160}, {100, 300}};
+const int kLines = 200000;
+// 约 16ms 的 PTY 读取量
+const size_t kChunkBytes = 64 * 1024;
+
+// 时间戳 + 彩色级别 + 模块名 + 长短不一的消息，偶尔有 WARN / ERROR
+std::string makeLogTail(int lines, uint32_t seed = 7) {
+  static const char *const kLevels[] = {
+      "\x1b[32mINFO \x1b[0m", "\x1b[36mDEBUG\x1b[0m", "\x1b[33mWARN \x1b[0m",
+      "\x1b[1;31mERROR\x1b[0m"};
+  static const char *const kWords[] = {"request", "handled", "id=4f2a",
+                                       "status=200", "took", "12ms",
+                                       "cache", "miss", "upstream", "retry"};
+  std::string out;
+  uint32_t x = seed;
+  char stamp[64];
+  for (int i = 0; i < lines; ++i) {
+    x = x * 1103515245u + 12345u;
+    std::snprintf(stamp, sizeof(stamp),
+                  "\x1b[2m2026-10-18T12:%02d:%02d.%03dZ\x1b[0m ", (i / 60000) % 60,
+                  (i / 1000) % 60, i % 1000);
+    out += stamp;
+    uint32_t level = (x >> 8) % 20;
+    out += kLevels[level < 12 ? 0 : level < 16 ? 1 : level < 19 ? 2 : 3];
+    out += " [worker-" + std::to_string((x >> 4) % 8) + "] ";
+    int words = 3 + static_cast<int>((x >> 12) % 12);
+    for (int w = 0; w < words; ++w) {
+      out += kWords[(x >> (w % 16)) % 10];
+      out += ' ';
+    }
+    out += "\r\n";
+  }
+  return out;
+}
+
+double benchLogTail(Size size, const std::string &log) {
+  PocketTerminal term(size.rows, size.cols);
+  std::vector<TerminalCell> cells;
+  std::vector<int> rowLengths;
+
+  uint64_t start = nowNs();
+  for (size_t offset = 0; offset < log.size(); offset += kChunkBytes) {
+    term.writeInput(log.data() + offset,
+                    std::min(kChunkBytes, log.size() - offset));
+    term.pullScrollback(cells, rowLengths);
+  }
+  uint64_t elapsed = nowNs() - start;
+  return kLines / (elapsed / 1e9);
+}
+
+} // namespace
+
+int main() {
+  std::string log = makeLogTail(kLines);
+  std::printf("%d lines, %.1f MB\n", kLines, log.size() / 1e6);
+  std::printf("%-10s %14s\n", "size", "lines/s");
+  for (Size size : kSizes) {
+    char label[32];
+    std::snprintf(label, sizeof(label), "%dx%d", size.rows, size.cols);
+    std::printf("%-10s %14.0f\n", label, benchLogTail(size, log));
+  }
+  return 0;
+}
@@ -0,0 +1,389 @@
+// 尺寸 × 负载的基准矩阵：从竖屏手机 (40 列) 到平板桌面模式 (300x100)，
+// 每帧模拟一次 PTY 读取 + 一次取帧 (copyBufferOut + pullScrollback)，
+// 与 JS 侧每帧的调用顺序一致。输出每帧耗时、会话内存与随格数的缩放曲线。
+//
+//   bench_matrix [--frames N] [--json out.json]
+//                [--compare baseline.json] [--tolerance 0.3]
+//
+// --compare 读入之前 --json 的结果，任一项每帧中位数或缩放斜率超出容差时
+// 打印 REGRESSION 并以 1 退出，便于在 CI 上发现只在大尺寸出现的退化
+#include "bench_util.h"
+#include "pocket_terminal.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+using namespace pocket::bench;
+using pocket::terminal::PocketTerminal;
+using pocket::terminal::TerminalCell;
+
+namespace {
+
+struct Size {
+  int rows;
+  int cols;
+};
+
+const Size kSizes[] = {{40, 40},  {24, 80},  {50, 120},
+                       {50, 160}, {60, 200}, {100, 300}};
+
+enum class Workload {
+  AsciiTail, // 纯文本日志滚动
+  Colored,   // 带 SGR 颜色的输出滚动
+  TuiRedraw, // 全屏 TUI (htop / vim) 逐行定位重绘
+  Resize,    // 旋转 / 分屏拖拽：每帧一次 resize 加少量输出
+  Altscreen, // 进出备用屏幕 (less、vim 启动与退出)
+};
+
+const struct {
+  Workload workload;
+  const char *name;
+} kWorkloads[] = {
+    {Workload::AsciiTail, "ascii_tail"}, {Workload::Colored, "colored"},
+    {Workload::TuiRedraw, "tui_redraw"}, {Workload::Resize, "resize"},
+    {Workload::Altscreen, "altscreen"},
+};
+
+struct Result {
+  std::string workload;
+  int rows{0};
+  int cols{0};
+  int frames{0};
+  double parseUs{0};   // 每帧 writeInput 平均
+  double pullUs{0};    // 每帧取帧平均
+  double frameP50{0};  // 每帧合计中位数
+  double frameP99{0};
+  size_t inputBytes{0}; // 每帧平均输入
+  size_t memoryBytes{0};
+};
+
+// 每帧约等于一次 PTY 读取：滚动类负载为一屏高的行数
+std::string asciiFrame(Size size, int frame) {
+  std::string out;
+  uint32_t x = frame * 2654435761u + 1;
+  for (int i = 0; i < size.rows; ++i) {
+    x = x * 1103515245u + 12345u;
+    int width = static_cast<int>((x >> 8) % static_cast<uint32_t>(size.cols));
+    for (int c = 0; c < width; ++c)
+      out += static_cast<char>('a' + (c + i + frame) % 26);
+    out += "\r\n";
+  }
+  return out;
+}
+
+// 每行一个状态栏：反显标题、彩色数字列，最后一行留空白
+std::string tuiFrame(Size size, int frame) {
+  std::string out = "\x1b[H";
+  char buf[64];
+  for (int row = 0; row < size.rows; ++row) {
+    std::snprintf(buf, sizeof(buf), "\x1b[%d;1H", row + 1);
+    out += buf;
+    if (row == 0) {
+      out += "\x1b[7m";
+      out.append(size.cols, ' ');
+      out += "\x1b[0m";
+      continue;
+    }
+    int col = 0;
+    for (int field = 0; col < size.cols - 8; ++field) {
+      std::snprintf(buf, sizeof(buf), "\x1b[3%dm%7d ", (row + field) % 8,
+                    (row * 131 + field * 17 + frame * 7) % 1000000);
+      out += buf;
+      col += 8;
+    }
+    out += "\x1b[0m\x1b[K";
+  }
+  return out;
+}
+
+std::string frameInput(Workload workload, Size size, int frame) {
+  switch (workload) {
+  case Workload::AsciiTail:
+    return asciiFrame(size, frame);
+  case Workload::Colored:
+    return makeColoredLog(size.rows, size.cols, frame + 1);
+  case Workload::TuiRedraw:
+    return tuiFrame(size, frame);
+  case Workload::Resize:
+    return makeColoredLog(4, size.cols, frame + 1);
+  case Workload::Altscreen:
+    return "\x1b[?1049h" + tuiFrame(size, frame) + "\x1b[?1049l";
+  }
+  return std::string();
+}
+
+Result runCase(Workload workload, const char *name, Size size, int frames) {
+  PocketTerminal term(size.rows, size.cols);
+  std::vector<TerminalCell> screen;
+  std::vector<TerminalCell> history;
+  std::vector<int> rowLengths;
+
+  // 先铺满屏幕与一部分历史，避免测到空终端
+  std::string warmup = makeColoredLog(size.rows * 4, size.cols);
+  term.writeInput(warmup.data(), warmup.size());
+
+  // 输入预先生成，不计入耗时
+  std::vector<std::string> inputs;
+  for (int i = 0; i < frames; ++i)
+    inputs.push_back(frameInput(workload, size, i));
+
+  Result result;
+  result.workload = name;
+  result.rows = size.rows;
+  result.cols = size.cols;
+  result.frames = frames;
+
+  std::vector<uint64_t> totals;
+  uint64_t parseNs = 0, pullNs = 0;
+  size_t inputBytes = 0;
+  for (int i = 0; i < frames; ++i) {
+    int rows = size.rows, cols = size.cols;
+    uint64_t start = nowNs();
+    if (workload == Workload::Resize) {
+      // 偶数帧旋转为 2/3 宽，奇数帧转回
+      if (i % 2 == 0) {
+        rows = size.rows * 3 / 2;
+        cols = std::max(size.cols * 2 / 3, 1);
+      }
+      term.resize(rows, cols);
+    }
+    term.writeInput(inputs[i].data(), inputs[i].size());
+    uint64_t parsed = nowNs();
+
+    screen.resize(static_cast<size_t>(rows) * cols);
+    term.copyBufferOut(screen.data(), screen.size() * sizeof(TerminalCell));
+    term.pullScrollback(history, rowLengths);
+    uint64_t end = nowNs();
+
+    parseNs += parsed - start;
+    pullNs += end - parsed;
+    totals.push_back(end - start);
+    inputBytes += inputs[i].size();
+  }
+
+  result.parseUs = parseNs / 1000.0 / frames;
+  result.pullUs = pullNs / 1000.0 / frames;
+  result.frameP50 = percentile(totals, 0.5) / 1000.0;
+  result.frameP99 = percentile(totals, 0.99) / 1000.0;
+  result.inputBytes = inputBytes / frames;
+  result.memoryBytes = term.getMemoryUsage();
+  return result;
+}
+
+// 每帧中位数对格数的缩放：线性拟合 frame = fixed + perCell * cells，
+// 以及 log-log 斜率 (1 为线性，明显大于 1 说明有随尺寸超线性增长的路径)
+struct Scaling {
+  std::string workload;
+  double fixedUs{0};
+  double nsPerCell{0};
+  double exponent{0};
+};
+
+// 最小二乘直线，返回斜率与截距
+bool fitLine(const std::vector<double> &xs, const std::vector<double> &ys,
+             double &slope, double &intercept) {
+  double n = xs.size(), sx = 0, sy = 0, sxx = 0, sxy = 0;
+  for (size_t i = 0; i < xs.size(); ++i) {
+    sx += xs[i];
+    sy += ys[i];
+    sxx += xs[i] * xs[i];
+    sxy += xs[i] * ys[i];
+  }
+  double denom = n * sxx - sx * sx;
+  if (n < 2 || denom == 0)
+    return false;
+  slope = (n * sxy - sx * sy) / denom;
+  intercept = (sy - slope * sx) / n;
+  return true;
+}
+
+Scaling fitScaling(const std::string &workload,
+                   const std::vector<Result> &results) {
+  std::vector<double> cells, frameUs, logCells, logFrameUs;
+  for (const Result &r : results) {
+    if (r.workload != workload || r.frameP50 <= 0)
+      continue;
+    cells.push_back(static_cast<double>(r.rows) * r.cols);
+    frameUs.push_back(r.frameP50);
+    logCells.push_back(std::log(cells.back()));
+    logFrameUs.push_back(std::log(r.frameP50));
+  }
+  Scaling scaling;
+  scaling.workload = workload;
+  double slope, intercept;
+  if (fitLine(cells, frameUs, slope, intercept)) {
+    scaling.nsPerCell = slope * 1000.0;
+    scaling.fixedUs = intercept;
+  }
+  if (fitLine(logCells, logFrameUs, slope, intercept))
+    scaling.exponent = slope;
+  return scaling;
+}
+
+std::string toJson(const std::vector<Result> &results,
+                   const std::vector<Scaling> &scalings) {
+  std::string out = "{\n  \"results\": [\n";
+  char buf[512];
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result &r = results[i];
+    std::snprintf(buf, sizeof(buf),
+                  "    {\"workload\": \"%s\", \"rows\": %d, \"cols\": %d, "
+                  "\"cells\": %d, \"frames\": %d, \"parse_us\": %.2f, "
+                  "\"pull_us\": %.2f, \"frame_us_p50\": %.2f, "
+                  "\"frame_us_p99\": %.2f, \"input_bytes\": %zu, "
+                  "\"memory_bytes\": %zu}%s\n",
+                  r.workload.c_str(), r.rows, r.cols, r.rows * r.cols,
+                  r.frames, r.parseUs, r.pullUs, r.frameP50, r.frameP99,
+                  r.inputBytes, r.memoryBytes,
+                  i + 1 < results.size() ? "," : "");
+    out += buf;
+  }
+  out += "  ],\n  \"scaling\": [\n";
+  for (size_t i = 0; i < scalings.size(); ++i) {
+    const Scaling &s = scalings[i];
+    std::snprintf(buf, sizeof(buf),
+                  "    {\"workload\": \"%s\", \"fixed_us\": %.2f, "
+                  "\"ns_per_cell\": %.3f, \"exponent\": %.3f}%s\n",
+                  s.workload.c_str(), s.fixedUs, s.nsPerCell, s.exponent,
+                  i + 1 < scalings.size() ? "," : "");
+    out += buf;
+  }
+  out += "  ]\n}\n";
+  return out;
+}
+
+// 只读回 toJson 自己写出的格式：逐行找 "key": value
+double jsonNumber(const std::string &line, const char *key) {
+  std::string pattern = std::string("\"") + key + "\": ";
+  size_t pos = line.find(pattern);
+  if (pos == std::string::npos)
+    return NAN;
+  return std::strtod(line.c_str() + pos + pattern.size(), nullptr);
+}
+
+std::string jsonString(const std::string &line, const char *key) {
+  std::string pattern = std::string("\"") + key + "\": \"";
+  size_t pos = line.find(pattern);
+  if (pos == std::string::npos)
+    return std::string();
+  pos += pattern.size();
+  return line.substr(pos, line.find('"', pos) - pos);
+}
+
+// 与基线比较，返回退化项数
+int compareBaseline(const char *path, const std::vector<Result> &results,
+                    const std::vector<Scaling> &scalings, double tolerance) {
+  std::ifstream in(path);
+  if (!in) {
+    std::fprintf(stderr, "cannot read baseline %s\n", path);
+    return 1;
+  }
+  int regressions = 0;
+  auto check = [&](const std::string &label, double base, double now) {
+    if (std::isnan(base) || base <= 0)
+      return;
+    double ratio = now / base;
+    if (ratio > 1 + tolerance) {
+      std::printf("REGRESSION %-28s %10.2f -> %10.2f (%+.0f%%)\n",
+                  label.c_str(), base, now, (ratio - 1) * 100);
+      regressions++;
+    }
+  };
+
+  std::string line;
+  while (std::getline(in, line)) {
+    std::string workload = jsonString(line, "workload");
+    if (workload.empty())
+      continue;
+    if (line.find("\"ns_per_cell\"") != std::string::npos) {
+      for (const Scaling &s : scalings) {
+        if (s.workload == workload)
+          check(workload + " ns/cell", jsonNumber(line, "ns_per_cell"),
+                s.nsPerCell);
+      }
+      continue;
+    }
+    int rows = static_cast<int>(jsonNumber(line, "rows"));
+    int cols = static_cast<int>(jsonNumber(line, "cols"));
+    for (const Result &r : results) {
+      if (r.workload == workload && r.rows == rows && r.cols == cols)
+        check(workload + " " + std::to_string(rows) + "x" +
+                  std::to_string(cols),
+              jsonNumber(line, "frame_us_p50"), r.frameP50);
+    }
+  }
+  return regressions;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int frames = 200;
+  const char *jsonPath = nullptr;
+  const char *baselinePath = nullptr;
+  double tolerance = 0.3;
+  for (int i = 1; i < argc; ++i) {
+    if (!std::strcmp(argv[i], "--frames") && i + 1 < argc)
+      frames = std::max(std::atoi(argv[++i]), 1);
+    else if (!std::strcmp(argv[i], "--json") && i + 1 < argc)
+      jsonPath = argv[++i];
+    else if (!std::strcmp(argv[i], "--compare") && i + 1 < argc)
+      baselinePath = argv[++i];
+    else if (!std::strcmp(argv[i], "--tolerance") && i + 1 < argc)
+      tolerance = std::atof(argv[++i]);
+    else {
+      std::fprintf(stderr,
+                   "usage: %s [--frames N] [--json out.json] "
+                   "[--compare baseline.json] [--tolerance 0.3]\n",
+                   argv[0]);
+      return 2;
+    }
+  }
+
+  std::vector<Result> results;
+  std::vector<Scaling> scalings;
+  std::printf("%-11s %-9s %10s %10s %10s %10s %10s %10s\n", "workload",
+              "size", "parse(us)", "pull(us)", "p50(us)", "p99(us)",
+              "in(B)", "mem(KB)");
+  for (const auto &w : kWorkloads) {
+    for (Size size : kSizes) {
+      Result r = runCase(w.workload, w.name, size, frames);
+      char label[32];
+      std::snprintf(label, sizeof(label), "%dx%d", size.rows, size.cols);
+      std::printf("%-11s %-9s %10.1f %10.1f %10.1f %10.1f %10zu %10zu\n",
+                  w.name, label, r.parseUs, r.pullUs, r.frameP50, r.frameP99,
+                  r.inputBytes, r.memoryBytes / 1024);
+      results.push_back(r);
+    }
+    scalings.push_back(fitScaling(w.name, results));
+  }
+
+  std::printf("\n%-11s %10s %12s %10s\n", "workload", "fixed(us)", "ns/cell",
+              "exponent");
+  for (const Scaling &s : scalings)
+    std::printf("%-11s %10.1f %12.3f %10.2f\n", s.workload.c_str(), s.fixedUs,
+                s.nsPerCell, s.exponent);
+
+  if (jsonPath) {
+    std::ofstream out(jsonPath);
+    out << toJson(results, scalings);
+    if (!out) {
+      std::fprintf(stderr, "cannot write %s\n", jsonPath);
+      return 1;
+    }
+  }
+
+  if (baselinePath) {
+    int regressions =
+        compareBaseline(baselinePath, results, scalings, tolerance);
+    if (regressions > 0) {
+      std::printf("%d regression(s) over %.0f%%\n", regressions,
+                  tolerance * 100);
+      return 1;
+    }
+    std::printf("no regressions over %.0f%%\n", tolerance * 100);
+  }
+  return 0;
+}
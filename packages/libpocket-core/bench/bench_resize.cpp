@@ -0,0 +1,90 @@
+// resize 延迟基准：模拟平板旋转 (行列互换) 与分屏拖拽 (逐列收缩)
+// 分别测量裸 libvterm (reflow 开/关) 与 PocketTerminal::resize 的端到端耗时
+#include "bench_util.h"
+#include "pocket_terminal.h"
+#include <cstdio>
+
+using namespace pocket::bench;
+using pocket::terminal::PocketTerminal;
+
+namespace {
+
+struct Size {
+  int rows;
+  int cols;
+};
+
+const Size kSizes[] = {{24, 40}, {30, 80}, {50, 160}, {100, 300}};
+const int kIterations = 200;
+
+int onSbPushLine(int, const VTermScreenCell *, void *) { return 1; }
+
+// 裸 libvterm：隔离出 screen.c resize_buffer 本身的开销
+double benchVterm(Size size, bool reflow, bool drag) {
+  VTerm *vt = vterm_new(size.rows, size.cols);
+  vterm_set_utf8(vt, 1);
+  VTermScreen *screen = vterm_obtain_screen(vt);
+  vterm_screen_enable_altscreen(screen, 1);
+  vterm_screen_enable_reflow(screen, reflow);
+  static VTermScreenCallbacks cb = {};
+  cb.sb_pushline = onSbPushLine;
+  vterm_screen_set_callbacks(screen, &cb, nullptr);
+  vterm_screen_reset(screen, 1);
+
+  std::string log = makeColoredLog(size.rows * 2, size.cols * 2);
+  vterm_input_write(vt, log.data(), log.size());
+
+  uint64_t total = 0;
+  for (int i = 0; i < kIterations; ++i) {
+    Size next = size;
+    if (drag)
+      next.cols = size.cols - (i % 20);
+    else if (i % 2 == 0)
+      next = {size.rows * 3 / 2, size.cols * 2 / 3};
+
+    uint64_t start = nowNs();
+    vterm_set_size(vt, next.rows, next.cols);
+    total += nowNs() - start;
+
+    // 每次 resize 后补一些输出，保证下一次 reflow 面对的是满屏内容
+    vterm_input_write(vt, log.data(), std::min<size_t>(log.size(), 4096));
+  }
+
+  vterm_free(vt);
+  return total / 1000.0 / kIterations;
+}
+
+// PocketTerminal：包含锁、cellBuffer 重分配与整屏 onDamage 转换
+double benchPocketTerminal(Size size) {
+  PocketTerminal term(size.rows, size.cols);
+  std::string log = makeColoredLog(size.rows * 2, size.cols * 2);
+  term.writeInput(log.data(), log.size());
+
+  uint64_t total = 0;
+  for (int i = 0; i < kIterations; ++i) {
+    int rows = (i % 2 == 0) ? size.rows * 3 / 2 : size.rows;
+    int cols = (i % 2 == 0) ? size.cols * 2 / 3 : size.cols;
+
+    uint64_t start = nowNs();
+    term.resize(rows, cols);
+    total += nowNs() - start;
+
+    term.writeInput(log.data(), std::min<size_t>(log.size(), 4096));
+  }
+  return total / 1000.0 / kIterations;
+}
+
+} // namespace
+
+int main() {
+  std::printf("%-10s %14s %14s %14s %14s\n", "size", "rotate(us)",
+              "rotate+rf(us)", "drag+rf(us)", "terminal(us)");
+  for (Size size : kSizes) {
+    char label[32];
+    std::snprintf(label, sizeof(label), "%dx%d", size.rows, size.cols);
+    std::printf("%-10s %14.1f %14.1f %14.1f %14.1f\n", label,
+                benchVterm(size, false, false), benchVterm(size, true, false),
+                benchVterm(size, true, true), benchPocketTerminal(size));
+  }
+  return 0;
+}
@@ -0,0 +1,137 @@
+// 屏幕层吞吐基准：screen.c + VTermScreenCallbacks 对比 StaticScreen
+// 两边都把 damage 转成 TerminalCell，以贴近 PocketTerminal 的实际工作量
+#include "bench_util.h"
+#include "static_screen.h"
+#include <cstdio>
+
+using namespace pocket::bench;
+using pocket::terminal::colorCode;
+using pocket::terminal::ScreenSinkBase;
+using pocket::terminal::StaticScreen;
+using pocket::terminal::TerminalCell;
+
+namespace {
+
+struct Size {
+  int rows;
+  int cols;
+};
+
+const Size kSizes[] = {{24, 80}, {50, 160}, {100, 300}};
+const int kRounds = 20;
+
+// ============== C 屏幕层：回调 + vterm_screen_get_cell 转换 ==============
+
+struct CScreenCtx {
+  VTermScreen *screen;
+  std::vector<TerminalCell> cells;
+  int cols;
+};
+
+int onCDamage(VTermRect rect, void *user) {
+  auto *ctx = static_cast<CScreenCtx *>(user);
+  VTermScreenCell cell;
+  for (int row = rect.start_row; row < rect.end_row; row++) {
+    for (int col = rect.start_col; col < rect.end_col; col++) {
+      vterm_screen_get_cell(ctx->screen, {row, col}, &cell);
+      TerminalCell &out = ctx->cells[row * ctx->cols + col];
+      out.ch = cell.chars[0];
+      out.fg = colorCode(cell.fg);
+      out.bg = colorCode(cell.bg);
+      out.flags = (cell.attrs.bold ? 1 : 0) | (cell.attrs.underline ? 2 : 0) |
+                  (cell.attrs.italic ? 4 : 0) | (cell.attrs.reverse ? 16 : 0) |
+                  (cell.width << 8);
+    }
+  }
+  return 1;
+}
+
+int onCPushLine(int, const VTermScreenCell *, void *) { return 1; }
+
+double benchCScreen(Size size, const std::string &input) {
+  VTerm *vt = vterm_new(size.rows, size.cols);
+  vterm_set_utf8(vt, 1);
+  VTermScreen *screen = vterm_obtain_screen(vt);
+  vterm_screen_enable_altscreen(screen, 1);
+  CScreenCtx ctx{screen,
+                 std::vector<TerminalCell>(size.rows * size.cols), size.cols};
+  static VTermScreenCallbacks cb = {};
+  cb.damage = onCDamage;
+  cb.sb_pushline = onCPushLine;
+  vterm_screen_set_callbacks(screen, &cb, &ctx);
+  vterm_screen_set_damage_merge(screen, VTERM_DAMAGE_SCROLL);
+  vterm_screen_reset(screen, 1);
+
+  uint64_t start = nowNs();
+  for (int i = 0; i < kRounds; ++i) {
+    vterm_input_write(vt, input.data(), input.size());
+    vterm_screen_flush_damage(screen);
+  }
+  uint64_t elapsed = nowNs() - start;
+
+  vterm_free(vt);
+  return input.size() * kRounds / (elapsed / 1e9) / (1 << 20);
+}
+
+// ============== StaticScreen：单元格本身就是 TerminalCell ==============
+
+struct CopySink : ScreenSinkBase {
+  static constexpr bool kHasScrollback = true;
+
+  const StaticScreen<CopySink> *screen{nullptr};
+  std::vector<TerminalCell> cells;
+  size_t pushed{0};
+
+  void damage(VTermRect rect) {
+    int cols = screen->cols();
+    for (int row = rect.start_row; row < rect.end_row; row++) {
+      std::memcpy(&cells[row * cols + rect.start_col],
+                  screen->cell(row, rect.start_col),
+                  (rect.end_col - rect.start_col) * sizeof(TerminalCell));
+    }
+  }
+
+  void pushLine(const TerminalCell *, int cols, bool) { pushed += cols; }
+};
+
+double benchStaticScreen(Size size, const std::string &input) {
+  VTerm *vt = vterm_new(size.rows, size.cols);
+  vterm_set_utf8(vt, 1);
+  CopySink sink;
+  sink.cells.resize(size.rows * size.cols);
+  uint64_t elapsed;
+  {
+    StaticScreen<CopySink> screen(vt, sink);
+    sink.screen = &screen;
+    screen.enableAltscreen(true);
+    screen.setDamageMerge(VTERM_DAMAGE_SCROLL);
+    screen.reset(true);
+
+    uint64_t start = nowNs();
+    for (int i = 0; i < kRounds; ++i) {
+      vterm_input_write(vt, input.data(), input.size());
+      screen.flushDamage();
+    }
+    elapsed = nowNs() - start;
+  }
+
+  vterm_free(vt);
+  return input.size() * kRounds / (elapsed / 1e9) / (1 << 20);
+}
+
+} // namespace
+
+int main() {
+  std::printf("%-10s %14s %14s %10s\n", "size", "c-screen(MB/s)",
+              "static(MB/s)", "speedup");
+  for (Size size : kSizes) {
+    std::string input = makeColoredLog(size.rows * 40, size.cols);
+    double c = benchCScreen(size, input);
+    double s = benchStaticScreen(size, input);
+
+    char label[32];
+    std::snprintf(label, sizeof(label), "%dx%d", size.rows, size.cols);
+    std::printf("%-10s %14.1f %14.1f %9.2fx\n", label, c, s, s / c);
+  }
+  return 0;
+}
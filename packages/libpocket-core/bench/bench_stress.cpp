@@ -0,0 +1,192 @@
+// 并发压力基准：PTY 洪泛时 JS 线程的卡顿。
+//
+// 生产线程以读线程的粒度 (每次 4096 字节，一次持锁) 不停写入彩色日志；
+// 消费线程按 60 Hz 调用公开 API：取帧 (copyBufferOut)、pullScrollback、
+// 键盘输入 (writeInput)，并随机 resize。统计消费侧每类调用的延迟百分位与
+// 超出 16.7ms 帧预算的次数。以 -DPOCKET_CORE_LOCK_STATS=ON 构建时另外输出
+// m_vtermMutex 的等锁 / 持锁分布。
+//
+//   bench_stress [--seconds N] [--rows R] [--cols C] [--resize-every N]
+#include "bench_util.h"
+#include "pocket_terminal.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+using namespace pocket::bench;
+using pocket::terminal::PocketTerminal;
+using pocket::terminal::TerminalCell;
+
+namespace {
+
+// 与 readerLoop 的读缓冲相同
+const size_t kChunkBytes = 4096;
+const uint64_t kFrameNs = 16666667;
+
+struct Options {
+  int seconds{5};
+  int rows{50};
+  int cols{160};
+  int resizeEvery{30}; // 平均每多少帧 resize 一次
+};
+
+enum Call { kFrame, kCopy, kPull, kWrite, kResize, kCallCount };
+
+const char *const kCallNames[kCallCount] = {"frame", "copyBufferOut",
+                                            "pullScrollback", "writeInput",
+                                            "resize"};
+
+void printLatency(const char *name, std::vector<uint64_t> &samples) {
+  if (samples.empty()) {
+    std::printf("%-16s %8s\n", name, "-");
+    return;
+  }
+  double max = percentile(samples, 1.0);
+  std::printf("%-16s %8zu %10.1f %10.1f %10.1f %10.1f %10.1f\n", name,
+              samples.size(), percentile(samples, 0.5) / 1000,
+              percentile(samples, 0.9) / 1000,
+              percentile(samples, 0.99) / 1000,
+              percentile(samples, 0.999) / 1000, max / 1000);
+}
+
+#ifdef POCKET_CORE_LOCK_STATS
+using pocket::terminal::LockStats;
+
+void printHistogram(const char *name,
+                    const uint64_t (&histogram)[LockStats::kBuckets],
+                    uint64_t max) {
+  // 格的上界可能超过实测最大值，截到 max
+  auto at = [&](double p) {
+    return std::min(LockStats::percentile(histogram, p), max) / 1000.0;
+  };
+  std::printf("%-6s %10.1f %10.1f %10.1f %10.1f %10.1f\n", name, at(0.5),
+              at(0.9), at(0.99), at(0.999), max / 1000.0);
+}
+
+void printLockStats(PocketTerminal &term, double seconds) {
+  LockStats stats;
+  term.getLockStats(stats);
+  std::printf("\nm_vtermMutex: %llu acquisitions, %.1f%% contended, "
+              "held %.1f%% of wall time\n",
+              static_cast<unsigned long long>(stats.acquisitions),
+              stats.acquisitions ? 100.0 * stats.contended / stats.acquisitions
+                                 : 0.0,
+              100.0 * stats.totalHoldNs / (seconds * 1e9));
+  std::printf("%-6s %10s %10s %10s %10s %10s\n", "(us)", "p50", "p90", "p99",
+              "p99.9", "max");
+  printHistogram("hold", stats.holdNs, stats.maxHoldNs);
+  printHistogram("wait", stats.waitNs, stats.maxWaitNs);
+  std::printf("(bucketed by powers of two; wait covers contended "
+              "acquisitions only)\n");
+}
+#endif
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    int value = std::atoi(argv[i + 1]);
+    if (!std::strcmp(argv[i], "--seconds"))
+      options.seconds = std::max(value, 1);
+    else if (!std::strcmp(argv[i], "--rows"))
+      options.rows = std::max(value, 2);
+    else if (!std::strcmp(argv[i], "--cols"))
+      options.cols = std::max(value, 2);
+    else if (!std::strcmp(argv[i], "--resize-every"))
+      options.resizeEvery = std::max(value, 0);
+  }
+
+  PocketTerminal term(options.rows, options.cols);
+  std::string log = makeColoredLog(20000, options.cols * 3 / 2);
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> produced{0};
+
+#ifdef POCKET_CORE_LOCK_STATS
+  term.resetLockStats();
+#endif
+
+  std::thread producer([&] {
+    size_t offset = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      size_t len = std::min(kChunkBytes, log.size() - offset);
+      term.writeInput(log.data() + offset, len);
+      produced.fetch_add(len, std::memory_order_relaxed);
+      offset = (offset + len) % log.size();
+    }
+  });
+
+  std::vector<uint64_t> latency[kCallCount];
+  std::vector<TerminalCell> screen;
+  std::vector<TerminalCell> history;
+  std::vector<int> rowLengths;
+  uint32_t x = 12345;
+  int rows = options.rows, cols = options.cols;
+  int missed = 0;
+
+  auto timed = [&](Call call, auto &&fn) {
+    uint64_t start = nowNs();
+    fn();
+    latency[call].push_back(nowNs() - start);
+  };
+
+  uint64_t begin = nowNs();
+  uint64_t deadline =
+      begin + static_cast<uint64_t>(options.seconds) * 1000000000ull;
+  uint64_t nextFrame = begin;
+  while (nowNs() < deadline) {
+    uint64_t frameStart = nowNs();
+    x = x * 1103515245u + 12345u;
+
+    if (options.resizeEvery > 0 &&
+        (x >> 8) % static_cast<uint32_t>(options.resizeEvery) == 0) {
+      // 在原尺寸的一半到 1.5 倍之间随机
+      rows = options.rows / 2 + static_cast<int>((x >> 12) % options.rows);
+      cols = options.cols / 2 + static_cast<int>((x >> 20) % options.cols);
+      timed(kResize, [&] { term.resize(rows, cols); });
+    }
+    if ((x >> 16) % 4 == 0)
+      timed(kWrite, [&] { term.writeInput("k", 1); });
+
+    screen.resize(static_cast<size_t>(term.getRows()) * term.getCols());
+    timed(kCopy, [&] {
+      term.copyBufferOut(screen.data(), screen.size() * sizeof(TerminalCell));
+    });
+    timed(kPull, [&] { term.pullScrollback(history, rowLengths); });
+
+    uint64_t frameEnd = nowNs();
+    latency[kFrame].push_back(frameEnd - frameStart);
+    if (frameEnd - frameStart > kFrameNs)
+      missed++;
+
+    nextFrame += kFrameNs;
+    if (nextFrame > frameEnd)
+      std::this_thread::sleep_for(
+          std::chrono::nanoseconds(nextFrame - frameEnd));
+    else
+      nextFrame = frameEnd; // 落后时不追帧
+  }
+  double elapsed = (nowNs() - begin) / 1e9;
+  stop = true;
+  producer.join();
+
+  std::printf("%dx%d, %.1fs, producer %.1f MB/s, %zu frames, %d over 16.7ms\n",
+              options.rows, options.cols, elapsed,
+              produced.load() / elapsed / (1 << 20), latency[kFrame].size(),
+              missed);
+  std::printf("%-16s %8s %10s %10s %10s %10s %10s\n", "call (us)", "count",
+              "p50", "p90", "p99", "p99.9", "max");
+  for (int call = 0; call < kCallCount; ++call)
+    printLatency(kCallNames[call], latency[call]);
+
+#ifdef POCKET_CORE_LOCK_STATS
+  printLockStats(term, elapsed);
+#else
+  std::printf("\n(lock hold/wait times: rebuild with "
+              "-DPOCKET_CORE_LOCK_STATS=ON)\n");
+#endif
+  return 0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pocket {
+namespace bench {
+
+inline uint64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// 对一组耗时样本 (ns) 取百分位，samples 会被排序
+inline double percentile(std::vector<uint64_t> &samples, double p) {
+  if (samples.empty())
+    return 0;
+  std::sort(samples.begin(), samples.end());
+  size_t idx = static_cast<size_t>(p * (samples.size() - 1) + 0.5);
+  return static_cast<double>(samples[idx]);
+}
+
+// 生成一段带 SGR 颜色、长短不一的日志文本，用于填充屏幕与历史
+inline std::string makeColoredLog(int lines, int maxWidth, uint32_t seed = 1) {
+  std::string out;
+  uint32_t x = seed;
+  for (int i = 0; i < lines; ++i) {
+    x = x * 1103515245u + 12345u;
+    int width = static_cast<int>((x >> 8) % static_cast<uint32_t>(maxWidth));
+    out += "\x1b[3" + std::to_string(i % 8) + "m";
+    for (int c = 0; c < width; ++c)
+      out += static_cast<char>('a' + (c + i) % 26);
+    out += "\x1b[0m\r\n";
+  }
+  return out;
+}
+
+} // namespace bench
+} // namespace pocket
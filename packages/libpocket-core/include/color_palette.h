@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+namespace pocket {
+namespace terminal {
+
+// TerminalCell.fg / bg 与历史样式中的颜色编码，保留颜色的来源而不是
+// 捕获时的 RGB：
+//   0xFFRRGGBB       直接 RGB (SGR 38;2 / 48;2)
+//   0x01000000 | n   调色板表第 n 项：0-255 为 256 色调色板，
+//                    256 / 257 为默认前景 / 背景
+// 主题切换只换调色板表，已导出的格子与历史不需要重新转换。
+constexpr uint32_t kColorIndexed = 0x01000000;
+constexpr int kPaletteSize = 258;
+constexpr int kPaletteDefaultFg = 256;
+constexpr int kPaletteDefaultBg = 257;
+constexpr uint32_t kColorDefaultFg = kColorIndexed | kPaletteDefaultFg;
+constexpr uint32_t kColorDefaultBg = kColorIndexed | kPaletteDefaultBg;
+
+constexpr bool isIndexedColor(uint32_t color) {
+  return (color >> 24) == 0x01;
+}
+
+// 颜色的当前显示值 (ARGB)，随帧一起取出
+struct ColorPalette {
+  uint32_t colors[kPaletteSize];
+
+  uint32_t resolve(uint32_t color) const {
+    return isIndexedColor(color) ? colors[(color & 0xFFFF) % kPaletteSize]
+                                 : color;
+  }
+};
+
+} // namespace terminal
+} // namespace pocket
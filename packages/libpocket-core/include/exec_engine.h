@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace pocket {
+namespace terminal {
+
+/**
+ * 有界输出捕获：保留最先的 headBytes 与最后的 tailBytes，中间部分只计数。
+ * 噪声很大的命令也只占用 headBytes + tailBytes 内存。
+ */
+class BoundedCapture {
+public:
+  BoundedCapture(size_t headBytes, size_t tailBytes);
+
+  void append(const char *data, size_t len);
+
+  const std::string &head() const { return m_head; }
+  // 按时间顺序返回尾部
+  std::string tail() const;
+
+  uint64_t totalBytes() const { return m_total; }
+  // 既不在头部也不在尾部、被丢弃的字节数
+  uint64_t droppedBytes() const;
+
+  // 头 + 省略标记 + 尾，便于直接展示
+  std::string text() const;
+
+private:
+  size_t m_headLimit;
+  size_t m_tailLimit;
+  std::string m_head;
+  std::string m_tail; // 环形缓冲，满后从 m_tailPos 开始为最旧数据
+  size_t m_tailPos{0};
+  uint64_t m_total{0};
+};
+
+struct ExecOptions {
+  // argv[0] 按 PATH 查找；为空时用 shell -c command
+  std::vector<std::string> argv;
+  std::string command;
+  std::string shell{"/system/bin/sh"};
+  std::string cwd;
+  // 形如 "KEY=VALUE"，追加到当前环境之后 (同名覆盖)
+  std::vector<std::string> env;
+  std::string stdinData;
+
+  int timeoutMs{0};        // 0 表示不限时
+  int killGraceMs{2000};   // 超时/取消时 SIGTERM 到 SIGKILL 的间隔
+  size_t headBytes{16 * 1024};
+  size_t tailBytes{48 * 1024};
+};
+
+struct ExecResult {
+  uint64_t id{0};
+  int exitCode{-1};  // 正常退出时的退出码
+  int signal{0};     // 被信号终止时的信号
+  bool timedOut{false};
+  bool cancelled{false};
+  std::string error; // 启动失败 (fork/exec/chdir) 的原因，成功为空
+  uint64_t durationMs{0};
+  BoundedCapture out{0, 0};
+  BoundedCapture err{0, 0};
+};
+
+/**
+ * 非交互的批量命令执行引擎，与 PocketTerminal 并列，不经过 PTY 和 libvterm。
+ *
+ * 子进程通过管道启动并各自成为新的进程组；所有运行中的命令共用一个 I/O
+ * 线程，用 poll 同时处理 stdin 写入、stdout/stderr 读取、超时和回收。
+ * 超时或取消时先对整棵进程树 (进程组 + /proc 中的后代) 发 SIGTERM，
+ * killGraceMs 后仍未退出再 SIGKILL。主进程退出后残留的后代同样被清理。
+ *
+ * completion 在 I/O 线程上调用，应尽快返回。
+ */
+class ExecEngine {
+public:
+  using Completion = std::function<void(ExecResult &result)>;
+
+  ExecEngine();
+  ~ExecEngine();
+
+  ExecEngine(const ExecEngine &) = delete;
+  ExecEngine &operator=(const ExecEngine &) = delete;
+
+  // 返回运行 id (从 1 开始)；启动失败也会通过 completion 报告
+  uint64_t start(ExecOptions options, Completion completion);
+
+  // 取消命令 (已结束的 id 忽略)，id 无效时返回 false
+  bool cancel(uint64_t id);
+
+  size_t running() const;
+
+private:
+  struct Run;
+
+  void ioLoop();
+  void wake();
+  void spawn(Run &run);
+  void finish(Run &run);
+  static void killTree(Run &run, int sig);
+
+  mutable std::mutex m_mutex;
+  std::vector<std::unique_ptr<Run>> m_pending;
+  std::vector<uint64_t> m_cancelled;
+  std::atomic<size_t> m_running{0};
+  uint64_t m_nextId{1};
+  bool m_stopping{false};
+
+  int m_wakePipe[2]{-1, -1};
+  std::thread m_thread;
+
+  // 只在 I/O 线程上访问
+  std::unordered_map<uint64_t, std::unique_ptr<Run>> m_runs;
+};
+
+} // namespace terminal
+} // namespace pocket
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "color_palette.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace pocket {
+namespace terminal {
+
+struct TerminalCell;
+
+enum class ExportFormat {
+  Text, // 纯文本，去掉行尾空白
+  Ansi, // 带 SGR 颜色与属性，可直接 cat 回终端
+  Html, // 独立的 <pre> 页面
+};
+
+struct ExportProgress {
+  int64_t linesDone{0};
+  int64_t linesTotal{0};
+  // 导出期间被挤出历史上限、没能写出的行
+  int64_t linesSkipped{0};
+  uint64_t bytesWritten{0};
+  bool done{false};
+  std::string error; // 完成时非空表示失败 (文件已删除)
+};
+
+using ExportCallback = std::function<void(const ExportProgress &progress)>;
+
+inline void appendUtf8(std::string &out, uint32_t ch) {
+  if (ch < 0x80) {
+    out += static_cast<char>(ch);
+  } else if (ch < 0x800) {
+    out += static_cast<char>(0xC0 | (ch >> 6));
+    out += static_cast<char>(0x80 | (ch & 0x3F));
+  } else if (ch < 0x10000) {
+    out += static_cast<char>(0xE0 | (ch >> 12));
+    out += static_cast<char>(0x80 | ((ch >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (ch & 0x3F));
+  } else {
+    out += static_cast<char>(0xF0 | (ch >> 18));
+    out += static_cast<char>(0x80 | ((ch >> 12) & 0x3F));
+    out += static_cast<char>(0x80 | ((ch >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (ch & 0x3F));
+  }
+}
+
+/**
+ * 按格式把终端行写入文件描述符。输出先攒在有界缓冲里，
+ * 满 kFlushBytes 才 write 一次；内存占用与导出的总行数无关。
+ *
+ * ANSI 保留 256 色下标 (在读者自己的主题下显示)，HTML 按 palette 解析。
+ */
+class HistoryWriter {
+public:
+  static constexpr size_t kFlushBytes = 64 * 1024;
+
+  HistoryWriter(int fd, ExportFormat format, const ColorPalette &palette);
+
+  bool begin();
+  bool writeLine(const TerminalCell *cells, size_t cols);
+  // 写一行说明 (如跳过的行数)，按格式转义
+  bool writeNote(const std::string &text);
+  bool finish();
+
+  uint64_t bytesWritten() const { return m_written; }
+  int error() const { return m_errno; }
+
+private:
+  struct Style {
+    uint32_t fg; // TerminalCell 的颜色编码
+    uint32_t bg;
+    uint32_t attrs; // TerminalCell.flags 的低 6 位
+    bool operator==(const Style &o) const {
+      return fg == o.fg && bg == o.bg && attrs == o.attrs;
+    }
+  };
+
+  void openStyle(const Style &style);
+  void closeStyle(const Style &style);
+  void appendSgrColor(int base, uint32_t color);
+  void appendEscaped(uint32_t ch);
+  bool flush(bool force);
+
+  int m_fd;
+  ExportFormat m_format;
+  ColorPalette m_palette;
+  std::string m_buffer;
+  uint64_t m_written{0};
+  int m_errno{0};
+};
+
+} // namespace terminal
+} // namespace pocket
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace pocket {
+namespace terminal {
+
+// 单张图像的宽高上限 (像素)，防止畸形数据把内存吃光
+constexpr int kMaxImageDimension = 4096;
+
+enum class ImageFormat : uint8_t {
+  Rgba8888 = 0, // 行优先 RGBA，每像素 4 字节
+  Png = 1,      // kitty f=100：保留原始 PNG 数据，交给 UI 侧平台解码器
+};
+
+// 解码完成的图像，进入缓存后不可变，可在任意线程只读访问
+struct DecodedImage {
+  uint32_t id{0};
+  int width{0};
+  int height{0};
+  ImageFormat format{ImageFormat::Rgba8888};
+  std::vector<uint8_t> data;
+
+  size_t byteSize() const { return sizeof(DecodedImage) + data.size(); }
+};
+
+using ImageRef = std::shared_ptr<const DecodedImage>;
+
+/**
+ * 按字节计量的 LRU 图像缓存。
+ *
+ * 条目以 shared_ptr 引用计数，屏幕上的图像放置 (placement) 持有引用；
+ * 淘汰只会丢弃仅被缓存自身持有的条目。liveBytes() 统计所有仍存活的
+ * 图像 (包括已被淘汰但仍被放置引用的)，用于计入会话内存预算。
+ */
+class ImageCache {
+public:
+  explicit ImageCache(size_t capacityBytes);
+
+  // 插入并返回引用；单张图像超过容量时拒绝并返回 nullptr
+  ImageRef insert(std::unique_ptr<DecodedImage> image);
+
+  // 查找并刷新 LRU 顺序
+  ImageRef find(uint32_t id);
+
+  void erase(uint32_t id);
+  void clear();
+
+  void setCapacity(size_t capacityBytes);
+  size_t capacity() const;
+
+  // 按容量淘汰未被引用的条目，返回是否已回到容量之内
+  bool trim();
+
+  size_t liveBytes() const { return m_liveBytes->load(); }
+
+private:
+  bool trimLocked();
+
+  mutable std::mutex m_mutex;
+  size_t m_capacity;
+
+  // 与每个图像的 deleter 共享，图像晚于缓存析构时依然安全
+  std::shared_ptr<std::atomic<size_t>> m_liveBytes;
+
+  std::list<ImageRef> m_lru; // 头部为最近使用
+  std::unordered_map<uint32_t, std::list<ImageRef>::iterator> m_index;
+};
+
+enum class ImageProtocol : uint8_t { Sixel, Kitty };
+
+// kitty 图形协议控制数据 (APC G 与 ';' 之间的 key=value 列表)
+struct KittyCommand {
+  char action{'t'};       // a= t 传输 / T 传输并显示 / p 放置 / d 删除 / q 查询
+  char deleteTarget{'a'}; // d= a 全部 / i 按 id (大写同时释放数据)
+  char medium{'d'};       // t= 仅支持 d (直接内联传输)
+  char compression{0};    // o= z 为 zlib，暂不支持
+  int format{32};         // f= 24 / 32 / 100
+  uint32_t id{0};         // i=
+  int width{0};           // s= 像素宽
+  int height{0};          // v= 像素高
+  int cols{0};            // c= 显示占用列数
+  int rows{0};            // r= 显示占用行数
+  int more{0};            // m= 1 表示后续还有分块
+  int quiet{0};           // q= 1 只报错 / 2 完全静默
+};
+
+KittyCommand parseKittyCommand(const char *data, size_t len);
+
+// 一次完整的图像传输，在解析线程上收集，交给工作线程解码
+struct ImageJob {
+  ImageProtocol protocol{ImageProtocol::Sixel};
+  std::string params; // sixel 的 DCS 参数 (如 "0;1;0")
+  KittyCommand kitty;
+  std::string payload; // sixel 数据或 kitty base64 负载
+  int64_t line{0};     // 传输结束时光标所在的绝对行号
+  int col{0};
+};
+
+// 以下解码函数均为纯函数，只在工作线程 (或基准) 中调用
+std::unique_ptr<DecodedImage> decodeSixel(const std::string &params,
+                                          const std::string &data);
+bool decodeBase64(const std::string &in, std::vector<uint8_t> &out);
+std::unique_ptr<DecodedImage> decodeKitty(const KittyCommand &cmd,
+                                          const std::string &payload);
+
+/**
+ * 单工作线程的图像解码器。解析线程只负责 submit (一次加锁入队)，
+ * 解码结果通过 completion 回调交还，回调在工作线程上执行。
+ * 工作线程在第一次 submit 时才创建。
+ */
+class ImageDecoder {
+public:
+  using Completion =
+      std::function<void(ImageJob &job, std::unique_ptr<DecodedImage> image)>;
+
+  explicit ImageDecoder(Completion completion);
+  ~ImageDecoder();
+
+  ImageDecoder(const ImageDecoder &) = delete;
+  ImageDecoder &operator=(const ImageDecoder &) = delete;
+
+  void submit(ImageJob job);
+
+  // 队列中尚未解码的负载字节数
+  size_t pendingBytes() const { return m_pendingBytes.load(); }
+
+private:
+  void workerLoop();
+
+  Completion m_completion;
+
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::deque<ImageJob> m_queue;
+  std::atomic<size_t> m_pendingBytes{0};
+  bool m_stopping{false};
+
+  std::thread m_worker;
+};
+
+} // namespace terminal
+} // namespace pocket
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+
+namespace pocket {
+namespace terminal {
+
+/**
+ * 单生产者单消费者的无锁字节环。容量向上取整为 2 的幂。
+ * 读写各自只推进自己的下标，通过 acquire/release 交接数据。
+ */
+class SpscByteRing {
+public:
+  explicit SpscByteRing(size_t capacity);
+
+  SpscByteRing(const SpscByteRing &) = delete;
+  SpscByteRing &operator=(const SpscByteRing &) = delete;
+
+  // 写入尽可能多的字节，返回实际写入数 (仅生产者线程)
+  size_t write(const char *data, size_t len);
+  // 读出最多 len 字节，返回实际读出数 (仅消费者线程)
+  size_t read(char *out, size_t len);
+
+  size_t readable() const;
+  size_t writable() const;
+  size_t capacity() const { return m_mask + 1; }
+
+private:
+  std::unique_ptr<char[]> m_data;
+  size_t m_mask;
+  alignas(64) std::atomic<size_t> m_head{0}; // 写下标
+  alignas(64) std::atomic<size_t> m_tail{0}; // 读下标
+};
+
+// 软件行规程的模式，对应 termios 中常用的几个标志
+struct LineMode {
+  bool echo{true};      // ECHO
+  bool canonical{true}; // ICANON：按行编辑，回车后才交给程序
+  bool signals{true};   // ISIG：^C / ^Z / ^\ 产生信号
+  bool echoCtl{true};   // ECHOCTL：控制字符回显为 ^X
+  bool icrnl{true};     // 输入 CR 转为 NL
+  bool onlcr{true};     // 输出 NL 转为 CR NL
+
+  uint8_t vintr{0x03};   // ^C (SIGINT)
+  uint8_t vquit{0x1c};   // ^\ (SIGQUIT)
+  uint8_t vsusp{0x1a};   // ^Z (SIGTSTP)
+  uint8_t veof{0x04};    // ^D
+  uint8_t verase{0x7f};  // DEL
+  uint8_t vkill{0x15};   // ^U
+  uint8_t vwerase{0x17}; // ^W
+};
+
+/**
+ * 进程内的伪终端：连接同进程里的生产者 (wasm2c 编译的 Python、QuickJS
+ * 等嵌入式运行时) 与 PocketTerminal，不需要内核 PTY，也不额外开线程。
+ *
+ * 两个方向各一个 SpscByteRing：
+ *  - 输入环：终端侧 terminalInput 经行规程处理后写入，生产者 producerRead 读出；
+ *  - 输出环：生产者 producerWrite (做 ONLCR) 写入，终端侧 terminalRead 读出。
+ * 快路径完全无锁；只有环空 (读) 或环满 (写) 需要阻塞时才进入条件变量。
+ *
+ * 线程约定：producer* 只在运行时所在的线程调用；terminal* 由终端侧调用，
+ * 多个终端侧线程时须由调用方串行化 (PocketTerminal 用 m_vtermMutex)。
+ */
+class InProcessTransport {
+public:
+  using SignalHandler = std::function<void(int sig)>;
+  using WindowSizeHandler = std::function<void(int rows, int cols)>;
+  using ReadyHandler = std::function<void()>;
+
+  explicit InProcessTransport(size_t ringBytes = 64 * 1024);
+  ~InProcessTransport();
+
+  InProcessTransport(const InProcessTransport &) = delete;
+  InProcessTransport &operator=(const InProcessTransport &) = delete;
+
+  // ---- 生产者 (运行时) 侧 ----
+
+  // 阻塞直到有输入；返回 0 表示 EOF (^D 或已关闭)。
+  // 阻塞期间收到 ^C 等信号时与内核 tty 一样返回 -1，errno 为 EINTR
+  ssize_t producerRead(char *buf, size_t len);
+  // 写输出，环满时阻塞等待终端侧取走；关闭后返回 -1
+  ssize_t producerWrite(const char *data, size_t len);
+
+  // 相当于 tcgetattr / tcsetattr，REPL 切换原始模式时使用
+  LineMode mode() const;
+  void setMode(const LineMode &mode);
+
+  void windowSize(int &rows, int &cols) const;
+
+  // 回调须在开始收发之前设置。信号与窗口尺寸回调在终端侧线程上执行，
+  // 应尽快返回 (通常只置一个标志，由运行时在安全点处理)
+  void setSignalHandler(SignalHandler handler);
+  void setWindowSizeHandler(WindowSizeHandler handler);
+
+  // ---- 终端侧 ----
+
+  // 键盘输入经行规程处理；需要回显给屏幕的字节追加到 echo
+  void terminalInput(const char *data, size_t len, std::string &echo);
+  // 绕过行规程直接交给生产者 (终端应答，如 DA / kitty 回复)
+  void terminalInputRaw(const char *data, size_t len);
+  // 取出生产者的输出
+  size_t terminalRead(char *out, size_t len);
+  size_t terminalReadable() const { return m_output.readable(); }
+
+  void setWindowSize(int rows, int cols);
+
+  // 输出环从空变为非空时回调 (在生产者线程上)，用于通知宿主刷新帧
+  void setOutputReadyHandler(ReadyHandler handler);
+
+  // ---- 两侧通用 ----
+
+  // 关闭后两侧的阻塞调用全部返回
+  void close();
+  bool closed() const { return m_closed.load(std::memory_order_acquire); }
+
+private:
+  void commitInput(const char *data, size_t len);
+  void echoChar(unsigned char c, const LineMode &mode, std::string &echo);
+  void eraseChars(size_t count, const LineMode &mode, std::string &echo);
+  void raiseSignal(int sig, unsigned char c, const LineMode &mode,
+                   std::string &echo);
+
+  SpscByteRing m_input;
+  SpscByteRing m_output;
+
+  // 模式很少改变，用普通锁；onlcr 在输出快路径上读取，单独缓存
+  mutable std::mutex m_modeMutex;
+  LineMode m_mode;
+  std::atomic<bool> m_onlcr{true};
+
+  // 只在终端侧访问：规范模式下正在编辑的一行
+  std::string m_line;
+
+  // ^D 产生的 EOF 计数，producerRead 在输入为空时消费
+  std::atomic<int> m_eofPending{0};
+
+  std::atomic<int> m_rows{24};
+  std::atomic<int> m_cols{80};
+
+  // 慢路径等待
+  std::mutex m_waitMutex;
+  std::condition_variable m_inputCv;
+  std::condition_variable m_outputCv;
+  std::atomic<bool> m_readerWaiting{false};
+  std::atomic<bool> m_readInterrupted{false};
+  std::atomic<bool> m_writerWaiting{false};
+  std::atomic<bool> m_closed{false};
+
+  SignalHandler m_signalHandler;
+  WindowSizeHandler m_windowSizeHandler;
+  ReadyHandler m_outputReadyHandler;
+};
+
+} // namespace terminal
+} // namespace pocket
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace pocket {
+namespace terminal {
+
+// 等锁 / 持锁时间的对数直方图，第 i 格为 [2^i, 2^(i+1)) ns
+struct LockStats {
+  static constexpr int kBuckets = 40;
+
+  uint64_t acquisitions{0};
+  uint64_t contended{0}; // try_lock 失败、需要等待的次数
+  uint64_t totalHoldNs{0};
+  uint64_t maxHoldNs{0};
+  uint64_t maxWaitNs{0};
+  uint64_t holdNs[kBuckets]{};
+  uint64_t waitNs[kBuckets]{};
+
+  static int bucketOf(uint64_t ns) {
+    int bucket = 0;
+    while (ns > 1 && bucket < kBuckets - 1) {
+      ns >>= 1;
+      bucket++;
+    }
+    return bucket;
+  }
+
+  // 直方图的近似百分位 (取所在格的上界)
+  static uint64_t percentile(const uint64_t (&histogram)[kBuckets], double p) {
+    uint64_t total = 0;
+    for (uint64_t count : histogram)
+      total += count;
+    if (total == 0)
+      return 0;
+    uint64_t rank = static_cast<uint64_t>(p * (total - 1)) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < kBuckets; ++i) {
+      seen += histogram[i];
+      if (seen >= rank)
+        return uint64_t(2) << i;
+    }
+    return uint64_t(2) << (kBuckets - 1);
+  }
+};
+
+/**
+ * 统计构建 (POCKET_CORE_LOCK_STATS) 中替代 std::mutex 的互斥量，
+ * 满足 Lockable，可直接用于 std::lock_guard。
+ *
+ * 统计在持锁期间更新，本身不需要原子操作；每次加解锁多两次读时钟。
+ */
+class TimedMutex {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  void lock() {
+    if (m_mutex.try_lock()) {
+      m_lockedAt = now();
+      m_stats.acquisitions++;
+      return;
+    }
+    uint64_t start = now();
+    m_mutex.lock();
+    m_lockedAt = now();
+    uint64_t wait = m_lockedAt - start;
+    m_stats.acquisitions++;
+    m_stats.contended++;
+    m_stats.waitNs[LockStats::bucketOf(wait)]++;
+    if (wait > m_stats.maxWaitNs)
+      m_stats.maxWaitNs = wait;
+  }
+
+  bool try_lock() {
+    if (!m_mutex.try_lock())
+      return false;
+    m_lockedAt = now();
+    m_stats.acquisitions++;
+    return true;
+  }
+
+  void unlock() {
+    uint64_t hold = now() - m_lockedAt;
+    m_stats.totalHoldNs += hold;
+    m_stats.holdNs[LockStats::bucketOf(hold)]++;
+    if (hold > m_stats.maxHoldNs)
+      m_stats.maxHoldNs = hold;
+    m_mutex.unlock();
+  }
+
+  // 取统计时不计入统计
+  void snapshot(LockStats &out) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    out = m_stats;
+  }
+
+  void resetStats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats = LockStats();
+  }
+
+private:
+  static uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               Clock::now().time_since_epoch())
+        .count();
+  }
+
+  std::mutex m_mutex;
+  uint64_t m_lockedAt{0};
+  LockStats m_stats;
+};
+
+} // namespace terminal
+} // namespace pocket
@@ -1,8 +1,20 @@
 #pragma once
 
+#include "color_palette.h"
+#include "history_export.h"
+#include "image_protocol.h"
+#include "inprocess_transport.h"
+#ifdef POCKET_CORE_LOCK_STATS
+#include "lock_stats.h"
+#endif
+#include "process_sampler.h"
+#include "scrollback_overview.h"
+#include "scrollback_store.h"
+#include "text_summary.h"
 #include "vterm.h"
 #include <atomic>
 #include <deque>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -17,12 +29,58 @@ namespace terminal {
 #pragma pack(push, 1)
 struct TerminalCell {
   uint32_t ch;    // Unicode CodePoint of the primary character
-  uint32_t fg;    // Foreground color ARGB (or RGB)
-  uint32_t bg;    // Background color ARGB
+  uint32_t fg;    // Foreground: palette index or RGB (color_palette.h)
+  uint32_t bg;    // Background color, same encoding
   uint32_t flags; // Bit flags (e.g., bit 0: bold, bit 1: underline, etc.)
 };
 #pragma pack(pop)
 
+// TerminalCell.flags bit 31：该格被图像覆盖。此时 ch 为图像 id，
+// fg 为格在图像内的坐标 (行 << 16 | 列)，bg 保留原背景色
+constexpr uint32_t kCellImage = 1u << 31;
+
+// 保留颜色的来源：默认色与 256 色记为调色板表下标，只有直接 RGB 存值，
+// 主题切换后由调色板表解析出新的颜色 (见 color_palette.h)
+inline uint32_t colorCode(const VTermColor &color) {
+  if (VTERM_COLOR_IS_DEFAULT_FG(&color))
+    return kColorDefaultFg;
+  if (VTERM_COLOR_IS_DEFAULT_BG(&color))
+    return kColorDefaultBg;
+  if (VTERM_COLOR_IS_INDEXED(&color))
+    return kColorIndexed | color.indexed.idx;
+  return (0xFFu << 24) | (color.rgb.red << 16) | (color.rgb.green << 8) |
+         color.rgb.blue;
+}
+
+// 图像在屏幕上的一次放置，row 为相对当前可视区顶部的行号 (滚入历史后为负)
+struct ImagePlacementInfo {
+  uint32_t id;
+  int row;
+  int col;
+  int rows;
+  int cols;
+};
+
+// 一帧屏幕：尺寸、格子 (rows * cols，按行连续) 与每行的行号
+// 在同一次加锁内取出，彼此一致
+struct ScreenSnapshot {
+  int rows{0};
+  int cols{0};
+  std::vector<TerminalCell> cells;
+  std::vector<uint64_t> lineIds;
+};
+
+// 读线程观察者收到的事件
+enum class ObserverEvent {
+  Output, // 一段 PTY 输出，已写入 libvterm
+  Tick,   // 安装后的首次调用，或观察者要求的定时到期
+  Closed, // PTY 已关闭，读线程即将退出
+};
+
+// 在 PTY 读线程上调用；返回距下一次 Tick 的毫秒数，-1 表示不需要定时
+using OutputObserver =
+    std::function<int(ObserverEvent event, const char *data, size_t len)>;
+
 class PocketTerminal {
 public:
   PocketTerminal(int rows, int cols);
@@ -31,26 +89,95 @@ public:
   // 调整终端大小
   void resize(int rows, int cols);
 
-  // 初始化并在沙盒内启动真实 PTY 子进程 (如 /system/bin/sh)
-  bool startPty();
+  // 初始化并在沙盒内启动真实 PTY 子进程，shell 默认为 /system/bin/sh
+  // (测试中换成桩程序)
+  bool startPty(const char *shell = "/system/bin/sh");
 
   // 停止并清理 PTY 进程与线程
   void stopPty();
 
+  // PTY 读线程是否在运行：Shell 退出或 stopPty 之后为 false
+  bool isPtyRunning() const { return m_running; }
+
+  // 接入进程内传输 (不能 forkpty 的平台上运行嵌入式运行时)。
+  // 不开线程：运行时的输出在 copyBufferOut / pullScrollback / exportSummary
+  // 或 pumpTransport 时才被取出并送入 VTerm，键盘输入经软件行规程交给运行时
+  bool attachTransport(std::shared_ptr<InProcessTransport> transport);
+  void detachTransport();
+
+  // 取出运行时的输出并更新屏幕，返回处理的字节数。
+  // 通常在 transport 的 outputReady 回调触发后由宿主安排调用
+  size_t pumpTransport();
+
   // 输入字节流。如果有 PTY 附加则写入 Pty，否则只在测试模式驱动 VTerm状态机
   size_t writeInput(const char *data, size_t len);
 
   // 获取当前二维渲染栅格的裸指针，实现零拷贝读取
-  // 注意：真实环境中该缓冲的实际读取应由外部完成
+  // 注意：真实环境中该缓冲的实际读取应由外部完成；
+  // 单元格按需转换，读取前先调用 syncCells
   const TerminalCell *getBuffer() const { return m_cellBuffer.data(); }
 
-  // 线程安全的缓冲复制
+  // 把解析后尚未转换的行写入 getBuffer 的缓冲
+  void syncCells();
+
+  // 线程安全的缓冲复制。调用方按 getRows / getCols 分配缓冲，中间发生
+  // resize 时尺寸可能对不上；需要尺寸与格子一致时用 snapshot
   void copyBufferOut(TerminalCell *outBuffer, size_t maxBytes);
 
-  // 消费暂存的历史缓冲区（取出被挤出屏幕的历史行数组，并将内部队列置空）
+  // 取一帧屏幕 (见 ScreenSnapshot)，out 的缓冲逐帧复用
+  void snapshot(ScreenSnapshot &out);
+
+  // 登记可见区域 (双指缩放、键盘遮住半屏)：[row, row + rows) x
+  // [col, col + cols)，超出屏幕的部分按屏幕裁剪，resize 后保持原坐标。
+  // 之后 syncCells / copyBufferOut / copyViewportOut 只转换区域外扩 margin
+  // 格内的过期格子，其余的过期记录保留，区域移过去时再转换；
+  // 所以这期间 getBuffer 与 copyBufferOut 只保证区域 (含边) 内是最新的。
+  // exportSummary / exportHistory 仍按整屏转换
+  void setViewport(int row, int col, int rows, int cols,
+                   int margin = kViewportMargin);
+  void clearViewport();
+
+  // 按行连续复制可见区域 (不含边) 的格子，返回复制的格数。
+  // 没有登记区域时复制整屏，与 copyBufferOut 相同
+  size_t copyViewportOut(TerminalCell *outBuffer, size_t maxBytes);
+
+  // 可见区域的默认外扩格数，小幅滚动、缩放时不必等转换
+  static constexpr int kViewportMargin = 4;
+
+  // 取出上次调用以来新挤出屏幕的历史行；历史本身保留在原生侧 (上限
+  // kMaxScrollback 行)，供 exportSummary 等导出使用
   // 采用连续复制提升 JSI ArrayBuffer 拷贝效率
+  // outLineIds 非空时一并给出每行的行号 (见 copyLineIdsOut)
   void pullScrollback(std::vector<TerminalCell> &outCells,
-                      std::vector<int> &outRowLengths);
+                      std::vector<int> &outRowLengths,
+                      std::vector<uint64_t> *outLineIds = nullptr);
+
+  // 屏幕每一行的行号。每个逻辑行分配一个递增的行号：滚动时跟着内容移动，
+  // 挤进历史后不变；新出现的行 (滚动露出的空行、备用屏幕、改列数后重排
+  // 的行) 用新号。消费方按行号做 key，内容没变的行可以直接复用渲染结果。
+  // 与格子分两次取时中间可能有输出，渲染用 snapshot
+  void copyLineIdsOut(std::vector<uint64_t> &out);
+
+  // 导出压缩后的纯文本 (历史 + 屏幕)，用于放进模型上下文，见 TextCompactor
+  std::string exportSummary(const SummaryOptions &options);
+
+  // 在后台线程把历史 + 屏幕流式写入 path (先写 path.part，成功后改名)。
+  // 每次只在锁内复制一小段行，不阻塞解析。已有导出在进行时返回 false。
+  // callback 在导出线程上调用：每段之后一次进度，最后一次 done 为 true
+  bool exportHistory(const std::string &path, ExportFormat format,
+                     ExportCallback callback);
+
+  // 历史概览 (小地图)，最多 buckets 格，O(buckets)。见 ScrollbackOverview
+  void getOverview(size_t buckets, std::vector<OverviewBucket> &out);
+
+  // 完整模拟器状态的快照 (libvterm 解析器、模式、画笔、滚动区、字符集、
+  // 制表位、行信息、备用屏幕与保存的光标)，带版本的二进制格式。
+  // 用于进程被杀后恢复、录像跳转与会话迁移；历史行与图像不在其中。
+  // 复用 out 的容量，定期调用时不重复分配
+  void checkpoint(std::vector<uint8_t> &out);
+
+  // 恢复快照，尺寸不同时先调整为快照的尺寸。快照无效时返回 false，终端不变
+  bool restore(const uint8_t *data, size_t len);
 
   // 获取终端尺寸
   int getRows() const { return m_rows; }
@@ -60,8 +187,97 @@ public:
   int getCursorX() const { return m_cursorX; }
   int getCursorY() const { return m_cursorY; }
 
+  // 屏幕内容或光标每变化一次递增。其他线程 (UI 线程绘制) 按帧轮询，
+  // 没变就不必复制
+  uint64_t getFrameSeq() const { return m_frameSeq; }
+
+  // ---- 颜色主题 ----
+
+  // 格子与历史里的颜色是调色板表下标或直接 RGB (见 color_palette.h)，
+  // 显示时用这张表解析。返回表的版本号，每次改表递增
+  uint32_t copyPaletteOut(ColorPalette &out);
+  uint32_t getPaletteVersion() const { return m_paletteVersion; }
+
+  // 切换主题 (ARGB)：只改表，屏幕格子与历史都不重新转换
+  void setDefaultColors(uint32_t fg, uint32_t bg);
+  void setPaletteColor(int index, uint32_t argb);
+
+  // ---- 内联图像 (sixel / kitty 图形协议) ----
+
+  // 单元格像素尺寸，用于把图像像素大小换算成占用的行列数
+  void setCellPixelSize(int width, int height);
+
+  // 会话内存预算：屏幕、历史与图像缓存合计，图像缓存使用剩余部分
+  void setMemoryBudget(size_t bytes);
+  size_t getMemoryUsage();
+
+  // 按 id 取图像 (可跨线程持有)，不存在时返回 nullptr
+  ImageRef getImage(uint32_t id) { return m_imageCache.find(id); }
+
+  void getImagePlacements(std::vector<ImagePlacementInfo> &out);
+
+  // ---- PTY 子进程树资源采样 ----
+
+  // 采样间隔 (毫秒)，0 关闭。采样在 PTY 读线程上进行，不额外开线程
+  void setProcessSampling(int intervalMs);
+
+  // 取最近一次随帧发布的采样，尚未采样时返回 false
+  bool getProcessStats(ProcessTreeStats &out);
+
+  // ---- 读线程观察者 (自动化脚本等) ----
+
+  // 同一时间只允许一个观察者：已有观察者时安装失败；传空函数卸载。
+  // 可在观察者回调内卸载自己。只作用于 PTY，不作用于进程内传输。
+  // 读线程已结束时，新观察者在本调用内直接收到 Closed
+  bool setOutputObserver(OutputObserver observer);
+
+#ifdef POCKET_CORE_LOCK_STATS
+  // ---- 锁统计 (cmake -DPOCKET_CORE_LOCK_STATS=ON) ----
+
+  // m_vtermMutex 自上次 reset 以来的等锁 / 持锁分布
+  void getLockStats(LockStats &out) { m_vtermMutex.snapshot(out); }
+  void resetLockStats() { m_vtermMutex.resetStats(); }
+#endif
+
 private:
   void readerLoop();
+  void wakeReader();
+  void exportLoop(std::string path, ExportFormat format,
+                  ExportCallback callback);
+  int lastContentRowLocked();
+  void markStaleLocked(int startRow, int endRow, int startCol, int endCol);
+  void refreshCellsLocked();
+  void refreshViewportLocked();
+  void convertStaleLocked(int top, int bottom, int left, int right);
+  void loadPaletteLocked();
+  void syncAltScreenLocked();
+  void resizeLineIdsLocked(bool sameCols, size_t pushed);
+  // 尺寸有变化时返回 true，调用方在锁外再通知 PTY
+  bool resizeLocked(int rows, int cols);
+  void setPtyWindowSize(int rows, int cols);
+  bool restoreLocked(const uint8_t *data, size_t len);
+  void sampleProcesses(pid_t pid);
+  size_t drainTransportLocked();
+
+  // 图像协议：解析线程上只缓冲负载，解码交给 m_imageDecoder
+  struct ImagePlacement {
+    ImageRef image;
+    int64_t line; // 绝对行号 (可视行 + m_lineOffset)
+    int col;
+    int rows;
+    int cols;
+  };
+
+  void submitImage(ImageJob &job);
+  // 自动分配的图像 id 从 1 << 31 起，回绕时跳过 0 与客户端可选的低半区
+  uint32_t nextImageId();
+  void onImageDecoded(ImageJob &job, std::unique_ptr<DecodedImage> image);
+  void placeImage(const ImageRef &image, int64_t line, int col, int rows,
+                  int cols);
+  void removePlacements(uint32_t id, bool all);
+  void applyImageOverlay(int startRow, int endRow);
+  size_t textBytesLocked() const;
+  void respond(const std::string &data);
 
   // libvterm 实例引用
   VTerm *m_vterm{nullptr};
@@ -77,27 +293,135 @@ private:
   // 内部持有的连续内存缓冲，映射终端的每一行每一列
   std::vector<TerminalCell> m_cellBuffer;
 
+  // 行号：m_rowIds 为正在显示的屏幕 (主或备用)，m_savedRowIds 为另一块。
+  // 推入历史的总是主屏幕顶部的行，一批推入中的第 m_pushedRows 行
+  std::vector<uint64_t> m_rowIds;
+  std::vector<uint64_t> m_savedRowIds;
+  uint64_t m_nextLineId{1};
+  bool m_altScreen{false};
+  size_t m_pushedRows{0};
+
+  // 解析线程只记录每行过期的列区间 [startCol, endCol)，
+  // 转换推迟到有人取帧时 (refreshCellsLocked)，看不到的帧不付转换开销
+  struct StaleSpan {
+    int startCol;
+    int endCol;
+  };
+  std::vector<StaleSpan> m_staleRows;
+  bool m_cellsStale{false};
+
+  // 登记的可见区域；m_viewportStale 表示区域 (含边) 内有过期格子
+  struct CellRect {
+    int row;
+    int col;
+    int rows;
+    int cols;
+  };
+  bool m_hasViewport{false};
+  CellRect m_viewport{0, 0, 0, 0};
+  int m_viewportMargin{0};
+  bool m_viewportStale{false};
+  // 区域外扩 margin 格后裁到屏幕；没有登记区域时为整屏
+  CellRect viewportRectLocked(int margin) const;
+
+  // 调色板表，从 libvterm 的状态同步 (受 m_vtermMutex 保护)
+  ColorPalette m_palette;
+  std::atomic<uint32_t> m_paletteVersion{0};
+
+  // 见 getFrameSeq，解析线程上递增
+  std::atomic<uint64_t> m_frameSeq{0};
+
   // 线程保护锁，保护从多个线程（JS 主线程写，PTY后台线程读/写）并发访问
-  // libvterm
-  std::mutex m_vtermMutex;
+  // libvterm。统计构建中换成记录持锁时间的 TimedMutex
+#ifdef POCKET_CORE_LOCK_STATS
+  using VTermMutex = TimedMutex;
+#else
+  using VTermMutex = std::mutex;
+#endif
+  VTermMutex m_vtermMutex;
 
   // PTY 文件描述符和子进程 ID
   int m_ptyFd{-1};
   pid_t m_pid{-1};
 
+  // 进程树采样：m_processSampler 只在读线程上使用，结果在 m_vtermMutex
+  // 下发布到 m_processStats，与单元格缓冲保持同一帧
+  std::atomic<int> m_sampleIntervalMs{0};
+  ProcessSampler m_processSampler;
+  ProcessTreeStats m_processStats;
+
+  // 进程内传输，与 PTY 互斥 (受 m_vtermMutex 保护)
+  std::shared_ptr<InProcessTransport> m_transport;
+
   // 独立读取子线程与运行状态标志
   std::thread m_readerThread;
   std::atomic<bool> m_running{false};
+  // 唤醒读线程 (观察者变更、stopPty)
+  int m_wakePipe[2]{-1, -1};
+
+  // 读线程在回调前复制一份，回调内卸载观察者也安全
+  std::mutex m_observerMutex;
+  std::shared_ptr<const OutputObserver> m_observer;
+  // 读线程已退出且已发出 Closed (m_observerMutex 保护)
+  bool m_readerClosed{false};
+
+  // 保存溢出可视区的历史输出行 (Scrollback Buffer)，记录上限 2000 行
+  static constexpr size_t kMaxScrollback = 2000;
+  ScrollbackStore m_scrollback;
+  // 推入一行时拼接文本的缓冲，供概览判断错误 / 警告行
+  std::string m_pushText;
+  // 历史末尾尚未被 pullScrollback 取走的行数
+  size_t m_pendingScrollback{0};
+
+  // OSC 133 提示符开始 (A) 所在的绝对行号，从旧到新
+  std::deque<int64_t> m_promptLines;
 
-  // 保存溢出可视区的历史输出行 (Scrollback Buffer)
-  std::deque<std::vector<TerminalCell>> m_scrollbackBuffer;
-  size_t m_maxScrollback{2000}; // 记录上限 2000 行
+  // 累计推入历史的行数，屏幕行 + m_lineOffset 即为绝对行号
+  int64_t m_lineOffset{0};
+
+  // 历史概览，随 onSbPushLine 增量更新
+  ScrollbackOverview m_overview;
+
+  // 历史导出线程，同一时间只有一个
+  std::thread m_exportThread;
+  std::atomic<bool> m_exportRunning{false};
+  std::atomic<bool> m_exportCancel{false};
+
+  size_t m_memoryBudget{64 << 20};
+  int m_cellPixelWidth{10};
+  int m_cellPixelHeight{20};
+
+  // 正在收集的 DCS sixel / APC 负载 (受 m_vtermMutex 保护)
+  ImageJob m_sixelJob;
+  bool m_sixelActive{false};
+  std::string m_apcBuffer;
+  bool m_apcOverflow{false};
+  // kitty 分块传输 (m=1) 尚未收齐的部分
+  ImageJob m_kittyJob;
+  bool m_kittyActive{false};
+
+  uint32_t m_nextImageId{1u << 31};
+  ImageCache m_imageCache{64 << 20};
+  std::vector<ImagePlacement> m_imagePlacements;
+  // 析构函数最先 reset，保证解码回调不会碰到已释放的 vterm
+  std::unique_ptr<ImageDecoder> m_imageDecoder;
 
   // libvterm 的屏幕更新回调集合
   static int onDamage(VTermRect rect, void *user);
   static int onMoveCursor(VTermPos pos, VTermPos oldpos, int visible,
                           void *user);
-  static int onSbPushLine(int cols, const VTermScreenCell *cells, void *user);
+  static int onSbPushLine(int cols, int width, const VTermPackedCell *cells,
+                          bool continuation, void *user);
+  static int onMoveRect(VTermRect dest, VTermRect src, void *user);
+  static int onSetTermProp(VTermProp prop, VTermValue *val, void *user);
+
+  // 未被 libvterm 处理的 OSC，用于接收 OSC 133 命令边界标记
+  static int onOsc(int command, VTermStringFragment frag, void *user);
+
+  // 未被 libvterm 处理的 DCS / APC，用于接收图像协议
+  static int onDcs(const char *command, size_t commandlen,
+                   VTermStringFragment frag, void *user);
+  static int onApc(VTermStringFragment frag, void *user);
 };
 
 } // namespace terminal
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include <unordered_map>
+#include <vector>
+
+namespace pocket {
+namespace terminal {
+
+// 单个进程 (或一组进程合计) 的资源占用
+struct ProcessUsage {
+  pid_t pid{-1};
+  std::string name;      // /proc/<pid>/stat 中的 comm，合计时为组长的名字
+  uint64_t cpuTimeMs{0}; // 累计用户态 + 内核态 CPU 时间
+  float cpuPercent{0};   // 相对上一次采样的 CPU 占用，100 表示占满一个核
+  uint64_t rssBytes{0};
+  int threads{0};
+};
+
+// PTY 子进程树的一次采样结果，随帧一起发布给 UI
+struct ProcessTreeStats {
+  uint64_t sampleTimeMs{0}; // CLOCK_MONOTONIC 毫秒
+  uint32_t sequence{0};     // 每次采样递增，0 表示还没有采样过
+  int processCount{0};
+  ProcessUsage tree;       // m_pid 及其全部后代的合计
+  pid_t foregroundPgid{-1}; // tcgetpgrp，失败时为 -1
+  ProcessUsage foreground; // 前台进程组的合计
+  // 树内 CPU 占用最高的若干进程，按 cpuPercent 降序
+  std::vector<ProcessUsage> top;
+};
+
+// /proc/<pid>/stat 中用到的字段
+struct ProcStat {
+  pid_t pid{-1};
+  pid_t ppid{-1};
+  pid_t pgrp{-1};
+  std::string name;  // comm，可能含空格与括号
+  uint64_t ticks{0}; // utime + stime
+  uint64_t rssPages{0};
+  int threads{0};
+};
+
+// 解析 /proc/<pid>/stat 的内容 (以 '\0' 结尾)
+bool parseProcStat(pid_t pid, const char *text, ProcStat &out);
+bool readProcStat(pid_t pid, ProcStat &out);
+
+// 扫描 /proc，读出当前所有可读的进程
+void scanProcesses(std::vector<ProcStat> &out);
+
+// root 的全部后代 (不含 root) 在 procs 中的下标。按 ppid 做 BFS，
+// 不依赖 pid 大小顺序 (pid 会回绕)
+std::vector<size_t> findDescendants(const std::vector<ProcStat> &procs,
+                                    pid_t root);
+
+/**
+ * 基于 /proc 的进程树采样器，不依赖 ps。
+ *
+ * 每次 sample 扫描一遍 /proc/<pid>/stat，按 ppid 建树后累加根进程的全部
+ * 后代；CPU 占用由与上一次采样的时间差求得，因此采样器需要长期持有，
+ * 且只应在一个线程 (PTY 读线程) 上调用。
+ */
+class ProcessSampler {
+public:
+  static constexpr size_t kMaxTop = 8;
+
+  ProcessSampler();
+
+  // ptyFd 用于 tcgetpgrp，可为 -1
+  void sample(pid_t root, int ptyFd, ProcessTreeStats &out);
+
+  void reset();
+
+private:
+  long m_ticksPerSecond;
+  long m_pageSize;
+  uint64_t m_lastSampleMs{0};
+  uint32_t m_sequence{0};
+
+  // 上一次采样时各进程的 CPU tick，用于计算占用率
+  std::unordered_map<pid_t, uint64_t> m_lastTicks;
+
+  // 复用的扫描缓冲
+  std::vector<ProcStat> m_procs;
+};
+
+} // namespace terminal
+} // namespace pocket
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace pocket {
+namespace terminal {
+
+// 前景色粗分为 8 类 (每个通道是否 >= 0x80)，用于统计主色
+constexpr int kOverviewColorClasses = 8;
+
+// 一行推入历史时的特征，由调用方从单元格算出
+struct LineSignature {
+  uint32_t cells{0};
+  uint32_t nonBlank{0};
+  uint32_t colorCounts[kOverviewColorClasses]{}; // 非空白格按前景色类计数
+  bool error{false};
+  bool warning{false};
+  bool prompt{false}; // OSC 133;A 提示符所在行
+};
+
+// 小地图上的一格，覆盖 [startLine, startLine + lineCount) 的历史行
+struct OverviewBucket {
+  int64_t startLine;
+  uint32_t lineCount;
+  float density;          // 非空白格占比
+  uint32_t dominantColor; // 非空白格最多的前景色类的代表色 (ARGB)，无内容为 0
+  uint32_t errorLines;
+  uint32_t warningLines;
+  uint32_t promptMarks;
+};
+
+/**
+ * 历史行的概览索引，供滚动条小地图与错误标记使用。
+ *
+ * 历史按 kBucketLines 行分成固定桶，只在每个桶边界记录一份累计值
+ * (前缀和)，推入一行是 O(1)。查询任意行区间的统计都是两个前缀相减，
+ * 所以 query(n) 是 O(n)，与历史行数无关。
+ *
+ * 概览覆盖的行数 (kMaxBuckets 个桶) 远多于原生保留的单元格历史，
+ * 与 JS 侧累积的完整历史对应；超出后丢弃最旧的桶。
+ */
+class ScrollbackOverview {
+public:
+  static constexpr int kBucketLines = 64;
+  static constexpr size_t kMaxBuckets = 4096;
+
+  ScrollbackOverview();
+
+  void addLine(const LineSignature &line);
+
+  // 最多 buckets 格，均分当前覆盖的行；桶数不足时返回的格数更少
+  void query(size_t buckets, std::vector<OverviewBucket> &out) const;
+
+  int64_t firstLine() const { return m_firstLine; }
+  int64_t endLine() const;
+
+  static int colorClass(uint32_t argb);
+  static bool looksLikeWarning(const std::string &text);
+  // lower 的 ASCII 字母已是小写
+  static bool looksLikeWarningLower(const std::string &lower);
+
+private:
+  struct Totals {
+    uint64_t lines{0};
+    uint64_t cells{0};
+    uint64_t nonBlank{0};
+    uint64_t colors[kOverviewColorClasses]{};
+    uint64_t errors{0};
+    uint64_t warnings{0};
+    uint64_t prompts{0};
+  };
+
+  const Totals &boundary(size_t index) const;
+
+  // m_marks[k] 为第 k 个整桶开始时的累计值，最后一个之后是未满的桶
+  std::deque<Totals> m_marks;
+  Totals m_running;
+  int64_t m_firstLine{0};
+};
+
+} // namespace terminal
+} // namespace pocket
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+namespace pocket {
+namespace terminal {
+
+struct TerminalCell;
+
+// 历史格子的样式：与 TerminalCell 的 fg / bg / flags 相同
+struct ScrollbackStyle {
+  uint32_t fg;
+  uint32_t bg;
+  uint32_t flags;
+
+  bool operator==(const ScrollbackStyle &o) const {
+    return fg == o.fg && bg == o.bg && flags == o.flags;
+  }
+};
+
+/**
+ * 原生历史行的存储，上限 maxLines 行，超出后丢弃最旧的行。
+ *
+ * 行尾的默认背景空白不存，取出时按原行宽补回 blank 样式的空格。
+ * 样式驻留在样式表里，每格只存码点与样式号 (8 字节，TerminalCell 为
+ * 16 字节)。日志类输出一行只有几种样式，推入时只在样式变化时查表。
+ * 样式表随历史滚动会积累不再使用的样式，超过阈值时整理一次。
+ */
+class ScrollbackStore {
+public:
+  ScrollbackStore(size_t maxLines, const ScrollbackStyle &blank);
+
+  size_t size() const { return m_lines.size(); }
+  size_t maxLines() const { return m_maxLines; }
+
+  // 样式号在下一次 commitLine 之前有效 (整理样式表会重新编号)
+  uint32_t internStyle(const ScrollbackStyle &style);
+
+  // 逐格追加正在推入的一行，commitLine 结束该行；cols 为原行宽，
+  // id 为该行在屏幕上时的行号 (见 PocketTerminal::copyLineIdsOut)
+  void appendCell(uint32_t ch, uint32_t style) {
+    m_cells.push_back({ch, style});
+  }
+  void commitLine(uint32_t cols, uint64_t id);
+
+  // 第 index 行 (0 为最旧) 的原行宽
+  uint32_t lineCols(size_t index) const { return m_lines[index].cols; }
+  uint64_t lineId(size_t index) const { return m_lines[index].id; }
+
+  // 第 index 行展开为 lineCols(index) 个 TerminalCell，追加到 out
+  void appendLine(size_t index, std::vector<TerminalCell> &out) const;
+
+  size_t memoryBytes() const;
+
+private:
+  struct Cell {
+    uint32_t ch;
+    uint32_t style;
+  };
+
+  struct Line {
+    uint64_t start; // 首格的绝对下标，m_cells[start - m_cellBase]
+    uint64_t id;
+    uint32_t length;
+    uint32_t cols;
+  };
+
+  struct StyleHash {
+    size_t operator()(const ScrollbackStyle &s) const {
+      uint64_t h = (static_cast<uint64_t>(s.fg) << 32 | s.bg) *
+                   0x9E3779B97F4A7C15ull;
+      return static_cast<size_t>(h ^ (h >> 29) ^ s.flags * 0x85EBCA6Bu);
+    }
+  };
+
+  // 只保留历史中仍被引用的样式并重新编号
+  void compactStyles();
+
+  size_t m_maxLines;
+  ScrollbackStyle m_blank;
+
+  std::deque<Line> m_lines;
+  std::deque<Cell> m_cells;
+  uint64_t m_cellBase{0};
+  uint64_t m_lineStart{0}; // 正在推入的行的首格绝对下标
+
+  std::vector<ScrollbackStyle> m_styles;
+  std::unordered_map<ScrollbackStyle, uint32_t, StyleHash> m_styleIds;
+  size_t m_compactAt;
+};
+
+} // namespace terminal
+} // namespace pocket
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace pocket {
+namespace terminal {
+
+class PocketTerminal;
+
+/**
+ * 进程内的终端会话表，会话按 id 登记，不属于任何一个 JS 运行时。
+ *
+ * 主 JS 线程上的 HostObject 创建会话并登记；其他运行时 (UI 线程的
+ * worklet 运行时等) 按 id 取只读的帧访问器，JS 线程忙时也能取帧绘制。
+ * id 从 1 开始递增，不复用。表只在登记、查找、移除时加锁，
+ * 取到 shared_ptr 后的读写不经过这里
+ */
+class SessionRegistry {
+public:
+  static SessionRegistry &instance();
+
+  // 登记会话，返回新的 id
+  uint32_t add(std::shared_ptr<PocketTerminal> terminal);
+
+  // 找不到 (从未登记或已移除) 时返回空
+  std::shared_ptr<PocketTerminal> find(uint32_t id) const;
+
+  // 移除登记。其他线程已经取到的 shared_ptr 仍然有效，最后一个释放时析构
+  bool remove(uint32_t id);
+
+  // 当前登记的 id，升序
+  std::vector<uint32_t> ids() const;
+
+private:
+  mutable std::mutex m_mutex;
+  std::unordered_map<uint32_t, std::shared_ptr<PocketTerminal>> m_sessions;
+  uint32_t m_nextId{1};
+};
+
+} // namespace terminal
+} // namespace pocket
@@ -0,0 +1,964 @@
+#pragma once
+
+#include "pocket_terminal.h"
+#include "vterm.h"
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace pocket {
+namespace terminal {
+
+// TerminalCell.flags 的完整位布局。低 16 位与 PocketTerminal::onDamage
+// 导出的格式一致，高位为 StaticScreen 额外保存的、screen.c 才有的属性
+constexpr uint32_t kCellBold = 1u << 0;
+constexpr uint32_t kCellUnderline = 1u << 1;
+constexpr uint32_t kCellItalic = 1u << 2;
+constexpr uint32_t kCellBlink = 1u << 3;
+constexpr uint32_t kCellReverse = 1u << 4;
+constexpr uint32_t kCellStrike = 1u << 5;
+constexpr uint32_t kCellConceal = 1u << 6;
+constexpr uint32_t kCellSmall = 1u << 7;
+constexpr uint32_t kCellWidthShift = 8; // bit 8-15: 宽度
+constexpr uint32_t kCellWidthMask = 0xFFu << kCellWidthShift;
+// bit 16-17: 下划线样式 (VTERM_UNDERLINE_*)
+constexpr uint32_t kCellUnderlineShift = 16;
+constexpr uint32_t kCellFontShift = 18;     // bit 18-21: 字体 0-9
+constexpr uint32_t kCellBaselineShift = 22; // bit 22-23: VTERM_BASELINE_*
+constexpr uint32_t kCellProtected = 1u << 24;
+constexpr uint32_t kCellDwl = 1u << 25;
+constexpr uint32_t kCellDhlShift = 26; // bit 26-27: 1=上半 2=下半
+constexpr uint32_t kCellCombining = 1u << 30; // 组合字符存放在旁路数组中
+
+// 双宽字符右半格的占位码点，与 screen.c 相同
+constexpr uint32_t kWideContinuation = static_cast<uint32_t>(-1);
+
+// StaticScreen 的 Sink 默认实现。具体 Sink 继承它并按需"遮蔽"同名方法，
+// 调用点在编译期确定，编译器可以把整条 putglyph -> damage 路径内联。
+struct ScreenSinkBase {
+  // 为 true 时 scroll 先 flush 已合并的 damage 再调用 moveRect
+  static constexpr bool kHandlesMoveRect = false;
+  // 为 true 时滚出屏幕的行交给 pushLine，resize 变高时尝试 popLine
+  static constexpr bool kHasScrollback = false;
+
+  void damage(VTermRect) {}
+  bool moveRect(VTermRect, VTermRect) { return false; }
+  void moveCursor(VTermPos, VTermPos, bool) {}
+  bool setTermProp(VTermProp, VTermValue *) { return true; }
+  void bell() {}
+  void resize(int, int) {}
+  // cells 直接指向屏幕存储，仅在回调期间有效
+  void pushLine(const TerminalCell *, int, bool) {}
+  bool popLine(TerminalCell *, int) { return false; }
+  bool clearScrollback() { return false; }
+};
+
+/**
+ * screen.c 的 C++ 静态分派版本：直接挂到 libvterm 的 state 层，单元格以
+ * TerminalCell 导出格式存储，通知经 Sink 的非虚成员函数完成。
+ * fg / bg 与 PocketTerminal 相同，按 colorCode 编码：默认色与 256 色存
+ * 调色板下标，读取时再由当前调色板解析。
+ *
+ * 行为 (damage 合并、altscreen、reflow、滚动历史) 与 screen.c 保持一致，
+ * 由 t/6x 测试通过 static_screen_adapter 校验。lineinfo 的重新分配使用
+ * calloc/free，要求 VTerm 由 vterm_new 使用默认分配器创建。
+ */
+template <typename Sink> class StaticScreen {
+public:
+  using Combining = std::array<uint32_t, VTERM_MAX_CHARS_PER_CELL - 1>;
+
+  StaticScreen(VTerm *vt, Sink &sink)
+      : m_vt(vt), m_state(vterm_obtain_state(vt)), m_sink(sink) {
+    vterm_get_size(vt, &m_rows, &m_cols);
+    m_buffers[0].assign(static_cast<size_t>(m_rows) * m_cols, blankCell());
+    m_sbBuffer.resize(m_cols);
+
+    vterm_state_set_callbacks(m_state, &kStateCallbacks, this);
+    vterm_state_callbacks_has_premove(m_state);
+  }
+
+  ~StaticScreen() { vterm_state_set_callbacks(m_state, nullptr, nullptr); }
+
+  StaticScreen(const StaticScreen &) = delete;
+  StaticScreen &operator=(const StaticScreen &) = delete;
+
+  void enableAltscreen(bool altscreen) {
+    if (altscreen && m_buffers[1].empty())
+      m_buffers[1].assign(static_cast<size_t>(m_rows) * m_cols, blankCell());
+  }
+
+  void enableReflow(bool reflow) { m_reflow = reflow; }
+
+  void reset(bool hard) {
+    m_damaged.start_row = -1;
+    m_pendingScrollRect.start_row = -1;
+    vterm_state_reset(m_state, hard);
+    flushDamage();
+  }
+
+  void setDamageMerge(VTermDamageSize size) {
+    flushDamage();
+    m_damageMerge = size;
+  }
+
+  void flushDamage() {
+    if (m_pendingScrollRect.start_row != -1) {
+      vterm_scroll_rect(m_pendingScrollRect, m_pendingScrollDownward,
+                        m_pendingScrollRightward, &cbMoveRectUser,
+                        &cbEraseUser, this);
+      m_pendingScrollRect.start_row = -1;
+    }
+
+    if (m_damaged.start_row != -1) {
+      m_sink.damage(m_damaged);
+      m_damaged.start_row = -1;
+    }
+  }
+
+  // 格子里存的是默认色的调色板下标，换默认色不用改写格子
+  void setDefaultColors(const VTermColor *defaultFg,
+                        const VTermColor *defaultBg) {
+    vterm_state_set_default_colors(m_state, defaultFg, defaultBg);
+  }
+
+  VTermState *state() const { return m_state; }
+  int rows() const { return m_rows; }
+  int cols() const { return m_cols; }
+  bool globalReverse() const { return m_globalReverse; }
+
+  // 当前活动缓冲 (主屏或 altscreen)，rows * cols 个连续单元格
+  const TerminalCell *buffer() const { return m_buffers[m_active].data(); }
+
+  const TerminalCell *cell(int row, int col) const {
+    if (row < 0 || row >= m_rows || col < 0 || col >= m_cols)
+      return nullptr;
+    return &m_buffers[m_active][static_cast<size_t>(row) * m_cols + col];
+  }
+
+  // 组合字符 (不含主码点)，以 0 结尾或填满；没有时返回 nullptr
+  const uint32_t *combining(int row, int col) const {
+    const TerminalCell *c = cell(row, col);
+    if (!c || !(c->flags & kCellCombining))
+      return nullptr;
+    return m_combining[m_active][static_cast<size_t>(row) * m_cols + col]
+        .data();
+  }
+
+  // 与 vterm_screen_get_cell 相同的宽度判定：右侧紧跟占位格即为双宽
+  int cellWidth(int row, int col) const {
+    const TerminalCell *next = cell(row, col + 1);
+    return (next && next->ch == kWideContinuation) ? 2 : 1;
+  }
+
+private:
+  struct Pen {
+    uint32_t fg{kColorDefaultFg};
+    uint32_t bg{kColorDefaultBg};
+    uint32_t flags{0};
+  };
+
+  static constexpr uint32_t kWidthOne = 1u << kCellWidthShift;
+
+  TerminalCell blankCell() const {
+    return TerminalCell{0, m_pen.fg, m_pen.bg, m_pen.flags | kWidthOne};
+  }
+
+  static void setBits(uint32_t &flags, uint32_t mask, uint32_t value) {
+    flags = (flags & ~mask) | (value & mask);
+  }
+
+  TerminalCell *getcell(int row, int col) {
+    if (row < 0 || row >= m_rows || col < 0 || col >= m_cols)
+      return nullptr;
+    return &m_buffers[m_active][static_cast<size_t>(row) * m_cols + col];
+  }
+
+  Combining *combiningSlot(int bufidx, size_t index) {
+    auto &slots = m_combining[bufidx];
+    if (slots.empty())
+      slots.resize(m_buffers[bufidx].size());
+    return &slots[index];
+  }
+
+  // ============== rect helpers (同 rect.h) ==============
+
+  static void rectExpand(VTermRect &dst, const VTermRect &src) {
+    if (dst.start_row > src.start_row)
+      dst.start_row = src.start_row;
+    if (dst.start_col > src.start_col)
+      dst.start_col = src.start_col;
+    if (dst.end_row < src.end_row)
+      dst.end_row = src.end_row;
+    if (dst.end_col < src.end_col)
+      dst.end_col = src.end_col;
+  }
+
+  static void rectClip(VTermRect &dst, const VTermRect &bounds) {
+    if (dst.start_row < bounds.start_row)
+      dst.start_row = bounds.start_row;
+    if (dst.start_col < bounds.start_col)
+      dst.start_col = bounds.start_col;
+    if (dst.end_row > bounds.end_row)
+      dst.end_row = bounds.end_row;
+    if (dst.end_col > bounds.end_col)
+      dst.end_col = bounds.end_col;
+    if (dst.end_row < dst.start_row)
+      dst.end_row = dst.start_row;
+    if (dst.end_col < dst.start_col)
+      dst.end_col = dst.start_col;
+  }
+
+  static bool rectEqual(const VTermRect &a, const VTermRect &b) {
+    return a.start_row == b.start_row && a.start_col == b.start_col &&
+           a.end_row == b.end_row && a.end_col == b.end_col;
+  }
+
+  static bool rectContains(const VTermRect &big, const VTermRect &small) {
+    return small.start_row >= big.start_row &&
+           small.start_col >= big.start_col && small.end_row <= big.end_row &&
+           small.end_col <= big.end_col;
+  }
+
+  static bool rectIntersects(const VTermRect &a, const VTermRect &b) {
+    if (a.start_row > b.end_row || b.start_row > a.end_row)
+      return false;
+    if (a.start_col > b.end_col || b.start_col > a.end_col)
+      return false;
+    return true;
+  }
+
+  // ============== damage ==============
+
+  void damageRect(VTermRect rect) {
+    VTermRect emit;
+
+    switch (m_damageMerge) {
+    case VTERM_DAMAGE_CELL:
+      emit = rect;
+      break;
+
+    case VTERM_DAMAGE_ROW:
+      if (rect.end_row > rect.start_row + 1) {
+        flushDamage();
+        emit = rect;
+      } else if (m_damaged.start_row == -1) {
+        m_damaged = rect;
+        return;
+      } else if (rect.start_row == m_damaged.start_row) {
+        if (m_damaged.start_col > rect.start_col)
+          m_damaged.start_col = rect.start_col;
+        if (m_damaged.end_col < rect.end_col)
+          m_damaged.end_col = rect.end_col;
+        return;
+      } else {
+        emit = m_damaged;
+        m_damaged = rect;
+      }
+      break;
+
+    case VTERM_DAMAGE_SCREEN:
+    case VTERM_DAMAGE_SCROLL:
+      if (m_damaged.start_row == -1)
+        m_damaged = rect;
+      else
+        rectExpand(m_damaged, rect);
+      return;
+
+    default:
+      return;
+    }
+
+    m_sink.damage(emit);
+  }
+
+  void damageScreen() { damageRect(VTermRect{0, m_rows, 0, m_cols}); }
+
+  // ============== state callbacks ==============
+
+  int putglyph(VTermGlyphInfo *info, VTermPos pos) {
+    TerminalCell *cell = getcell(pos.row, pos.col);
+    if (!cell)
+      return 0;
+
+    uint32_t flags = m_pen.flags |
+                     (static_cast<uint32_t>(info->width & 0xFF)
+                      << kCellWidthShift) |
+                     (info->protected_cell ? kCellProtected : 0) |
+                     (info->dwl ? kCellDwl : 0) |
+                     (static_cast<uint32_t>(info->dhl) << kCellDhlShift);
+
+    cell->ch = info->chars[0];
+    cell->fg = m_pen.fg;
+    cell->bg = m_pen.bg;
+
+    if (info->chars[0] && info->chars[1]) {
+      size_t index = static_cast<size_t>(pos.row) * m_cols + pos.col;
+      Combining *slot = combiningSlot(m_active, index);
+      int i;
+      for (i = 0; i < VTERM_MAX_CHARS_PER_CELL - 1 && info->chars[i + 1]; i++)
+        (*slot)[i] = info->chars[i + 1];
+      if (i < VTERM_MAX_CHARS_PER_CELL - 1)
+        (*slot)[i] = 0;
+      flags |= kCellCombining;
+    }
+    cell->flags = flags;
+
+    for (int col = 1; col < info->width; col++) {
+      if (TerminalCell *gap = getcell(pos.row, pos.col + col))
+        gap->ch = kWideContinuation;
+    }
+
+    damageRect(
+        VTermRect{pos.row, pos.row + 1, pos.col, pos.col + info->width});
+    return 1;
+  }
+
+  int movecursor(VTermPos pos, VTermPos oldpos, int visible) {
+    m_sink.moveCursor(pos, oldpos, visible != 0);
+    return 1;
+  }
+
+  int premove(VTermRect rect) {
+    if constexpr (Sink::kHasScrollback) {
+      if (rect.start_row == 0 && rect.start_col == 0 &&
+          rect.end_col == m_cols && m_active == 0) {
+        for (int row = 0; row < rect.end_row; row++) {
+          const VTermLineInfo *info = vterm_state_get_lineinfo(m_state, row);
+          m_sink.pushLine(&m_buffers[0][static_cast<size_t>(row) * m_cols],
+                          m_cols, info->continuation);
+        }
+      }
+    }
+    return 1;
+  }
+
+  int moveRectInternal(VTermRect dest, VTermRect src) {
+    int cols = src.end_col - src.start_col;
+    int downward = src.start_row - dest.start_row;
+
+    int initRow, testRow, incRow;
+    if (downward < 0) {
+      initRow = dest.end_row - 1;
+      testRow = dest.start_row - 1;
+      incRow = -1;
+    } else {
+      initRow = dest.start_row;
+      testRow = dest.end_row;
+      incRow = +1;
+    }
+
+    auto &slots = m_combining[m_active];
+    for (int row = initRow; row != testRow; row += incRow) {
+      size_t to = static_cast<size_t>(row) * m_cols + dest.start_col;
+      size_t from =
+          static_cast<size_t>(row + downward) * m_cols + src.start_col;
+      std::memmove(&m_buffers[m_active][to], &m_buffers[m_active][from],
+                   cols * sizeof(TerminalCell));
+      if (!slots.empty())
+        std::memmove(&slots[to], &slots[from], cols * sizeof(Combining));
+    }
+    return 1;
+  }
+
+  int moveRectUser(VTermRect dest, VTermRect src) {
+    if constexpr (Sink::kHandlesMoveRect) {
+      if (m_damageMerge != VTERM_DAMAGE_SCROLL)
+        flushDamage(); // Avoid an infinite loop
+
+      if (m_sink.moveRect(dest, src))
+        return 1;
+    }
+
+    damageRect(dest);
+    return 1;
+  }
+
+  int eraseInternal(VTermRect rect, int selective) {
+    for (int row = rect.start_row; row < m_rows && row < rect.end_row;
+         row++) {
+      const VTermLineInfo *info = vterm_state_get_lineinfo(m_state, row);
+      // 擦除只保留颜色，其余属性回到复位状态
+      uint32_t flags = kWidthOne | (info->doublewidth ? kCellDwl : 0) |
+                       (static_cast<uint32_t>(info->doubleheight)
+                        << kCellDhlShift);
+
+      TerminalCell *cell = getcell(row, rect.start_col);
+      for (int col = rect.start_col; col < rect.end_col; col++, cell++) {
+        if (selective && (cell->flags & kCellProtected))
+          continue;
+
+        cell->ch = 0;
+        cell->fg = m_pen.fg;
+        cell->bg = m_pen.bg;
+        cell->flags = flags;
+      }
+    }
+    return 1;
+  }
+
+  int eraseUser(VTermRect rect, int) {
+    damageRect(rect);
+    return 1;
+  }
+
+  int erase(VTermRect rect, int selective) {
+    eraseInternal(rect, selective);
+    return eraseUser(rect, 0);
+  }
+
+  int scrollrect(VTermRect rect, int downward, int rightward) {
+    if (m_damageMerge != VTERM_DAMAGE_SCROLL) {
+      vterm_scroll_rect(rect, downward, rightward, &cbMoveRectInternal,
+                        &cbEraseInternal, this);
+
+      flushDamage();
+
+      vterm_scroll_rect(rect, downward, rightward, &cbMoveRectUser,
+                        &cbEraseUser, this);
+      return 1;
+    }
+
+    if (m_damaged.start_row != -1 && !rectIntersects(rect, m_damaged))
+      flushDamage();
+
+    if (m_pendingScrollRect.start_row == -1) {
+      m_pendingScrollRect = rect;
+      m_pendingScrollDownward = downward;
+      m_pendingScrollRightward = rightward;
+    } else if (rectEqual(m_pendingScrollRect, rect) &&
+               ((m_pendingScrollDownward == 0 && downward == 0) ||
+                (m_pendingScrollRightward == 0 && rightward == 0))) {
+      m_pendingScrollDownward += downward;
+      m_pendingScrollRightward += rightward;
+    } else {
+      flushDamage();
+
+      m_pendingScrollRect = rect;
+      m_pendingScrollDownward = downward;
+      m_pendingScrollRightward = rightward;
+    }
+
+    vterm_scroll_rect(rect, downward, rightward, &cbMoveRectInternal,
+                      &cbEraseInternal, this);
+
+    if (m_damaged.start_row == -1)
+      return 1;
+
+    if (rectContains(rect, m_damaged)) {
+      // Scroll region entirely contains the damage; just move it
+      vterm_rect_move(&m_damaged, -downward, -rightward);
+      rectClip(m_damaged, rect);
+    } else if (rect.start_col <= m_damaged.start_col &&
+               rect.end_col >= m_damaged.end_col && rightward == 0) {
+      // 纵向滚动恰好把 damage 切成两半的常见情况
+      if (m_damaged.start_row >= rect.start_row &&
+          m_damaged.start_row < rect.end_row) {
+        m_damaged.start_row -= downward;
+        if (m_damaged.start_row < rect.start_row)
+          m_damaged.start_row = rect.start_row;
+        if (m_damaged.start_row > rect.end_row)
+          m_damaged.start_row = rect.end_row;
+      }
+      if (m_damaged.end_row >= rect.start_row &&
+          m_damaged.end_row < rect.end_row) {
+        m_damaged.end_row -= downward;
+        if (m_damaged.end_row < rect.start_row)
+          m_damaged.end_row = rect.start_row;
+        if (m_damaged.end_row > rect.end_row)
+          m_damaged.end_row = rect.end_row;
+      }
+    }
+
+    return 1;
+  }
+
+  int setpenattr(VTermAttr attr, VTermValue *val) {
+    switch (attr) {
+    case VTERM_ATTR_BOLD:
+      setBits(m_pen.flags, kCellBold, val->boolean ? kCellBold : 0);
+      return 1;
+    case VTERM_ATTR_UNDERLINE:
+      setBits(m_pen.flags, kCellUnderline | (3u << kCellUnderlineShift),
+              (val->number ? kCellUnderline : 0) |
+                  (static_cast<uint32_t>(val->number) << kCellUnderlineShift));
+      return 1;
+    case VTERM_ATTR_ITALIC:
+      setBits(m_pen.flags, kCellItalic, val->boolean ? kCellItalic : 0);
+      return 1;
+    case VTERM_ATTR_BLINK:
+      setBits(m_pen.flags, kCellBlink, val->boolean ? kCellBlink : 0);
+      return 1;
+    case VTERM_ATTR_REVERSE:
+      setBits(m_pen.flags, kCellReverse, val->boolean ? kCellReverse : 0);
+      return 1;
+    case VTERM_ATTR_CONCEAL:
+      setBits(m_pen.flags, kCellConceal, val->boolean ? kCellConceal : 0);
+      return 1;
+    case VTERM_ATTR_STRIKE:
+      setBits(m_pen.flags, kCellStrike, val->boolean ? kCellStrike : 0);
+      return 1;
+    case VTERM_ATTR_FONT:
+      setBits(m_pen.flags, 0xFu << kCellFontShift,
+              static_cast<uint32_t>(val->number) << kCellFontShift);
+      return 1;
+    case VTERM_ATTR_FOREGROUND:
+      m_pen.fg = colorCode(val->color);
+      return 1;
+    case VTERM_ATTR_BACKGROUND:
+      m_pen.bg = colorCode(val->color);
+      return 1;
+    case VTERM_ATTR_SMALL:
+      setBits(m_pen.flags, kCellSmall, val->boolean ? kCellSmall : 0);
+      return 1;
+    case VTERM_ATTR_BASELINE:
+      setBits(m_pen.flags, 3u << kCellBaselineShift,
+              static_cast<uint32_t>(val->number) << kCellBaselineShift);
+      return 1;
+
+    case VTERM_N_ATTRS:
+      return 0;
+    }
+    return 0;
+  }
+
+  int settermprop(VTermProp prop, VTermValue *val) {
+    switch (prop) {
+    case VTERM_PROP_ALTSCREEN:
+      if (val->boolean && m_buffers[1].empty())
+        return 0;
+
+      m_active = val->boolean ? 1 : 0;
+      // 进入时 state 会擦除整屏并产生 damage，只需在退出时补发
+      if (!val->boolean)
+        damageScreen();
+      break;
+    case VTERM_PROP_REVERSE:
+      m_globalReverse = val->boolean;
+      damageScreen();
+      break;
+    default:;
+    }
+
+    return m_sink.setTermProp(prop, val) ? 1 : 0;
+  }
+
+  int bell() {
+    m_sink.bell();
+    return 1;
+  }
+
+  static int linePopcount(const TerminalCell *buffer, int row, int cols) {
+    int col = cols - 1;
+    while (col >= 0 && buffer[static_cast<size_t>(row) * cols + col].ch == 0)
+      col--;
+    return col + 1;
+  }
+
+  // 与 screen.c resize_buffer 相同的逆序逻辑行重排，按跨度整段复制
+  void resizeBuffer(int bufidx, int newRows, int newCols, bool active,
+                    VTermStateFields *statefields) {
+    int oldRows = m_rows;
+    int oldCols = m_cols;
+
+    std::vector<TerminalCell> &oldBuffer = m_buffers[bufidx];
+    std::vector<Combining> &oldSlots = m_combining[bufidx];
+    VTermLineInfo *oldLineinfo = statefields->lineinfos[bufidx];
+
+    std::vector<TerminalCell> newBuffer(static_cast<size_t>(newRows) *
+                                        newCols);
+    std::vector<Combining> newSlots(oldSlots.empty() ? 0 : newBuffer.size());
+    auto *newLineinfo = static_cast<VTermLineInfo *>(
+        std::calloc(newRows, sizeof(VTermLineInfo)));
+
+    auto copySpan = [&](size_t to, size_t from, int count) {
+      std::memcpy(&newBuffer[to], &oldBuffer[from],
+                  count * sizeof(TerminalCell));
+      if (!newSlots.empty())
+        std::memcpy(&newSlots[to], &oldSlots[from], count * sizeof(Combining));
+    };
+    auto clearSpan = [&](size_t at, int count) {
+      TerminalCell blank = blankCell();
+      for (int i = 0; i < count; i++)
+        newBuffer[at + i] = blank;
+    };
+
+    std::vector<int> oldLinelen(oldRows);
+    for (int row = 0; row < oldRows; row++) {
+      if (m_reflow && row < (oldRows - 1) && oldLineinfo[row + 1].continuation)
+        oldLinelen[row] = oldCols;
+      else
+        oldLinelen[row] = linePopcount(oldBuffer.data(), row, oldCols);
+    }
+
+    int oldRow = oldRows - 1;
+    int newRow = newRows - 1;
+
+    VTermPos oldCursor = statefields->pos;
+    VTermPos newCursor = {-1, -1};
+
+    int finalBlankRow = newRows;
+
+    while (oldRow >= 0) {
+      int oldRowEnd = oldRow;
+      while (m_reflow && oldLineinfo && oldRow > 0 &&
+             oldLineinfo[oldRow].continuation)
+        oldRow--;
+      int oldRowStart = oldRow;
+
+      int width = 0;
+      for (int row = oldRowStart; row <= oldRowEnd; row++)
+        width += oldLinelen[row];
+
+      if (finalBlankRow == (newRow + 1) && width == 0)
+        finalBlankRow = newRow;
+
+      int newHeight = m_reflow ? width ? (width + newCols - 1) / newCols : 1
+                               : 1;
+
+      int newRowEnd = newRow;
+      int newRowStart = newRow - newHeight + 1;
+
+      oldRow = oldRowStart;
+      int oldCol = 0;
+
+      int spareRows = newRows - finalBlankRow;
+
+      if (newRowStart < 0 && spareRows >= 0 &&
+          (!active || newCursor.row == -1 ||
+           (newCursor.row - newRowStart) < newRows)) {
+        // 尝试把已排好的内容下移到底部空行中腾出位置
+        int downwards = -newRowStart;
+        if (downwards > spareRows)
+          downwards = spareRows;
+        int rowcount = newRows - downwards;
+
+        size_t shift = static_cast<size_t>(downwards) * newCols;
+        size_t count = static_cast<size_t>(rowcount) * newCols;
+        std::memmove(&newBuffer[shift], &newBuffer[0],
+                     count * sizeof(TerminalCell));
+        if (!newSlots.empty())
+          std::memmove(&newSlots[shift], &newSlots[0],
+                       count * sizeof(Combining));
+        std::memmove(&newLineinfo[downwards], &newLineinfo[0],
+                     rowcount * sizeof(VTermLineInfo));
+
+        newRow += downwards;
+        newRowStart += downwards;
+        newRowEnd += downwards;
+
+        if (newCursor.row >= 0)
+          newCursor.row += downwards;
+
+        finalBlankRow += downwards;
+      }
+
+      if (newRowStart < 0) {
+        if (oldRowStart <= oldCursor.row && oldCursor.row <= oldRowEnd) {
+          newCursor.row = 0;
+          newCursor.col = oldCursor.col;
+          if (newCursor.col >= newCols)
+            newCursor.col = newCols - 1;
+        }
+        break;
+      }
+
+      for (newRow = newRowStart, oldRow = oldRowStart; newRow <= newRowEnd;
+           newRow++) {
+        int count = width >= newCols ? newCols : width;
+        width -= count;
+
+        int newCol = 0;
+
+        while (count) {
+          int span = oldCols - oldCol;
+          if (span > count)
+            span = count;
+
+          copySpan(static_cast<size_t>(newRow) * newCols + newCol,
+                   static_cast<size_t>(oldRow) * oldCols + oldCol, span);
+
+          if (oldCursor.row == oldRow && oldCursor.col >= oldCol &&
+              oldCursor.col < oldCol + span)
+            newCursor.row = newRow,
+            newCursor.col = newCol + (oldCursor.col - oldCol);
+
+          oldCol += span;
+          newCol += span;
+          count -= span;
+
+          if (oldCol == oldCols) {
+            oldRow++;
+
+            if (!m_reflow)
+              break;
+            oldCol = 0;
+          }
+        }
+
+        if (oldCursor.row == oldRow && oldCursor.col >= oldCol) {
+          newCursor.row = newRow,
+          newCursor.col = (oldCursor.col - oldCol + newCol);
+          if (newCursor.col >= newCols)
+            newCursor.col = newCols - 1;
+        }
+
+        clearSpan(static_cast<size_t>(newRow) * newCols + newCol,
+                  newCols - newCol);
+
+        newLineinfo[newRow].continuation = (newRow > newRowStart);
+      }
+
+      oldRow = oldRowStart - 1;
+      newRow = newRowStart - 1;
+    }
+
+    if (oldCursor.row <= oldRow) {
+      // 光标整个移出了屏幕顶部，拉回可见范围
+      newCursor.row = 0, newCursor.col = oldCursor.col;
+      if (newCursor.col >= newCols)
+        newCursor.col = newCols - 1;
+    }
+
+    if (active && (newCursor.row == -1 || newCursor.col == -1)) {
+      // screen.c 在此处 abort()；这里退化为把光标钳制到左上角
+      newCursor.row = 0;
+      newCursor.col = 0;
+    }
+
+    if (oldRow >= 0 && bufidx == 0) {
+      // 多出的行推入滚动历史
+      if constexpr (Sink::kHasScrollback) {
+        for (int row = 0; row <= oldRow; row++)
+          m_sink.pushLine(&oldBuffer[static_cast<size_t>(row) * oldCols],
+                          oldCols, oldLineinfo[row].continuation);
+      }
+      if (active)
+        statefields->pos.row -= (oldRow + 1);
+    }
+
+    if constexpr (Sink::kHasScrollback) {
+      if (newRow >= 0 && bufidx == 0) {
+        // 变高时尝试从滚动历史回填
+        if (static_cast<int>(m_sbBuffer.size()) < oldCols)
+          m_sbBuffer.resize(oldCols);
+
+        while (newRow >= 0) {
+          if (!m_sink.popLine(m_sbBuffer.data(), oldCols))
+            break;
+
+          size_t rowBase = static_cast<size_t>(newRow) * newCols;
+          int col = 0;
+          while (col < oldCols && col < newCols) {
+            const TerminalCell &src = m_sbBuffer[col];
+            int width = (src.flags & kCellWidthMask) >> kCellWidthShift;
+            if (width < 1)
+              width = 1;
+
+            TerminalCell &dst = newBuffer[rowBase + col];
+            dst = src;
+            dst.flags &= ~kCellCombining;
+            if (m_globalReverse)
+              dst.flags ^= kCellReverse;
+
+            if (width == 2 && col < (newCols - 1))
+              newBuffer[rowBase + col + 1].ch = kWideContinuation;
+            col += width;
+          }
+          if (col < newCols)
+            clearSpan(rowBase + col, newCols - col);
+          newRow--;
+
+          if (active)
+            statefields->pos.row++;
+        }
+      }
+    }
+
+    if (newRow >= 0) {
+      // 把新内容上移到顶部，底部补空行
+      int moverows = newRows - newRow - 1;
+      size_t shift = static_cast<size_t>(newRow + 1) * newCols;
+      std::memmove(&newBuffer[0], &newBuffer[shift],
+                   static_cast<size_t>(moverows) * newCols *
+                       sizeof(TerminalCell));
+      if (!newSlots.empty())
+        std::memmove(&newSlots[0], &newSlots[shift],
+                     static_cast<size_t>(moverows) * newCols *
+                         sizeof(Combining));
+      std::memmove(&newLineinfo[0], &newLineinfo[newRow + 1],
+                   moverows * sizeof(VTermLineInfo));
+
+      newCursor.row -= (newRow + 1);
+
+      clearSpan(static_cast<size_t>(moverows) * newCols,
+                (newRows - moverows) * newCols);
+      for (newRow = moverows; newRow < newRows; newRow++)
+        newLineinfo[newRow] = VTermLineInfo{};
+    }
+
+    oldBuffer.swap(newBuffer);
+    oldSlots.swap(newSlots);
+
+    std::free(oldLineinfo);
+    statefields->lineinfos[bufidx] = newLineinfo;
+
+    if (active)
+      statefields->pos = newCursor;
+  }
+
+  int resize(int newRows, int newCols, VTermStateFields *fields) {
+    bool altscreenActive = m_active == 1;
+    int oldRows = m_rows;
+
+    resizeBuffer(0, newRows, newCols, !altscreenActive, fields);
+    if (altscreenActive) {
+      resizeBuffer(1, newRows, newCols, true, fields);
+    } else if (!m_buffers[1].empty()) {
+      // 未激活的 altscreen 每次进入都会被擦除，直接换成空白缓冲
+      m_buffers[1].assign(static_cast<size_t>(newRows) * newCols,
+                          blankCell());
+      m_combining[1].clear();
+    }
+
+    if (!altscreenActive && (!m_buffers[1].empty() || newRows != oldRows)) {
+      std::free(fields->lineinfos[1]);
+      fields->lineinfos[1] = static_cast<VTermLineInfo *>(
+          std::calloc(newRows, sizeof(VTermLineInfo)));
+    }
+
+    m_rows = newRows;
+    m_cols = newCols;
+    m_sbBuffer.resize(newCols);
+
+    damageScreen();
+
+    m_sink.resize(newRows, newCols);
+    return 1;
+  }
+
+  int setlineinfo(int row, const VTermLineInfo *newinfo,
+                  const VTermLineInfo *oldinfo) {
+    if (newinfo->doublewidth != oldinfo->doublewidth ||
+        newinfo->doubleheight != oldinfo->doubleheight) {
+      uint32_t bits =
+          (newinfo->doublewidth ? kCellDwl : 0) |
+          (static_cast<uint32_t>(newinfo->doubleheight) << kCellDhlShift);
+      for (int col = 0; col < m_cols; col++)
+        setBits(getcell(row, col)->flags, kCellDwl | (3u << kCellDhlShift),
+                bits);
+
+      VTermRect rect{row, row + 1, 0,
+                     newinfo->doublewidth ? m_cols / 2 : m_cols};
+      damageRect(rect);
+
+      if (newinfo->doublewidth) {
+        rect.start_col = m_cols / 2;
+        rect.end_col = m_cols;
+
+        eraseInternal(rect, 0);
+      }
+    }
+    return 1;
+  }
+
+  int sbClear() { return m_sink.clearScrollback() ? 1 : 0; }
+
+  // ============== C 回调跳板 ==============
+  // state 层是 C 代码，这一跳无法避免；跳板之后的全部调用都是静态分派
+
+  static StaticScreen *self(void *user) {
+    return static_cast<StaticScreen *>(user);
+  }
+
+  static int cbPutglyph(VTermGlyphInfo *info, VTermPos pos, void *user) {
+    return self(user)->putglyph(info, pos);
+  }
+  static int cbMoveCursor(VTermPos pos, VTermPos oldpos, int visible,
+                          void *user) {
+    return self(user)->movecursor(pos, oldpos, visible);
+  }
+  static int cbScrollRect(VTermRect rect, int downward, int rightward,
+                          void *user) {
+    return self(user)->scrollrect(rect, downward, rightward);
+  }
+  static int cbErase(VTermRect rect, int selective, void *user) {
+    return self(user)->erase(rect, selective);
+  }
+  static int cbSetPenAttr(VTermAttr attr, VTermValue *val, void *user) {
+    return self(user)->setpenattr(attr, val);
+  }
+  static int cbSetTermProp(VTermProp prop, VTermValue *val, void *user) {
+    return self(user)->settermprop(prop, val);
+  }
+  static int cbBell(void *user) { return self(user)->bell(); }
+  static int cbResize(int rows, int cols, VTermStateFields *fields,
+                      void *user) {
+    return self(user)->resize(rows, cols, fields);
+  }
+  static int cbSetLineInfo(int row, const VTermLineInfo *newinfo,
+                           const VTermLineInfo *oldinfo, void *user) {
+    return self(user)->setlineinfo(row, newinfo, oldinfo);
+  }
+  static int cbSbClear(void *user) { return self(user)->sbClear(); }
+  static int cbPremove(VTermRect rect, void *user) {
+    return self(user)->premove(rect);
+  }
+  static int cbMoveRectInternal(VTermRect dest, VTermRect src, void *user) {
+    return self(user)->moveRectInternal(dest, src);
+  }
+  static int cbMoveRectUser(VTermRect dest, VTermRect src, void *user) {
+    return self(user)->moveRectUser(dest, src);
+  }
+  static int cbEraseInternal(VTermRect rect, int selective, void *user) {
+    return self(user)->eraseInternal(rect, selective);
+  }
+  static int cbEraseUser(VTermRect rect, int selective, void *user) {
+    return self(user)->eraseUser(rect, selective);
+  }
+
+  static inline const VTermStateCallbacks kStateCallbacks = {
+      &cbPutglyph,    // putglyph
+      &cbMoveCursor,  // movecursor
+      &cbScrollRect,  // scrollrect
+      nullptr,        // moverect
+      &cbErase,       // erase
+      nullptr,        // initpen
+      &cbSetPenAttr,  // setpenattr
+      &cbSetTermProp, // settermprop
+      &cbBell,        // bell
+      &cbResize,      // resize
+      &cbSetLineInfo, // setlineinfo
+      &cbSbClear,     // sb_clear
+      &cbPremove,     // premove
+  };
+
+  VTerm *m_vt;
+  VTermState *m_state;
+  Sink &m_sink;
+
+  int m_rows{0};
+  int m_cols{0};
+
+  bool m_globalReverse{false};
+  bool m_reflow{false};
+
+  VTermDamageSize m_damageMerge{VTERM_DAMAGE_CELL};
+  VTermRect m_damaged{-1, 0, 0, 0};
+  VTermRect m_pendingScrollRect{-1, 0, 0, 0};
+  int m_pendingScrollDownward{0};
+  int m_pendingScrollRightward{0};
+
+  // 主屏与 altscreen；[1] 按需分配。组合字符旁路数组在首次出现时才分配
+  std::vector<TerminalCell> m_buffers[2];
+  std::vector<Combining> m_combining[2];
+  int m_active{0};
+
+  // resize 回填时 popLine 的行缓冲
+  std::vector<TerminalCell> m_sbBuffer;
+
+  Pen m_pen;
+};
+
+} // namespace terminal
+} // namespace pocket
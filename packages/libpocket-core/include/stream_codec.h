@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pocket {
+namespace terminal {
+
+/**
+ * 终端字节流的流式 LZ 压缩 (录像、字节传输、中继镜像，每会话一对)。
+ *
+ * 流格式：4 字节头 "PKZ" + 版本，之后是连续的序列
+ *   token       高 4 位字面量长度，低 4 位匹配长度 - 4，15 表示后续扩展
+ *   [扩展长度]  每字节累加，255 表示还有下一字节
+ *   字面量
+ *   offset      2 字节小端，0 表示本序列没有匹配 (一段输出的末尾)
+ *   [扩展长度]
+ * 匹配只引用之前的字节，窗口不超过 64KiB。两端的历史开头都预置
+ * kStreamDictionary (常见 SGR / 光标 / 清屏序列与换行)，开头几 KB 与每次
+ * 空闲刷新后的短片段也能匹配到。
+ */
+struct StreamCodecOptions {
+  // 匹配距离上限 (<= 65535)；解码端总是保留 64KiB
+  size_t windowBytes{32 * 1024};
+  // 攒满多少输入才编码一次，越大比率越高、延迟越大
+  size_t blockBytes{16 * 1024};
+  // 每个位置最多比较的候选数，越大比率越高、越慢
+  int searchDepth{4};
+  // 交互会话：读端空闲 (没有更多字节可读) 时 idle() 立即输出攒着的输入
+  bool flushOnIdle{false};
+};
+
+// 预置字典的内容，两端必须一致 (改动须升级流格式版本)
+extern const char kStreamDictionary[];
+extern const size_t kStreamDictionarySize;
+
+class StreamCompressor {
+public:
+  explicit StreamCompressor(const StreamCodecOptions &options = {});
+
+  // 追加输入，攒满 blockBytes 的部分立即编码，压缩结果追加到 out
+  void write(const char *data, size_t len, std::string &out);
+
+  // 读端暂时没有更多字节时调用。flushOnIdle 下等同 flush，否则不输出
+  void idle(std::string &out) {
+    if (m_options.flushOnIdle)
+      flush(out);
+  }
+
+  // 编码所有攒着的输入 (录像结束、切换会话等)
+  void flush(std::string &out);
+
+  bool hasPending() const { return m_pending > 0; }
+  uint64_t bytesIn() const { return m_bytesIn; }
+  uint64_t bytesOut() const { return m_bytesOut; }
+
+private:
+  void encode(size_t end, std::string &out);
+  void emitSequence(const uint8_t *literals, size_t literalLen, size_t offset,
+                    size_t matchLen, std::string &out);
+  void insertHash(size_t pos);
+  void slide();
+
+  StreamCodecOptions m_options;
+  // 预置字典 + 已读入的字节；[m_encoded, size) 为还没编码的输入
+  std::vector<uint8_t> m_history;
+  size_t m_encoded{0};
+  size_t m_pending{0};
+  // 历史开头在整条流中的绝对位置，哈希表存绝对位置
+  uint32_t m_base{0};
+  std::vector<uint32_t> m_head;  // 哈希 -> 最近一次出现的位置 + 1
+  std::vector<uint32_t> m_chain; // 位置 & mask -> 同哈希的上一次位置 + 1
+  bool m_headerWritten{false};
+  uint64_t m_bytesIn{0};
+  uint64_t m_bytesOut{0};
+};
+
+class StreamDecompressor {
+public:
+  StreamDecompressor();
+
+  // 输入可以在任意位置切开；能解出的部分追加到 out。
+  // 流损坏 (头不符、偏移越界) 时返回 false，之后的调用都失败
+  bool write(const char *data, size_t len, std::string &out);
+
+  // 收到的字节都已解出 (没有停在某个序列中间)
+  bool idle() const { return m_input.size() == m_consumed; }
+  bool failed() const { return m_failed; }
+
+private:
+  bool decodeSequences(std::string &out);
+
+  std::string m_input;
+  size_t m_consumed{0};
+  std::vector<uint8_t> m_history;
+  bool m_headerRead{false};
+  bool m_failed{false};
+};
+
+} // namespace terminal
+} // namespace pocket
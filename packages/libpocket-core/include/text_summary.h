@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pocket {
+namespace terminal {
+
+// exportSummary 的参数。lastCommands 与 lastLines 都为 0 时导出全部历史
+struct SummaryOptions {
+  size_t maxBytes{4096}; // 输出上限 (字节，含换行)
+  int lastCommands{0};   // 最近 N 条命令，依赖 OSC 133 提示符标记
+  int lastLines{0};      // 最近 N 行 (在 lastCommands 之后再截取)
+};
+
+/**
+ * 把终端行流式压缩成适合放进模型上下文的纯文本。
+ *
+ * addLine 按从旧到新的顺序逐行调用，只做一遍：
+ *  - 连续相同的行合并为一行并标注重复次数；
+ *  - 只有数字不同的连续行 (进度、计数) 只保留首尾两行；
+ *  - 连续空行合并，首尾空行去掉 (调用方已去掉行尾空白)。
+ * finish 时如果超出预算，优先保留疑似错误的行，其余从最旧的开始丢弃，
+ * 被丢弃的区间用一行省略标记代替。
+ */
+class TextCompactor {
+public:
+  explicit TextCompactor(size_t maxBytes);
+
+  // text 为已去掉行尾空白的 UTF-8；highlighted 表示该行含红色前景等错误提示
+  void addLine(const std::string &text, bool highlighted);
+
+  std::string finish();
+
+  static bool looksLikeError(const std::string &text);
+  // 同上，lower 的 ASCII 字母已是小写 (调用方在拼接时顺便转换，省一次复制)
+  static bool looksLikeErrorLower(const std::string &lower);
+
+private:
+  struct Entry {
+    std::string text;
+    bool error;
+    int lines; // 代表的原始行数 (合并的重复行、相似行、空行)
+  };
+
+  void flushRun();
+  void pushEntry(std::string text, bool error, int lines);
+
+  size_t m_maxBytes;
+  std::vector<Entry> m_entries;
+  size_t m_totalBytes{0};
+
+  // 正在合并的连续行
+  std::string m_runKey;
+  std::string m_runFirst;
+  std::string m_runLast;
+  int m_runCount{0};
+  bool m_runIdentical{true};
+  bool m_runError{false};
+  int m_pendingBlanks{0};
+};
+
+} // namespace terminal
+} // namespace pocket
@@ -0,0 +1,563 @@
+#include "exec_engine.h"
+#include "process_sampler.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+namespace pocket {
+namespace terminal {
+
+static uint64_t nowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// 主进程退出后，继承了管道的后代最多再等这么久，之后按进程树清理
+static const uint64_t kLingerMs = 200;
+// 有未退出的子进程时，poll 最长等待时间 (用于 waitid 轮询)
+static const int kReapPollMs = 50;
+
+// ============== BoundedCapture ==============
+
+BoundedCapture::BoundedCapture(size_t headBytes, size_t tailBytes)
+    : m_headLimit(headBytes), m_tailLimit(tailBytes) {}
+
+void BoundedCapture::append(const char *data, size_t len) {
+  m_total += len;
+
+  size_t take = std::min(len, m_headLimit - m_head.size());
+  m_head.append(data, take);
+  data += take;
+  len -= take;
+  if (len == 0 || m_tailLimit == 0)
+    return;
+
+  if (len >= m_tailLimit) {
+    m_tail.assign(data + len - m_tailLimit, m_tailLimit);
+    m_tailPos = 0;
+    return;
+  }
+
+  if (m_tail.size() < m_tailLimit) {
+    size_t n = std::min(len, m_tailLimit - m_tail.size());
+    m_tail.append(data, n);
+    data += n;
+    len -= n;
+  }
+  // 尾部已满：覆盖最旧的数据
+  while (len > 0) {
+    size_t n = std::min(len, m_tailLimit - m_tailPos);
+    std::memcpy(&m_tail[m_tailPos], data, n);
+    m_tailPos = (m_tailPos + n) % m_tailLimit;
+    data += n;
+    len -= n;
+  }
+}
+
+std::string BoundedCapture::tail() const {
+  if (m_tailPos == 0)
+    return m_tail;
+  return m_tail.substr(m_tailPos) + m_tail.substr(0, m_tailPos);
+}
+
+uint64_t BoundedCapture::droppedBytes() const {
+  return m_total - m_head.size() - m_tail.size();
+}
+
+std::string BoundedCapture::text() const {
+  uint64_t dropped = droppedBytes();
+  if (dropped == 0)
+    return m_head + tail();
+  return m_head + "\n[... " + std::to_string(dropped) + " bytes dropped ...]\n" +
+         tail();
+}
+
+// ============== ExecEngine ==============
+
+struct ExecEngine::Run {
+  uint64_t id{0};
+  ExecOptions options;
+  Completion completion;
+  ExecResult result;
+
+  pid_t pid{-1};
+  // 主进程已退出：用 WNOWAIT 只取状态，僵尸留到 finish 才回收，
+  // 期间 pid (也就是进程组 id) 不会被复用，可以放心对组发信号
+  bool exited{false};
+  bool reaped{false};
+  int inFd{-1};
+  int outFd{-1};
+  int errFd{-1};
+  size_t stdinOffset{0};
+
+  uint64_t startMs{0};
+  uint64_t deadlineMs{0}; // 0 表示不限时
+  uint64_t killAtMs{0};   // 已发 SIGTERM，到点升级为 SIGKILL
+  uint64_t lingerUntilMs{0};
+};
+
+static void closeFd(int &fd) {
+  if (fd >= 0) {
+    close(fd);
+    fd = -1;
+  }
+}
+
+// 收集 root 的全部后代 (不含 root)；主进程退出后子进程被过继，
+// 父子关系已丢失，所以只在主进程仍存活时有意义
+static std::vector<pid_t> collectDescendants(pid_t root) {
+  std::vector<ProcStat> procs;
+  scanProcesses(procs);
+  std::vector<pid_t> result;
+  for (size_t index : findDescendants(procs, root))
+    result.push_back(procs[index].pid);
+  return result;
+}
+
+void ExecEngine::killTree(Run &run, int sig) {
+  if (run.pid <= 0)
+    return;
+  if (run.reaped)
+    return;
+  if (!run.exited) {
+    // 先按父子关系找出离开了进程组 (setsid / setpgid) 的后代
+    for (pid_t child : collectDescendants(run.pid))
+      kill(child, sig);
+  }
+  // 子进程以自己的 pid 为进程组；主进程未回收 (至多是僵尸) 时 pid 不会被复用
+  kill(-run.pid, sig);
+  if (!run.exited)
+    kill(run.pid, sig);
+}
+
+ExecEngine::ExecEngine() {
+  if (pipe(m_wakePipe) == 0) {
+    for (int fd : m_wakePipe) {
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+  }
+}
+
+ExecEngine::~ExecEngine() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  wake();
+  if (m_thread.joinable())
+    m_thread.join();
+  closeFd(m_wakePipe[0]);
+  closeFd(m_wakePipe[1]);
+}
+
+uint64_t ExecEngine::start(ExecOptions options, Completion completion) {
+  auto run = std::make_unique<Run>();
+  run->options = std::move(options);
+  run->completion = std::move(completion);
+  run->result.out = BoundedCapture(run->options.headBytes,
+                                   run->options.tailBytes);
+  run->result.err = BoundedCapture(run->options.headBytes,
+                                   run->options.tailBytes);
+
+  uint64_t id;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    id = m_nextId++;
+    run->id = id;
+    run->result.id = id;
+    m_pending.push_back(std::move(run));
+    m_running++;
+    if (!m_thread.joinable())
+      m_thread = std::thread(&ExecEngine::ioLoop, this);
+  }
+  wake();
+  return id;
+}
+
+bool ExecEngine::cancel(uint64_t id) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (id == 0 || id >= m_nextId)
+      return false;
+    m_cancelled.push_back(id);
+  }
+  wake();
+  return true;
+}
+
+size_t ExecEngine::running() const { return m_running.load(); }
+
+void ExecEngine::wake() {
+  char c = 1;
+  if (m_wakePipe[1] >= 0)
+    (void)!write(m_wakePipe[1], &c, 1);
+}
+
+void ExecEngine::spawn(Run &run) {
+  const ExecOptions &opt = run.options;
+  run.startMs = nowMs();
+
+  // fork 之后不再分配内存：argv / envp 提前准备好
+  std::vector<std::string> args = opt.argv;
+  if (args.empty())
+    args = {opt.shell, "-c", opt.command};
+  std::vector<char *> argv;
+  for (auto &arg : args)
+    argv.push_back(const_cast<char *>(arg.c_str()));
+  argv.push_back(nullptr);
+
+  std::vector<std::string> envStore;
+  std::vector<char *> envp;
+  if (!opt.env.empty()) {
+    for (char **e = environ; *e; ++e) {
+      const char *eq = std::strchr(*e, '=');
+      size_t keyLen = eq ? eq - *e : std::strlen(*e);
+      bool overridden = false;
+      for (const auto &kv : opt.env) {
+        if (kv.size() > keyLen && kv[keyLen] == '=' &&
+            kv.compare(0, keyLen, *e, keyLen) == 0) {
+          overridden = true;
+          break;
+        }
+      }
+      if (!overridden)
+        envStore.emplace_back(*e);
+    }
+    envStore.insert(envStore.end(), opt.env.begin(), opt.env.end());
+    for (auto &kv : envStore)
+      envp.push_back(const_cast<char *>(kv.c_str()));
+    envp.push_back(nullptr);
+  }
+
+  int inPipe[2] = {-1, -1}, outPipe[2] = {-1, -1}, errPipe[2] = {-1, -1};
+  int execPipe[2] = {-1, -1};
+  auto closeAll = [&] {
+    for (int *p : {inPipe, outPipe, errPipe, execPipe}) {
+      closeFd(p[0]);
+      closeFd(p[1]);
+    }
+  };
+  // 全部带 O_CLOEXEC 创建：其他线程同时 fork / exec (PTY 会话、别的批量
+  // 命令) 时不会继承这些管道、拖住 EOF
+  if (pipe2(inPipe, O_CLOEXEC) != 0 || pipe2(outPipe, O_CLOEXEC) != 0 ||
+      pipe2(errPipe, O_CLOEXEC) != 0 || pipe2(execPipe, O_CLOEXEC) != 0) {
+    run.result.error = std::string("pipe: ") + std::strerror(errno);
+    closeAll();
+    return;
+  }
+
+  pid_t pid = fork();
+  if (pid < 0) {
+    run.result.error = std::string("fork: ") + std::strerror(errno);
+    closeAll();
+    return;
+  }
+
+  if (pid == 0) {
+    // 子进程：新进程组，恢复信号屏蔽与 SIGPIPE 默认行为
+    setpgid(0, 0);
+    sigset_t none;
+    sigemptyset(&none);
+    sigprocmask(SIG_SETMASK, &none, nullptr);
+    signal(SIGPIPE, SIG_DFL);
+
+    // dup2 出的描述符不带 CLOEXEC；原描述符恰好就是目标时 dup2 什么也
+    // 不做，要手动清掉标志
+    int redirects[3][2] = {{inPipe[0], STDIN_FILENO},
+                           {outPipe[1], STDOUT_FILENO},
+                           {errPipe[1], STDERR_FILENO}};
+    for (auto &r : redirects) {
+      if (r[0] == r[1])
+        fcntl(r[0], F_SETFD, 0);
+      else
+        dup2(r[0], r[1]);
+    }
+    // 其余管道端都关掉，只留 exec 报错管道的写端 (exec 成功时自动关闭)
+    for (int fd : {inPipe[0], inPipe[1], outPipe[0], outPipe[1], errPipe[0],
+                   errPipe[1], execPipe[0]}) {
+      if (fd > STDERR_FILENO)
+        close(fd);
+    }
+
+    int err = 0;
+    if (!opt.cwd.empty() && chdir(opt.cwd.c_str()) != 0) {
+      err = errno;
+    } else {
+      if (envp.empty())
+        execvp(argv[0], argv.data());
+      else
+        execvpe(argv[0], argv.data(), envp.data());
+      err = errno;
+    }
+    (void)!write(execPipe[1], &err, sizeof(err));
+    _exit(127);
+  }
+
+  // 父进程也设一次，避免子进程尚未 setpgid 时就要对组发信号
+  setpgid(pid, pid);
+  run.pid = pid;
+  closeFd(inPipe[0]);
+  closeFd(outPipe[1]);
+  closeFd(errPipe[1]);
+  closeFd(execPipe[1]);
+
+  // exec 成功时管道因 CLOEXEC 关闭，读到 0；失败时读到 errno
+  int execErr = 0;
+  ssize_t n;
+  do {
+    n = read(execPipe[0], &execErr, sizeof(execErr));
+  } while (n < 0 && errno == EINTR);
+  closeFd(execPipe[0]);
+  if (n == sizeof(execErr)) {
+    run.result.error = (opt.cwd.empty() || execErr != ENOENT
+                            ? std::string("exec ") + argv[0]
+                            : std::string("exec ") + argv[0] + " in " +
+                                  opt.cwd) +
+                       ": " + std::strerror(execErr);
+  }
+
+  run.inFd = inPipe[1];
+  run.outFd = outPipe[0];
+  run.errFd = errPipe[0];
+  for (int fd : {run.inFd, run.outFd, run.errFd})
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  if (opt.stdinData.empty())
+    closeFd(run.inFd);
+
+  if (opt.timeoutMs > 0)
+    run.deadlineMs = run.startMs + opt.timeoutMs;
+}
+
+void ExecEngine::finish(Run &run) {
+  closeFd(run.inFd);
+  closeFd(run.outFd);
+  closeFd(run.errFd);
+  if (run.pid > 0 && !run.reaped) {
+    // 回收主进程之前清掉组里可能残留的后台进程：此时主进程至多是僵尸，
+    // 组 id 还不会被别的进程拿到
+    killTree(run, SIGKILL);
+    int status;
+    waitpid(run.pid, &status, 0);
+    run.reaped = true;
+  }
+  run.result.durationMs = nowMs() - run.startMs;
+  m_running--;
+  if (run.completion)
+    run.completion(run.result);
+}
+
+// 非阻塞地读空一个管道，EOF 或出错时关闭
+static void drainPipe(int &fd, BoundedCapture &capture) {
+  char buf[65536];
+  for (;;) {
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n > 0) {
+      capture.append(buf, n);
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      return;
+    if (n < 0 && errno == EINTR)
+      continue;
+    closeFd(fd);
+    return;
+  }
+}
+
+void ExecEngine::ioLoop() {
+  // 向已退出子进程的 stdin 写入会产生 SIGPIPE；在本线程屏蔽，改由 EPIPE 处理
+  sigset_t pipeSet;
+  sigemptyset(&pipeSet);
+  sigaddset(&pipeSet, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &pipeSet, nullptr);
+
+  std::vector<struct pollfd> pfds;
+  std::vector<std::pair<Run *, int *>> owners;
+
+  for (;;) {
+    std::vector<std::unique_ptr<Run>> pending;
+    std::vector<uint64_t> cancelled;
+    bool stopping;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      pending.swap(m_pending);
+      cancelled.swap(m_cancelled);
+      stopping = m_stopping;
+    }
+
+    uint64_t now = nowMs();
+    for (auto &run : pending) {
+      if (stopping) {
+        run->result.cancelled = true;
+        run->result.error = "exec engine stopped";
+        run->startMs = now;
+        finish(*run);
+        continue;
+      }
+      spawn(*run);
+      if (run->pid <= 0) {
+        finish(*run);
+        continue;
+      }
+      uint64_t id = run->id;
+      m_runs.emplace(id, std::move(run));
+    }
+
+    for (uint64_t id : cancelled) {
+      auto it = m_runs.find(id);
+      if (it == m_runs.end() || it->second->killAtMs != 0)
+        continue;
+      Run &run = *it->second;
+      run.result.cancelled = true;
+      killTree(run, SIGTERM);
+      run.killAtMs = now + run.options.killGraceMs;
+    }
+
+    if (stopping) {
+      for (auto &entry : m_runs) {
+        entry.second->result.cancelled = true;
+        finish(*entry.second);
+      }
+      m_runs.clear();
+      return;
+    }
+
+    // 组装 poll 集合并计算最近的截止时间
+    pfds.clear();
+    owners.clear();
+    pfds.push_back({m_wakePipe[0], POLLIN, 0});
+    owners.emplace_back(nullptr, nullptr);
+    int timeout = -1;
+    auto limitTimeout = [&timeout, now](uint64_t at) {
+      if (at == 0)
+        return;
+      int ms = at > now ? static_cast<int>(at - now) : 0;
+      timeout = timeout < 0 ? ms : std::min(timeout, ms);
+    };
+    for (auto &entry : m_runs) {
+      Run &run = *entry.second;
+      if (run.inFd >= 0) {
+        pfds.push_back({run.inFd, POLLOUT, 0});
+        owners.emplace_back(&run, &run.inFd);
+      }
+      if (run.outFd >= 0) {
+        pfds.push_back({run.outFd, POLLIN, 0});
+        owners.emplace_back(&run, &run.outFd);
+      }
+      if (run.errFd >= 0) {
+        pfds.push_back({run.errFd, POLLIN, 0});
+        owners.emplace_back(&run, &run.errFd);
+      }
+      if (!run.result.timedOut && run.killAtMs == 0)
+        limitTimeout(run.deadlineMs);
+      limitTimeout(run.killAtMs);
+      limitTimeout(run.lingerUntilMs);
+      if (!run.exited)
+        timeout = timeout < 0 ? kReapPollMs : std::min(timeout, kReapPollMs);
+    }
+
+    int ready = poll(pfds.data(), pfds.size(), timeout);
+    if (ready < 0 && errno != EINTR)
+      break;
+
+    if (ready > 0) {
+      for (size_t i = 0; i < pfds.size(); ++i) {
+        if (pfds[i].revents == 0)
+          continue;
+        if (i == 0) {
+          char buf[64];
+          while (read(m_wakePipe[0], buf, sizeof(buf)) > 0) {
+          }
+          continue;
+        }
+        Run &run = *owners[i].first;
+        int &fd = *owners[i].second;
+        if (&fd == &run.inFd) {
+          const std::string &data = run.options.stdinData;
+          ssize_t n = write(fd, data.data() + run.stdinOffset,
+                            data.size() - run.stdinOffset);
+          if (n > 0)
+            run.stdinOffset += n;
+          if (run.stdinOffset >= data.size() ||
+              (n < 0 && errno != EAGAIN && errno != EINTR)) {
+            if (n < 0 && errno == EPIPE) {
+              // 取走挂起的 SIGPIPE
+              struct timespec zero = {0, 0};
+              sigtimedwait(&pipeSet, nullptr, &zero);
+            }
+            closeFd(fd);
+          }
+        } else {
+          drainPipe(fd, &fd == &run.outFd ? run.result.out : run.result.err);
+        }
+      }
+    }
+
+    // 回收、超时与收尾
+    now = nowMs();
+    for (auto it = m_runs.begin(); it != m_runs.end();) {
+      Run &run = *it->second;
+      if (!run.exited) {
+        siginfo_t info;
+        info.si_pid = 0;
+        if (waitid(P_PID, run.pid, &info, WEXITED | WNOHANG | WNOWAIT) == 0 &&
+            info.si_pid == run.pid) {
+          run.exited = true;
+          if (info.si_code == CLD_EXITED)
+            run.result.exitCode = info.si_status;
+          else
+            run.result.signal = info.si_status;
+        }
+      }
+
+      if (!run.result.timedOut && run.deadlineMs && now >= run.deadlineMs &&
+          run.killAtMs == 0 && !run.exited) {
+        run.result.timedOut = true;
+        killTree(run, SIGTERM);
+        run.killAtMs = now + run.options.killGraceMs;
+      }
+      if (run.killAtMs && now >= run.killAtMs) {
+        killTree(run, SIGKILL);
+        run.killAtMs = 0;
+      }
+
+      bool pipesOpen = run.outFd >= 0 || run.errFd >= 0;
+      if (run.exited && pipesOpen) {
+        // 后台后代仍持有管道：短暂等待后按进程树清理
+        if (run.lingerUntilMs == 0) {
+          run.lingerUntilMs = now + kLingerMs;
+        } else if (now >= run.lingerUntilMs) {
+          killTree(run, SIGKILL);
+          if (run.outFd >= 0)
+            drainPipe(run.outFd, run.result.out);
+          if (run.errFd >= 0)
+            drainPipe(run.errFd, run.result.err);
+          closeFd(run.outFd);
+          closeFd(run.errFd);
+          pipesOpen = false;
+        }
+      }
+
+      if (run.exited && !pipesOpen) {
+        finish(run);
+        it = m_runs.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+}
+
+} // namespace terminal
+} // namespace pocket
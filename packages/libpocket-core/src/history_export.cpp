@@ -0,0 +1,205 @@
+#include "history_export.h"
+#include "pocket_terminal.h"
+#include <cerrno>
+#include <cstdio>
+#include <unistd.h>
+#include <utility>
+
+namespace pocket {
+namespace terminal {
+
+static const uint32_t kAttrMask = 0x3F;
+
+// 页面底色与默认前景色按导出时的主题填入
+static const char kHtmlHeader[] =
+    "<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\">"
+    "<style>body{background:#%06x;color:#%06x;margin:0}"
+    "pre{font-family:monospace;padding:8px;white-space:pre-wrap}</style>"
+    "</head><body><pre>";
+static const char kHtmlFooter[] = "</pre></body></html>\n";
+
+HistoryWriter::HistoryWriter(int fd, ExportFormat format,
+                             const ColorPalette &palette)
+    : m_fd(fd), m_format(format), m_palette(palette) {
+  m_buffer.reserve(kFlushBytes + 4096);
+}
+
+bool HistoryWriter::begin() {
+  if (m_format == ExportFormat::Html) {
+    char buf[sizeof(kHtmlHeader) + 8];
+    std::snprintf(buf, sizeof(buf), kHtmlHeader,
+                  m_palette.resolve(kColorDefaultBg) & 0xFFFFFF,
+                  m_palette.resolve(kColorDefaultFg) & 0xFFFFFF);
+    m_buffer += buf;
+  }
+  return flush(false);
+}
+
+bool HistoryWriter::finish() {
+  if (m_format == ExportFormat::Html)
+    m_buffer += kHtmlFooter;
+  return flush(true);
+}
+
+bool HistoryWriter::writeNote(const std::string &text) {
+  if (m_format == ExportFormat::Html) {
+    m_buffer += "<i>[";
+    for (unsigned char c : text)
+      appendEscaped(c);
+    m_buffer += "]</i>\n";
+  } else {
+    m_buffer += "[" + text + "]\n";
+  }
+  return flush(false);
+}
+
+bool HistoryWriter::writeLine(const TerminalCell *cells, size_t cols) {
+  const Style plain{kColorDefaultFg, kColorDefaultBg, 0};
+
+  // 行尾空白不写；带背景色的空格在 ANSI / HTML 下算内容
+  size_t end = 0;
+  for (size_t col = 0; col < cols; ++col) {
+    const TerminalCell &cell = cells[col];
+    bool blank = (cell.flags & kCellImage) || cell.ch == 0 ||
+                 cell.ch == ' ' || cell.ch == 0xFFFFFFFF;
+    if (!blank ||
+        (m_format != ExportFormat::Text && cell.bg != kColorDefaultBg))
+      end = col + 1;
+  }
+
+  Style current = plain;
+  for (size_t col = 0; col < end; ++col) {
+    const TerminalCell &cell = cells[col];
+    if (cell.ch == 0xFFFFFFFF)
+      continue; // 宽字符的后半格
+    bool image = cell.flags & kCellImage;
+    uint32_t ch = image || cell.ch == 0 ? ' ' : cell.ch;
+
+    if (m_format != ExportFormat::Text) {
+      Style style{image ? kColorDefaultFg : cell.fg, cell.bg,
+                  image ? 0 : cell.flags & kAttrMask};
+      if (!(style == current)) {
+        if (!(current == plain))
+          closeStyle(current);
+        if (!(style == plain))
+          openStyle(style);
+        current = style;
+      }
+    }
+    appendEscaped(ch);
+  }
+  if (!(current == plain))
+    closeStyle(current);
+  m_buffer += '\n';
+  return flush(false);
+}
+
+void HistoryWriter::openStyle(const Style &style) {
+  char buf[64];
+  if (m_format == ExportFormat::Ansi) {
+    m_buffer += "\x1b[0";
+    static const struct {
+      uint32_t bit;
+      const char *sgr;
+    } kAttrs[] = {{1 << 0, ";1"}, {1 << 1, ";4"}, {1 << 2, ";3"},
+                  {1 << 3, ";5"}, {1 << 4, ";7"}, {1 << 5, ";9"}};
+    for (const auto &attr : kAttrs) {
+      if (style.attrs & attr.bit)
+        m_buffer += attr.sgr;
+    }
+    if (style.fg != kColorDefaultFg)
+      appendSgrColor(38, style.fg);
+    if (style.bg != kColorDefaultBg)
+      appendSgrColor(48, style.bg);
+    m_buffer += 'm';
+    return;
+  }
+
+  // HTML：反显直接交换前景与背景
+  uint32_t fg = style.fg, bg = style.bg;
+  if (style.attrs & (1 << 4))
+    std::swap(fg, bg);
+  m_buffer += "<span style=\"";
+  if (fg != kColorDefaultFg) {
+    std::snprintf(buf, sizeof(buf), "color:#%06x;",
+                  m_palette.resolve(fg) & 0xFFFFFF);
+    m_buffer += buf;
+  }
+  if (bg != kColorDefaultBg) {
+    std::snprintf(buf, sizeof(buf), "background:#%06x;",
+                  m_palette.resolve(bg) & 0xFFFFFF);
+    m_buffer += buf;
+  }
+  if (style.attrs & (1 << 0))
+    m_buffer += "font-weight:bold;";
+  if (style.attrs & (1 << 2))
+    m_buffer += "font-style:italic;";
+  if (style.attrs & ((1 << 1) | (1 << 5))) {
+    m_buffer += "text-decoration:";
+    if (style.attrs & (1 << 1))
+      m_buffer += " underline";
+    if (style.attrs & (1 << 5))
+      m_buffer += " line-through";
+    m_buffer += ';';
+  }
+  m_buffer += "\">";
+}
+
+// 256 色写下标；默认色出现在另一侧 (如前景用了默认背景色) 时只能写 RGB
+void HistoryWriter::appendSgrColor(int base, uint32_t color) {
+  char buf[32];
+  if (isIndexedColor(color) && (color & 0xFFFF) < 256) {
+    std::snprintf(buf, sizeof(buf), ";%d;5;%u", base, color & 0xFF);
+  } else {
+    uint32_t rgb = m_palette.resolve(color);
+    std::snprintf(buf, sizeof(buf), ";%d;2;%u;%u;%u", base, (rgb >> 16) & 0xFF,
+                  (rgb >> 8) & 0xFF, rgb & 0xFF);
+  }
+  m_buffer += buf;
+}
+
+void HistoryWriter::closeStyle(const Style &) {
+  m_buffer += m_format == ExportFormat::Ansi ? "\x1b[0m" : "</span>";
+}
+
+void HistoryWriter::appendEscaped(uint32_t ch) {
+  if (m_format == ExportFormat::Html) {
+    switch (ch) {
+    case '&':
+      m_buffer += "&amp;";
+      return;
+    case '<':
+      m_buffer += "&lt;";
+      return;
+    case '>':
+      m_buffer += "&gt;";
+      return;
+    }
+  }
+  appendUtf8(m_buffer, ch);
+}
+
+bool HistoryWriter::flush(bool force) {
+  if (m_errno != 0)
+    return false;
+  if (!force && m_buffer.size() < kFlushBytes)
+    return true;
+
+  size_t offset = 0;
+  while (offset < m_buffer.size()) {
+    ssize_t n = write(m_fd, m_buffer.data() + offset, m_buffer.size() - offset);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      m_errno = errno;
+      return false;
+    }
+    offset += n;
+  }
+  m_written += m_buffer.size();
+  m_buffer.clear();
+  return true;
+}
+
+} // namespace terminal
+} // namespace pocket
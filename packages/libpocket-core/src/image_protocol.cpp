@@ -0,0 +1,524 @@
+#include "image_protocol.h"
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+
+namespace pocket {
+namespace terminal {
+
+// ============== ImageCache ==============
+
+ImageCache::ImageCache(size_t capacityBytes)
+    : m_capacity(capacityBytes),
+      m_liveBytes(std::make_shared<std::atomic<size_t>>(0)) {}
+
+ImageRef ImageCache::insert(std::unique_ptr<DecodedImage> image) {
+  if (!image)
+    return nullptr;
+
+  size_t bytes = image->byteSize();
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (bytes > m_capacity)
+    return nullptr;
+
+  uint32_t id = image->id;
+  auto counter = m_liveBytes;
+  counter->fetch_add(bytes);
+  ImageRef ref(image.release(), [counter, bytes](const DecodedImage *p) {
+    counter->fetch_sub(bytes);
+    delete p;
+  });
+
+  auto it = m_index.find(id);
+  if (it != m_index.end()) {
+    m_lru.erase(it->second);
+    m_index.erase(it);
+  }
+  m_lru.push_front(ref);
+  m_index[id] = m_lru.begin();
+
+  trimLocked();
+  return ref;
+}
+
+ImageRef ImageCache::find(uint32_t id) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_index.find(id);
+  if (it == m_index.end())
+    return nullptr;
+  m_lru.splice(m_lru.begin(), m_lru, it->second);
+  return *it->second;
+}
+
+void ImageCache::erase(uint32_t id) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_index.find(id);
+  if (it == m_index.end())
+    return;
+  m_lru.erase(it->second);
+  m_index.erase(it);
+}
+
+void ImageCache::clear() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_lru.clear();
+  m_index.clear();
+}
+
+void ImageCache::setCapacity(size_t capacityBytes) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_capacity = capacityBytes;
+  trimLocked();
+}
+
+size_t ImageCache::capacity() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_capacity;
+}
+
+bool ImageCache::trim() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return trimLocked();
+}
+
+bool ImageCache::trimLocked() {
+  // 从最久未用的一端开始，只丢弃没有放置引用的条目
+  auto it = m_lru.end();
+  while (m_liveBytes->load() > m_capacity && it != m_lru.begin()) {
+    --it;
+    if (it->use_count() > 1)
+      continue;
+    m_index.erase((*it)->id);
+    it = m_lru.erase(it);
+  }
+  return m_liveBytes->load() <= m_capacity;
+}
+
+// ============== Sixel ==============
+
+namespace {
+
+uint32_t packRgb(int r, int g, int b) {
+  return (uint32_t(r) << 16) | (uint32_t(g) << 8) | uint32_t(b);
+}
+
+// sixel 颜色分量为 0-100 的百分比
+int percentToByte(int v) {
+  return (std::min(std::max(v, 0), 100) * 255 + 50) / 100;
+}
+
+// DEC HLS：色相 0 度为蓝色，需旋转到常规 HLS (0 度为红色) 后换算
+uint32_t hlsToRgb(int hue, int lightness, int saturation) {
+  double h = ((hue + 240) % 360) / 360.0;
+  double l = std::min(std::max(lightness, 0), 100) / 100.0;
+  double s = std::min(std::max(saturation, 0), 100) / 100.0;
+
+  if (s == 0) {
+    int v = int(l * 255 + 0.5);
+    return packRgb(v, v, v);
+  }
+
+  double q = l < 0.5 ? l * (1 + s) : l + s - l * s;
+  double p = 2 * l - q;
+  auto channel = [&](double t) {
+    if (t < 0)
+      t += 1;
+    if (t > 1)
+      t -= 1;
+    if (t < 1.0 / 6)
+      return p + (q - p) * 6 * t;
+    if (t < 1.0 / 2)
+      return q;
+    if (t < 2.0 / 3)
+      return p + (q - p) * (2.0 / 3 - t) * 6;
+    return p;
+  };
+  return packRgb(int(channel(h + 1.0 / 3) * 255 + 0.5),
+                 int(channel(h) * 255 + 0.5),
+                 int(channel(h - 1.0 / 3) * 255 + 0.5));
+}
+
+// VT340 的默认 16 色寄存器 (百分比)
+const int kVt340Palette[16][3] = {
+    {0, 0, 0},    {20, 20, 80}, {80, 13, 13}, {20, 80, 20},
+    {80, 20, 80}, {20, 80, 80}, {80, 80, 20}, {53, 53, 53},
+    {26, 26, 26}, {33, 33, 60}, {60, 26, 26}, {33, 60, 33},
+    {60, 33, 60}, {33, 60, 60}, {60, 60, 33}, {80, 80, 80},
+};
+
+// 按需增长的 sixel 画布，像素为 0x00RRGGBB | (已绘制 ? 1<<24 : 0)
+struct SixelCanvas {
+  int width{0};
+  int height{0};
+  std::vector<uint32_t> pixels;
+
+  void ensure(int w, int h) {
+    w = std::min(w, kMaxImageDimension);
+    h = std::min(h, kMaxImageDimension);
+    if (w <= width && h <= height)
+      return;
+    int newWidth = std::max(width, w);
+    int newHeight = std::max(height, h);
+    // 宽度成倍增长，避免逐列扩展时反复搬移
+    if (newWidth > width && width > 0)
+      newWidth = std::min(std::max(newWidth, width * 2), kMaxImageDimension);
+    std::vector<uint32_t> grown(size_t(newWidth) * newHeight, 0);
+    for (int y = 0; y < height; y++)
+      std::memcpy(&grown[size_t(y) * newWidth], &pixels[size_t(y) * width],
+                  width * sizeof(uint32_t));
+    pixels.swap(grown);
+    width = newWidth;
+    height = newHeight;
+  }
+};
+
+int readNumber(const std::string &s, size_t &pos) {
+  int value = 0;
+  while (pos < s.size() && s[pos] >= '0' && s[pos] <= '9') {
+    value = std::min(value * 10 + (s[pos] - '0'), 1 << 20);
+    pos++;
+  }
+  return value;
+}
+
+} // namespace
+
+std::unique_ptr<DecodedImage> decodeSixel(const std::string &params,
+                                          const std::string &data) {
+  // P2 = 1 时未绘制的像素保持透明，否则以 0 号颜色填充
+  int p2 = 0;
+  {
+    size_t pos = 0;
+    readNumber(params, pos);
+    if (pos < params.size() && params[pos] == ';') {
+      pos++;
+      p2 = readNumber(params, pos);
+    }
+  }
+
+  uint32_t palette[256];
+  for (int i = 0; i < 256; i++) {
+    const int *c = kVt340Palette[i % 16];
+    palette[i] = i < 16 ? packRgb(percentToByte(c[0]), percentToByte(c[1]),
+                                  percentToByte(c[2]))
+                        : 0;
+  }
+
+  SixelCanvas canvas;
+  int x = 0, y = 0;
+  int color = 0;
+  int usedWidth = 0, usedHeight = 0;
+  int rasterWidth = 0, rasterHeight = 0;
+
+  // x、y 停在 kMaxImageDimension：之后的像素画不进画布，
+  // 重复次数再大也不会让坐标溢出
+  auto paint = [&](int bits, int repeat) {
+    if (bits && x < kMaxImageDimension && y < kMaxImageDimension) {
+      int end = std::min(x + repeat, kMaxImageDimension);
+      canvas.ensure(end, y + 6);
+      uint32_t value = palette[color] | (1u << 24);
+      for (int bit = 0; bit < 6; bit++) {
+        if (!(bits & (1 << bit)) || y + bit >= canvas.height)
+          continue;
+        uint32_t *row = &canvas.pixels[size_t(y + bit) * canvas.width];
+        for (int px = x; px < end; px++)
+          row[px] = value;
+        usedHeight = std::max(usedHeight, y + bit + 1);
+      }
+      usedWidth = std::max(usedWidth, end);
+    }
+    x = std::min(x + repeat, kMaxImageDimension);
+  };
+
+  size_t pos = 0;
+  while (pos < data.size()) {
+    char c = data[pos];
+    if (c >= 0x3F && c <= 0x7E) {
+      paint(c - 0x3F, 1);
+      pos++;
+    } else if (c == '!') {
+      pos++;
+      int repeat = std::max(readNumber(data, pos), 1);
+      if (pos < data.size() && data[pos] >= 0x3F && data[pos] <= 0x7E)
+        paint(data[pos++] - 0x3F, repeat);
+    } else if (c == '#') {
+      pos++;
+      int args[5] = {0, 0, 0, 0, 0};
+      int argc = 0;
+      args[argc++] = readNumber(data, pos);
+      while (argc < 5 && pos < data.size() && data[pos] == ';') {
+        pos++;
+        args[argc++] = readNumber(data, pos);
+      }
+      color = args[0] & 0xFF;
+      if (argc >= 5) {
+        if (args[1] == 1)
+          palette[color] = hlsToRgb(args[2], args[3], args[4]);
+        else if (args[1] == 2)
+          palette[color] = packRgb(percentToByte(args[2]),
+                                   percentToByte(args[3]),
+                                   percentToByte(args[4]));
+      }
+    } else if (c == '"') {
+      // 光栅属性 "Pan;Pad;Ph;Pv：预先分配画布
+      pos++;
+      int args[4] = {0, 0, 0, 0};
+      int argc = 0;
+      args[argc++] = readNumber(data, pos);
+      while (argc < 4 && pos < data.size() && data[pos] == ';') {
+        pos++;
+        args[argc++] = readNumber(data, pos);
+      }
+      rasterWidth = std::min(args[2], kMaxImageDimension);
+      rasterHeight = std::min(args[3], kMaxImageDimension);
+      canvas.ensure(rasterWidth, rasterHeight);
+    } else if (c == '$') {
+      x = 0;
+      pos++;
+    } else if (c == '-') {
+      x = 0;
+      y = std::min(y + 6, kMaxImageDimension);
+      pos++;
+    } else {
+      pos++; // 忽略换行等无关字符
+    }
+  }
+
+  int width = std::max(usedWidth, rasterWidth);
+  int height = std::max(usedHeight, rasterHeight);
+  if (width <= 0 || height <= 0)
+    return nullptr;
+  canvas.ensure(width, height);
+
+  auto image = std::make_unique<DecodedImage>();
+  image->width = width;
+  image->height = height;
+  image->format = ImageFormat::Rgba8888;
+  image->data.resize(size_t(width) * height * 4);
+
+  uint32_t background = p2 == 1 ? 0 : (palette[0] | (1u << 24));
+  uint8_t *out = image->data.data();
+  for (int row = 0; row < height; row++) {
+    const uint32_t *in = &canvas.pixels[size_t(row) * canvas.width];
+    for (int col = 0; col < width; col++) {
+      uint32_t px = in[col] ? in[col] : background;
+      *out++ = (px >> 16) & 0xFF;
+      *out++ = (px >> 8) & 0xFF;
+      *out++ = px & 0xFF;
+      *out++ = (px & (1u << 24)) ? 0xFF : 0;
+    }
+  }
+  return image;
+}
+
+// ============== Kitty ==============
+
+KittyCommand parseKittyCommand(const char *data, size_t len) {
+  KittyCommand cmd;
+  size_t pos = 0;
+  while (pos < len) {
+    char key = data[pos];
+    if (pos + 1 >= len || data[pos + 1] != '=')
+      break;
+    pos += 2;
+
+    size_t start = pos;
+    while (pos < len && data[pos] != ',')
+      pos++;
+    std::string value(data + start, pos - start);
+    if (pos < len)
+      pos++;
+
+    char ch = value.empty() ? 0 : value[0];
+    long number = std::strtol(value.c_str(), nullptr, 10);
+    switch (key) {
+    case 'a':
+      cmd.action = ch;
+      break;
+    case 'd':
+      cmd.deleteTarget = ch;
+      break;
+    case 't':
+      cmd.medium = ch;
+      break;
+    case 'o':
+      cmd.compression = ch;
+      break;
+    case 'f':
+      cmd.format = int(number);
+      break;
+    case 'i':
+      cmd.id = uint32_t(std::strtoul(value.c_str(), nullptr, 10));
+      break;
+    case 's':
+      cmd.width = int(number);
+      break;
+    case 'v':
+      cmd.height = int(number);
+      break;
+    case 'c':
+      cmd.cols = int(number);
+      break;
+    case 'r':
+      cmd.rows = int(number);
+      break;
+    case 'm':
+      cmd.more = int(number);
+      break;
+    case 'q':
+      cmd.quiet = int(number);
+      break;
+    default:
+      break; // 其余键 (x/y/X/Y/z/p/...) 暂不支持，忽略
+    }
+  }
+  return cmd;
+}
+
+bool decodeBase64(const std::string &in, std::vector<uint8_t> &out) {
+  static const auto table = [] {
+    std::array<int8_t, 256> t;
+    t.fill(-1);
+    const char *alphabet =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    for (int i = 0; i < 64; i++)
+      t[uint8_t(alphabet[i])] = int8_t(i);
+    return t;
+  }();
+
+  out.clear();
+  out.reserve(in.size() / 4 * 3);
+
+  uint32_t acc = 0;
+  int bits = 0;
+  for (unsigned char c : in) {
+    if (c == '=')
+      break;
+    if (c == '\r' || c == '\n' || c == ' ')
+      continue;
+    int v = table[c];
+    if (v < 0)
+      return false;
+    acc = (acc << 6) | uint32_t(v);
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      out.push_back(uint8_t(acc >> bits));
+    }
+  }
+  return true;
+}
+
+std::unique_ptr<DecodedImage> decodeKitty(const KittyCommand &cmd,
+                                          const std::string &payload) {
+  if (cmd.medium != 'd' || cmd.compression != 0)
+    return nullptr;
+
+  auto image = std::make_unique<DecodedImage>();
+  if (!decodeBase64(payload, image->data))
+    return nullptr;
+
+  if (cmd.format == 100) {
+    // PNG：从 IHDR 读出尺寸，像素解码交给 UI 侧
+    static const uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n',
+                                          0x1A, '\n'};
+    const std::vector<uint8_t> &d = image->data;
+    if (d.size() < 24 || std::memcmp(d.data(), kSignature, 8) != 0)
+      return nullptr;
+    auto be32 = [&](size_t at) {
+      return int((uint32_t(d[at]) << 24) | (uint32_t(d[at + 1]) << 16) |
+                 (uint32_t(d[at + 2]) << 8) | uint32_t(d[at + 3]));
+    };
+    image->format = ImageFormat::Png;
+    image->width = be32(16);
+    image->height = be32(20);
+  } else if (cmd.format == 32 || cmd.format == 24) {
+    int bpp = cmd.format / 8;
+    if (cmd.width <= 0 || cmd.height <= 0 ||
+        cmd.width > kMaxImageDimension || cmd.height > kMaxImageDimension)
+      return nullptr;
+    size_t pixels = size_t(cmd.width) * cmd.height;
+    if (image->data.size() < pixels * bpp)
+      return nullptr;
+
+    image->width = cmd.width;
+    image->height = cmd.height;
+    if (bpp == 3) {
+      std::vector<uint8_t> rgba(pixels * 4);
+      for (size_t i = 0; i < pixels; i++) {
+        rgba[i * 4] = image->data[i * 3];
+        rgba[i * 4 + 1] = image->data[i * 3 + 1];
+        rgba[i * 4 + 2] = image->data[i * 3 + 2];
+        rgba[i * 4 + 3] = 0xFF;
+      }
+      image->data.swap(rgba);
+    } else {
+      image->data.resize(pixels * 4);
+    }
+  } else {
+    return nullptr;
+  }
+
+  // PNG 的尺寸来自 IHDR，可能为负或超大
+  if (image->width <= 0 || image->height <= 0 ||
+      image->width > kMaxImageDimension || image->height > kMaxImageDimension)
+    return nullptr;
+  image->data.shrink_to_fit();
+  return image;
+}
+
+// ============== ImageDecoder ==============
+
+ImageDecoder::ImageDecoder(Completion completion)
+    : m_completion(std::move(completion)) {}
+
+ImageDecoder::~ImageDecoder() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_cv.notify_all();
+  if (m_worker.joinable())
+    m_worker.join();
+}
+
+void ImageDecoder::submit(ImageJob job) {
+  m_pendingBytes += job.payload.size();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queue.push_back(std::move(job));
+    if (!m_worker.joinable())
+      m_worker = std::thread(&ImageDecoder::workerLoop, this);
+  }
+  m_cv.notify_one();
+}
+
+void ImageDecoder::workerLoop() {
+  while (true) {
+    ImageJob job;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cv.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+      if (m_stopping)
+        return;
+      job = std::move(m_queue.front());
+      m_queue.pop_front();
+    }
+
+    std::unique_ptr<DecodedImage> image;
+    if (job.protocol == ImageProtocol::Sixel)
+      image = decodeSixel(job.params, job.payload);
+    else if (job.kitty.action == 't' || job.kitty.action == 'T')
+      image = decodeKitty(job.kitty, job.payload);
+
+    m_pendingBytes -= job.payload.size();
+    // 负载不再需要，先释放再回调，缩短峰值内存
+    std::string().swap(job.payload);
+
+    m_completion(job, std::move(image));
+  }
+}
+
+} // namespace terminal
+} // namespace pocket
@@ -0,0 +1,380 @@
+#include "inprocess_transport.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+
+namespace pocket {
+namespace terminal {
+
+// ============== SpscByteRing ==============
+
+static size_t roundUpPow2(size_t n) {
+  size_t cap = 64;
+  while (cap < n)
+    cap <<= 1;
+  return cap;
+}
+
+SpscByteRing::SpscByteRing(size_t capacity)
+    : m_data(new char[roundUpPow2(capacity)]),
+      m_mask(roundUpPow2(capacity) - 1) {}
+
+size_t SpscByteRing::write(const char *data, size_t len) {
+  size_t head = m_head.load(std::memory_order_relaxed);
+  size_t tail = m_tail.load(std::memory_order_acquire);
+  size_t n = std::min(len, capacity() - (head - tail));
+  if (n == 0)
+    return 0;
+
+  size_t offset = head & m_mask;
+  size_t first = std::min(n, capacity() - offset);
+  std::memcpy(&m_data[offset], data, first);
+  std::memcpy(&m_data[0], data + first, n - first);
+  m_head.store(head + n, std::memory_order_release);
+  return n;
+}
+
+size_t SpscByteRing::read(char *out, size_t len) {
+  size_t tail = m_tail.load(std::memory_order_relaxed);
+  size_t head = m_head.load(std::memory_order_acquire);
+  size_t n = std::min(len, head - tail);
+  if (n == 0)
+    return 0;
+
+  size_t offset = tail & m_mask;
+  size_t first = std::min(n, capacity() - offset);
+  std::memcpy(out, &m_data[offset], first);
+  std::memcpy(out + first, &m_data[0], n - first);
+  m_tail.store(tail + n, std::memory_order_release);
+  return n;
+}
+
+size_t SpscByteRing::readable() const {
+  return m_head.load(std::memory_order_acquire) -
+         m_tail.load(std::memory_order_acquire);
+}
+
+size_t SpscByteRing::writable() const { return capacity() - readable(); }
+
+// ============== InProcessTransport ==============
+
+InProcessTransport::InProcessTransport(size_t ringBytes)
+    : m_input(ringBytes), m_output(ringBytes) {}
+
+InProcessTransport::~InProcessTransport() { close(); }
+
+ssize_t InProcessTransport::producerRead(char *buf, size_t len) {
+  if (len == 0)
+    return 0;
+
+  for (;;) {
+    size_t n = m_input.read(buf, len);
+    if (n > 0)
+      return static_cast<ssize_t>(n);
+
+    int eof = m_eofPending.load(std::memory_order_acquire);
+    while (eof > 0) {
+      if (m_eofPending.compare_exchange_weak(eof, eof - 1))
+        return 0;
+    }
+    if (closed())
+      return 0;
+
+    // 慢路径：先公布等待状态再复查，与 commitInput 中的 fence 配对，
+    // 保证不会错过唤醒
+    std::unique_lock<std::mutex> lock(m_waitMutex);
+    m_readerWaiting.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    m_inputCv.wait(lock, [this] {
+      return m_input.readable() > 0 || m_eofPending.load() > 0 ||
+             m_readInterrupted.load() || closed();
+    });
+    m_readerWaiting.store(false);
+    if (m_readInterrupted.exchange(false)) {
+      errno = EINTR;
+      return -1;
+    }
+  }
+}
+
+ssize_t InProcessTransport::producerWrite(const char *data, size_t len) {
+  if (closed())
+    return -1;
+
+  bool onlcr = m_onlcr.load(std::memory_order_relaxed);
+  size_t done = 0;
+  auto writeAll = [this](const char *p, size_t n) {
+    while (n > 0) {
+      bool wasEmpty = m_output.readable() == 0;
+      size_t written = m_output.write(p, n);
+      if (written > 0 && wasEmpty && m_outputReadyHandler)
+        m_outputReadyHandler();
+      p += written;
+      n -= written;
+      if (n == 0)
+        return true;
+
+      std::unique_lock<std::mutex> lock(m_waitMutex);
+      m_writerWaiting.store(true);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      m_outputCv.wait(lock,
+                      [this] { return m_output.writable() > 0 || closed(); });
+      m_writerWaiting.store(false);
+      if (closed())
+        return false;
+    }
+    return true;
+  };
+
+  // ONLCR：按 '\n' 分段写入，段间补 "\r\n"
+  while (done < len) {
+    const char *start = data + done;
+    size_t remaining = len - done;
+    const char *nl = onlcr ? static_cast<const char *>(
+                                 std::memchr(start, '\n', remaining))
+                           : nullptr;
+    size_t segment = nl ? static_cast<size_t>(nl - start) : remaining;
+    if (segment > 0 && !writeAll(start, segment))
+      return done > 0 ? static_cast<ssize_t>(done) : -1;
+    done += segment;
+    if (nl) {
+      if (!writeAll("\r\n", 2))
+        return done > 0 ? static_cast<ssize_t>(done) : -1;
+      done++;
+    }
+  }
+  return static_cast<ssize_t>(len);
+}
+
+LineMode InProcessTransport::mode() const {
+  std::lock_guard<std::mutex> lock(m_modeMutex);
+  return m_mode;
+}
+
+void InProcessTransport::setMode(const LineMode &mode) {
+  std::lock_guard<std::mutex> lock(m_modeMutex);
+  m_mode = mode;
+  m_onlcr.store(mode.onlcr, std::memory_order_relaxed);
+}
+
+void InProcessTransport::windowSize(int &rows, int &cols) const {
+  rows = m_rows.load(std::memory_order_relaxed);
+  cols = m_cols.load(std::memory_order_relaxed);
+}
+
+void InProcessTransport::setSignalHandler(SignalHandler handler) {
+  m_signalHandler = std::move(handler);
+}
+
+void InProcessTransport::setWindowSizeHandler(WindowSizeHandler handler) {
+  m_windowSizeHandler = std::move(handler);
+}
+
+void InProcessTransport::setOutputReadyHandler(ReadyHandler handler) {
+  m_outputReadyHandler = std::move(handler);
+}
+
+void InProcessTransport::commitInput(const char *data, size_t len) {
+  // 与内核 tty 一样，输入队列满时丢弃多余的字节
+  if (m_input.write(data, len) == 0)
+    return;
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (m_readerWaiting.load()) {
+    std::lock_guard<std::mutex> lock(m_waitMutex);
+    m_inputCv.notify_one();
+  }
+}
+
+void InProcessTransport::terminalInputRaw(const char *data, size_t len) {
+  commitInput(data, len);
+}
+
+size_t InProcessTransport::terminalRead(char *out, size_t len) {
+  size_t n = m_output.read(out, len);
+  if (n > 0) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_writerWaiting.load()) {
+      std::lock_guard<std::mutex> lock(m_waitMutex);
+      m_outputCv.notify_one();
+    }
+  }
+  return n;
+}
+
+void InProcessTransport::setWindowSize(int rows, int cols) {
+  m_rows.store(rows, std::memory_order_relaxed);
+  m_cols.store(cols, std::memory_order_relaxed);
+  // 相当于 SIGWINCH
+  if (m_windowSizeHandler)
+    m_windowSizeHandler(rows, cols);
+}
+
+void InProcessTransport::close() {
+  m_closed.store(true, std::memory_order_release);
+  std::lock_guard<std::mutex> lock(m_waitMutex);
+  m_inputCv.notify_all();
+  m_outputCv.notify_all();
+}
+
+// ---- 行规程 ----
+
+// 回显退格时需要知道被删字符占几列；只区分常见的东亚宽字符
+static bool isWideCodepoint(uint32_t cp) {
+  return (cp >= 0x1100 && cp <= 0x115F) || (cp >= 0x2E80 && cp <= 0xA4CF) ||
+         (cp >= 0xAC00 && cp <= 0xD7A3) || (cp >= 0xF900 && cp <= 0xFAFF) ||
+         (cp >= 0xFE30 && cp <= 0xFE4F) || (cp >= 0xFF00 && cp <= 0xFF60) ||
+         (cp >= 0xFFE0 && cp <= 0xFFE6) || (cp >= 0x1F300 && cp <= 0x1FAFF) ||
+         (cp >= 0x20000 && cp <= 0x3FFFD);
+}
+
+void InProcessTransport::echoChar(unsigned char c, const LineMode &mode,
+                                  std::string &echo) {
+  if (!mode.echo)
+    return;
+  if (c < 0x20 && c != '\t' && c != '\n' && mode.echoCtl) {
+    echo += '^';
+    echo += static_cast<char>(c + '@');
+  } else if (c == 0x7f && mode.echoCtl) {
+    echo += "^?";
+  } else if (c == '\n') {
+    echo += "\r\n";
+  } else {
+    echo += static_cast<char>(c);
+  }
+}
+
+void InProcessTransport::eraseChars(size_t count, const LineMode &mode,
+                                    std::string &echo) {
+  while (count-- > 0 && !m_line.empty()) {
+    // 回退一个完整的 UTF-8 字符
+    size_t end = m_line.size();
+    size_t start = end - 1;
+    while (start > 0 && (m_line[start] & 0xC0) == 0x80)
+      start--;
+
+    const unsigned char *p =
+        reinterpret_cast<const unsigned char *>(&m_line[start]);
+    uint32_t cp = p[0];
+    size_t bytes = end - start;
+    if (bytes == 2)
+      cp = ((p[0] & 0x1F) << 6) | (p[1] & 0x3F);
+    else if (bytes == 3)
+      cp = ((p[0] & 0x0F) << 12) | ((p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+    else if (bytes == 4)
+      cp = ((p[0] & 0x07) << 18) | ((p[1] & 0x3F) << 12) |
+           ((p[2] & 0x3F) << 6) | (p[3] & 0x3F);
+
+    int columns = 1;
+    if (cp < 0x20 && cp != '\t' && mode.echoCtl)
+      columns = 2; // 之前回显成了 ^X
+    else if (isWideCodepoint(cp))
+      columns = 2;
+    m_line.resize(start);
+
+    if (mode.echo) {
+      for (int i = 0; i < columns; ++i)
+        echo += "\b \b";
+    }
+  }
+}
+
+void InProcessTransport::raiseSignal(int sig, unsigned char c,
+                                     const LineMode &mode, std::string &echo) {
+  // 信号丢弃正在编辑的行
+  m_line.clear();
+  if (mode.echo && mode.echoCtl) {
+    echo += '^';
+    echo += static_cast<char>(c + '@');
+  }
+  if (m_signalHandler)
+    m_signalHandler(sig);
+
+  // 打断正阻塞在 producerRead 上的运行时，让 REPL 能丢弃当前输入
+  if (m_readerWaiting.load()) {
+    std::lock_guard<std::mutex> lock(m_waitMutex);
+    m_readInterrupted.store(true);
+    m_inputCv.notify_one();
+  }
+}
+
+void InProcessTransport::terminalInput(const char *data, size_t len,
+                                       std::string &echo) {
+  LineMode mode = this->mode();
+
+  // 从规范模式切到原始模式时，已编辑的部分直接交出
+  if (!mode.canonical && !m_line.empty()) {
+    commitInput(m_line.data(), m_line.size());
+    m_line.clear();
+  }
+
+  // 原始模式下连续的普通字节攒成一批再写入环
+  std::string raw;
+  for (size_t i = 0; i < len; ++i) {
+    unsigned char c = static_cast<unsigned char>(data[i]);
+    if (c == '\r' && mode.icrnl)
+      c = '\n';
+
+    if (mode.signals &&
+        (c == mode.vintr || c == mode.vquit || c == mode.vsusp)) {
+      if (!raw.empty()) {
+        commitInput(raw.data(), raw.size());
+        raw.clear();
+      }
+      int sig = c == mode.vintr ? SIGINT : c == mode.vquit ? SIGQUIT : SIGTSTP;
+      raiseSignal(sig, c, mode, echo);
+      continue;
+    }
+
+    if (!mode.canonical) {
+      raw += static_cast<char>(c);
+      echoChar(c, mode, echo);
+      continue;
+    }
+
+    if (c == mode.verase || c == '\b') {
+      eraseChars(1, mode, echo);
+    } else if (c == mode.vwerase) {
+      size_t erase = 0;
+      size_t pos = m_line.size();
+      while (pos > 0 && m_line[pos - 1] == ' ')
+        pos--, erase++;
+      while (pos > 0 && m_line[pos - 1] != ' ') {
+        // 按字符计数，续字节不单独计
+        if ((m_line[pos - 1] & 0xC0) != 0x80)
+          erase++;
+        pos--;
+      }
+      eraseChars(erase, mode, echo);
+    } else if (c == mode.vkill) {
+      eraseChars(m_line.size(), mode, echo);
+    } else if (c == mode.veof) {
+      // 空行上的 ^D 即 EOF；否则把当前行原样交出 (不带换行)
+      if (m_line.empty()) {
+        m_eofPending.fetch_add(1, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_readerWaiting.load()) {
+          std::lock_guard<std::mutex> lock(m_waitMutex);
+          m_inputCv.notify_one();
+        }
+      } else {
+        commitInput(m_line.data(), m_line.size());
+        m_line.clear();
+      }
+    } else if (c == '\n') {
+      m_line += '\n';
+      echoChar(c, mode, echo);
+      commitInput(m_line.data(), m_line.size());
+      m_line.clear();
+    } else {
+      m_line += static_cast<char>(c);
+      echoChar(c, mode, echo);
+    }
+  }
+
+  if (!raw.empty())
+    commitInput(raw.data(), raw.size());
+}
+
+} // namespace terminal
+} // namespace pocket
@@ -25,6 +25,7 @@ Java_com_pocketcode_terminal_TerminalCore_getDirectBuffer(JNIEnv *env,
   if (!term)
     return nullptr;
 
+  term->syncCells();
   const void *addr = term->getBuffer();
   // VTermCell[] 大小：总行数 * 列数 * sizeof(TerminalCell)
   // 根据 pocket_terminal.h 推算大小大概是每格 32 ~ 64 bytes 左右
@@ -43,6 +44,8 @@ JNIEXPORT void JNICALL Java_com_pocketcode_terminal_TerminalCore_writeOutput(
   jbyte *buffer = env->GetByteArrayElements(data, nullptr);
   term->writeInput(reinterpret_cast<const char *>(buffer), len);
   env->ReleaseByteArrayElements(data, buffer, JNI_ABORT);
+  // 直接缓冲在 Java 侧读取，这里把本次输入改动的行转换好
+  term->syncCells();
 }
 
 } // extern "C"
@@ -1,7 +1,11 @@
 #include "pocket_terminal.h"
 #include <algorithm>
+#include <cerrno>
+#include <cstdio>
 #include <cstring>
+#include <chrono>
 #include <fcntl.h>
+#include <poll.h>
 #include <pty.h>
 #include <stdexcept>
 #include <sys/ioctl.h>
@@ -22,13 +26,35 @@ static VTermColor get_default_bg() {
   return c;
 }
 
+// 默认画笔下空白格转换后的样式，历史行被去掉的行尾按它补回
+static const ScrollbackStyle kBlankStyle = {kColorDefaultFg, kColorDefaultBg,
+                                            1u << 8};
+
+// VTERM_ATTR_BOLD_MASK .. VTERM_ATTR_STRIKE_MASK 即 TerminalCell.flags 的 bit 0-5
+static const uint32_t kAttrFlagsMask = 0x3F;
+
+static void assignNewLineIds(std::vector<uint64_t> &ids, uint64_t &nextId) {
+  for (uint64_t &id : ids)
+    id = nextId++;
+}
+
 PocketTerminal::PocketTerminal(int rows, int cols)
-    : m_rows(rows), m_cols(cols) {
+    : m_rows(rows), m_cols(cols), m_scrollback(kMaxScrollback, kBlankStyle),
+      m_imageDecoder(std::make_unique<ImageDecoder>(
+          [this](ImageJob &job, std::unique_ptr<DecodedImage> image) {
+            onImageDecoded(job, std::move(image));
+          })) {
   if (rows <= 0 || cols <= 0) {
     throw std::invalid_argument("Rows and cols must be strictly positive");
   }
 
   m_cellBuffer.resize(rows * cols);
+  m_staleRows.assign(rows, {0, cols});
+  m_cellsStale = true;
+  m_rowIds.resize(rows);
+  m_savedRowIds.resize(rows);
+  assignNewLineIds(m_rowIds, m_nextLineId);
+  assignNewLineIds(m_savedRowIds, m_nextLineId);
 
   // 初始化 libvterm
   m_vterm = vterm_new(rows, cols);
@@ -44,47 +70,83 @@ PocketTerminal::PocketTerminal(int rows, int cols)
   VTermColor fg = get_default_fg();
   VTermColor bg = get_default_bg();
   vterm_screen_set_default_colors(m_screen, &fg, &bg);
+  loadPaletteLocked();
 
   static VTermScreenCallbacks cb = {};
   cb.damage = onDamage;
   cb.movecursor = onMoveCursor;
-  cb.sb_pushline = onSbPushLine;
+  cb.sb_pushline_packed = onSbPushLine;
+  cb.moverect = onMoveRect;
+  cb.settermprop = onSetTermProp;
 
   // 注册回调，并将 this 指针传递供 C 回调使用
   vterm_screen_set_callbacks(m_screen, &cb, this);
+  vterm_screen_callbacks_has_pushline_packed(m_screen);
+
+  static VTermStateFallbacks fallbacks = {};
+  fallbacks.osc = onOsc;
+  fallbacks.dcs = onDcs;
+  fallbacks.apc = onApc;
+  vterm_screen_set_unrecognised_fallbacks(m_screen, &fallbacks, this);
 
   vterm_screen_reset(m_screen, 1);
 }
 
 PocketTerminal::~PocketTerminal() {
+  m_exportCancel = true;
+  if (m_exportThread.joinable())
+    m_exportThread.join();
   stopPty();
+  detachTransport();
+  m_imageDecoder.reset();
   if (m_vterm) {
     vterm_free(m_vterm);
   }
 }
 
 void PocketTerminal::resize(int rows, int cols) {
+  {
+    std::lock_guard<VTermMutex> lock(m_vtermMutex);
+    if (!resizeLocked(rows, cols))
+      return;
+  }
+  setPtyWindowSize(rows, cols);
+}
+
+bool PocketTerminal::resizeLocked(int rows, int cols) {
   if (rows == m_rows && cols == m_cols)
-    return;
+    return false;
 
+  bool sameCols = cols == m_cols;
   m_rows = rows;
   m_cols = cols;
 
-  {
-    std::lock_guard<std::mutex> lock(m_vtermMutex);
-    m_cellBuffer.resize(rows * cols);
-    vterm_set_size(m_vterm, rows, cols);
-  }
+  m_cellBuffer.resize(rows * cols);
+  m_staleRows.assign(rows, {0, cols});
+  m_cellsStale = true;
+  m_viewportStale = true;
+  syncAltScreenLocked();
+  int64_t lineOffset = m_lineOffset;
+  m_pushedRows = 0;
+  vterm_set_size(m_vterm, rows, cols);
+  resizeLineIdsLocked(sameCols, static_cast<size_t>(m_lineOffset - lineOffset));
 
-  // 通知子进程 PTY 尺寸改变
-  if (m_ptyFd >= 0) {
-    struct winsize ws;
-    ws.ws_row = rows;
-    ws.ws_col = cols;
-    ws.ws_xpixel = 0;
-    ws.ws_ypixel = 0;
-    ioctl(m_ptyFd, TIOCSWINSZ, &ws);
-  }
+  // 通知运行时窗口尺寸改变
+  if (m_transport)
+    m_transport->setWindowSize(rows, cols);
+  return true;
+}
+
+// 通知子进程 PTY 尺寸改变
+void PocketTerminal::setPtyWindowSize(int rows, int cols) {
+  if (m_ptyFd < 0)
+    return;
+  struct winsize ws;
+  ws.ws_row = rows;
+  ws.ws_col = cols;
+  ws.ws_xpixel = 0;
+  ws.ws_ypixel = 0;
+  ioctl(m_ptyFd, TIOCSWINSZ, &ws);
 }
 
 size_t PocketTerminal::writeInput(const char *data, size_t len) {
@@ -97,20 +159,102 @@ size_t PocketTerminal::writeInput(const char *data, size_t len) {
   if (!m_vterm || len == 0)
     return 0;
 
-  std::lock_guard<std::mutex> lock(m_vtermMutex);
+  std::lock_guard<VTermMutex> lock(m_vtermMutex);
+  if (m_transport) {
+    // 先把运行时已有的输出送上屏幕，回显才不会跑到前面
+    drainTransportLocked();
+    std::string echo;
+    m_transport->terminalInput(data, len, echo);
+    if (!echo.empty())
+      vterm_input_write(m_vterm, echo.data(), echo.size());
+    return len;
+  }
   return vterm_input_write(m_vterm, data, len);
 }
 
 void PocketTerminal::copyBufferOut(TerminalCell *outBuffer, size_t maxBytes) {
-  std::lock_guard<std::mutex> lock(m_vtermMutex);
+  std::lock_guard<VTermMutex> lock(m_vtermMutex);
+  if (m_transport)
+    drainTransportLocked();
+  refreshViewportLocked();
   size_t bytesToCopy =
       std::min(maxBytes, m_cellBuffer.size() * sizeof(TerminalCell));
   std::memcpy(outBuffer, m_cellBuffer.data(), bytesToCopy);
 }
 
-bool PocketTerminal::startPty() {
+void PocketTerminal::snapshot(ScreenSnapshot &out) {
+  std::lock_guard<VTermMutex> lock(m_vtermMutex);
+  if (m_transport)
+    drainTransportLocked();
+  refreshViewportLocked();
+  syncAltScreenLocked();
+  out.rows = m_rows;
+  out.cols = m_cols;
+  out.cells.assign(m_cellBuffer.begin(), m_cellBuffer.end());
+  out.lineIds.assign(m_rowIds.begin(), m_rowIds.end());
+}
+
+void PocketTerminal::syncCells() {
+  std::lock_guard<VTermMutex> lock(m_vtermMutex);
+  if (m_transport)
+    drainTransportLocked();
+  refreshViewportLocked();
+}
+
+void PocketTerminal::setViewport(int row, int col, int rows, int cols,
+                                 int margin) {
+  std::lock_guard<VTermMutex> lock(m_vtermMutex);
+  m_hasViewport = true;
+  m_viewport = {row, col, std::max(rows, 0), std::max(cols, 0)};
+  m_viewportMargin = std::max(margin, 0);
+  // 新露出的格子可能在区域外时过期了
+  m_viewportStale = m_cellsStale;
+}
+
+void PocketTerminal::clearViewport() {
+  std::lock_guard<VTermMutex> lock(m_vtermMutex);
+  m_hasViewport = false;
+}
+
+size_t PocketTerminal::copyViewportOut(TerminalCell *outBuffer,
+                                       size_t maxBytes) {
+  std::lock_guard<VTermMutex> lock(m_vtermMutex);
+  if (m_transport)
+    drainTransportLocked();
+  refreshViewportLocked();
+
+  CellRect rect = viewportRectLocked(0);
+  size_t maxCells = maxBytes / sizeof(TerminalCell);
+  size_t copied = 0;
+  for (int row = rect.row; row < rect.row + rect.rows; ++row) {
+    size_t count = std::min<size_t>(rect.cols, maxCells - copied);
+    std::memcpy(outBuffer + copied, &m_cellBuffer[row * m_cols + rect.col],
+                count * sizeof(TerminalCell));
+    copied += count;
+    if (copied == maxCells)
+      break;
+  }
+  return copied;
+}
+
+PocketTerminal::CellRect PocketTerminal::viewportRectLocked(int margin) const {
+  if (!m_hasViewport)
+    return {0, 0, m_rows, m_cols};
+  int top = std::max(m_viewport.row - margin, 0);
+  int left = std::max(m_viewport.col - margin, 0);
+  int bottom = std::min(m_viewport.row + m_viewport.rows + margin, m_rows);
+  int right = std::min(m_viewport.col + m_viewport.cols + margin, m_cols);
+  return {top, left, std::max(bottom - top, 0), std::max(right - left, 0)};
+}
+
+bool PocketTerminal::startPty(const char *shell) {
   if (m_running)
     return false;
+  {
+    std::lock_guard<VTermMutex> lock(m_vtermMutex);
+    if (m_transport)
+      return false;
+  }
 
   m_pid = forkpty(&m_ptyFd, nullptr, nullptr, nullptr);
   if (m_pid < 0) {
@@ -120,12 +264,21 @@ bool PocketTerminal::startPty() {
   if (m_pid == 0) {
     // Child process: execute shell
     setenv("TERM", "xterm-256color", 1);
-    const char *shell = "/system/bin/sh";
     execl(shell, "-", nullptr);
     exit(1);
   }
 
   // Parent process
+  if (pipe(m_wakePipe) == 0) {
+    for (int fd : m_wakePipe) {
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_observerMutex);
+    m_readerClosed = false;
+  }
   m_running = true;
   m_readerThread = std::thread(&PocketTerminal::readerLoop, this);
 
@@ -142,6 +295,7 @@ bool PocketTerminal::startPty() {
 
 void PocketTerminal::stopPty() {
   m_running = false;
+  wakeReader();
   if (m_ptyFd >= 0) {
     close(m_ptyFd);
     m_ptyFd = -1;
@@ -154,151 +308,1172 @@ void PocketTerminal::stopPty() {
   if (m_readerThread.joinable()) {
     m_readerThread.join();
   }
+  for (int &fd : m_wakePipe) {
+    if (fd >= 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+}
+
+void PocketTerminal::wakeReader() {
+  char c = 1;
+  if (m_wakePipe[1] >= 0)
+    (void)!write(m_wakePipe[1], &c, 1);
+}
+
+bool PocketTerminal::setOutputObserver(OutputObserver observer) {
+  std::shared_ptr<const OutputObserver> closed;
+  {
+    std::lock_guard<std::mutex> lock(m_observerMutex);
+    if (observer && m_observer)
+      return false;
+    m_observer = observer ? std::make_shared<const OutputObserver>(
+                                std::move(observer))
+                          : nullptr;
+    if (m_readerClosed)
+      closed = m_observer;
+  }
+  // 没有读线程会再回调它，在锁外直接通知 (回调内可卸载自己)
+  if (closed)
+    (*closed)(ObserverEvent::Closed, nullptr, 0);
+  else
+    wakeReader();
+  return true;
+}
+
+bool PocketTerminal::attachTransport(
+    std::shared_ptr<InProcessTransport> transport) {
+  if (m_running || !transport)
+    return false;
+
+  std::lock_guard<VTermMutex> lock(m_vtermMutex);
+  m_transport = std::move(transport);
+  m_transport->setWindowSize(m_rows, m_cols);
+  return true;
+}
+
+void PocketTerminal::detachTransport() {
+  std::shared_ptr<InProcessTransport> transport;
+  {
+    std::lock_guard<VTermMutex> lock(m_vtermMutex);
+    if (!m_transport)
+      return;
+    drainTransportLocked();
+    transport = std::move(m_transport);
+  }
+  // 解除运行时在 producerRead / producerWrite 上的阻塞
+  transport->close();
+}
+
+size_t PocketTerminal::pumpTransport() {
+  std::lock_guard<VTermMutex> lock(m_vtermMutex);
+  return m_transport ? drainTransportLocked() : 0;
+}
+
+size_t PocketTerminal::drainTransportLocked() {
+  char buf[4096];
+  size_t total = 0;
+  size_t n;
+  while ((n = m_transport->terminalRead(buf, sizeof(buf))) > 0) {
+    vterm_input_write(m_vterm, buf, n);
+    total += n;
+  }
+  return total;
 }
 
 void PocketTerminal::readerLoop() {
+  using Clock = std::chrono::steady_clock;
   char buf[4096];
+  // stopPty 会在 join 之前清掉 m_pid，这里保留一份
+  const pid_t pid = m_pid;
+  Clock::time_point nextSample = Clock::now();
+  Clock::time_point nextTick = Clock::time_point::max();
+  std::shared_ptr<const OutputObserver> observer;
+  m_processSampler.reset();
+
+  // 回调观察者并记下它要求的下一次 Tick
+  auto notify = [&](ObserverEvent event, const char *data, size_t len) {
+    int ms = (*observer)(event, data, len);
+    nextTick = ms < 0 ? Clock::time_point::max()
+                      : Clock::now() + std::chrono::milliseconds(ms);
+  };
+  // 观察者变更后，新观察者先收到一次 Tick
+  auto reloadObserver = [&] {
+    std::shared_ptr<const OutputObserver> current;
+    {
+      std::lock_guard<std::mutex> lock(m_observerMutex);
+      current = m_observer;
+    }
+    if (current == observer)
+      return;
+    observer = std::move(current);
+    nextTick = Clock::time_point::max();
+    if (observer)
+      notify(ObserverEvent::Tick, nullptr, 0);
+  };
+  reloadObserver();
+
   while (m_running) {
+    Clock::time_point now = Clock::now();
+    int intervalMs = m_sampleIntervalMs.load(std::memory_order_relaxed);
+    if (intervalMs > 0 && now >= nextSample) {
+      sampleProcesses(pid);
+      nextSample = now + std::chrono::milliseconds(intervalMs);
+    }
+    if (observer && now >= nextTick)
+      notify(ObserverEvent::Tick, nullptr, 0);
+
+    // 等待输出或唤醒，开启采样或观察者定时时限时等待
+    Clock::time_point deadline = observer ? nextTick : Clock::time_point::max();
+    if (intervalMs > 0)
+      deadline = std::min(deadline, nextSample);
+    int timeout = -1;
+    if (deadline != Clock::time_point::max()) {
+      auto waitMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        deadline - Clock::now())
+                        .count();
+      timeout = static_cast<int>(std::max<int64_t>(waitMs, 0));
+    }
+    struct pollfd pfds[2] = {{m_ptyFd, POLLIN, 0}, {m_wakePipe[0], POLLIN, 0}};
+    int ready = poll(pfds, m_wakePipe[0] >= 0 ? 2 : 1, timeout);
+    if (ready < 0 && errno != EINTR)
+      break;
+    if (ready <= 0)
+      continue;
+
+    if (pfds[1].revents & POLLIN) {
+      while (read(m_wakePipe[0], buf, sizeof(buf)) > 0) {
+      }
+      reloadObserver();
+    }
+    if (pfds[0].revents == 0)
+      continue;
+
     int bytesRead = read(m_ptyFd, buf, sizeof(buf));
     if (bytesRead > 0) {
-      std::lock_guard<std::mutex> lock(m_vtermMutex);
-      vterm_input_write(m_vterm, buf, bytesRead);
-    } else if (bytesRead <= 0) {
+      {
+        std::lock_guard<VTermMutex> lock(m_vtermMutex);
+        vterm_input_write(m_vterm, buf, bytesRead);
+      }
+      if (observer)
+        notify(ObserverEvent::Output, buf, bytesRead);
+    } else if (bytesRead < 0 && errno == EINTR) {
+      continue;
+    } else {
       // Error or EOF (Shell closed)
       break;
     }
   }
   m_running = false;
+  // 退出前才装上的观察者可能还没 reload，Closed 发给当前的那个；
+  // 之后再装的由 setOutputObserver 自己发
+  {
+    std::lock_guard<std::mutex> lock(m_observerMutex);
+    m_readerClosed = true;
+    observer = m_observer;
+  }
+  if (observer)
+    notify(ObserverEvent::Closed, nullptr, 0);
+}
+
+void PocketTerminal::setProcessSampling(int intervalMs) {
+  m_sampleIntervalMs = std::max(intervalMs, 0);
+}
+
+bool PocketTerminal::getProcessStats(ProcessTreeStats &out) {
+  std::lock_guard<VTermMutex> lock(m_vtermMutex);
+  if (m_processStats.sequence == 0)
+    return false;
+  out = m_processStats;
+  return true;
+}
+
+void PocketTerminal::sampleProcesses(pid_t pid) {
+  // 扫描 /proc 在锁外完成，只在发布时短暂持锁
+  ProcessTreeStats stats;
+  m_processSampler.sample(pid, m_ptyFd, stats);
+  std::lock_guard<VTermMutex> lock(m_vtermMutex);
+  m_processStats = std::move(stats);
 }
 
 // ============== C Callbacks ==============
 
+// 与 JS 端 Uint32Array 约定的单元格格式：颜色见 colorCode，
+// flags bit 0(bold), 1(underline), 2(italic), 3(blink), 4(reverse),
+// 5(strike)，bit 8-15 存放宽度 (width)
+static TerminalCell convertCell(const VTermScreenCell &vcell) {
+  TerminalCell out;
+  out.ch = vcell.chars[0];
+  out.fg = colorCode(vcell.fg);
+  out.bg = colorCode(vcell.bg);
+
+  uint32_t flags = 0;
+  if (vcell.attrs.bold)
+    flags |= (1 << 0);
+  if (vcell.attrs.underline)
+    flags |= (1 << 1);
+  if (vcell.attrs.italic)
+    flags |= (1 << 2);
+  if (vcell.attrs.blink)
+    flags |= (1 << 3);
+  if (vcell.attrs.reverse)
+    flags |= (1 << 4);
+  if (vcell.attrs.strike)
+    flags |= (1 << 5);
+  flags |= ((vcell.width & 0xFF) << 8);
+  out.flags = flags;
+  return out;
+}
+
 int PocketTerminal::onDamage(VTermRect rect, void *user) {
   auto self = static_cast<PocketTerminal *>(user);
   if (!self->m_screen)
     return 0;
 
-  // 当终端有任何字符活动（比如接到 printf 输出），触发此回调
-  // 更新指定矩形范围内的 Cell
-  for (int row = rect.start_row; row < rect.end_row; ++row) {
-    for (int col = rect.start_col; col < rect.end_col; ++col) {
-
-      VTermPos pos = {row, col};
-      VTermScreenCell vcell;
-      // 从 libvterm 读取真正的格式化栅格
-      vterm_screen_get_cell(self->m_screen, pos, &vcell);
-
-      // 转换为我们封装供 JNI 使用的 C++ 结构体
-      size_t idx = row * self->m_cols + col;
-      auto &out = self->m_cellBuffer[idx];
-
-      out.ch = vcell.chars[0];
-
-      // 将可能存在的 Palette(Index) 色彩空间强制转换为 RGB 真彩色方便前端消费
-      vterm_screen_convert_color_to_rgb(self->m_screen, &vcell.fg);
-      vterm_screen_convert_color_to_rgb(self->m_screen, &vcell.bg);
-
-      // ARGB (0xAARRGGBB) 方便 JS 端 Uint32Array 直接解析
-      out.fg = (0xFF << 24) | (vcell.fg.rgb.red << 16) |
-               (vcell.fg.rgb.green << 8) | vcell.fg.rgb.blue;
-      out.bg = (0xFF << 24) | (vcell.bg.rgb.red << 16) |
-               (vcell.bg.rgb.green << 8) | vcell.bg.rgb.blue;
-
-      // 组装标志位: bit 0(bold), 1(underline), 2(italic), 3(blink), 4(reverse),
-      // 5(strike) bit 8-15 存放宽度 (width)
-      uint32_t flags = 0;
-      if (vcell.attrs.bold)
-        flags |= (1 << 0);
-      if (vcell.attrs.underline)
-        flags |= (1 << 1);
-      if (vcell.attrs.italic)
-        flags |= (1 << 2);
-      if (vcell.attrs.blink)
-        flags |= (1 << 3);
-      if (vcell.attrs.reverse)
-        flags |= (1 << 4);
-      if (vcell.attrs.strike)
-        flags |= (1 << 5);
-
-      flags |= ((vcell.width & 0xFF) << 8);
-      out.flags = flags;
+  // 当终端有任何字符活动（比如接到 printf 输出），触发此回调。
+  // 这里在解析线程上，只记录过期区域；转换留给取帧的一方
+  self->m_pushedRows = 0;
+  self->markStaleLocked(rect.start_row, rect.end_row, rect.start_col,
+                        rect.end_col);
+  return 1;
+}
+
+void PocketTerminal::markStaleLocked(int startRow, int endRow, int startCol,
+                                     int endCol) {
+  startRow = std::max(startRow, 0);
+  endRow = std::min(endRow, static_cast<int>(m_staleRows.size()));
+  for (int row = startRow; row < endRow; ++row) {
+    StaleSpan &span = m_staleRows[row];
+    if (span.startCol >= span.endCol) {
+      span = {startCol, endCol};
+    } else {
+      span.startCol = std::min(span.startCol, startCol);
+      span.endCol = std::max(span.endCol, endCol);
     }
   }
-  return 1;
+  if (startRow >= endRow)
+    return;
+  m_cellsStale = true;
+  m_frameSeq++;
+  if (m_hasViewport && !m_viewportStale) {
+    CellRect rect = viewportRectLocked(m_viewportMargin);
+    m_viewportStale = startRow < rect.row + rect.rows && endRow > rect.row &&
+                      startCol < rect.col + rect.cols && endCol > rect.col;
+  }
 }
 
-int PocketTerminal::onMoveCursor(VTermPos pos, VTermPos oldpos, int visible,
-                                 void *user) {
+// 从 libvterm 读取过期的格子并转换，再叠加图像
+void PocketTerminal::refreshCellsLocked() {
+  if (!m_cellsStale)
+    return;
+  m_cellsStale = false;
+  m_viewportStale = false;
+  convertStaleLocked(0, static_cast<int>(m_staleRows.size()), 0, m_cols);
+}
+
+// 只转换可见区域 (含边) 内的过期格子。m_cellsStale 不清除：区域外
+// 可能还有过期记录，整屏转换时再处理
+void PocketTerminal::refreshViewportLocked() {
+  if (!m_hasViewport) {
+    refreshCellsLocked();
+    return;
+  }
+  if (!m_viewportStale)
+    return;
+  m_viewportStale = false;
+  CellRect rect = viewportRectLocked(m_viewportMargin);
+  convertStaleLocked(rect.row, rect.row + rect.rows, rect.col,
+                     rect.col + rect.cols);
+}
+
+// 转换 [top, bottom) x [left, right) 与过期区间的交集。交集在区间中间时
+// 整段保留，之后再转换一遍只是多做几格
+void PocketTerminal::convertStaleLocked(int top, int bottom, int left,
+                                        int right) {
+  VTermScreenCell vcell;
+  bottom = std::min(bottom, static_cast<int>(m_staleRows.size()));
+  for (int row = top; row < bottom; ++row) {
+    StaleSpan &span = m_staleRows[row];
+    int spanEnd = std::min(span.endCol, m_cols);
+    int startCol = std::max(span.startCol, left);
+    int endCol = std::min(spanEnd, right);
+    if (startCol >= endCol)
+      continue;
+    for (int col = startCol; col < endCol; ++col) {
+      vterm_screen_get_cell(m_screen, {row, col}, &vcell);
+      m_cellBuffer[row * m_cols + col] = convertCell(vcell);
+    }
+    if (startCol <= span.startCol && endCol >= spanEnd)
+      span = {0, 0};
+    else if (startCol <= span.startCol)
+      span.startCol = endCol;
+    else if (endCol >= spanEnd)
+      span.endCol = startCol;
+    if (!m_imagePlacements.empty())
+      applyImageOverlay(row, row + 1);
+  }
+}
+
+int PocketTerminal::onMoveCursor(VTermPos pos, VTermPos, int, void *user) {
   // 处理光标移动，记录当前光标位置供上层渲染
   auto self = static_cast<PocketTerminal *>(user);
   self->m_cursorX = pos.col;
   self->m_cursorY = pos.row;
+  self->m_frameSeq++;
   return 1;
 }
 
 void PocketTerminal::pullScrollback(std::vector<TerminalCell> &outCells,
-                                    std::vector<int> &outRowLengths) {
-  std::lock_guard<std::mutex> lock(m_vtermMutex);
+                                    std::vector<int> &outRowLengths,
+                                    std::vector<uint64_t> *outLineIds) {
+  std::lock_guard<VTermMutex> lock(m_vtermMutex);
+  if (m_transport)
+    drainTransportLocked();
   outCells.clear();
   outRowLengths.clear();
+  if (outLineIds)
+    outLineIds->clear();
 
-  for (auto &row : m_scrollbackBuffer) {
-    outRowLengths.push_back(row.size());
-    outCells.insert(outCells.end(), row.begin(), row.end());
+  size_t first = m_scrollback.size() - m_pendingScrollback;
+  for (size_t i = first; i < m_scrollback.size(); ++i) {
+    outRowLengths.push_back(m_scrollback.lineCols(i));
+    m_scrollback.appendLine(i, outCells);
+    if (outLineIds)
+      outLineIds->push_back(m_scrollback.lineId(i));
   }
-  m_scrollbackBuffer.clear();
+  m_pendingScrollback = 0;
 }
 
-int PocketTerminal::onSbPushLine(int cols, const VTermScreenCell *cells,
+// ============== 行号 ==============
+
+void PocketTerminal::copyLineIdsOut(std::vector<uint64_t> &out) {
+  std::lock_guard<VTermMutex> lock(m_vtermMutex);
+  if (m_transport)
+    drainTransportLocked();
+  syncAltScreenLocked();
+  out.assign(m_rowIds.begin(), m_rowIds.end());
+}
+
+// 显示的屏幕换了 (切换备用屏幕；快照恢复、RIS 不经过回调) 时交换两组行号。
+// 每次进入备用屏幕都是全新的行
+void PocketTerminal::syncAltScreenLocked() {
+  bool alt = vterm_screen_is_altscreen(m_screen);
+  if (alt == m_altScreen)
+    return;
+  m_altScreen = alt;
+  m_rowIds.swap(m_savedRowIds);
+  if (alt)
+    assignNewLineIds(m_rowIds, m_nextLineId);
+}
+
+// 只改行数时主屏幕的行保持顺序，整体上移推入历史的行数；改列数会重排，
+// 备用屏幕的行不进历史、被裁掉的位置也不知道，这两种情况全部换新号
+void PocketTerminal::resizeLineIdsLocked(bool sameCols, size_t pushed) {
+  std::vector<uint64_t> &primary = m_altScreen ? m_savedRowIds : m_rowIds;
+  std::vector<uint64_t> &alt = m_altScreen ? m_rowIds : m_savedRowIds;
+  std::vector<uint64_t> ids(m_rows);
+  for (size_t row = 0; row < ids.size(); ++row) {
+    size_t from = row + pushed;
+    ids[row] = sameCols && from < primary.size() ? primary[from]
+                                                 : m_nextLineId++;
+  }
+  primary.swap(ids);
+  alt.resize(m_rows);
+  assignNewLineIds(alt, m_nextLineId);
+  m_pushedRows = 0;
+}
+
+// 整行的上下移动 (滚动、插入 / 删除行) 带着行号走，移出后空出的行换新号。
+// 行内的左右移动 (插入 / 删除字符、左右边距内滚动) 不改变行号。
+// 返回 0：libvterm 照常把目标区域报为损坏
+int PocketTerminal::onMoveRect(VTermRect dest, VTermRect src, void *user) {
+  auto self = static_cast<PocketTerminal *>(user);
+  self->m_pushedRows = 0;
+  self->syncAltScreenLocked();
+  std::vector<uint64_t> &ids = self->m_rowIds;
+  int rows = static_cast<int>(ids.size());
+  if (dest.start_col != 0 || dest.end_col < self->m_cols ||
+      src.start_row == dest.start_row || src.start_row < 0 ||
+      src.end_row > rows || dest.start_row < 0 || dest.end_row > rows)
+    return 0;
+
+  int height = dest.end_row - dest.start_row;
+  if (dest.start_row < src.start_row) {
+    std::copy(ids.begin() + src.start_row, ids.begin() + src.start_row + height,
+              ids.begin() + dest.start_row);
+  } else {
+    std::copy_backward(ids.begin() + src.start_row,
+                       ids.begin() + src.start_row + height,
+                       ids.begin() + dest.end_row);
+  }
+  for (int row = src.start_row; row < src.end_row; ++row) {
+    if (row < dest.start_row || row >= dest.end_row)
+      ids[row] = self->m_nextLineId++;
+  }
+  return 0;
+}
+
+int PocketTerminal::onSetTermProp(VTermProp prop, VTermValue *, void *user) {
+  if (prop == VTERM_PROP_ALTSCREEN)
+    static_cast<PocketTerminal *>(user)->syncAltScreenLocked();
+  return 1;
+}
+
+// 按字节比较：索引色未使用的字节不同时只是多查一次样式表
+static bool sameColor(const VTermColor &a, const VTermColor &b) {
+  return std::memcmp(&a, &b, sizeof(VTermColor)) == 0;
+}
+
+// 红色前景的非空字符视为错误提示，与 appendLineText 一致
+static bool isRedish(uint32_t argb) {
+  uint32_t r = (argb >> 16) & 0xFF, g = (argb >> 8) & 0xFF, b = argb & 0xFF;
+  return r >= 0x80 && g < 0x60 && b < 0x60;
+}
+
+int PocketTerminal::onSbPushLine(int cols, int width,
+                                 const VTermPackedCell *cells, bool,
                                  void *user) {
   auto self = static_cast<PocketTerminal *>(user);
 
-  std::vector<TerminalCell> rowData;
-  rowData.reserve(cols);
+  // 单遍：写入历史存储，同时统计概览特征并拼出小写文本。
+  // 相邻格的样式大多相同，只在颜色或属性变化时转换颜色并查样式表
+  LineSignature signature;
+  signature.cells = static_cast<uint32_t>(width);
+  std::string &text = self->m_pushText;
+  text.clear();
+  size_t trimmed = 0;
+  bool highlighted = false;
 
+  const VTermPackedCell *run = nullptr;
+  uint32_t style = 0;
+  int colorClass = 0;
+  bool redish = false;
   for (int col = 0; col < cols; ++col) {
-    TerminalCell out;
-    const VTermScreenCell &vcell = cells[col];
-    out.ch = vcell.chars[0];
-
-    VTermColor fg = vcell.fg;
-    VTermColor bg = vcell.bg;
-    vterm_screen_convert_color_to_rgb(self->m_screen, &fg);
-    vterm_screen_convert_color_to_rgb(self->m_screen, &bg);
-
-    out.fg =
-        (0xFF << 24) | (fg.rgb.red << 16) | (fg.rgb.green << 8) | fg.rgb.blue;
-    out.bg =
-        (0xFF << 24) | (bg.rgb.red << 16) | (bg.rgb.green << 8) | bg.rgb.blue;
-
-    uint32_t flags = 0;
-    if (vcell.attrs.bold)
-      flags |= (1 << 0);
-    if (vcell.attrs.underline)
-      flags |= (1 << 1);
-    if (vcell.attrs.italic)
-      flags |= (1 << 2);
-    if (vcell.attrs.blink)
-      flags |= (1 << 3);
-    if (vcell.attrs.reverse)
-      flags |= (1 << 4);
-    if (vcell.attrs.strike)
-      flags |= (1 << 5);
-    flags |= ((vcell.width & 0xFF) << 8);
-    out.flags = flags;
-
-    rowData.push_back(out);
+    const VTermPackedCell &cell = cells[col];
+    if (!run || cell.attrs != run->attrs || cell.width != run->width ||
+        !sameColor(cell.fg, run->fg) || !sameColor(cell.bg, run->bg)) {
+      run = &cell;
+      ScrollbackStyle packed{colorCode(cell.fg), colorCode(cell.bg),
+                             (cell.attrs & kAttrFlagsMask) |
+                                 (static_cast<uint32_t>(cell.width) << 8)};
+      style = self->m_scrollback.internStyle(packed);
+      // 概览按推入时的主题分类
+      uint32_t fg = self->m_palette.resolve(packed.fg);
+      colorClass = ScrollbackOverview::colorClass(fg);
+      redish = isRedish(fg);
+    }
+    self->m_scrollback.appendCell(cell.ch, style);
+
+    uint32_t ch = cell.ch;
+    if (ch == 0xFFFFFFFF)
+      continue; // 宽字符的后半格
+    if (ch == 0)
+      ch = ' ';
+    if (ch >= 'A' && ch <= 'Z')
+      text += static_cast<char>(ch - 'A' + 'a');
+    else
+      appendUtf8(text, ch);
+    if (ch == ' ')
+      continue;
+    signature.nonBlank++;
+    signature.colorCounts[colorClass]++;
+    if (ch != '\t') {
+      trimmed = text.size();
+      highlighted = highlighted || redish;
+    }
+  }
+  // 推入的总是主屏幕顶部的行，一批推入中依次是第 0、1、... 行；
+  // 行号随行进入历史，屏幕上那一行换新号 (之后的移动会覆盖它)
+  std::vector<uint64_t> &primary =
+      self->m_altScreen ? self->m_savedRowIds : self->m_rowIds;
+  uint64_t lineId = self->m_nextLineId++;
+  if (self->m_pushedRows < primary.size())
+    std::swap(lineId, primary[self->m_pushedRows]);
+  self->m_pushedRows++;
+  self->m_scrollback.commitLine(static_cast<uint32_t>(width), lineId);
+
+  if (signature.nonBlank > 0) {
+    text.resize(trimmed);
+    signature.error = highlighted || TextCompactor::looksLikeErrorLower(text);
+    signature.warning =
+        !signature.error && ScrollbackOverview::looksLikeWarningLower(text);
+  }
+  // 提示符标记记录在它出现时的屏幕行上，此时才随该行进入历史
+  for (auto it = self->m_promptLines.rbegin();
+       it != self->m_promptLines.rend() && *it >= self->m_lineOffset; ++it) {
+    if (*it == self->m_lineOffset)
+      signature.prompt = true;
   }
+  self->m_overview.addLine(signature);
 
   // 此回调一般由 vterm_input_write 等函数同步触发，此时已被 m_vtermMutex 保护，
-  // 所以操作 std::deque 是并发安全的（pullScrollback 此时无法被抢占并调用）。
-  if (self->m_scrollbackBuffer.size() >= self->m_maxScrollback) {
-    self->m_scrollbackBuffer.pop_front();
+  // 所以操作历史存储是并发安全的（pullScrollback 此时无法被抢占并调用）。
+  self->m_pendingScrollback =
+      std::min(self->m_pendingScrollback + 1, self->m_scrollback.size());
+
+  // 图像放置随内容一起上移；完全滚出历史上限的放置释放其图像引用
+  self->m_lineOffset++;
+  int64_t oldest =
+      self->m_lineOffset - static_cast<int64_t>(kMaxScrollback);
+  while (!self->m_promptLines.empty() && self->m_promptLines.front() < oldest)
+    self->m_promptLines.pop_front();
+  if (!self->m_imagePlacements.empty()) {
+    auto &placements = self->m_imagePlacements;
+    placements.erase(std::remove_if(placements.begin(), placements.end(),
+                                    [oldest](const ImagePlacement &p) {
+                                      return p.line + p.rows <= oldest;
+                                    }),
+                     placements.end());
+  }
+
+  return 1;
+}
+
+// ============== 文本导出 ==============
+
+int PocketTerminal::onOsc(int command, VTermStringFragment frag, void *user) {
+  // OSC 133 ; A ST 标记提示符开始，即一条命令的边界
+  if (command != 133 || !frag.initial || frag.len == 0 || frag.str[0] != 'A')
+    return 0;
+
+  auto self = static_cast<PocketTerminal *>(user);
+  VTermPos pos;
+  vterm_state_get_cursorpos(vterm_obtain_state(self->m_vterm), &pos);
+  int64_t line = self->m_lineOffset + pos.row;
+  if (self->m_promptLines.empty() || self->m_promptLines.back() != line)
+    self->m_promptLines.push_back(line);
+  return 1;
+}
+
+// 一行单元格转为去掉行尾空白的 UTF-8；红色前景的非空字符视为错误提示
+static void appendLineText(const TerminalCell *cells, size_t cols,
+                           const ColorPalette &palette, std::string &out,
+                           bool &highlighted) {
+  out.clear();
+  highlighted = false;
+  size_t trimmed = 0;
+  for (size_t col = 0; col < cols; ++col) {
+    const TerminalCell &cell = cells[col];
+    uint32_t ch = cell.ch;
+    if (cell.flags & kCellImage)
+      ch = ' ';
+    else if (ch == 0xFFFFFFFF)
+      continue; // 宽字符的后半格
+    else if (ch == 0)
+      ch = ' ';
+
+    appendUtf8(out, ch);
+
+    if (ch != ' ' && ch != '\t') {
+      trimmed = out.size();
+      if (isRedish(palette.resolve(cell.fg)))
+        highlighted = true;
+    }
+  }
+  out.resize(trimmed);
+}
+
+// 可视区只导出到最后一个非空行 (至少到光标行)
+int PocketTerminal::lastContentRowLocked() {
+  std::string text;
+  bool highlighted;
+  for (int row = m_rows - 1; row > m_cursorY; --row) {
+    appendLineText(&m_cellBuffer[row * m_cols], m_cols, m_palette, text,
+                   highlighted);
+    if (!text.empty())
+      return row;
+  }
+  return m_cursorY;
+}
+
+std::string PocketTerminal::exportSummary(const SummaryOptions &options) {
+  TextCompactor compactor(options.maxBytes);
+  std::string text;
+  bool highlighted = false;
+  {
+    std::lock_guard<VTermMutex> lock(m_vtermMutex);
+    if (m_transport)
+      drainTransportLocked();
+    refreshCellsLocked();
+
+    int lastRow = lastContentRowLocked();
+
+    int64_t historyStart =
+        m_lineOffset - static_cast<int64_t>(m_scrollback.size());
+    int64_t endLine = m_lineOffset + lastRow + 1;
+    int64_t startLine = historyStart;
+    if (options.lastCommands > 0 && !m_promptLines.empty()) {
+      size_t n = std::min<size_t>(options.lastCommands, m_promptLines.size());
+      startLine = std::max(startLine, m_promptLines[m_promptLines.size() - n]);
+    }
+    if (options.lastLines > 0)
+      startLine = std::max(startLine, endLine - options.lastLines);
+
+    // 单遍：历史从旧到新，然后是可视区
+    std::vector<TerminalCell> row;
+    for (int64_t line = startLine; line < endLine; ++line) {
+      if (line < m_lineOffset) {
+        row.clear();
+        m_scrollback.appendLine(line - historyStart, row);
+        appendLineText(row.data(), row.size(), m_palette, text, highlighted);
+      } else {
+        int screenRow = static_cast<int>(line - m_lineOffset);
+        appendLineText(&m_cellBuffer[screenRow * m_cols], m_cols, m_palette,
+                       text, highlighted);
+      }
+      compactor.addLine(text, highlighted);
+    }
+  }
+  return compactor.finish();
+}
+
+bool PocketTerminal::exportHistory(const std::string &path,
+                                   ExportFormat format,
+                                   ExportCallback callback) {
+  // 检查与置位必须是一步，否则两个调用方可能同时通过检查
+  bool idle = false;
+  if (!m_exportRunning.compare_exchange_strong(idle, true))
+    return false;
+  // 上一次导出已结束，回收它的线程
+  if (m_exportThread.joinable())
+    m_exportThread.join();
+  m_exportCancel = false;
+  m_exportThread = std::thread(&PocketTerminal::exportLoop, this, path, format,
+                               std::move(callback));
+  return true;
+}
+
+void PocketTerminal::exportLoop(std::string path, ExportFormat format,
+                                ExportCallback callback) {
+  // 每次持锁复制的行数
+  const int64_t kChunkLines = 256;
+
+  ExportProgress progress;
+  std::string partial = path + ".part";
+  int fd = open(partial.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    progress.error = "open " + partial + ": " + std::strerror(errno);
+    progress.done = true;
+    m_exportRunning = false;
+    if (callback)
+      callback(progress);
+    return;
+  }
+
+  // 导出范围在开始时确定；之后新增的输出不导出
+  // 颜色按开始时的主题导出
+  int64_t line, endLine;
+  ColorPalette palette;
+  {
+    std::lock_guard<VTermMutex> lock(m_vtermMutex);
+    if (m_transport)
+      drainTransportLocked();
+    refreshCellsLocked();
+    palette = m_palette;
+    line = m_lineOffset - static_cast<int64_t>(m_scrollback.size());
+    endLine = m_lineOffset + lastContentRowLocked() + 1;
+  }
+  progress.linesTotal = endLine - line;
+
+  HistoryWriter writer(fd, format, palette);
+  bool ok = writer.begin();
+  std::vector<TerminalCell> cells;
+  std::vector<size_t> lengths;
+  while (ok && line < endLine && !m_exportCancel) {
+    int64_t skipped = 0;
+    cells.clear();
+    lengths.clear();
+    {
+      std::lock_guard<VTermMutex> lock(m_vtermMutex);
+      int64_t historyStart =
+          m_lineOffset - static_cast<int64_t>(m_scrollback.size());
+      if (line < historyStart) {
+        // 导出期间输出太快，这些行已被挤出历史上限
+        skipped = std::min(historyStart, endLine) - line;
+        line += skipped;
+      }
+      int64_t chunkEnd = std::min(endLine, line + kChunkLines);
+      for (; line < chunkEnd; ++line) {
+        if (line < m_lineOffset) {
+          m_scrollback.appendLine(line - historyStart, cells);
+          lengths.push_back(m_scrollback.lineCols(line - historyStart));
+          continue;
+        }
+        int row = static_cast<int>(line - m_lineOffset);
+        if (row >= m_rows) {
+          // 导出期间屏幕缩小，剩余的行已不存在
+          endLine = line;
+          break;
+        }
+        refreshCellsLocked();
+        auto begin = m_cellBuffer.begin() + row * m_cols;
+        cells.insert(cells.end(), begin, begin + m_cols);
+        lengths.push_back(m_cols);
+      }
+    }
+
+    if (skipped > 0) {
+      progress.linesSkipped += skipped;
+      progress.linesDone += skipped;
+      ok = writer.writeNote("... " + std::to_string(skipped) +
+                            " lines dropped from history during export ...");
+    }
+    const TerminalCell *rowCells = cells.data();
+    for (size_t length : lengths) {
+      if (!ok)
+        break;
+      ok = writer.writeLine(rowCells, length);
+      rowCells += length;
+      progress.linesDone++;
+    }
+    progress.bytesWritten = writer.bytesWritten();
+    if (ok && line < endLine && callback)
+      callback(progress);
+  }
+
+  if (ok && m_exportCancel)
+    progress.error = "export cancelled";
+  ok = ok && !m_exportCancel && writer.finish();
+  if (!ok && progress.error.empty())
+    progress.error = std::string("write ") + partial + ": " +
+                     std::strerror(writer.error());
+  if (close(fd) != 0 && ok) {
+    ok = false;
+    progress.error = std::string("close ") + partial + ": " +
+                     std::strerror(errno);
+  }
+  if (ok && rename(partial.c_str(), path.c_str()) != 0) {
+    ok = false;
+    progress.error = "rename to " + path + ": " + std::strerror(errno);
+  }
+  if (!ok)
+    unlink(partial.c_str());
+
+  progress.bytesWritten = writer.bytesWritten();
+  progress.done = true;
+  m_exportRunning = false;
+  if (callback)
+    callback(progress);
+}
+
+void PocketTerminal::getOverview(size_t buckets,
+                                 std::vector<OverviewBucket> &out) {
+  std::lock_guard<VTermMutex> lock(m_vtermMutex);
+  if (m_transport)
+    drainTransportLocked();
+  m_overview.query(buckets, out);
+}
+
+void PocketTerminal::checkpoint(std::vector<uint8_t> &out) {
+  std::lock_guard<VTermMutex> lock(m_vtermMutex);
+  if (m_transport)
+    drainTransportLocked();
+  out.resize(out.capacity());
+  size_t size = vterm_screen_checkpoint(m_screen, out.data(), out.size());
+  if (size > out.size()) {
+    out.resize(size);
+    vterm_screen_checkpoint(m_screen, out.data(), out.size());
+  }
+  out.resize(size);
+}
+
+bool PocketTerminal::restore(const uint8_t *data, size_t len) {
+  // 头、负载长度、校验和与各字段的范围都先检查 (libvterm 在临时终端上
+  // 试解一遍)，无效或伪造的快照连尺寸也不改
+  int rows, cols;
+  if (!vterm_screen_checkpoint_validate(data, len, &rows, &cols) ||
+      rows <= 0 || cols <= 0)
+    return false;
+
+  // 调整尺寸与恢复在同一次持锁内，中间不会有输出按快照的尺寸解析到旧状态上
+  bool resized, ok;
+  {
+    std::lock_guard<VTermMutex> lock(m_vtermMutex);
+    resized = resizeLocked(rows, cols);
+    ok = restoreLocked(data, len);
+  }
+  if (resized)
+    setPtyWindowSize(rows, cols);
+  return ok;
+}
+
+// 快照未经 vterm_screen_checkpoint_validate 时可能失败，此时 libvterm
+// 已把终端重置
+
+bool PocketTerminal::restoreLocked(const uint8_t *data, size_t len) {
+  if (!vterm_screen_restore(m_screen, data, len))
+    return false;
+  loadPaletteLocked();
+  // 屏幕内容整个换掉，两块屏幕的行都是新行
+  syncAltScreenLocked();
+  assignNewLineIds(m_rowIds, m_nextLineId);
+  assignNewLineIds(m_savedRowIds, m_nextLineId);
+
+  // 图像放置与收到一半的图像负载属于旧屏幕；解析器可能正处在一个
+  // APC 中间，其余分块没有开头，整段丢弃
+  m_imagePlacements.clear();
+  m_sixelActive = false;
+  m_kittyActive = false;
+  std::string().swap(m_sixelJob.payload);
+  std::string().swap(m_kittyJob.payload);
+  std::string().swap(m_apcBuffer);
+  m_apcOverflow = true;
+  return true;
+}
+
+// ============== 颜色主题 ==============
+
+static uint32_t toArgb(VTermColor color) {
+  return (0xFFu << 24) | (color.rgb.red << 16) | (color.rgb.green << 8) |
+         color.rgb.blue;
+}
+
+static VTermColor fromArgb(uint32_t argb) {
+  VTermColor color;
+  vterm_color_rgb(&color, (argb >> 16) & 0xFF, (argb >> 8) & 0xFF,
+                  argb & 0xFF);
+  return color;
+}
+
+// 构造与恢复快照时从 libvterm 读取整张表；16 色以上的自定义颜色不在
+// 快照里，恢复后回到标准值
+void PocketTerminal::loadPaletteLocked() {
+  VTermState *state = vterm_obtain_state(m_vterm);
+  VTermColor fg, bg;
+  for (int index = 0; index < 256; ++index) {
+    vterm_state_get_palette_color(state, index, &fg);
+    m_palette.colors[index] = toArgb(fg);
+  }
+  vterm_state_get_default_colors(state, &fg, &bg);
+  m_palette.colors[kPaletteDefaultFg] = toArgb(fg);
+  m_palette.colors[kPaletteDefaultBg] = toArgb(bg);
+  m_paletteVersion++;
+}
+
+uint32_t PocketTerminal::copyPaletteOut(ColorPalette &out) {
+  std::lock_guard<VTermMutex> lock(m_vtermMutex);
+  out = m_palette;
+  return m_paletteVersion;
+}
+
+void PocketTerminal::setDefaultColors(uint32_t fg, uint32_t bg) {
+  std::lock_guard<VTermMutex> lock(m_vtermMutex);
+  // libvterm 内部也同步，使快照带上新的默认色
+  VTermColor vfg = fromArgb(fg), vbg = fromArgb(bg);
+  vterm_screen_set_default_colors(m_screen, &vfg, &vbg);
+  m_palette.colors[kPaletteDefaultFg] = toArgb(vfg);
+  m_palette.colors[kPaletteDefaultBg] = toArgb(vbg);
+  m_paletteVersion++;
+}
+
+void PocketTerminal::setPaletteColor(int index, uint32_t argb) {
+  if (index < 0 || index >= 256)
+    return;
+  std::lock_guard<VTermMutex> lock(m_vtermMutex);
+  // libvterm 只保存前 16 色，其余由色立方与灰阶算出，只改在表里
+  VTermColor color = fromArgb(argb);
+  if (index < 16)
+    vterm_state_set_palette_color(vterm_obtain_state(m_vterm), index, &color);
+  m_palette.colors[index] = toArgb(color);
+  m_paletteVersion++;
+}
+
+// ============== 内联图像 ==============
+
+void PocketTerminal::setCellPixelSize(int width, int height) {
+  std::lock_guard<VTermMutex> lock(m_vtermMutex);
+  if (width > 0)
+    m_cellPixelWidth = width;
+  if (height > 0)
+    m_cellPixelHeight = height;
+}
+
+void PocketTerminal::setMemoryBudget(size_t bytes) {
+  std::lock_guard<VTermMutex> lock(m_vtermMutex);
+  m_memoryBudget = bytes;
+  size_t text = textBytesLocked();
+  m_imageCache.setCapacity(m_memoryBudget > text ? m_memoryBudget - text : 0);
+}
+
+size_t PocketTerminal::getMemoryUsage() {
+  std::lock_guard<VTermMutex> lock(m_vtermMutex);
+  return textBytesLocked() + m_imageCache.liveBytes() +
+         m_imageDecoder->pendingBytes() + m_sixelJob.payload.size() +
+         m_apcBuffer.size() + m_kittyJob.payload.size();
+}
+
+size_t PocketTerminal::textBytesLocked() const {
+  return m_cellBuffer.size() * sizeof(TerminalCell) +
+         m_scrollback.memoryBytes();
+}
+
+void PocketTerminal::getImagePlacements(std::vector<ImagePlacementInfo> &out) {
+  std::lock_guard<VTermMutex> lock(m_vtermMutex);
+  out.clear();
+  for (const auto &p : m_imagePlacements) {
+    out.push_back({p.image->id, static_cast<int>(p.line - m_lineOffset), p.col,
+                   p.rows, p.cols});
+  }
+}
+
+void PocketTerminal::respond(const std::string &data) {
+  // 协议应答直接写回 PTY (或进程内传输，不经行规程)；
+  // 脱机模式下没有读取方，丢弃即可
+  if (m_ptyFd >= 0 && m_running)
+    write(m_ptyFd, data.data(), data.size());
+  else if (m_transport)
+    m_transport->terminalInputRaw(data.data(), data.size());
+}
+
+void PocketTerminal::submitImage(ImageJob &job) {
+  job.line = m_cursorY + m_lineOffset;
+  job.col = m_cursorX;
+  m_imageDecoder->submit(std::move(job));
+  job = ImageJob();
+}
+
+int PocketTerminal::onDcs(const char *command, size_t commandlen,
+                          VTermStringFragment frag, void *user) {
+  auto self = static_cast<PocketTerminal *>(user);
+
+  // sixel：DCS P1;P2;P3 q ... ST，参数只含数字与分号
+  if (commandlen == 0 || command[commandlen - 1] != 'q')
+    return 0;
+  for (size_t i = 0; i + 1 < commandlen; ++i) {
+    if (!(command[i] >= '0' && command[i] <= '9') && command[i] != ';')
+      return 0;
   }
-  self->m_scrollbackBuffer.push_back(std::move(rowData));
 
+  // 解析线程上只做拷贝；超过预算四分之一的负载整段丢弃
+  size_t limit = self->m_memoryBudget / 4;
+  if (frag.initial) {
+    self->m_sixelJob = ImageJob();
+    self->m_sixelJob.protocol = ImageProtocol::Sixel;
+    self->m_sixelJob.params.assign(command, commandlen - 1);
+    self->m_sixelActive = true;
+  }
+  if (self->m_sixelActive) {
+    if (self->m_sixelJob.payload.size() + frag.len > limit) {
+      self->m_sixelActive = false;
+      std::string().swap(self->m_sixelJob.payload);
+    } else {
+      self->m_sixelJob.payload.append(frag.str, frag.len);
+    }
+  }
+  if (frag.final && self->m_sixelActive) {
+    self->m_sixelActive = false;
+    self->submitImage(self->m_sixelJob);
+  }
   return 1;
 }
 
+int PocketTerminal::onApc(VTermStringFragment frag, void *user) {
+  auto self = static_cast<PocketTerminal *>(user);
+
+  if (frag.initial) {
+    self->m_apcBuffer.clear();
+    self->m_apcOverflow = false;
+  }
+  if (!self->m_apcOverflow) {
+    if (self->m_apcBuffer.size() + frag.len > self->m_memoryBudget / 4) {
+      self->m_apcOverflow = true;
+      std::string().swap(self->m_apcBuffer);
+    } else {
+      self->m_apcBuffer.append(frag.str, frag.len);
+    }
+  }
+  if (!frag.final)
+    return 1;
+
+  std::string apc;
+  apc.swap(self->m_apcBuffer);
+  if (self->m_apcOverflow || apc.empty() || apc[0] != 'G') {
+    self->m_kittyActive = false;
+    std::string().swap(self->m_kittyJob.payload);
+    return 0;
+  }
+
+  // kitty：G<控制数据>;<base64 负载>
+  size_t sep = apc.find(';');
+  size_t controlEnd = sep == std::string::npos ? apc.size() : sep;
+  KittyCommand cmd = parseKittyCommand(apc.data() + 1, controlEnd - 1);
+  std::string payload =
+      sep == std::string::npos ? std::string() : apc.substr(sep + 1);
+
+  if (self->m_kittyActive) {
+    // 后续分块只带 m= (及 q=)，控制数据沿用第一块
+    auto &job = self->m_kittyJob;
+    if (job.payload.size() + payload.size() > self->m_memoryBudget / 4) {
+      self->m_kittyActive = false;
+      std::string().swap(job.payload);
+      return 1;
+    }
+    job.payload += payload;
+    if (!cmd.more) {
+      self->m_kittyActive = false;
+      self->submitImage(job);
+    }
+    return 1;
+  }
+
+  if (cmd.action == 'q') {
+    // 支持性探测：程序据此决定是否使用图形协议
+    if (cmd.quiet < 2)
+      self->respond("\x1b_Gi=" + std::to_string(cmd.id) + ";OK\x1b\\");
+    return 1;
+  }
+
+  ImageJob job;
+  job.protocol = ImageProtocol::Kitty;
+  job.kitty = cmd;
+  job.payload.swap(payload);
+  if (cmd.more) {
+    self->m_kittyJob = std::move(job);
+    self->m_kittyActive = true;
+  } else {
+    self->submitImage(job);
+  }
+  return 1;
+}
+
+void PocketTerminal::onImageDecoded(ImageJob &job,
+                                    std::unique_ptr<DecodedImage> image) {
+  std::lock_guard<VTermMutex> lock(m_vtermMutex);
+
+  size_t text = textBytesLocked();
+  m_imageCache.setCapacity(m_memoryBudget > text ? m_memoryBudget - text : 0);
+
+  if (job.protocol == ImageProtocol::Sixel) {
+    if (!image)
+      return;
+    image->id = nextImageId();
+    if (ImageRef ref = m_imageCache.insert(std::move(image)))
+      placeImage(ref, job.line, job.col, 0, 0);
+    return;
+  }
+
+  const KittyCommand &cmd = job.kitty;
+  auto reply = [&](const char *message, bool error) {
+    // 没有 i= 的请求不应答；q=1 只报告错误，q=2 完全静默
+    if (!cmd.id || cmd.quiet >= 2 || (!error && cmd.quiet == 1))
+      return;
+    respond("\x1b_Gi=" + std::to_string(cmd.id) + ";" + message + "\x1b\\");
+  };
+
+  switch (cmd.action) {
+  case 't':
+  case 'T': {
+    if (!image) {
+      reply("EINVAL:unsupported or malformed image data", true);
+      return;
+    }
+    image->id = cmd.id ? cmd.id : nextImageId();
+    ImageRef ref = m_imageCache.insert(std::move(image));
+    if (!ref) {
+      reply("ENOSPC:image exceeds memory budget", true);
+      return;
+    }
+    if (cmd.action == 'T')
+      placeImage(ref, job.line, job.col, cmd.rows, cmd.cols);
+    reply("OK", false);
+    break;
+  }
+  case 'p': {
+    ImageRef ref = m_imageCache.find(cmd.id);
+    if (!ref) {
+      reply("ENOENT:image not found", true);
+      return;
+    }
+    placeImage(ref, job.line, job.col, cmd.rows, cmd.cols);
+    reply("OK", false);
+    break;
+  }
+  case 'd': {
+    char target = cmd.deleteTarget;
+    bool byId = target == 'i' || target == 'I';
+    removePlacements(cmd.id, !byId);
+    // 大写目标同时释放图像数据
+    if (target == 'I')
+      m_imageCache.erase(cmd.id);
+    else if (target == 'A')
+      m_imageCache.clear();
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+uint32_t PocketTerminal::nextImageId() {
+  uint32_t id = m_nextImageId++;
+  if (m_nextImageId == 0)
+    m_nextImageId = 1u << 31;
+  return id;
+}
+
+void PocketTerminal::placeImage(const ImageRef &image, int64_t line, int col,
+                                int rows, int cols) {
+  // 图像尺寸已由解码器限制在 kMaxImageDimension 内；c= / r= 来自客户端，
+  // 同样裁到这个范围，后面的行列运算不会溢出
+  if (cols <= 0)
+    cols = (image->width + m_cellPixelWidth - 1) / m_cellPixelWidth;
+  if (rows <= 0)
+    rows = (image->height + m_cellPixelHeight - 1) / m_cellPixelHeight;
+  cols = std::min(std::max(cols, 1), kMaxImageDimension);
+  rows = std::min(std::max(rows, 1), kMaxImageDimension);
+
+  m_imagePlacements.push_back({image, line, col, rows, cols});
+
+  // 超出预算时从最早的放置开始释放，直到缓存能回到容量之内
+  while (!m_imageCache.trim() && m_imagePlacements.size() > 1) {
+    const ImagePlacement &oldest = m_imagePlacements.front();
+    int row = static_cast<int>(oldest.line - m_lineOffset);
+    int endRow = row + oldest.rows;
+    m_imagePlacements.erase(m_imagePlacements.begin());
+    if (endRow > 0 && row < m_rows)
+      markStaleLocked(row, endRow, 0, m_cols);
+  }
+
+  int row = static_cast<int>(line - m_lineOffset);
+  markStaleLocked(row, row + rows, 0, m_cols);
+}
+
+void PocketTerminal::removePlacements(uint32_t id, bool all) {
+  auto &placements = m_imagePlacements;
+  for (auto it = placements.begin(); it != placements.end();) {
+    if (!all && it->image->id != id) {
+      ++it;
+      continue;
+    }
+    int row = static_cast<int>(it->line - m_lineOffset);
+    int endRow = row + it->rows;
+    it = placements.erase(it);
+    // 用 libvterm 的真实内容重画被图像覆盖过的格子
+    if (endRow > 0 && row < m_rows)
+      markStaleLocked(row, endRow, 0, m_cols);
+  }
+}
+
+void PocketTerminal::applyImageOverlay(int startRow, int endRow) {
+  for (const auto &p : m_imagePlacements) {
+    int top = static_cast<int>(p.line - m_lineOffset);
+    int from = std::max(startRow, top);
+    int to = std::min(endRow, top + p.rows);
+    for (int row = from; row < to; ++row) {
+      for (int col = p.col; col < p.col + p.cols && col < m_cols; ++col) {
+        auto &cell = m_cellBuffer[row * m_cols + col];
+        // 文字优先：只覆盖空白格
+        if (cell.ch != 0 && !(cell.flags & kCellImage))
+          continue;
+        cell.ch = p.image->id;
+        cell.fg = (static_cast<uint32_t>(row - top) << 16) |
+                  static_cast<uint32_t>(col - p.col);
+        cell.flags = kCellImage | (1 << 8);
+      }
+    }
+  }
+}
+
 } // namespace terminal
 } // namespace pocket
@@ -0,0 +1,230 @@
+#include "process_sampler.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace pocket {
+namespace terminal {
+
+static uint64_t monotonicMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+ProcessSampler::ProcessSampler()
+    : m_ticksPerSecond(sysconf(_SC_CLK_TCK)), m_pageSize(sysconf(_SC_PAGESIZE)) {
+  if (m_ticksPerSecond <= 0)
+    m_ticksPerSecond = 100;
+  if (m_pageSize <= 0)
+    m_pageSize = 4096;
+}
+
+void ProcessSampler::reset() {
+  m_lastSampleMs = 0;
+  m_lastTicks.clear();
+}
+
+bool parseProcStat(pid_t pid, const char *text, ProcStat &out) {
+  // 格式: pid (comm) state ppid pgrp ...，comm 可能含空格和括号，
+  // 以最后一个 ')' 为准
+  const char *open_paren = std::strchr(text, '(');
+  const char *close_paren = std::strrchr(text, ')');
+  if (!open_paren || !close_paren || close_paren < open_paren)
+    return false;
+
+  out.pid = pid;
+  out.name.assign(open_paren + 1, close_paren - open_paren - 1);
+
+  // 从 state (字段 3) 开始按空格切分
+  const char *p = close_paren + 1;
+  long long fields[22] = {0};
+  int field = 3;
+  while (*p && field <= 24) {
+    while (*p == ' ')
+      p++;
+    if (!*p)
+      break;
+    if (field == 3) {
+      // state 是单个字符
+      while (*p && *p != ' ')
+        p++;
+    } else {
+      // priority / nice 等字段可以为负
+      char *end;
+      long long v = std::strtoll(p, &end, 10);
+      if (end == p)
+        return false;
+      p = end;
+      fields[field - 3] = v;
+    }
+    field++;
+  }
+  if (field <= 24)
+    return false;
+
+  // 下标 = 字段号 - 3
+  out.ppid = static_cast<pid_t>(fields[4 - 3]);
+  out.pgrp = static_cast<pid_t>(fields[5 - 3]);
+  out.ticks = static_cast<uint64_t>(std::max(fields[14 - 3], 0LL)) +
+              static_cast<uint64_t>(std::max(fields[15 - 3], 0LL));
+  out.threads = static_cast<int>(fields[20 - 3]);
+  out.rssPages = static_cast<uint64_t>(std::max(fields[24 - 3], 0LL));
+  return true;
+}
+
+bool readProcStat(pid_t pid, ProcStat &out) {
+  char path[32];
+  std::snprintf(path, sizeof(path), "/proc/%d/stat", static_cast<int>(pid));
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  char buf[512];
+  ssize_t n = read(fd, buf, sizeof(buf) - 1);
+  close(fd);
+  if (n <= 0)
+    return false;
+  buf[n] = '\0';
+  return parseProcStat(pid, buf, out);
+}
+
+void scanProcesses(std::vector<ProcStat> &out) {
+  out.clear();
+  DIR *dir = opendir("/proc");
+  if (!dir)
+    return;
+  while (struct dirent *entry = readdir(dir)) {
+    const char *name = entry->d_name;
+    if (name[0] < '0' || name[0] > '9')
+      continue;
+    ProcStat stat;
+    if (readProcStat(static_cast<pid_t>(std::atoi(name)), stat))
+      out.push_back(std::move(stat));
+  }
+  closedir(dir);
+}
+
+std::vector<size_t> findDescendants(const std::vector<ProcStat> &procs,
+                                    pid_t root) {
+  std::unordered_map<pid_t, std::vector<size_t>> children;
+  for (size_t i = 0; i < procs.size(); ++i)
+    children[procs[i].ppid].push_back(i);
+
+  // 按 pid 去重，防止 /proc 扫描期间 pid 复用造成环
+  std::vector<char> seen(procs.size(), 0);
+  std::vector<size_t> result;
+  std::vector<pid_t> parents{root};
+  for (size_t head = 0; head < parents.size(); ++head) {
+    auto it = children.find(parents[head]);
+    if (it == children.end())
+      continue;
+    for (size_t child : it->second) {
+      if (seen[child] || procs[child].pid == root)
+        continue;
+      seen[child] = 1;
+      result.push_back(child);
+      parents.push_back(procs[child].pid);
+    }
+  }
+  return result;
+}
+
+void ProcessSampler::sample(pid_t root, int ptyFd, ProcessTreeStats &out) {
+  uint64_t now = monotonicMs();
+  uint64_t elapsedMs = m_lastSampleMs ? now - m_lastSampleMs : 0;
+  m_lastSampleMs = now;
+
+  out.sampleTimeMs = now;
+  out.sequence = ++m_sequence;
+  out.processCount = 0;
+  out.tree = ProcessUsage();
+  out.foreground = ProcessUsage();
+  out.foregroundPgid = ptyFd >= 0 ? tcgetpgrp(ptyFd) : -1;
+  out.top.clear();
+  if (root <= 0)
+    return;
+
+  // 扫描 /proc，从根进程出发按 ppid 标记后代
+  scanProcesses(m_procs);
+  std::vector<char> inTree(m_procs.size(), 0);
+  int rootIndex = -1;
+  for (size_t i = 0; i < m_procs.size(); ++i) {
+    if (m_procs[i].pid == root)
+      rootIndex = static_cast<int>(i);
+  }
+  if (rootIndex >= 0) {
+    inTree[rootIndex] = 1;
+    for (size_t child : findDescendants(m_procs, root))
+      inTree[child] = 1;
+  }
+
+  double tickMs = 1000.0 / m_ticksPerSecond;
+  std::unordered_map<pid_t, uint64_t> ticks;
+
+  auto accumulate = [](ProcessUsage &sum, const ProcessUsage &p) {
+    sum.cpuTimeMs += p.cpuTimeMs;
+    sum.cpuPercent += p.cpuPercent;
+    sum.rssBytes += p.rssBytes;
+    sum.threads += p.threads;
+  };
+
+  for (size_t i = 0; i < m_procs.size(); ++i) {
+    const ProcStat &stat = m_procs[i];
+    bool inForeground =
+        out.foregroundPgid > 0 && stat.pgrp == out.foregroundPgid;
+    if (!inTree[i] && !inForeground)
+      continue;
+
+    ProcessUsage usage;
+    usage.pid = stat.pid;
+    usage.name = stat.name;
+    usage.cpuTimeMs = static_cast<uint64_t>(stat.ticks * tickMs);
+    usage.rssBytes = stat.rssPages * m_pageSize;
+    usage.threads = stat.threads;
+    auto last = m_lastTicks.find(stat.pid);
+    if (elapsedMs > 0 && last != m_lastTicks.end() &&
+        stat.ticks >= last->second) {
+      usage.cpuPercent = static_cast<float>(
+          (stat.ticks - last->second) * tickMs * 100.0 / elapsedMs);
+    }
+    ticks[stat.pid] = stat.ticks;
+
+    if (inForeground) {
+      accumulate(out.foreground, usage);
+      if (stat.pid == out.foregroundPgid || out.foreground.name.empty()) {
+        out.foreground.pid = stat.pid;
+        out.foreground.name = stat.name;
+      }
+    }
+    if (inTree[i]) {
+      out.processCount++;
+      accumulate(out.tree, usage);
+      out.top.push_back(std::move(usage));
+    }
+  }
+
+  if (rootIndex >= 0) {
+    out.tree.pid = root;
+    out.tree.name = m_procs[rootIndex].name;
+  }
+
+  size_t topCount = std::min(out.top.size(), kMaxTop);
+  std::partial_sort(out.top.begin(), out.top.begin() + topCount, out.top.end(),
+                    [](const ProcessUsage &a, const ProcessUsage &b) {
+                      if (a.cpuPercent != b.cpuPercent)
+                        return a.cpuPercent > b.cpuPercent;
+                      return a.rssBytes > b.rssBytes;
+                    });
+  out.top.resize(topCount);
+
+  // 只保留本次见到的进程，已退出的 pid 不再占用
+  m_lastTicks.swap(ticks);
+}
+
+} // namespace terminal
+} // namespace pocket
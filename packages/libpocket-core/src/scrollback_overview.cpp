@@ -0,0 +1,109 @@
+#include "scrollback_overview.h"
+#include <algorithm>
+#include <cctype>
+
+namespace pocket {
+namespace terminal {
+
+static const char *const kWarningWords[] = {"warning", "warn:", "deprecated"};
+
+// 各色类的代表色，与 xterm 的 8 色相近
+static const uint32_t kClassColors[kOverviewColorClasses] = {
+    0xFF000000, 0xFF0000CD, 0xFF00CD00, 0xFF00CDCD,
+    0xFFCD0000, 0xFFCD00CD, 0xFFCDCD00, 0xFFE5E5E5,
+};
+
+ScrollbackOverview::ScrollbackOverview() { m_marks.emplace_back(); }
+
+int ScrollbackOverview::colorClass(uint32_t argb) {
+  int r = (argb >> 16) & 0xFF, g = (argb >> 8) & 0xFF, b = argb & 0xFF;
+  return (r >= 0x80 ? 4 : 0) | (g >= 0x80 ? 2 : 0) | (b >= 0x80 ? 1 : 0);
+}
+
+bool ScrollbackOverview::looksLikeWarning(const std::string &text) {
+  std::string lower(text);
+  for (char &c : lower) {
+    if ((unsigned char)c < 0x80)
+      c = std::tolower((unsigned char)c);
+  }
+  return looksLikeWarningLower(lower);
+}
+
+bool ScrollbackOverview::looksLikeWarningLower(const std::string &lower) {
+  for (const char *word : kWarningWords) {
+    if (lower.find(word) != std::string::npos)
+      return true;
+  }
+  return false;
+}
+
+void ScrollbackOverview::addLine(const LineSignature &line) {
+  m_running.lines++;
+  m_running.cells += line.cells;
+  m_running.nonBlank += line.nonBlank;
+  for (int i = 0; i < kOverviewColorClasses; ++i)
+    m_running.colors[i] += line.colorCounts[i];
+  m_running.errors += line.error;
+  m_running.warnings += line.warning;
+  m_running.prompts += line.prompt;
+
+  if (m_running.lines - m_marks.back().lines < kBucketLines)
+    return;
+  // 当前桶满，记一个边界
+  m_marks.push_back(m_running);
+  if (m_marks.size() > kMaxBuckets + 1) {
+    m_marks.pop_front();
+    m_firstLine += kBucketLines;
+  }
+}
+
+int64_t ScrollbackOverview::endLine() const {
+  return m_firstLine +
+         static_cast<int64_t>(m_running.lines - m_marks.front().lines);
+}
+
+const ScrollbackOverview::Totals &
+ScrollbackOverview::boundary(size_t index) const {
+  return index < m_marks.size() ? m_marks[index] : m_running;
+}
+
+void ScrollbackOverview::query(size_t buckets,
+                               std::vector<OverviewBucket> &out) const {
+  out.clear();
+  // 可用的桶：整桶 + 未满的桶
+  size_t full = m_marks.size() - 1;
+  size_t available = full + (m_running.lines > m_marks.back().lines ? 1 : 0);
+  size_t count = std::min(buckets, available);
+  out.reserve(count);
+
+  for (size_t i = 0; i < count; ++i) {
+    size_t a = i * available / count;
+    size_t b = (i + 1) * available / count;
+    const Totals &from = boundary(a);
+    const Totals &to = boundary(b);
+
+    OverviewBucket bucket;
+    bucket.startLine = m_firstLine + static_cast<int64_t>(a) * kBucketLines;
+    bucket.lineCount = static_cast<uint32_t>(to.lines - from.lines);
+    uint64_t cells = to.cells - from.cells;
+    uint64_t nonBlank = to.nonBlank - from.nonBlank;
+    bucket.density =
+        cells ? static_cast<float>(nonBlank) / static_cast<float>(cells) : 0;
+    bucket.dominantColor = 0;
+    uint64_t best = 0;
+    for (int c = 0; c < kOverviewColorClasses; ++c) {
+      uint64_t n = to.colors[c] - from.colors[c];
+      if (n > best) {
+        best = n;
+        bucket.dominantColor = kClassColors[c];
+      }
+    }
+    bucket.errorLines = static_cast<uint32_t>(to.errors - from.errors);
+    bucket.warningLines = static_cast<uint32_t>(to.warnings - from.warnings);
+    bucket.promptMarks = static_cast<uint32_t>(to.prompts - from.prompts);
+    out.push_back(bucket);
+  }
+}
+
+} // namespace terminal
+} // namespace pocket
@@ -0,0 +1,80 @@
+#include "scrollback_store.h"
+#include "pocket_terminal.h"
+#include <algorithm>
+
+namespace pocket {
+namespace terminal {
+
+// 样式表不到这个大小时不整理
+static const size_t kMinCompactStyles = 4096;
+
+ScrollbackStore::ScrollbackStore(size_t maxLines, const ScrollbackStyle &blank)
+    : m_maxLines(maxLines), m_blank(blank), m_compactAt(kMinCompactStyles) {}
+
+uint32_t ScrollbackStore::internStyle(const ScrollbackStyle &style) {
+  auto it = m_styleIds.find(style);
+  if (it != m_styleIds.end())
+    return it->second;
+  uint32_t id = static_cast<uint32_t>(m_styles.size());
+  m_styles.push_back(style);
+  m_styleIds.emplace(style, id);
+  return id;
+}
+
+void ScrollbackStore::commitLine(uint32_t cols, uint64_t id) {
+  uint64_t end = m_cellBase + m_cells.size();
+  m_lines.push_back({m_lineStart, id, static_cast<uint32_t>(end - m_lineStart),
+                     cols});
+  m_lineStart = end;
+
+  if (m_lines.size() > m_maxLines) {
+    uint32_t length = m_lines.front().length;
+    m_lines.pop_front();
+    m_cells.erase(m_cells.begin(), m_cells.begin() + length);
+    m_cellBase += length;
+  }
+
+  if (m_styles.size() >= m_compactAt)
+    compactStyles();
+}
+
+void ScrollbackStore::compactStyles() {
+  std::vector<uint32_t> remap(m_styles.size(), UINT32_MAX);
+  std::vector<ScrollbackStyle> styles;
+  for (Cell &cell : m_cells) {
+    uint32_t &id = remap[cell.style];
+    if (id == UINT32_MAX) {
+      id = static_cast<uint32_t>(styles.size());
+      styles.push_back(m_styles[cell.style]);
+    }
+    cell.style = id;
+  }
+
+  m_styles.swap(styles);
+  m_styleIds.clear();
+  for (size_t i = 0; i < m_styles.size(); ++i)
+    m_styleIds.emplace(m_styles[i], static_cast<uint32_t>(i));
+  // 仍在使用的样式很多时放宽阈值，避免每行都整理
+  m_compactAt = std::max(kMinCompactStyles, m_styles.size() * 2);
+}
+
+void ScrollbackStore::appendLine(size_t index,
+                                 std::vector<TerminalCell> &out) const {
+  const Line &line = m_lines[index];
+  auto cell = m_cells.begin() + (line.start - m_cellBase);
+  for (uint32_t i = 0; i < line.length; ++i, ++cell) {
+    const ScrollbackStyle &style = m_styles[cell->style];
+    out.push_back({cell->ch, style.fg, style.bg, style.flags});
+  }
+  out.resize(out.size() + (line.cols - line.length),
+             {0, m_blank.fg, m_blank.bg, m_blank.flags});
+}
+
+size_t ScrollbackStore::memoryBytes() const {
+  // 哈希表每项按节点加桶指针粗略估计
+  return m_cells.size() * sizeof(Cell) + m_lines.size() * sizeof(Line) +
+         m_styles.size() * (sizeof(ScrollbackStyle) * 2 + 32);
+}
+
+} // namespace terminal
+} // namespace pocket
@@ -0,0 +1,53 @@
+#include "session_registry.h"
+#include "pocket_terminal.h"
+#include <algorithm>
+
+namespace pocket {
+namespace terminal {
+
+SessionRegistry &SessionRegistry::instance() {
+  static SessionRegistry registry;
+  return registry;
+}
+
+uint32_t SessionRegistry::add(std::shared_ptr<PocketTerminal> terminal) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  uint32_t id = m_nextId++;
+  m_sessions.emplace(id, std::move(terminal));
+  return id;
+}
+
+std::shared_ptr<PocketTerminal> SessionRegistry::find(uint32_t id) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_sessions.find(id);
+  return it == m_sessions.end() ? nullptr : it->second;
+}
+
+bool SessionRegistry::remove(uint32_t id) {
+  std::shared_ptr<PocketTerminal> released;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_sessions.find(id);
+    if (it == m_sessions.end())
+      return false;
+    released = std::move(it->second);
+    m_sessions.erase(it);
+  }
+  // 析构 (停 PTY、等线程) 放在锁外，不挡其他会话的查找
+  return true;
+}
+
+std::vector<uint32_t> SessionRegistry::ids() const {
+  std::vector<uint32_t> out;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    out.reserve(m_sessions.size());
+    for (const auto &entry : m_sessions)
+      out.push_back(entry.first);
+  }
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+} // namespace terminal
+} // namespace pocket
@@ -0,0 +1,299 @@
+#include "stream_codec.h"
+#include <algorithm>
+#include <cstring>
+
+namespace pocket {
+namespace terminal {
+
+// 常用的放在后面：编码端先把字典插入哈希表，链头是最后一次出现
+const char kStreamDictionary[] =
+    "\x1b]0;\x07\x1b]2;\x07\x1b]133;A\x07\x1b]133;B\x07\x1b]133;C\x07"
+    "\x1b]133;D;0\x07\x1b[?1049h\x1b[?1049l\x1b[?2004h\x1b[?2004l"
+    "\x1b[?1h\x1b=\x1b[?1l\x1b>\x1b[?7h\x1b[?12l\x1b[?25h\x1b[?25l"
+    "\x1b[?1000h\x1b[?1006h\x1b(B\x1b)0\x1b[r\x1b[1;1H\x1b[2J\x1b[3J\x1b[J"
+    "\x1b[1K\x1b[2K\x1b[0K\x1b[A\x1b[B\x1b[C\x1b[D\x1b[1A\x1b[1B\x1b[1C"
+    "\x1b[1D\x1b[22;0;0t\x1b[23;0;0t\x1b[6n\x1b[c"
+    "\x1b[38;5;\x1b[48;5;\x1b[38;2;\x1b[48;2;\x1b[1;38;5;\x1b[0;38;5;"
+    "\x1b[30m\x1b[31m\x1b[32m\x1b[33m\x1b[34m\x1b[35m\x1b[36m\x1b[37m"
+    "\x1b[40m\x1b[41m\x1b[42m\x1b[43m\x1b[44m\x1b[45m\x1b[46m\x1b[47m"
+    "\x1b[90m\x1b[91m\x1b[92m\x1b[93m\x1b[94m\x1b[95m\x1b[96m\x1b[97m"
+    "\x1b[1;30m\x1b[1;31m\x1b[1;32m\x1b[1;33m\x1b[1;34m\x1b[1;35m\x1b[1;36m"
+    "\x1b[1;37m\x1b[0;31m\x1b[0;32m\x1b[0;33m\x1b[0;34m\x1b[0;36m"
+    "\x1b[01;31m\x1b[01;32m\x1b[01;34m\x1b[01;36m\x1b[01;35m\x1b[40;33;01m"
+    "\x1b[2m\x1b[3m\x1b[4m\x1b[5m\x1b[7m\x1b[22m\x1b[23m\x1b[24m\x1b[27m"
+    "\x1b[39m\x1b[49m\x1b[39;49m\x1b[1m\x1b[m\x1b[0m\x1b[K\x1b[H"
+    "warning: error: Error: ERROR WARN INFO DEBUG failed Traceback "
+    "(most recent call last):\r\n  File \"\", line "
+    "npm ERR! [==========          ] 100%|"
+    "----------------------------------------------------------------"
+    "================================================================"
+    "root@localhost:~# ~ $ \x1b[0m\x1b[K\r\n\r\n";
+const size_t kStreamDictionarySize = sizeof(kStreamDictionary) - 1;
+
+static const char kMagic[4] = {'P', 'K', 'Z', 1};
+static const size_t kMinMatch = 4;
+static const int kHashBits = 15;
+static const size_t kChainSize = 1 << 16; // >= 窗口上限
+// 解码端保留的历史，滑动前最多攒到两倍
+static const size_t kMaxWindow = 65535;
+// 单个匹配的长度上限，防止损坏的流展开成巨大的输出
+static const size_t kMaxMatchLength = 1 << 24;
+
+static uint32_t read32(const uint8_t *p) {
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static uint32_t hash4(const uint8_t *p) {
+  return (read32(p) * 2654435761u) >> (32 - kHashBits);
+}
+
+static void appendLength(size_t length, std::string &out) {
+  while (length >= 255) {
+    out += static_cast<char>(255);
+    length -= 255;
+  }
+  out += static_cast<char>(length);
+}
+
+// ============== 压缩 ==============
+
+StreamCompressor::StreamCompressor(const StreamCodecOptions &options)
+    : m_options(options), m_head(size_t(1) << kHashBits, 0),
+      m_chain(kChainSize, 0) {
+  m_options.windowBytes =
+      std::min(std::max<size_t>(m_options.windowBytes, 1024), kMaxWindow);
+  m_options.blockBytes = std::max<size_t>(m_options.blockBytes, 1);
+  m_options.searchDepth = std::max(m_options.searchDepth, 1);
+
+  m_history.reserve(2 * m_options.windowBytes + m_options.blockBytes);
+  m_history.assign(kStreamDictionary,
+                   kStreamDictionary + kStreamDictionarySize);
+  for (size_t pos = 0; pos + kMinMatch <= m_history.size(); ++pos)
+    insertHash(pos);
+  m_encoded = m_history.size();
+}
+
+void StreamCompressor::insertHash(size_t pos) {
+  uint32_t h = hash4(&m_history[pos]);
+  uint32_t abs = m_base + static_cast<uint32_t>(pos);
+  m_chain[abs & (kChainSize - 1)] = m_head[h];
+  m_head[h] = abs + 1;
+}
+
+void StreamCompressor::write(const char *data, size_t len,
+                             std::string &out) {
+  m_bytesIn += len;
+  while (len > 0) {
+    size_t take = std::min(len, m_options.blockBytes - m_pending);
+    m_history.insert(m_history.end(), reinterpret_cast<const uint8_t *>(data),
+                     reinterpret_cast<const uint8_t *>(data) + take);
+    m_pending += take;
+    data += take;
+    len -= take;
+    if (m_pending == m_options.blockBytes)
+      encode(m_history.size(), out);
+  }
+}
+
+void StreamCompressor::flush(std::string &out) {
+  if (m_pending > 0)
+    encode(m_history.size(), out);
+}
+
+void StreamCompressor::encode(size_t end, std::string &out) {
+  size_t before = out.size();
+  if (!m_headerWritten) {
+    out.append(kMagic, sizeof(kMagic));
+    m_headerWritten = true;
+  }
+
+  const uint8_t *data = m_history.data();
+  const size_t window = m_options.windowBytes;
+  size_t pos = m_encoded;
+  size_t anchor = pos;
+  // 连续找不到匹配时加大步长，不可压缩的输入不至于逐字节查表
+  size_t misses = 0;
+  while (pos + kMinMatch <= end) {
+    size_t bestLen = 0, bestDist = 0;
+    uint32_t abs = m_base + static_cast<uint32_t>(pos);
+    uint32_t candidate = m_head[hash4(data + pos)];
+    for (int depth = m_options.searchDepth; candidate && depth > 0; --depth) {
+      uint32_t dist = abs - (candidate - 1);
+      if (dist == 0 || dist > window || dist > pos)
+        break;
+      const uint8_t *match = data + pos - dist;
+      if (read32(match) == read32(data + pos)) {
+        size_t len = kMinMatch;
+        while (pos + len < end && match[len] == data[pos + len])
+          ++len;
+        if (len > bestLen) {
+          bestLen = len;
+          bestDist = dist;
+        }
+      }
+      candidate = m_chain[(candidate - 1) & (kChainSize - 1)];
+    }
+    insertHash(pos);
+
+    if (bestLen < kMinMatch) {
+      size_t step = 1 + (++misses >> 6);
+      for (size_t i = 1; i < step && pos + i + kMinMatch <= end; ++i)
+        insertHash(pos + i);
+      pos += step;
+      continue;
+    }
+    misses = 0;
+    // 向前延伸进还没输出的字面量
+    while (pos > anchor && bestDist < pos &&
+           data[pos - 1] == data[pos - 1 - bestDist]) {
+      --pos;
+      ++bestLen;
+    }
+    emitSequence(data + anchor, pos - anchor, bestDist, bestLen, out);
+    for (size_t i = pos + 1;
+         i < pos + bestLen && i + kMinMatch <= m_history.size(); ++i)
+      insertHash(i);
+    pos += bestLen;
+    anchor = pos;
+  }
+  if (anchor < end)
+    emitSequence(data + anchor, end - anchor, 0, 0, out);
+
+  m_pending -= end - m_encoded;
+  m_encoded = end;
+  m_bytesOut += out.size() - before;
+  slide();
+}
+
+void StreamCompressor::emitSequence(const uint8_t *literals,
+                                    size_t literalLen, size_t offset,
+                                    size_t matchLen, std::string &out) {
+  size_t matchCode = offset ? matchLen - kMinMatch : 0;
+  out += static_cast<char>((std::min<size_t>(literalLen, 15) << 4) |
+                           std::min<size_t>(matchCode, 15));
+  if (literalLen >= 15)
+    appendLength(literalLen - 15, out);
+  out.append(reinterpret_cast<const char *>(literals), literalLen);
+  out += static_cast<char>(offset & 0xFF);
+  out += static_cast<char>(offset >> 8);
+  if (offset && matchCode >= 15)
+    appendLength(matchCode - 15, out);
+}
+
+// 已编码部分超过两个窗口时丢掉最旧的一个窗口；哈希表存绝对位置，不用改
+void StreamCompressor::slide() {
+  size_t window = m_options.windowBytes;
+  if (m_encoded < 2 * window)
+    return;
+  size_t cut = m_encoded - window;
+  m_history.erase(m_history.begin(), m_history.begin() + cut);
+  m_base += static_cast<uint32_t>(cut);
+  m_encoded -= cut;
+}
+
+// ============== 解压 ==============
+
+StreamDecompressor::StreamDecompressor()
+    : m_history(kStreamDictionary, kStreamDictionary + kStreamDictionarySize) {
+  m_history.reserve(2 * kMaxWindow + 4096);
+}
+
+bool StreamDecompressor::write(const char *data, size_t len,
+                               std::string &out) {
+  if (m_failed)
+    return false;
+  m_input.append(data, len);
+  if (!m_headerRead) {
+    if (m_input.size() < sizeof(kMagic))
+      return true;
+    if (std::memcmp(m_input.data(), kMagic, sizeof(kMagic)) != 0) {
+      m_failed = true;
+      return false;
+    }
+    m_consumed = sizeof(kMagic);
+    m_headerRead = true;
+  }
+  if (!decodeSequences(out)) {
+    m_failed = true;
+    return false;
+  }
+  m_input.erase(0, m_consumed);
+  m_consumed = 0;
+  return true;
+}
+
+bool StreamDecompressor::decodeSequences(std::string &out) {
+  const uint8_t *in = reinterpret_cast<const uint8_t *>(m_input.data());
+  const size_t size = m_input.size();
+
+  // 读扩展长度，数据不够时返回 false 并保持 pos 不变
+  auto readLength = [&](size_t &pos, size_t &length) {
+    size_t p = pos;
+    for (;;) {
+      if (p >= size)
+        return false;
+      uint8_t byte = in[p++];
+      length += byte;
+      if (byte != 255)
+        break;
+    }
+    pos = p;
+    return true;
+  };
+
+  while (m_consumed < size) {
+    size_t pos = m_consumed;
+    uint8_t token = in[pos++];
+    size_t literalLen = token >> 4;
+    size_t matchLen = token & 0x0F;
+    if (literalLen == 15 && !readLength(pos, literalLen))
+      return true;
+    if (size - pos < literalLen + 2)
+      return true;
+    const uint8_t *literals = in + pos;
+    pos += literalLen;
+    size_t offset = in[pos] | (static_cast<size_t>(in[pos + 1]) << 8);
+    pos += 2;
+    if (offset == 0) {
+      if (matchLen != 0)
+        return false;
+    } else {
+      if (matchLen == 15 && !readLength(pos, matchLen))
+        return true;
+      matchLen += kMinMatch;
+      if (matchLen > kMaxMatchLength)
+        return false;
+    }
+    if (offset > m_history.size() + literalLen)
+      return false;
+
+    size_t start = m_history.size();
+    m_history.insert(m_history.end(), literals, literals + literalLen);
+    if (offset) {
+      size_t from = m_history.size() - offset;
+      m_history.resize(m_history.size() + matchLen);
+      uint8_t *dst = m_history.data() + start + literalLen;
+      if (offset >= matchLen) {
+        std::memcpy(dst, m_history.data() + from, matchLen);
+      } else {
+        // 与目标重叠：逐字节复制，重复前面的片段
+        for (size_t i = 0; i < matchLen; ++i)
+          dst[i] = m_history[from + i];
+      }
+    }
+    out.append(reinterpret_cast<const char *>(m_history.data()) + start,
+               m_history.size() - start);
+    m_consumed = pos;
+
+    if (m_history.size() > 2 * kMaxWindow) {
+      m_history.erase(m_history.begin(),
+                      m_history.end() - static_cast<ptrdiff_t>(kMaxWindow));
+    }
+  }
+  return true;
+}
+
+} // namespace terminal
+} // namespace pocket
@@ -0,0 +1,199 @@
+#include "text_summary.h"
+#include <algorithm>
+#include <cctype>
+
+namespace pocket {
+namespace terminal {
+
+// 省略标记 "[... N lines omitted]" 的预留长度
+static const size_t kGapReserve = 32;
+
+static const char *const kErrorWords[] = {
+    "error",     "fail",      "fatal",     "exception",
+    "traceback", "panic",     "denied",    "not found",
+    "abort",     "cannot",    "no such file",
+    "segmentation fault",     "undefined reference",
+};
+
+// 近似相同的判断键：数字串折叠为 '0'，连续的 ASCII 符号 (进度条的
+// "[===>  ]"、分隔符等) 折叠为一个 '~'，连续空白折叠为一个空格，
+// 使进度、计数器、时间戳不同的行得到同一个键
+static std::string similarityKey(const std::string &text) {
+  std::string key;
+  key.reserve(text.size());
+  for (size_t i = 0; i < text.size(); ++i) {
+    unsigned char c = text[i];
+    char token;
+    if (std::isdigit(c))
+      token = '0';
+    else if (c == ' ' || c == '\t')
+      token = ' ';
+    else if (c < 0x80 && std::ispunct(c))
+      token = '~';
+    else {
+      key.push_back(c);
+      continue;
+    }
+    if (key.empty() || key.back() != token)
+      key.push_back(token);
+  }
+  return key;
+}
+
+// 在 UTF-8 字符边界上截断到不超过 maxBytes
+static void truncateUtf8(std::string &text, size_t maxBytes) {
+  if (text.size() <= maxBytes)
+    return;
+  size_t end = maxBytes;
+  while (end > 0 && (text[end] & 0xC0) == 0x80)
+    end--;
+  text.resize(end);
+}
+
+TextCompactor::TextCompactor(size_t maxBytes) : m_maxBytes(maxBytes) {}
+
+bool TextCompactor::looksLikeError(const std::string &text) {
+  std::string lower(text);
+  for (char &c : lower) {
+    if ((unsigned char)c < 0x80)
+      c = std::tolower((unsigned char)c);
+  }
+  return looksLikeErrorLower(lower);
+}
+
+bool TextCompactor::looksLikeErrorLower(const std::string &lower) {
+  for (const char *word : kErrorWords) {
+    if (lower.find(word) != std::string::npos)
+      return true;
+  }
+  return false;
+}
+
+void TextCompactor::addLine(const std::string &text, bool highlighted) {
+  if (text.empty()) {
+    flushRun();
+    // 空行只在两段内容之间保留一个
+    if (!m_entries.empty())
+      m_pendingBlanks++;
+    return;
+  }
+
+  bool error = highlighted || looksLikeError(text);
+  std::string key = similarityKey(text);
+  if (m_runCount > 0 && key == m_runKey) {
+    m_runCount++;
+    m_runIdentical = m_runIdentical && text == m_runFirst;
+    m_runLast = text;
+    m_runError = m_runError || error;
+    return;
+  }
+
+  flushRun();
+  if (m_pendingBlanks > 0) {
+    pushEntry(std::string(), false, m_pendingBlanks);
+    m_pendingBlanks = 0;
+  }
+  m_runKey = std::move(key);
+  m_runFirst = text;
+  m_runLast = text;
+  m_runCount = 1;
+  m_runIdentical = true;
+  m_runError = error;
+}
+
+void TextCompactor::flushRun() {
+  if (m_runCount == 0)
+    return;
+
+  if (m_runCount == 1) {
+    pushEntry(std::move(m_runFirst), m_runError, 1);
+  } else if (m_runIdentical) {
+    pushEntry(m_runFirst + " [x" + std::to_string(m_runCount) + "]",
+              m_runError, m_runCount);
+  } else {
+    pushEntry(std::move(m_runFirst), m_runError, 1);
+    if (m_runCount > 2) {
+      pushEntry("[... " + std::to_string(m_runCount - 2) + " similar lines]",
+                false, m_runCount - 2);
+    }
+    pushEntry(std::move(m_runLast), m_runError, 1);
+  }
+  m_runCount = 0;
+}
+
+void TextCompactor::pushEntry(std::string text, bool error, int lines) {
+  // 单行最多占一半预算，避免一行超长输出挤掉其它内容
+  truncateUtf8(text, m_maxBytes / 2);
+  m_totalBytes += text.size() + 1;
+  m_entries.push_back({std::move(text), error, lines});
+}
+
+std::string TextCompactor::finish() {
+  flushRun();
+
+  std::string out;
+  size_t count = m_entries.size();
+  if (m_totalBytes <= m_maxBytes) {
+    out.reserve(m_totalBytes);
+    for (const Entry &entry : m_entries) {
+      out += entry.text;
+      out += '\n';
+    }
+    return out;
+  }
+
+  // 超出预算：每个保留的条目按最坏情况多预留一个省略标记
+  std::vector<char> keep(count, 0);
+  size_t used = 0;
+  auto cost = [this](size_t i) {
+    return m_entries[i].text.size() + 1 + kGapReserve;
+  };
+
+  // 1. 错误行最多占一半预算，从新到旧
+  for (size_t i = count; i-- > 0;) {
+    if (m_entries[i].error && used + cost(i) <= m_maxBytes / 2) {
+      keep[i] = 1;
+      used += cost(i);
+    }
+  }
+  // 2. 从最新的内容往前连续保留，放不下就停
+  for (size_t i = count; i-- > 0;) {
+    if (keep[i])
+      continue;
+    if (used + cost(i) > m_maxBytes)
+      break;
+    keep[i] = 1;
+    used += cost(i);
+  }
+  // 3. 剩余空间再补更早的错误行
+  for (size_t i = count; i-- > 0;) {
+    if (!keep[i] && m_entries[i].error && used + cost(i) <= m_maxBytes) {
+      keep[i] = 1;
+      used += cost(i);
+    }
+  }
+
+  // 省略标记按原始行数计，合并过的条目代表多行
+  out.reserve(used);
+  size_t omitted = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (!keep[i]) {
+      omitted += m_entries[i].lines;
+      continue;
+    }
+    if (omitted > 0) {
+      out += "[... " + std::to_string(omitted) + " lines omitted]\n";
+      omitted = 0;
+    }
+    out += m_entries[i].text;
+    out += '\n';
+  }
+  if (omitted > 0)
+    out += "[... " + std::to_string(omitted) + " lines omitted]\n";
+
+  truncateUtf8(out, m_maxBytes);
+  return out;
+}
+
+} // namespace terminal
+} // namespace pocket
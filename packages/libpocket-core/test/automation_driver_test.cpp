@@ -0,0 +1,180 @@
+// 自动化驱动：在桩 shell 上跑声明式步骤，覆盖匹配、超时时的 failedStep、
+// expect 途中 PTY 关闭、PTY 结束后启动的脚本立即结束、
+// 同一终端上的第二个脚本被拒绝
+#include "automation_driver.h"
+#include "test_util.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace pocket::terminal;
+
+namespace {
+
+bool contains(const std::string &text, const std::string &part) {
+  return text.find(part) != std::string::npos;
+}
+
+AutomationStep send(std::string text) {
+  AutomationStep step;
+  step.kind = AutomationStep::Kind::Send;
+  step.text = std::move(text);
+  return step;
+}
+
+AutomationStep expect(std::string text, int timeoutMs, bool regex = false) {
+  AutomationStep step;
+  step.kind = AutomationStep::Kind::Expect;
+  step.text = std::move(text);
+  step.timeoutMs = timeoutMs;
+  step.regex = regex;
+  return step;
+}
+
+// completion 在读线程上调用，这里等它交回结果
+class Outcome {
+public:
+  Automation::Completion completion() {
+    return [this](AutomationResult &result) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_result = result;
+      m_done = true;
+      m_cond.notify_all();
+    };
+  }
+
+  bool wait(AutomationResult &out) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_cond.wait_for(lock, std::chrono::seconds(10),
+                         [this] { return m_done; }))
+      return false;
+    out = m_result;
+    return true;
+  }
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  bool m_done{false};
+  AutomationResult m_result;
+};
+
+bool start(PocketTerminal &term, std::vector<AutomationStep> steps,
+           Outcome &outcome) {
+  return Automation::start(
+      term,
+      [steps = std::move(steps)](Automation &automation) {
+        return runSteps(automation, steps);
+      },
+      outcome.completion());
+}
+
+// 脚本先装上再启动 PTY：装上之前读到的输出不会交给脚本，提示符可能被错过。
+// 提示符带 SGR 与 OSC 133，去掉控制序列后才是 "stub$ "；
+// 回显里有命令名，正则只能匹配到桩 shell 的输出行
+void testMatch() {
+  PocketTerminal term(24, 80);
+  Outcome outcome;
+  CHECK(start(term,
+              {expect("stub$ ", 5000), send("frobnicate\n"),
+               expect("stub: (\\w+): not found", 5000, true),
+               expect("stub$ ", 5000)},
+              outcome));
+  CHECK(term.startPty(STUB_SHELL));
+  AutomationResult result;
+  CHECK(outcome.wait(result));
+  CHECK(result.ok && result.failedStep == -1 && result.error.empty());
+  CHECK(result.matches ==
+        std::vector<std::string>({"stub$ ", "stub: frobnicate: not found",
+                                  "stub$ "}));
+  CHECK(contains(result.output, "frobnicate\nstub: frobnicate: not found\n"));
+  CHECK(!contains(result.output, "\x1b"));
+}
+
+void testTimeout() {
+  PocketTerminal term(24, 80);
+  Outcome outcome;
+  CHECK(start(term,
+              {expect("stub$ ", 5000), send("echo hi\n"),
+               expect("never printed", 200), send("echo unreachable\n")},
+              outcome));
+  CHECK(term.startPty(STUB_SHELL));
+  AutomationResult result;
+  CHECK(outcome.wait(result));
+  CHECK(!result.ok && result.failedStep == 2);
+  CHECK(result.error == "timed out waiting for \"never printed\"");
+  CHECK(result.matches.size() == 1 && result.durationMs >= 200);
+  CHECK(contains(result.output, "hi\n") &&
+        !contains(result.output, "unreachable"));
+}
+
+// shell 在 expect 等待期间退出：不等到超时，立即以 terminal closed 结束
+void testCloseMidExpect() {
+  PocketTerminal term(24, 80);
+  Outcome outcome;
+  CHECK(start(term,
+              {expect("stub$ ", 5000), send("exit\n"),
+               expect("never printed", 8000)},
+              outcome));
+  CHECK(term.startPty(STUB_SHELL));
+  AutomationResult result;
+  CHECK(outcome.wait(result));
+  CHECK(!result.ok && result.failedStep == 2);
+  CHECK(result.error == "terminal closed");
+  CHECK(result.durationMs < 8000);
+}
+
+// 读线程已退出：再没有 Tick，脚本在 start 内就以 terminal closed 结束
+void testStartAfterClose() {
+  PocketTerminal term(24, 80);
+  CHECK(term.startPty(STUB_SHELL));
+  term.writeInput("exit\n", 5);
+  for (int i = 0; i < 500 && term.isPtyRunning(); ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  CHECK(!term.isPtyRunning());
+
+  Outcome outcome;
+  CHECK(start(term, {expect("stub$ ", 5000)}, outcome));
+  AutomationResult result;
+  CHECK(outcome.wait(result));
+  CHECK(!result.ok && result.failedStep == 0);
+  CHECK(result.error == "terminal closed");
+  CHECK(result.durationMs < 5000);
+
+  // 观察者已卸载，之后的脚本同样立即结束
+  Outcome again;
+  CHECK(start(term, {expect("again", 5000)}, again));
+  CHECK(again.wait(result));
+  CHECK(result.error == "terminal closed");
+}
+
+// 脚本运行中再 start 被拒绝；前一个结束后观察者已卸载，可以再启动
+void testSecondStartRejected() {
+  PocketTerminal term(24, 80);
+  CHECK(term.startPty(STUB_SHELL));
+  Outcome first;
+  CHECK(start(term, {expect("never printed", 300)}, first));
+  Outcome second;
+  CHECK(!start(term, {expect("stub$ ", 5000)}, second));
+
+  AutomationResult result;
+  CHECK(first.wait(result));
+  CHECK(!result.ok && result.failedStep == 0);
+
+  Outcome third;
+  CHECK(start(term, {send("echo again\n"), expect("again\n", 5000)}, third));
+  CHECK(third.wait(result));
+  CHECK(result.ok);
+}
+
+} // namespace
+
+int main() {
+  testMatch();
+  testTimeout();
+  testCloseMidExpect();
+  testStartAfterClose();
+  testSecondStartRejected();
+  return pocket::test::finish("automation_driver");
+}
@@ -0,0 +1,22 @@
+// automation_driver_test 用的桩 shell：带颜色的提示符，支持 echo / exit，
+// 其余命令报 not found。输出固定，不依赖系统 shell 的 profile 与提示符
+#include <cstdio>
+#include <cstring>
+
+int main() {
+  char line[1024];
+  for (;;) {
+    std::fputs("\x1b]133;A\x07\x1b[1;32mstub\x1b[0m$ ", stdout);
+    std::fflush(stdout);
+    if (!std::fgets(line, sizeof(line), stdin))
+      return 0;
+    line[std::strcspn(line, "\r\n")] = '\0';
+
+    if (std::strcmp(line, "exit") == 0)
+      return 0;
+    if (std::strncmp(line, "echo ", 5) == 0)
+      std::printf("%s\n", line + 5);
+    else if (line[0] != '\0')
+      std::printf("stub: %s: not found\n", line);
+  }
+}
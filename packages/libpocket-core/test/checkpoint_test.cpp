@@ -0,0 +1,258 @@
+// checkpoint / restore：快照恢复到另一个终端后，继续喂相同的字节，
+// 两边的屏幕、光标与再次快照都应完全一致
+#include "pocket_terminal.h"
+#include "test_util.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace pocket::terminal;
+
+namespace {
+
+std::vector<TerminalCell> screenOf(PocketTerminal &term) {
+  std::vector<TerminalCell> cells(term.getRows() * term.getCols());
+  term.copyBufferOut(cells.data(), cells.size() * sizeof(TerminalCell));
+  return cells;
+}
+
+bool sameCells(const std::vector<TerminalCell> &a,
+               const std::vector<TerminalCell> &b) {
+  return a.size() == b.size() &&
+         std::memcmp(a.data(), b.data(), a.size() * sizeof(TerminalCell)) == 0;
+}
+
+bool sameScreen(PocketTerminal &a, PocketTerminal &b) {
+  return a.getRows() == b.getRows() && a.getCols() == b.getCols() &&
+         a.getCursorX() == b.getCursorX() &&
+         a.getCursorY() == b.getCursorY() && sameCells(screenOf(a), screenOf(b));
+}
+
+void feed(PocketTerminal &term, const std::string &bytes) {
+  term.writeInput(bytes.data(), bytes.size());
+}
+
+// 把大部分状态都改一遍，最后停在一个 CSI 与一个 UTF-8 序列的中间
+const char kSetup[] =
+    "primary \x1b[38;5;196mindexed\x1b[0m \x1b[38;2;1;2;3;48;5;17mrgb\x1b[0m\r\n"
+    "\x1b[3g\x1b[5G\x1bH\x1b[13G\x1bH"         // 只在第 5、13 列设制表位
+    "\x1b[?1049h\x1b[2J\x1b[H"                 // 进入备用屏幕
+    "\x1b[4;10r"                               // 滚动区 4..10
+    "\x1b[6;3H\x1b[1;4;7msaved\x1b" "7"        // 保存光标与画笔
+    "\x1b(0lqqk\x1b(B"                         // DEC 线条字符集
+    "\x1b[?25l\x1b[?2004h\x1b#6"               // 隐藏光标、括号粘贴、倍宽行
+    "e\xcc\x81 "                               // 组合字符
+    "\x1b[3";                                  // 未完成的 CSI
+
+const char kContinue[] =
+    "1mred\x1b[0m \xe4\xb8"                    // 结束 CSI，再停在 UTF-8 中间
+    "\xad\tT\tT\r\n\x1b(0x\x1b(B"
+    "\x1b[9;1H\n\n\n\nscrolled"
+    "\x1b""8after-restore"
+    "\x1b[?1049lback on primary";
+
+void testRoundTrip() {
+  PocketTerminal a(24, 80);
+  feed(a, kSetup);
+  std::vector<uint8_t> blob;
+  a.checkpoint(blob);
+  CHECK(!blob.empty());
+
+  // 尺寸不同的终端会被调整为快照的尺寸
+  PocketTerminal b(10, 20);
+  feed(b, "noise that must disappear");
+  CHECK(b.restore(blob.data(), blob.size()));
+  CHECK(b.getRows() == 24 && b.getCols() == 80);
+  CHECK(sameScreen(a, b));
+
+  std::vector<uint8_t> again;
+  b.checkpoint(again);
+  CHECK(again == blob);
+
+  feed(a, kContinue);
+  feed(b, kContinue);
+  CHECK(sameScreen(a, b));
+
+  a.checkpoint(blob);
+  b.checkpoint(again);
+  CHECK(again == blob);
+}
+
+void testRejectsBadBlob() {
+  PocketTerminal a(24, 80);
+  feed(a, kSetup);
+  std::vector<uint8_t> blob;
+  a.checkpoint(blob);
+
+  PocketTerminal b(24, 80);
+  feed(b, "untouched");
+  auto before = screenOf(b);
+
+  std::vector<uint8_t> corrupt = blob;
+  corrupt[corrupt.size() / 2] ^= 0x40;
+  CHECK(!b.restore(corrupt.data(), corrupt.size()));
+  CHECK(!b.restore(blob.data(), blob.size() - 1));
+  CHECK(!b.restore(blob.data(), 8));
+  CHECK(sameCells(screenOf(b), before));
+}
+
+// 快照尺寸与终端不同且负载损坏：校验先于调整尺寸，终端原样不动
+void testRejectsBadBlobOfOtherSize() {
+  PocketTerminal a(24, 80);
+  feed(a, kSetup);
+  std::vector<uint8_t> blob;
+  a.checkpoint(blob);
+
+  PocketTerminal b(10, 20);
+  feed(b, "untouched\r\n\x1b[31mred\x1b[0m");
+  auto before = screenOf(b);
+  std::vector<uint8_t> state, after;
+  b.checkpoint(state);
+
+  std::vector<uint8_t> corrupt = blob;
+  corrupt[corrupt.size() - 3] ^= 0x01;
+  CHECK(!b.restore(corrupt.data(), corrupt.size()));
+  CHECK(!b.restore(blob.data(), blob.size() - 1));
+  CHECK(b.getRows() == 10 && b.getCols() == 20);
+  CHECK(b.getCursorX() == 3 && b.getCursorY() == 1);
+  CHECK(sameCells(screenOf(b), before));
+  b.checkpoint(after);
+  CHECK(after == state);
+}
+
+// 与 libvterm 的校验和相同：负载上按 64 位字做 FNV-1a
+uint32_t checksum(const uint8_t *bytes, size_t len) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, bytes + i, 8);
+    hash = (hash ^ word) * 0x100000001b3ULL;
+  }
+  for (; i < len; i++)
+    hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+  return static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+// 改写负载中的一个 int32 字段并重算校验和：只有范围检查能拦住
+std::vector<uint8_t> forge(std::vector<uint8_t> blob, size_t offset,
+                           int32_t value) {
+  const size_t kHeader = 7 * sizeof(uint32_t);
+  std::memcpy(&blob[offset], &value, sizeof(value));
+  uint32_t sum = checksum(blob.data() + kHeader, blob.size() - kHeader);
+  std::memcpy(&blob[6 * sizeof(uint32_t)], &sum, sizeof(sum));
+  return blob;
+}
+
+int32_t intAt(const std::vector<uint8_t> &blob, size_t offset) {
+  int32_t value;
+  std::memcpy(&value, &blob[offset], sizeof(value));
+  return value;
+}
+
+// 状态段开头依次是 rows、cols、光标行列、at_phantom 与滚动区上下左右
+size_t stateOffset(const std::vector<uint8_t> &blob, int rows, int cols,
+                   int top, int bottom) {
+  for (size_t i = 7 * sizeof(uint32_t); i + 9 * 4 <= blob.size(); i += 4) {
+    if (intAt(blob, i) == rows && intAt(blob, i + 4) == cols &&
+        intAt(blob, i + 20) == top && intAt(blob, i + 24) == bottom)
+      return i;
+  }
+  return 0;
+}
+
+// 校验和对得上、字段越界的快照被拒绝，终端原样不动 (不调整尺寸、不重置)
+void testRejectsForgedFields() {
+  PocketTerminal a(24, 80);
+  feed(a, kSetup);
+  std::vector<uint8_t> blob;
+  a.checkpoint(blob);
+  size_t state = stateOffset(blob, 24, 80, 3, 10);
+  CHECK(state != 0);
+  if (state == 0)
+    return;
+  const size_t top = state + 20, bottom = state + 24, left = state + 28,
+               right = state + 32;
+
+  PocketTerminal b(10, 20);
+  feed(b, "untouched\r\n\x1b[31mred\x1b[0m");
+  auto before = screenOf(b);
+
+  // 只改校验和之外的字段时校验和不符；重算后才轮到范围检查
+  std::vector<uint8_t> unsummed = blob;
+  std::memcpy(&unsummed[top], "\xce\xff\xff\xff", 4);
+  CHECK(!b.restore(unsummed.data(), unsummed.size()));
+
+  const std::vector<uint8_t> forged[] = {
+      forge(blob, top, -50),     forge(blob, top, 24),
+      forge(blob, bottom, 1000), forge(blob, bottom, -2),
+      forge(blob, bottom, 3),    forge(forge(blob, top, 8), bottom, 5),
+      forge(blob, left, -1),     forge(blob, right, 81),
+      forge(blob, state + 8, 24), forge(blob, state + 12, -1),
+  };
+  for (const std::vector<uint8_t> &bad : forged) {
+    CHECK(!b.restore(bad.data(), bad.size()));
+    CHECK(b.getRows() == 10 && b.getCols() == 20);
+    CHECK(sameCells(screenOf(b), before));
+  }
+
+  // 重算校验和本身不影响合法的快照
+  std::vector<uint8_t> same = forge(blob, top, 3);
+  CHECK(same == blob && b.restore(same.data(), same.size()));
+  feed(b, "\x1b[L\x1b[M");
+}
+
+// 缩小后放不下的滚动区与保存的光标被收进屏幕：活的终端的快照总能恢复
+void testShrunkStateRestores() {
+  PocketTerminal a(24, 80);
+  feed(a, "\x1b[20;24r\x1b[22;70H\x1b" "7\x1b[?69h\x1b[60;75s");
+  a.resize(10, 40);
+  std::vector<uint8_t> blob;
+  a.checkpoint(blob);
+
+  PocketTerminal b(24, 80);
+  CHECK(b.restore(blob.data(), blob.size()));
+  CHECK(b.getRows() == 10 && b.getCols() == 40);
+  feed(a, "\x1b" "8x\x1b[L\x1b[M\r\n\r\n");
+  feed(b, "\x1b" "8x\x1b[L\x1b[M\r\n\r\n");
+  CHECK(sameScreen(a, b));
+}
+
+void testTiming() {
+  PocketTerminal term(60, 200);
+  std::string text;
+  for (int i = 0; i < 200; ++i)
+    text += "\x1b[3" + std::to_string(i % 8) + "mline " + std::to_string(i) +
+            " some text to fill the row\r\n";
+  feed(term, text);
+
+  std::vector<uint8_t> blob;
+  term.checkpoint(blob);
+  const int kRounds = 200;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < kRounds; ++i)
+    term.checkpoint(blob);
+  auto t1 = std::chrono::steady_clock::now();
+  for (int i = 0; i < kRounds; ++i)
+    term.restore(blob.data(), blob.size());
+  auto t2 = std::chrono::steady_clock::now();
+
+  using us = std::chrono::duration<double, std::micro>;
+  std::printf("200x60: %zu bytes, checkpoint %.0f us, restore %.0f us\n",
+              blob.size(), us(t1 - t0).count() / kRounds,
+              us(t2 - t1).count() / kRounds);
+}
+
+} // namespace
+
+int main() {
+  testRoundTrip();
+  testRejectsBadBlob();
+  testRejectsBadBlobOfOtherSize();
+  testRejectsForgedFields();
+  testShrunkStateRestores();
+  testTiming();
+  return pocket::test::finish("checkpoint");
+}
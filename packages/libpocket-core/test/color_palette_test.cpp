@@ -0,0 +1,153 @@
+// 调色板：格子与历史保留颜色来源，主题切换只换表，不改任何格子
+#include "pocket_terminal.h"
+#include "test_util.h"
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+using namespace pocket::terminal;
+
+namespace {
+
+std::vector<TerminalCell> screenOf(PocketTerminal &term) {
+  std::vector<TerminalCell> cells(term.getRows() * term.getCols());
+  term.copyBufferOut(cells.data(), cells.size() * sizeof(TerminalCell));
+  return cells;
+}
+
+void feed(PocketTerminal &term, const std::string &bytes) {
+  term.writeInput(bytes.data(), bytes.size());
+}
+
+const char kColored[] = "\x1b[31mred\x1b[0m \x1b[38;5;200mx\x1b[0m "
+                        "\x1b[38;2;1;2;3;48;5;17mrgb\x1b[0m plain\r\n";
+
+// 默认色、256 色与直接 RGB 各自的编码
+void testCellEncoding() {
+  PocketTerminal term(4, 30);
+  feed(term, kColored);
+  std::vector<TerminalCell> cells = screenOf(term);
+  CHECK(cells[0].ch == 'r' && cells[0].fg == (kColorIndexed | 1));
+  CHECK(cells[0].bg == kColorDefaultBg);
+  CHECK(cells[4].ch == 'x' && cells[4].fg == (kColorIndexed | 200));
+  CHECK(cells[6].ch == 'r' && cells[6].fg == 0xFF010203u);
+  CHECK(cells[6].bg == (kColorIndexed | 17));
+  CHECK(cells[10].ch == 'p' && cells[10].fg == kColorDefaultFg);
+
+  ColorPalette palette;
+  term.copyPaletteOut(palette);
+  CHECK(palette.resolve(cells[0].fg) == 0xFFE00000u);
+  CHECK(palette.resolve(cells[10].fg) == 0xFFFFFFFFu);
+  CHECK(palette.resolve(cells[10].bg) == 0xFF000000u);
+  CHECK(palette.resolve(cells[6].fg) == 0xFF010203u);
+}
+
+// 主题切换：版本号递增、表更新，屏幕与历史的格子逐字节不变
+void testThemeSwitch() {
+  PocketTerminal term(4, 30);
+  for (int i = 0; i < 6; ++i)
+    feed(term, kColored);
+  std::vector<TerminalCell> screen = screenOf(term);
+  std::vector<TerminalCell> history;
+  std::vector<int> lengths;
+  term.pullScrollback(history, lengths);
+  CHECK(!lengths.empty());
+
+  uint32_t version = term.getPaletteVersion();
+  term.setDefaultColors(0xFF202020, 0xFFF8F8F0);
+  term.setPaletteColor(1, 0xFF00AA00);
+  term.setPaletteColor(200, 0xFF123456);
+  term.setPaletteColor(256, 0xFF000000); // 越界，忽略
+  CHECK(term.getPaletteVersion() == version + 3);
+
+  ColorPalette palette;
+  CHECK(term.copyPaletteOut(palette) == version + 3);
+  CHECK(palette.resolve(kColorDefaultFg) == 0xFF202020u);
+  CHECK(palette.resolve(kColorDefaultBg) == 0xFFF8F8F0u);
+  CHECK(palette.resolve(kColorIndexed | 1) == 0xFF00AA00u);
+  CHECK(palette.resolve(kColorIndexed | 200) == 0xFF123456u);
+
+  std::vector<TerminalCell> after = screenOf(term);
+  CHECK(after.size() == screen.size() &&
+        std::memcmp(after.data(), screen.data(),
+                    screen.size() * sizeof(TerminalCell)) == 0);
+
+  // 切换后推入的历史行与之前的编码相同
+  feed(term, kColored);
+  std::vector<TerminalCell> more;
+  term.pullScrollback(more, lengths);
+  CHECK(lengths.size() == 1 && more.size() == 30);
+  if (more.size() == 30 && history.size() >= 30)
+    CHECK(std::memcmp(more.data(), history.data(),
+                      30 * sizeof(TerminalCell)) == 0);
+}
+
+// 默认色与前 16 色在快照里；16 色以上的自定义颜色恢复后回到标准值
+void testCheckpointKeepsTheme() {
+  PocketTerminal term(4, 30);
+  term.setDefaultColors(0xFF202020, 0xFFF8F8F0);
+  term.setPaletteColor(2, 0xFF0000AA);
+  term.setPaletteColor(100, 0xFF123456);
+  std::vector<uint8_t> snapshot;
+  term.checkpoint(snapshot);
+
+  PocketTerminal restored(4, 30);
+  CHECK(restored.restore(snapshot.data(), snapshot.size()));
+  ColorPalette palette;
+  restored.copyPaletteOut(palette);
+  CHECK(palette.resolve(kColorDefaultFg) == 0xFF202020u);
+  CHECK(palette.resolve(kColorDefaultBg) == 0xFFF8F8F0u);
+  CHECK(palette.resolve(kColorIndexed | 2) == 0xFF0000AAu);
+  CHECK(palette.resolve(kColorIndexed | 100) != 0xFF123456u);
+}
+
+std::string writeLines(ExportFormat format, const ColorPalette &palette,
+                       const std::vector<TerminalCell> &cells) {
+  char path[] = "/tmp/color_palette_testXXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0)
+    return std::string();
+  HistoryWriter writer(fd, format, palette);
+  writer.begin();
+  writer.writeLine(cells.data(), cells.size());
+  writer.finish();
+
+  std::string out(static_cast<size_t>(writer.bytesWritten()), '\0');
+  ssize_t n = pread(fd, &out[0], out.size(), 0);
+  out.resize(n > 0 ? static_cast<size_t>(n) : 0);
+  close(fd);
+  unlink(path);
+  return out;
+}
+
+// ANSI 保留 256 色下标；HTML 按导出时的表解析
+void testExport() {
+  PocketTerminal term(4, 30);
+  feed(term, kColored);
+  term.setPaletteColor(1, 0xFF00AA00);
+  std::vector<TerminalCell> cells = screenOf(term);
+  cells.resize(30);
+  ColorPalette palette;
+  term.copyPaletteOut(palette);
+
+  std::string ansi = writeLines(ExportFormat::Ansi, palette, cells);
+  CHECK(ansi.find("\x1b[0;38;5;1mred") != std::string::npos);
+  CHECK(ansi.find(";38;5;200m") != std::string::npos);
+  CHECK(ansi.find(";38;2;1;2;3;48;5;17m") != std::string::npos);
+  CHECK(ansi.find("plain\n") != std::string::npos);
+
+  std::string html = writeLines(ExportFormat::Html, palette, cells);
+  CHECK(html.find("body{background:#000000;color:#ffffff;") !=
+        std::string::npos);
+  CHECK(html.find("color:#00aa00;\">red") != std::string::npos);
+}
+
+} // namespace
+
+int main() {
+  testCellEncoding();
+  testThemeSwitch();
+  testCheckpointKeepsTheme();
+  testExport();
+  return pocket::test::finish("color_palette");
+}
@@ -0,0 +1,150 @@
+// 延迟转换：输出随机切块写入，在随机位置取帧；每次取到的屏幕都与
+// 从头重放同样输入、只在最后转换一次的新终端一致。
+// 输入包含滚动、滚动区域、备用屏幕切换、宽字符与调整大小
+#include "pocket_terminal.h"
+#include "test_util.h"
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace pocket::terminal;
+
+namespace {
+
+// 一段输出，或者 bytes 为空时的一次 resize
+struct Step {
+  std::string bytes;
+  int rows{0};
+  int cols{0};
+};
+
+Step output(std::string bytes) { return Step{std::move(bytes), 0, 0}; }
+Step resize(int rows, int cols) { return Step{std::string(), rows, cols}; }
+
+std::vector<TerminalCell> screenOf(PocketTerminal &term) {
+  std::vector<TerminalCell> cells(term.getRows() * term.getCols());
+  term.copyBufferOut(cells.data(), cells.size() * sizeof(TerminalCell));
+  return cells;
+}
+
+bool sameCells(const std::vector<TerminalCell> &a,
+               const std::vector<TerminalCell> &b) {
+  return a.size() == b.size() &&
+         std::memcmp(a.data(), b.data(), a.size() * sizeof(TerminalCell)) == 0;
+}
+
+void feed(PocketTerminal &term, const std::string &bytes) {
+  term.writeInput(bytes.data(), bytes.size());
+}
+
+std::string numberedLines(int from, int to) {
+  std::string out;
+  for (int i = from; i < to; ++i)
+    out += "\x1b[3" + std::to_string(i % 8) + "mline " + std::to_string(i) +
+           "\x1b[0m tail\r\n";
+  return out;
+}
+
+std::vector<Step> script() {
+  return {
+      output("\x1b[1mhello\x1b[0m \x1b[38;5;200mworld\x1b[0m\r\n"),
+      output(numberedLines(0, 30)), // 滚出屏幕
+      output("\x1b[3;8r\x1b[5;1H\x1b[44minside region\x1b[0m\r\n"
+             "\x1b[3;1H\x1bM\x1bM\x1b[r"), // 滚动区域与反向换行
+      output("\x1b[10;5H中文宽字符 \x1b[7mrev\x1b[0m\x1b[10;3H\x1b[2@"
+             "\x1b[11;1Habcdef\x1b[11;2H\x1b[3P"),
+      resize(8, 30),
+      output(numberedLines(30, 45)),
+      output("\x1b[?1049h\x1b[H\x1b[2J"), // 进入备用屏幕
+      output("\x1b[2;2H\x1b[32mALT SCREEN\x1b[0m\x1b[5;1H" +
+             std::string(40, '#')),
+      resize(12, 50), // 备用屏幕中调整大小
+      output("\x1b[12;1Hbottom\r\n\x1b[1;1H\x1b[K"),
+      output("\x1b[?1049l"), // 回到主屏幕
+      output(numberedLines(45, 60) + "\x1b[2;10H\x1b[1K\x1b[6;1H\x1b[J"),
+      resize(6, 20),
+      output("done \x1b[48;2;10;20;30mrgb bg\x1b[0m"),
+      resize(10, 40),
+  };
+}
+
+// 从头重放前 count 步，最后才转换一次
+std::vector<TerminalCell> replay(const std::vector<Step> &steps,
+                                 size_t count, const std::string &partial) {
+  PocketTerminal term(10, 40);
+  for (size_t i = 0; i < count; ++i) {
+    if (steps[i].bytes.empty())
+      term.resize(steps[i].rows, steps[i].cols);
+    else
+      feed(term, steps[i].bytes);
+  }
+  feed(term, partial);
+  return screenOf(term);
+}
+
+// 各种取帧方式都会转换过期的行
+void pull(PocketTerminal &term, std::mt19937 &rng) {
+  switch (rng() % 3) {
+  case 0:
+    screenOf(term);
+    break;
+  case 1:
+    term.syncCells();
+    break;
+  default: {
+    SummaryOptions options;
+    term.exportSummary(options);
+    break;
+  }
+  }
+}
+
+void runSeed(unsigned seed) {
+  const std::vector<Step> steps = script();
+  std::mt19937 rng(seed);
+  PocketTerminal term(10, 40);
+  int compared = 0;
+
+  for (size_t i = 0; i < steps.size(); ++i) {
+    const Step &step = steps[i];
+    if (step.bytes.empty()) {
+      term.resize(step.rows, step.cols);
+      if (rng() % 2)
+        pull(term, rng);
+      continue;
+    }
+
+    size_t pos = 0;
+    while (pos < step.bytes.size()) {
+      size_t len = std::min<size_t>(1 + rng() % 24, step.bytes.size() - pos);
+      feed(term, step.bytes.substr(pos, len));
+      pos += len;
+      unsigned roll = rng() % 8;
+      if (roll == 0) {
+        // 取帧并与从头整屏转换的结果比对
+        bool same = sameCells(screenOf(term),
+                              replay(steps, i, step.bytes.substr(0, pos)));
+        if (!same)
+          std::fprintf(stderr, "seed %u: step %zu, byte %zu differs\n", seed,
+                       i, pos);
+        CHECK(same);
+        compared++;
+      } else if (roll == 1) {
+        pull(term, rng);
+      }
+    }
+  }
+
+  CHECK(sameCells(screenOf(term), replay(steps, steps.size(), "")));
+  CHECK(compared > 0);
+}
+
+} // namespace
+
+int main() {
+  for (unsigned seed = 1; seed <= 40; ++seed)
+    runSeed(seed);
+  return pocket::test::finish("deferred_conversion");
+}
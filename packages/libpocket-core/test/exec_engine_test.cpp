@@ -0,0 +1,185 @@
+// ExecEngine：有界捕获、并发运行、超时与进程树清理
+#include "exec_engine.h"
+#include "test_util.h"
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <fcntl.h>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+using namespace pocket::terminal;
+
+namespace {
+
+// 收集 completion 结果，按 id 等待
+struct Results {
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::map<uint64_t, ExecResult> done;
+
+  ExecEngine::Completion sink() {
+    return [this](ExecResult &result) {
+      std::lock_guard<std::mutex> lock(mutex);
+      done.emplace(result.id, std::move(result));
+      cv.notify_all();
+    };
+  }
+
+  ExecResult wait(uint64_t id) {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait_for(lock, std::chrono::seconds(20),
+                [&] { return done.count(id) > 0; });
+    auto it = done.find(id);
+    return it != done.end() ? it->second : ExecResult{};
+  }
+};
+
+ExecOptions shell(const std::string &command) {
+  ExecOptions options;
+  options.shell = "/bin/sh";
+  options.command = command;
+  return options;
+}
+
+void testBoundedCapture() {
+  BoundedCapture capture(4, 6);
+  capture.append("ab", 2);
+  CHECK(capture.text() == "ab");
+  capture.append("cdefgh", 6);
+  CHECK(capture.head() == "abcd");
+  CHECK(capture.tail() == "efgh");
+  CHECK(capture.droppedBytes() == 0);
+
+  // 尾部环绕
+  for (char c = 'i'; c <= 'z'; ++c)
+    capture.append(&c, 1);
+  CHECK(capture.head() == "abcd");
+  CHECK(capture.tail() == "uvwxyz");
+  CHECK(capture.totalBytes() == 26);
+  CHECK(capture.droppedBytes() == 16);
+  CHECK(capture.text() == "abcd\n[... 16 bytes dropped ...]\nuvwxyz");
+
+  // 单次写入超过尾部容量
+  capture.append("0123456789", 10);
+  CHECK(capture.tail() == "456789");
+}
+
+void testBasicRuns() {
+  ExecEngine engine;
+  Results results;
+
+  uint64_t echo = engine.start(shell("echo out; echo err >&2; exit 3"),
+                               results.sink());
+  ExecOptions cat;
+  cat.argv = {"cat"};
+  cat.stdinData = std::string(200000, 'x'); // 超过管道缓冲，需要边写边读
+  uint64_t catId = engine.start(cat, results.sink());
+  ExecOptions missing;
+  missing.argv = {"/nonexistent/tool"};
+  uint64_t missingId = engine.start(missing, results.sink());
+  ExecOptions env = shell("printf %s \"$POCKET_EXEC_TEST\"; pwd");
+  env.env = {"POCKET_EXEC_TEST=42"};
+  env.cwd = "/";
+  uint64_t envId = engine.start(env, results.sink());
+
+  ExecResult r = results.wait(echo);
+  CHECK(r.exitCode == 3);
+  CHECK(r.out.text() == "out\n");
+  CHECK(r.err.text() == "err\n");
+  CHECK(r.error.empty());
+
+  r = results.wait(catId);
+  CHECK(r.exitCode == 0);
+  CHECK(r.out.totalBytes() == 200000);
+  CHECK(r.out.head().size() == 16 * 1024);
+  CHECK(r.out.droppedBytes() == 200000 - 64 * 1024);
+
+  r = results.wait(missingId);
+  CHECK(!r.error.empty());
+  CHECK(r.exitCode == 127);
+
+  r = results.wait(envId);
+  CHECK(r.out.text() == "42/\n");
+
+  // 子进程除 0-2 外只继承测试进程本身不带 CLOEXEC 的描述符，
+  // 多出的一个是 ls 读目录用的
+  ExecOptions fds;
+  fds.argv = {"ls", "/proc/self/fd"};
+  r = results.wait(engine.start(fds, results.sink()));
+  std::istringstream lines(r.out.text());
+  int fd, foreign = 0;
+  while (lines >> fd) {
+    int flags = fcntl(fd, F_GETFD);
+    if (fd > STDERR_FILENO && (flags < 0 || (flags & FD_CLOEXEC)))
+      foreign++;
+  }
+  CHECK(foreign == 1);
+}
+
+void testConcurrent() {
+  ExecEngine engine;
+  Results results;
+  std::vector<uint64_t> ids;
+  for (int i = 0; i < 32; ++i)
+    ids.push_back(engine.start(
+        shell("sleep 0.2; echo " + std::to_string(i)), results.sink()));
+
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < 32; ++i) {
+    ExecResult r = results.wait(ids[i]);
+    CHECK(r.out.text() == std::to_string(i) + "\n");
+  }
+  // 并行执行：总耗时远小于串行的 6.4 秒
+  CHECK(std::chrono::steady_clock::now() - begin < std::chrono::seconds(4));
+  CHECK(engine.running() == 0);
+}
+
+void testTimeoutKillsTree() {
+  ExecEngine engine;
+  Results results;
+
+  // 忽略 SIGTERM 的进程树，且有一个后代离开了进程组。
+  // 超时留够 shell 启动并装上 trap 的时间，负载高时 200ms 不够。
+  // 主进程 exec 成同样忽略 SIGTERM 的 sleep：shell 用 wait 的话，后代先
+  // 被 SIGKILL 时它可能抢在自己被杀之前以 0 退出
+  ExecOptions options = shell(
+      "trap '' TERM; setsid sleep 30 & sleep 30 & echo started; exec sleep 30");
+  options.timeoutMs = 1000;
+  options.killGraceMs = 200;
+  auto begin = std::chrono::steady_clock::now();
+  uint64_t id = engine.start(options, results.sink());
+  ExecResult r = results.wait(id);
+  CHECK(r.timedOut);
+  CHECK(r.signal == SIGKILL);
+  CHECK(r.out.text() == "started\n");
+  CHECK(std::chrono::steady_clock::now() - begin < std::chrono::seconds(5));
+
+  // 主进程退出后残留的后台进程持有管道，也会被清理
+  uint64_t bg = engine.start(shell("sleep 30 & echo done"), results.sink());
+  r = results.wait(bg);
+  CHECK(r.exitCode == 0);
+  CHECK(r.out.text() == "done\n");
+
+  // exec：dash 不会把最后一条命令换成 exec，sleep 先被杀时 shell 可能
+  // 来不及收到 SIGTERM 就以 143 正常退出
+  uint64_t cancelled = engine.start(shell("exec sleep 30"), results.sink());
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  CHECK(engine.cancel(cancelled));
+  r = results.wait(cancelled);
+  CHECK(r.cancelled);
+  CHECK(r.signal == SIGTERM);
+  CHECK(!engine.cancel(12345));
+}
+
+} // namespace
+
+int main() {
+  testBoundedCapture();
+  testBasicRuns();
+  testConcurrent();
+  testTimeoutKillsTree();
+  return pocket::test::finish("exec_engine");
+}
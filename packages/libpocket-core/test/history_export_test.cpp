@@ -0,0 +1,219 @@
+// 历史导出：纯文本 / ANSI (SGR) / HTML 三种格式的内容与转义，
+// 历史与屏幕连续导出，同时发起的导出只有一个成功
+#include "pocket_terminal.h"
+#include "test_util.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace pocket::terminal;
+
+namespace {
+
+bool contains(const std::string &text, const std::string &part) {
+  return text.find(part) != std::string::npos;
+}
+
+void feed(PocketTerminal &term, const std::string &bytes) {
+  term.writeInput(bytes.data(), bytes.size());
+}
+
+std::string tempPath(const char *name) {
+  return "/tmp/history_export_test_" + std::to_string(getpid()) + "_" + name;
+}
+
+std::string readFile(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  std::ostringstream out;
+  out << in.rdbuf();
+  return out.str();
+}
+
+// 导出在后台线程上完成，等最后一次 done 回调
+class Waiter {
+public:
+  ExportCallback callback() {
+    return [this](const ExportProgress &progress) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (!progress.done)
+        return;
+      m_progress = progress;
+      m_done = true;
+      m_cond.notify_all();
+    };
+  }
+
+  bool wait(ExportProgress &out) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_cond.wait_for(lock, std::chrono::seconds(10),
+                         [this] { return m_done; }))
+      return false;
+    out = m_progress;
+    return true;
+  }
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  bool m_done{false};
+  ExportProgress m_progress;
+};
+
+std::string exportAs(PocketTerminal &term, ExportFormat format,
+                     const char *name) {
+  std::string path = tempPath(name);
+  Waiter waiter;
+  CHECK(term.exportHistory(path, format, waiter.callback()));
+  ExportProgress progress;
+  CHECK(waiter.wait(progress));
+  CHECK(progress.error.empty() && progress.linesDone == progress.linesTotal);
+  CHECK(access((path + ".part").c_str(), F_OK) != 0);
+  std::string text = readFile(path);
+  CHECK(progress.bytesWritten == text.size());
+  unlink(path.c_str());
+  return text;
+}
+
+// 3 行屏幕写 5 行：前两行进历史，导出时与屏幕连成一段
+void writeSample(PocketTerminal &term) {
+  feed(term, "first   \r\n");
+  feed(term, "\x1b[1;31mbold red\x1b[0m plain\r\n");
+  feed(term, "<a href=\"x\">&amp;</a>\r\n");
+  feed(term, "\x1b[38;2;1;2;3mrgb\x1b[0m \x1b[44m  \x1b[0m\r\n");
+  feed(term, "\x1b[4;7mlast\x1b[0m");
+}
+
+void testText() {
+  PocketTerminal term(3, 40);
+  writeSample(term);
+  CHECK(exportAs(term, ExportFormat::Text, "plain.txt") ==
+        "first\n"
+        "bold red plain\n"
+        "<a href=\"x\">&amp;</a>\n"
+        "rgb\n"
+        "last\n");
+}
+
+// 256 色写下标，直接 RGB 原样写出；带背景色的空格算内容
+void testAnsi() {
+  PocketTerminal term(3, 40);
+  writeSample(term);
+  CHECK(exportAs(term, ExportFormat::Ansi, "sgr.ans") ==
+        "first\n"
+        "\x1b[0;1;38;5;1mbold red\x1b[0m plain\n"
+        "<a href=\"x\">&amp;</a>\n"
+        "\x1b[0;38;2;1;2;3mrgb\x1b[0m \x1b[0;48;5;4m  \x1b[0m\n"
+        "\x1b[0;4;7mlast\x1b[0m\n");
+}
+
+// 文字中的 < > & 转义；颜色按导出时的主题解析，反显交换前景与背景
+void testHtml() {
+  PocketTerminal term(3, 40);
+  writeSample(term);
+  std::string html = exportAs(term, ExportFormat::Html, "page.html");
+  CHECK(html.compare(0, 15, "<!DOCTYPE html>") == 0);
+  CHECK(contains(html, "<pre>first\n"));
+  CHECK(contains(html, "&lt;a href=\"x\"&gt;&amp;amp;&lt;/a&gt;\n"));
+  CHECK(contains(html, "\">bold red</span> plain\n"));
+  CHECK(contains(html, "color:#010203;\">rgb</span>"));
+  CHECK(contains(html, "font-weight:bold;"));
+  CHECK(contains(html, "text-decoration: underline;\">last</span>\n"));
+  CHECK(html.size() > 21 &&
+        html.compare(html.size() - 21, 21, "</pre></body></html>\n") == 0);
+  CHECK(!contains(html, "<a href"));
+  CHECK(!contains(html, "\x1b"));
+}
+
+// 多个线程同时发起导出只有一个成功；第一次进度回调挡住导出线程，
+// 保证其余调用都落在导出进行期间
+void testConcurrentStart() {
+  PocketTerminal term(3, 40);
+  for (int i = 0; i < 2000; ++i)
+    feed(term, "line " + std::to_string(i) + "\r\n");
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool released = false;
+  ExportProgress final;
+  bool done = false;
+  ExportCallback callback = [&](const ExportProgress &progress) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (progress.done) {
+      final = progress;
+      done = true;
+      cond.notify_all();
+      return;
+    }
+    cond.wait(lock, [&] { return released; });
+  };
+
+  // 各线程就位后一起放行
+  const int kThreads = 8;
+  std::mutex gateMutex;
+  std::condition_variable gate;
+  int waiting = 0;
+  bool go = false;
+  std::atomic<int> succeeded{0};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([&, i] {
+      {
+        std::unique_lock<std::mutex> lock(gateMutex);
+        if (++waiting == kThreads) {
+          go = true;
+          gate.notify_all();
+        }
+        gate.wait(lock, [&] { return go; });
+      }
+      std::string path = tempPath(("race" + std::to_string(i)).c_str());
+      if (term.exportHistory(path, ExportFormat::Text, callback))
+        succeeded++;
+    });
+  }
+  for (std::thread &thread : threads)
+    thread.join();
+  CHECK(succeeded == 1);
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    released = true;
+    cond.notify_all();
+    CHECK(cond.wait_for(lock, std::chrono::seconds(10),
+                        [&] { return done; }));
+  }
+  CHECK(final.error.empty() && final.linesDone == 2000 + 1);
+  int files = 0;
+  for (int i = 0; i < kThreads; ++i) {
+    std::string path = tempPath(("race" + std::to_string(i)).c_str());
+    files += access(path.c_str(), F_OK) == 0;
+    unlink(path.c_str());
+  }
+  CHECK(files == 1);
+
+  // 结束后可以再导出；写不进的路径在回调里给出错误
+  CHECK(contains(exportAs(term, ExportFormat::Text, "again.txt"),
+                 "line 1999\n"));
+  Waiter failed;
+  CHECK(term.exportHistory("/nonexistent/dir/out.txt", ExportFormat::Text,
+                           failed.callback()));
+  ExportProgress progress;
+  CHECK(failed.wait(progress));
+  CHECK(progress.done && contains(progress.error, "open "));
+}
+
+} // namespace
+
+int main() {
+  testText();
+  testAnsi();
+  testHtml();
+  testConcurrentStart();
+  return pocket::test::finish("history_export");
+}
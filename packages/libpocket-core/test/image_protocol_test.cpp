@@ -0,0 +1,256 @@
+// 图像协议：sixel / base64 / kitty 解码对畸形与超大负载的处理，
+// 缓存按字节预算淘汰，解码结果在屏幕上的放置与覆盖
+#include "image_protocol.h"
+#include "pocket_terminal.h"
+#include "test_util.h"
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+
+using namespace pocket::terminal;
+
+namespace {
+
+std::string base64(const std::string &in) {
+  static const char *kAlphabet =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  size_t i = 0;
+  for (; i + 2 < in.size(); i += 3) {
+    uint32_t v = (uint8_t(in[i]) << 16) | (uint8_t(in[i + 1]) << 8) |
+                 uint8_t(in[i + 2]);
+    for (int shift = 18; shift >= 0; shift -= 6)
+      out += kAlphabet[(v >> shift) & 63];
+  }
+  if (i < in.size()) {
+    uint32_t v = uint8_t(in[i]) << 16;
+    if (i + 1 < in.size())
+      v |= uint8_t(in[i + 1]) << 8;
+    out += kAlphabet[(v >> 18) & 63];
+    out += kAlphabet[(v >> 12) & 63];
+    out += i + 1 < in.size() ? kAlphabet[(v >> 6) & 63] : '=';
+    out += '=';
+  }
+  return out;
+}
+
+// 只有 IHDR 尺寸有意义的 PNG 头
+std::string pngHeader(uint32_t width, uint32_t height) {
+  std::string png("\x89PNG\r\n\x1a\n\0\0\0\rIHDR", 16);
+  for (uint32_t v : {width, height})
+    for (int shift = 24; shift >= 0; shift -= 8)
+      png += static_cast<char>((v >> shift) & 0xFF);
+  return png + std::string(5, '\0');
+}
+
+KittyCommand kitty(const char *control) {
+  return parseKittyCommand(control, std::strlen(control));
+}
+
+void testSixel() {
+  // 一列红色的 6 像素，P2 = 0 时未绘制处填 0 号颜色
+  auto image = decodeSixel("", "#1;2;100;0;0~");
+  CHECK(image && image->width == 1 && image->height == 6);
+  CHECK(image && image->data[0] == 255 && image->data[1] == 0 &&
+        image->data[3] == 255);
+
+  // 第二段只画一行：P2 = 1 时上面一段的空白透明
+  image = decodeSixel("0;1", "-@");
+  CHECK(image && image->width == 1 && image->height == 7);
+  CHECK(image && image->data[3] == 0 && image->data[6 * 4 + 3] == 255);
+
+  // 重复次数与光栅尺寸都裁到上限
+  image = decodeSixel("", "!999999~");
+  CHECK(image && image->width == kMaxImageDimension && image->height == 6);
+  image = decodeSixel("", "\"1;1;999999;12~");
+  CHECK(image && image->width == kMaxImageDimension && image->height == 12);
+
+  // 反复的大重复次数累加起来超过 int：x 停在上限，之后的像素不再绘制
+  std::string repeats;
+  for (int i = 0; i < 2100; i++)
+    repeats += "!1048576~";
+  image = decodeSixel("", repeats + "~!1048576~~");
+  CHECK(image && image->width == kMaxImageDimension && image->height == 6);
+  // 换段同理：y 停在上限，画不进去
+  image = decodeSixel("", "~" + std::string(1000, '-') + "~");
+  CHECK(image && image->width == 1 && image->height == 6);
+
+  // 没画任何东西 / 只有控制字符
+  CHECK(!decodeSixel("", ""));
+  CHECK(!decodeSixel("", "$$--\r\n#3"));
+}
+
+void testBase64() {
+  std::vector<uint8_t> out;
+  CHECK(decodeBase64("aGVsbG8=", out) &&
+        std::string(out.begin(), out.end()) == "hello");
+  CHECK(decodeBase64("aGVs\r\nbG8", out) &&
+        std::string(out.begin(), out.end()) == "hello");
+  CHECK(decodeBase64("", out) && out.empty());
+  CHECK(!decodeBase64("aGV*bG8=", out));
+}
+
+void testKitty() {
+  KittyCommand cmd = kitty("a=T,f=24,s=2,v=1,i=7,c=3,r=2,q=2,m=1");
+  CHECK(cmd.action == 'T' && cmd.format == 24 && cmd.width == 2 &&
+        cmd.height == 1 && cmd.id == 7 && cmd.cols == 3 && cmd.rows == 2 &&
+        cmd.quiet == 2 && cmd.more == 1);
+
+  // RGB 补齐为 RGBA
+  auto image = decodeKitty(kitty("f=24,s=2,v=1"), base64("\1\2\3\4\5\6"));
+  CHECK(image && image->format == ImageFormat::Rgba8888);
+  CHECK(image && image->data == std::vector<uint8_t>({1, 2, 3, 255, 4, 5, 6,
+                                                      255}));
+  // 负载不够 / 尺寸超限 / 尺寸缺失
+  CHECK(!decodeKitty(kitty("f=32,s=2,v=2"), base64(std::string(15, 'x'))));
+  CHECK(!decodeKitty(kitty("f=32,s=5000,v=1"),
+                     base64(std::string(5000 * 4, 'x'))));
+  CHECK(!decodeKitty(kitty("f=32,s=-1,v=-1"), base64("xxxx")));
+  // 不支持的传输方式、压缩、格式，负载不是 base64
+  CHECK(!decodeKitty(kitty("t=f,f=24,s=1,v=1"), base64("abc")));
+  CHECK(!decodeKitty(kitty("o=z,f=24,s=1,v=1"), base64("abc")));
+  CHECK(!decodeKitty(kitty("f=99,s=1,v=1"), base64("abcd")));
+  CHECK(!decodeKitty(kitty("f=24,s=1,v=1"), "!!!!"));
+
+  // PNG 只读 IHDR；负数、零与超大尺寸都拒绝
+  image = decodeKitty(kitty("f=100"), base64(pngHeader(10, 20)));
+  CHECK(image && image->format == ImageFormat::Png && image->width == 10 &&
+        image->height == 20);
+  CHECK(!decodeKitty(kitty("f=100"), base64(pngHeader(0x80000000u, 20))));
+  CHECK(!decodeKitty(kitty("f=100"), base64(pngHeader(10, 0))));
+  CHECK(!decodeKitty(kitty("f=100"), base64(pngHeader(5000, 5000))));
+  CHECK(!decodeKitty(kitty("f=100"), base64("\x89PNG")));
+}
+
+std::unique_ptr<DecodedImage> makeImage(uint32_t id, size_t bytes) {
+  auto image = std::make_unique<DecodedImage>();
+  image->id = id;
+  image->width = 1;
+  image->height = 1;
+  image->data.resize(bytes);
+  return image;
+}
+
+void testCache() {
+  const size_t size = makeImage(0, 1000)->byteSize();
+  ImageCache cache(size * 3);
+
+  cache.insert(makeImage(1, 1000));
+  cache.insert(makeImage(2, 1000));
+  cache.insert(makeImage(3, 1000));
+  CHECK(cache.liveBytes() == size * 3);
+  CHECK(cache.find(1)); // 1 变为最近使用，2 最久未用
+
+  cache.insert(makeImage(4, 1000));
+  CHECK(!cache.find(2));
+  CHECK(cache.find(1) && cache.find(3) && cache.find(4));
+  CHECK(cache.liveBytes() == size * 3);
+
+  // 同 id 重新插入替换旧条目
+  cache.insert(makeImage(4, 1000));
+  CHECK(cache.liveBytes() == size * 3);
+
+  // 被引用的条目不淘汰，容量不够时 trim 报告失败
+  ImageRef held = cache.find(3);
+  cache.setCapacity(size);
+  CHECK(cache.find(3) && !cache.find(1) && !cache.find(4));
+  CHECK(cache.liveBytes() == size);
+  cache.setCapacity(0);
+  CHECK(!cache.trim());
+
+  // 移出缓存后仍被引用时照样计入，释放后归零
+  cache.erase(3);
+  CHECK(!cache.find(3) && cache.liveBytes() == size);
+  held.reset();
+  CHECK(cache.liveBytes() == 0);
+
+  // 单张超过容量直接拒绝
+  cache.setCapacity(size * 2);
+  CHECK(!cache.insert(makeImage(5, 3000)));
+  CHECK(cache.liveBytes() == 0);
+}
+
+void feed(PocketTerminal &term, const std::string &bytes) {
+  term.writeInput(bytes.data(), bytes.size());
+}
+
+std::string kittyApc(const std::string &control, const std::string &payload) {
+  return "\x1b_G" + control + ";" + base64(payload) + "\x1b\\";
+}
+
+// 解码在工作线程上完成，等放置数量变为 count
+std::vector<ImagePlacementInfo> waitPlacements(PocketTerminal &term,
+                                               size_t count) {
+  std::vector<ImagePlacementInfo> placements;
+  for (int i = 0; i < 400; ++i) {
+    term.getImagePlacements(placements);
+    if (placements.size() == count)
+      break;
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  return placements;
+}
+
+std::vector<TerminalCell> screenOf(PocketTerminal &term) {
+  std::vector<TerminalCell> cells(term.getRows() * term.getCols());
+  term.copyBufferOut(cells.data(), cells.size() * sizeof(TerminalCell));
+  return cells;
+}
+
+// 默认格子 10x20 像素：20x40 的图像占 2x2 格，只覆盖空白格
+void testPlacementOverlay() {
+  PocketTerminal term(4, 10);
+  feed(term, "\x1b[2;2Hx\x1b[H");
+  feed(term, kittyApc("a=T,f=24,s=20,v=40,i=7", std::string(20 * 40 * 3, 1)));
+  std::vector<ImagePlacementInfo> placements = waitPlacements(term, 1);
+  CHECK(placements.size() == 1);
+  CHECK(placements.size() == 1 && placements[0].id == 7 &&
+        placements[0].row == 0 && placements[0].col == 0 &&
+        placements[0].rows == 2 && placements[0].cols == 2);
+
+  std::vector<TerminalCell> cells = screenOf(term);
+  CHECK((cells[0].flags & kCellImage) && cells[0].ch == 7);
+  CHECK((cells[10].flags & kCellImage) && cells[10].fg == (1u << 16));
+  CHECK(!(cells[11].flags & kCellImage) && cells[11].ch == 'x');
+  CHECK(!(cells[2].flags & kCellImage));
+
+  // 客户端给的行列数裁到上限，覆盖只落在屏幕内
+  feed(term, kittyApc("a=p,i=7,r=2147483647,c=-5", ""));
+  placements = waitPlacements(term, 2);
+  CHECK(placements.size() == 2 &&
+        placements[1].rows == kMaxImageDimension && placements[1].cols == 2);
+  cells = screenOf(term);
+  CHECK((cells[3 * 10].flags & kCellImage));
+
+  // 大写 I 删除放置并释放图像，格子恢复为文字
+  feed(term, kittyApc("a=d,d=I,i=7", ""));
+  CHECK(waitPlacements(term, 0).empty() && !term.getImage(7));
+  cells = screenOf(term);
+  CHECK(!(cells[0].flags & kCellImage) && cells[11].ch == 'x');
+}
+
+// 畸形负载不放置；未给 id 的图像自动分配高半区 id
+void testMalformedAndAutoId() {
+  PocketTerminal term(4, 10);
+  feed(term, kittyApc("a=T,f=100", pngHeader(0xFFFFFFFFu, 0xFFFFFFFFu)));
+  feed(term, kittyApc("a=T,f=32,s=4096,v=4096", "short"));
+  feed(term, "\x1bP0;1q#1;2;100;0;0~\x1b\\");
+  feed(term, kittyApc("a=T,f=24,s=1,v=1", "abc"));
+  std::vector<ImagePlacementInfo> placements = waitPlacements(term, 2);
+  CHECK(placements.size() == 2);
+  CHECK(placements.size() == 2 && placements[0].id >= (1u << 31) &&
+        placements[1].id == placements[0].id + 1);
+}
+
+} // namespace
+
+int main() {
+  testSixel();
+  testBase64();
+  testKitty();
+  testCache();
+  testPlacementOverlay();
+  testMalformedAndAutoId();
+  return pocket::test::finish("image_protocol");
+}
@@ -0,0 +1,238 @@
+// InProcessTransport + 软件行规程：用一个桩 REPL 跑在运行时线程上，
+// 从 PocketTerminal 侧敲键盘，检查屏幕与运行时看到的内容
+#include "pocket_terminal.h"
+#include "test_util.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+using namespace pocket::terminal;
+
+namespace {
+
+void testRingWraparound() {
+  SpscByteRing ring(100); // 取整为 128
+  CHECK(ring.capacity() == 128);
+
+  // 两个线程搬运远大于容量的数据，校验顺序与内容
+  const size_t total = 1 << 20;
+  std::thread producer([&] {
+    char buf[97];
+    size_t sent = 0;
+    while (sent < total) {
+      size_t n = std::min(sizeof(buf), total - sent);
+      for (size_t i = 0; i < n; ++i)
+        buf[i] = static_cast<char>((sent + i) * 31);
+      size_t off = 0;
+      while (off < n) {
+        size_t written = ring.write(buf + off, n - off);
+        if (written == 0)
+          std::this_thread::yield();
+        off += written;
+      }
+      sent += n;
+    }
+  });
+
+  size_t received = 0;
+  bool ok = true;
+  char buf[61];
+  while (received < total) {
+    size_t n = ring.read(buf, sizeof(buf));
+    if (n == 0)
+      std::this_thread::yield();
+    for (size_t i = 0; i < n; ++i)
+      ok = ok && buf[i] == static_cast<char>((received + i) * 31);
+    received += n;
+  }
+  producer.join();
+  CHECK(ok);
+  CHECK(ring.readable() == 0);
+}
+
+// 桩 REPL：打印提示符，读一行回显 "got: ..."；"raw" 切到原始模式读 3 字节；
+// "size" 打印窗口尺寸；^C 打断读取时打印 KeyboardInterrupt；EOF 时退出
+void stubRepl(InProcessTransport &tty) {
+  auto print = [&tty](const std::string &s) {
+    tty.producerWrite(s.data(), s.size());
+  };
+
+  char buf[256];
+  for (;;) {
+    print(">>> ");
+    std::string line;
+    for (;;) {
+      ssize_t n = tty.producerRead(buf, sizeof(buf));
+      if (n < 0 && errno == EINTR) {
+        print("\nKeyboardInterrupt\n");
+        line.clear();
+        break;
+      }
+      if (n <= 0) {
+        print("bye\n");
+        return;
+      }
+      line.append(buf, n);
+      if (line.back() == '\n')
+        break;
+    }
+    if (line.empty())
+      continue;
+    line.pop_back();
+
+    if (line == "raw") {
+      LineMode saved = tty.mode();
+      LineMode raw = saved;
+      raw.canonical = false;
+      raw.echo = false;
+      raw.icrnl = false;
+      tty.setMode(raw);
+      std::string got;
+      while (got.size() < 3) {
+        ssize_t n = tty.producerRead(buf, 3 - got.size());
+        if (n <= 0)
+          break;
+        got.append(buf, n);
+      }
+      tty.setMode(saved);
+      char hex[32];
+      std::snprintf(hex, sizeof(hex), "raw: %02x %02x %02x\n",
+                    (unsigned char)got[0], (unsigned char)got[1],
+                    (unsigned char)got[2]);
+      print(hex);
+    } else if (line == "size") {
+      int rows, cols;
+      tty.windowSize(rows, cols);
+      print("size: " + std::to_string(rows) + "x" + std::to_string(cols) +
+            "\n");
+    } else {
+      print("got: " + line + "\n");
+    }
+  }
+}
+
+// 等运行时输出稳定后取屏幕文本
+std::string screenText(PocketTerminal &term, const char *expect) {
+  SummaryOptions options;
+  options.maxBytes = 1 << 16;
+  std::string text;
+  for (int i = 0; i < 200; ++i) {
+    term.pumpTransport();
+    text = term.exportSummary(options);
+    if (text.find(expect) != std::string::npos)
+      break;
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  return text;
+}
+
+void testStubRepl() {
+  PocketTerminal term(12, 60);
+  auto tty = std::make_shared<InProcessTransport>(1024);
+
+  std::atomic<int> interrupts{0};
+  std::atomic<int> winRows{0};
+  tty->setSignalHandler([&](int sig) {
+    if (sig == SIGINT)
+      interrupts++;
+  });
+  tty->setWindowSizeHandler([&](int rows, int) { winRows = rows; });
+
+  CHECK(term.attachTransport(tty));
+  CHECK(winRows == 12);
+
+  std::thread runtime(stubRepl, std::ref(*tty));
+
+  std::string text = screenText(term, ">>> ");
+  CHECK(text == ">>> \n" || text == ">>>\n");
+
+  // 规范模式行编辑：退格、^W、^U，回车经 ICRNL 变成换行
+  const char typed[] = "helo\x7flo wrld\x17world\r";
+  term.writeInput(typed, sizeof(typed) - 1);
+  text = screenText(term, "got: hello world");
+  CHECK(text.find(">>> hello world\ngot: hello world\n") != std::string::npos);
+
+  const char killed[] = "junk\x15ok\r";
+  term.writeInput(killed, sizeof(killed) - 1);
+  text = screenText(term, "got: ok");
+  CHECK(text.find(">>> ok\ngot: ok\n") != std::string::npos);
+
+  // ^C：回显 ^C，丢弃正在编辑的行并打断阻塞的 read
+  term.writeInput("abc\x03", 4);
+  text = screenText(term, "KeyboardInterrupt");
+  CHECK(interrupts == 1);
+  CHECK(text.find(">>> abc^C\nKeyboardInterrupt\n>>>") != std::string::npos);
+
+  // 宽字符退格回退两列
+  term.writeInput("\xe4\xb8\xad\x7f" "x\r", 6);
+  text = screenText(term, "got: x");
+  CHECK(text.find(">>> x\ngot: x\n") != std::string::npos);
+
+  // 原始模式：不回显、不转换 CR，逐字节交给运行时
+  term.writeInput("raw\r", 4);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  term.writeInput("\r\x1b" "A", 3);
+  text = screenText(term, "raw: ");
+  CHECK(text.find("raw: 0d 1b 41\n") != std::string::npos);
+
+  // 窗口尺寸变化通知
+  term.resize(14, 60);
+  CHECK(winRows == 14);
+  term.writeInput("size\r", 5);
+  text = screenText(term, "size: ");
+  CHECK(text.find("size: 14x60\n") != std::string::npos);
+
+  // 空行上的 ^D 为 EOF
+  term.writeInput("\x04", 1);
+  text = screenText(term, "bye");
+  CHECK(text.find(">>> bye\n") != std::string::npos);
+
+  runtime.join();
+  term.detachTransport();
+  CHECK(tty->closed());
+}
+
+// 运行时输出超过环容量时阻塞，直到终端侧取走
+void testOutputBackpressure() {
+  PocketTerminal term(24, 80);
+  auto tty = std::make_shared<InProcessTransport>(256);
+  std::atomic<int> ready{0};
+  tty->setOutputReadyHandler([&] { ready++; });
+  CHECK(term.attachTransport(tty));
+
+  std::thread runtime([&] {
+    for (int i = 0; i < 200; ++i) {
+      std::string line = "line " + std::to_string(i) + "\n";
+      tty->producerWrite(line.data(), line.size());
+    }
+  });
+
+  std::string text;
+  SummaryOptions options;
+  options.maxBytes = 1 << 16;
+  options.lastLines = 2;
+  for (int i = 0; i < 1000 && text.find("line 199") == std::string::npos;
+       ++i) {
+    term.pumpTransport();
+    text = term.exportSummary(options);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  runtime.join();
+  CHECK(text.find("line 199") != std::string::npos);
+  CHECK(ready > 0);
+  term.detachTransport();
+}
+
+} // namespace
+
+int main() {
+  testRingWraparound();
+  testStubRepl();
+  testOutputBackpressure();
+  return pocket::test::finish("inprocess_transport");
+}
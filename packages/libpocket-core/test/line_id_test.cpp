@@ -0,0 +1,227 @@
+// 行号：随内容滚动、进入历史不变；新出现的行用新号，任何时候都不重复；
+// 随 snapshot 一起取时与取到的行对应
+#include "inprocess_transport.h"
+#include "pocket_terminal.h"
+#include "test_util.h"
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <string>
+
+using namespace pocket::terminal;
+
+namespace {
+
+using Ids = std::vector<uint64_t>;
+
+void feed(PocketTerminal &term, const std::string &bytes) {
+  term.writeInput(bytes.data(), bytes.size());
+}
+
+Ids screenIds(PocketTerminal &term) {
+  Ids ids;
+  term.copyLineIdsOut(ids);
+  return ids;
+}
+
+Ids pullIds(PocketTerminal &term) {
+  std::vector<TerminalCell> cells;
+  std::vector<int> lengths;
+  Ids ids;
+  term.pullScrollback(cells, lengths, &ids);
+  CHECK(ids.size() == lengths.size());
+  return ids;
+}
+
+// 第 row 行的文字 (去掉行尾空白)
+std::string rowText(PocketTerminal &term, int row) {
+  std::vector<TerminalCell> cells(term.getRows() * term.getCols());
+  term.copyBufferOut(cells.data(), cells.size() * sizeof(TerminalCell));
+  std::string text;
+  for (int col = 0; col < term.getCols(); ++col) {
+    uint32_t ch = cells[row * term.getCols() + col].ch;
+    text += ch ? static_cast<char>(ch) : ' ';
+  }
+  return text.substr(0, text.find_last_not_of(' ') + 1);
+}
+
+// 屏幕滚动：行号上移一行，顶行的行号进历史，底部空出的行是新号
+void testScroll() {
+  PocketTerminal term(4, 10);
+  feed(term, "a\r\nb\r\nc\r\nd");
+  Ids before = screenIds(term);
+  CHECK(before.size() == 4);
+  CHECK(pullIds(term).empty());
+
+  feed(term, "\r\ne");
+  Ids after = screenIds(term);
+  CHECK(std::equal(before.begin() + 1, before.end(), after.begin()));
+  CHECK(after[3] > *std::max_element(before.begin(), before.end()));
+  CHECK(pullIds(term) == Ids({before[0]}));
+
+  // 原地改写不换行号
+  feed(term, "\x1b[2;1Hxyz\x1b[2;2H\x1b[2@\x1b[K");
+  CHECK(screenIds(term) == after);
+}
+
+// 大量输出后，历史与屏幕的行号全部不同，历史按推入顺序递增
+void testUniqueAcrossHistory() {
+  PocketTerminal term(5, 20);
+  Ids history;
+  for (int i = 0; i < 300; ++i) {
+    feed(term, "line " + std::to_string(i) + "\r\n");
+    if (i % 7 == 0)
+      feed(term, "\x1b[3S\x1b[5;1H"); // 一次滚动多行
+    if (i % 50 == 0) {
+      Ids pulled = pullIds(term);
+      history.insert(history.end(), pulled.begin(), pulled.end());
+    }
+  }
+  Ids pulled = pullIds(term);
+  history.insert(history.end(), pulled.begin(), pulled.end());
+  CHECK(std::is_sorted(history.begin(), history.end()));
+
+  Ids screen = screenIds(term);
+  std::set<uint64_t> all(history.begin(), history.end());
+  all.insert(screen.begin(), screen.end());
+  CHECK(all.size() == history.size() + screen.size());
+
+  // 一次滚动超过整屏：行全部进历史，屏幕上全是新号
+  Ids old = screenIds(term);
+  feed(term, "\x1b[20S");
+  CHECK(pullIds(term) == old);
+  for (uint64_t id : screenIds(term))
+    CHECK(id > *std::max_element(old.begin(), old.end()));
+}
+
+// 滚动区域与插入 / 删除行：区域外的行不动，被移动的行带着行号
+void testRegionAndInsert() {
+  PocketTerminal term(6, 10);
+  feed(term, "0\r\n1\r\n2\r\n3\r\n4\r\n5");
+  Ids ids = screenIds(term);
+
+  // 区域 2-4 行 (1 起) 内向上滚一行
+  feed(term, "\x1b[2;4r\x1b[4;1H\n\x1b[r");
+  Ids scrolled = screenIds(term);
+  CHECK(scrolled[0] == ids[0] && scrolled[4] == ids[4]);
+  CHECK(scrolled[5] == ids[5]);
+  CHECK(scrolled[1] == ids[2] && scrolled[2] == ids[3]);
+  CHECK(scrolled[3] != ids[1] && scrolled[3] != ids[3]);
+  CHECK(pullIds(term).empty()); // 区域不在顶部，不进历史
+
+  // 在第 2 行插入一行：其下的行下移，插入的是新行
+  feed(term, "\x1b[2;1H\x1b[L");
+  Ids inserted = screenIds(term);
+  CHECK(inserted[0] == scrolled[0]);
+  CHECK(inserted[2] == scrolled[1] && inserted[5] == scrolled[4]);
+  CHECK(inserted[1] > *std::max_element(scrolled.begin(), scrolled.end()));
+  CHECK(rowText(term, 2) == "2");
+
+  // 删除第 1 行
+  feed(term, "\x1b[1;1H\x1b[M");
+  Ids deleted = screenIds(term);
+  CHECK(std::equal(inserted.begin() + 1, inserted.end(), deleted.begin()));
+}
+
+// 备用屏幕是新行；退出后主屏幕的行号回来
+void testAltScreen() {
+  PocketTerminal term(4, 10);
+  feed(term, "a\r\nb");
+  Ids primary = screenIds(term);
+
+  feed(term, "\x1b[?1049h");
+  Ids alt = screenIds(term);
+  for (uint64_t id : alt)
+    CHECK(std::find(primary.begin(), primary.end(), id) == primary.end());
+  feed(term, "x\r\ny\r\nz\r\nw\r\nv"); // 备用屏幕滚动不进历史
+  CHECK(pullIds(term).empty());
+
+  feed(term, "\x1b[?1049l");
+  CHECK(screenIds(term) == primary);
+
+  feed(term, "\x1b[?1049h");
+  Ids again = screenIds(term);
+  CHECK(again != alt && again != primary);
+
+  // 在备用屏幕上恢复主屏幕的快照 (不经过回调)：之后的滚动仍从主屏幕
+  // 的行号推入历史
+  std::vector<uint8_t> snapshot;
+  PocketTerminal other(4, 10);
+  other.checkpoint(snapshot);
+  CHECK(term.restore(snapshot.data(), snapshot.size()));
+  Ids restored = screenIds(term);
+  feed(term, "\r\n\r\n\r\n\r\n");
+  CHECK(pullIds(term) == Ids({restored[0]}));
+}
+
+// 只改行数时保留的行不换号；改列数、恢复快照后全部是新号
+void testResizeAndRestore() {
+  PocketTerminal term(6, 10);
+  feed(term, "0\r\n1\r\n2\r\n3\r\n4\r\n5");
+  Ids ids = screenIds(term);
+
+  term.resize(4, 10); // 光标在底行，顶上两行进历史
+  CHECK(pullIds(term) == Ids({ids[0], ids[1]}));
+  CHECK(screenIds(term) == Ids(ids.begin() + 2, ids.end()));
+  CHECK(rowText(term, 0) == "2");
+
+  term.resize(6, 10); // 变高：原有的行不动，下面补新行
+  Ids taller = screenIds(term);
+  CHECK(std::equal(ids.begin() + 2, ids.end(), taller.begin()));
+  CHECK(taller[4] > ids[5] && taller[5] > taller[4]);
+
+  term.resize(6, 12);
+  for (uint64_t id : screenIds(term))
+    CHECK(std::find(taller.begin(), taller.end(), id) == taller.end());
+
+  std::vector<uint8_t> snapshot;
+  term.checkpoint(snapshot);
+  Ids beforeRestore = screenIds(term);
+  CHECK(term.restore(snapshot.data(), snapshot.size()));
+  for (uint64_t id : screenIds(term))
+    CHECK(id > *std::max_element(beforeRestore.begin(), beforeRestore.end()));
+}
+
+// 进程内传输的输出在取帧时才送入 VTerm：快照里的行号与格子对应，
+// 先取格子再单独取行号会拿到滚动之后的行号
+void testIdsWithCells() {
+  PocketTerminal term(4, 10);
+  auto tty = std::make_shared<InProcessTransport>(1024);
+  CHECK(term.attachTransport(tty));
+  tty->producerWrite("a\nb\nc\nd", 7);
+  Ids before = screenIds(term);
+
+  tty->producerWrite("\ne", 2);
+  ScreenSnapshot frame;
+  term.snapshot(frame);
+  CHECK(frame.rows == 4 && frame.cols == 10 && frame.cells.size() == 40);
+  CHECK(frame.lineIds.size() == 4);
+  CHECK(std::equal(before.begin() + 1, before.end(), frame.lineIds.begin()));
+  CHECK(frame.lineIds[3] > before[3]);
+  CHECK(frame.cells[0].ch == 'b' && frame.cells[3 * 10].ch == 'e');
+  CHECK(frame.lineIds == screenIds(term));
+
+  tty->producerWrite("\nf", 2);
+  std::vector<TerminalCell> cells(4 * 10);
+  term.copyBufferOut(cells.data(), cells.size() * sizeof(TerminalCell));
+  CHECK(cells[0].ch == 'c' && screenIds(term)[0] == frame.lineIds[1]);
+
+  // 尺寸随快照一起变
+  term.resize(3, 12);
+  term.snapshot(frame);
+  CHECK(frame.rows == 3 && frame.cols == 12 && frame.cells.size() == 36 &&
+        frame.lineIds.size() == 3);
+  term.detachTransport();
+}
+
+} // namespace
+
+int main() {
+  testScroll();
+  testUniqueAcrossHistory();
+  testRegionAndInsert();
+  testAltScreen();
+  testResizeAndRestore();
+  testIdsWithCells();
+  return pocket::test::finish("line_id");
+}
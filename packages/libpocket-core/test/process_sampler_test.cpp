@@ -0,0 +1,136 @@
+// 进程采样：/proc/<pid>/stat 解析 (comm 含空格与括号、负数字段)，
+// 对真实子进程树的遍历与 CPU 占用
+#include "process_sampler.h"
+#include "test_util.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace pocket::terminal;
+
+namespace {
+
+void testParse() {
+  ProcStat stat;
+  // comm 里有括号和空格；tty_nr / tpgid / cutime / priority / nice 为负
+  CHECK(parseProcStat(42,
+                      "42 (my (odd) name) R 7 40 40 -1 -1 4194304 10 0 0 0 "
+                      "15 7 -3 -4 -21 -20 3 0 100 8192 250 18446744 0 0\n",
+                      stat));
+  CHECK(stat.pid == 42 && stat.name == "my (odd) name");
+  CHECK(stat.ppid == 7 && stat.pgrp == 40);
+  CHECK(stat.ticks == 22 && stat.threads == 3 && stat.rssPages == 250);
+
+  CHECK(parseProcStat(5,
+                      "5 (a) b) S 1 5 5 0 -1 0 0 0 0 0 1 2 0 0 20 0 1 0 9 0 "
+                      "4",
+                      stat));
+  CHECK(stat.name == "a) b" && stat.ppid == 1 && stat.ticks == 3 &&
+        stat.rssPages == 4);
+
+  // 字段不全、没有括号、数字字段被截断
+  CHECK(!parseProcStat(5, "5 (x) S 1 2 3", stat));
+  CHECK(!parseProcStat(5, "5 x S 1 5 5 0 -1 0 0 0 0 0 1 2 0 0 20 0 1 0 9 0 4",
+                       stat));
+  CHECK(!parseProcStat(5, "5 (x) S 1 5 5 0 -1 0 0 0 0 0 ? 2 0 0 20 0 1 0 9 0 4",
+                       stat));
+  CHECK(!parseProcStat(5, "", stat));
+
+  CHECK(readProcStat(getpid(), stat));
+  CHECK(stat.ppid == getppid() && stat.threads >= 1 && stat.rssPages > 0);
+  CHECK(!readProcStat(-1, stat));
+}
+
+bool contains(const std::vector<ProcStat> &procs,
+              const std::vector<size_t> &indices, pid_t pid) {
+  return std::any_of(indices.begin(), indices.end(),
+                     [&](size_t i) { return procs[i].pid == pid; });
+}
+
+const ProcessUsage *findTop(const ProcessTreeStats &stats, pid_t pid) {
+  for (const ProcessUsage &usage : stats.top)
+    if (usage.pid == pid)
+      return &usage;
+  return nullptr;
+}
+
+// 本进程下：sleeper 带一个 setsid 脱离进程组的孙进程，spinner 占满一个核
+void testTree() {
+  int fds[2];
+  CHECK(pipe(fds) == 0);
+  pid_t sleeper = fork();
+  if (sleeper == 0) {
+    pid_t grandchild = fork();
+    if (grandchild == 0) {
+      setsid();
+      pause();
+      _exit(0);
+    }
+    write(fds[1], &grandchild, sizeof(grandchild));
+    pause();
+    _exit(0);
+  }
+  pid_t grandchild = -1;
+  CHECK(read(fds[0], &grandchild, sizeof(grandchild)) == sizeof(grandchild));
+  close(fds[0]);
+  close(fds[1]);
+
+  pid_t spinner = fork();
+  if (spinner == 0) {
+    volatile uint64_t x = 0;
+    for (;;)
+      x = x + 1;
+  }
+
+  std::vector<ProcStat> procs;
+  scanProcesses(procs);
+  std::vector<size_t> tree = findDescendants(procs, getpid());
+  CHECK(contains(procs, tree, sleeper) && contains(procs, tree, grandchild) &&
+        contains(procs, tree, spinner));
+  CHECK(!contains(procs, tree, getpid()));
+  CHECK(findDescendants(procs, grandchild).empty());
+
+  ProcessSampler sampler;
+  ProcessTreeStats stats;
+  sampler.sample(getpid(), -1, stats);
+  CHECK(stats.sequence == 1 && stats.processCount == 4);
+  CHECK(stats.tree.pid == getpid() && stats.foregroundPgid == -1);
+  CHECK(stats.tree.cpuPercent == 0); // 第一次采样没有基准
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  sampler.sample(getpid(), -1, stats);
+  CHECK(stats.sequence == 2 && stats.processCount == 4);
+  CHECK(!stats.top.empty() && stats.top[0].pid == spinner);
+  CHECK(findTop(stats, spinner) && findTop(stats, spinner)->cpuPercent > 10);
+  CHECK(findTop(stats, grandchild) &&
+        findTop(stats, grandchild)->cpuPercent < 5);
+  CHECK(stats.tree.threads >= 4 && stats.tree.rssBytes > 0);
+
+  // reset 后重新建立基准
+  sampler.reset();
+  sampler.sample(getpid(), -1, stats);
+  CHECK(stats.tree.cpuPercent == 0);
+
+  kill(grandchild, SIGKILL);
+  kill(sleeper, SIGKILL);
+  kill(spinner, SIGKILL);
+  waitpid(sleeper, nullptr, 0);
+  waitpid(spinner, nullptr, 0);
+  sampler.sample(getpid(), -1, stats);
+  CHECK(stats.processCount == 1 && stats.top.size() == 1);
+
+  // 根进程不存在时什么都不统计
+  sampler.sample(spinner, -1, stats);
+  CHECK(stats.processCount == 0 && stats.top.empty());
+}
+
+} // namespace
+
+int main() {
+  testParse();
+  testTree();
+  return pocket::test::finish("process_sampler");
+}
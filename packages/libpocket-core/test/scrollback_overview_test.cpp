@@ -0,0 +1,168 @@
+// 历史概览：query 按桶均分、最后未满的桶、超过 kMaxBuckets 后丢弃最旧的桶
+// (m_firstLine 前移)，每格的统计与逐行累加的结果一致
+#include "scrollback_overview.h"
+#include "test_util.h"
+#include <vector>
+
+using namespace pocket::terminal;
+
+namespace {
+
+constexpr int kBucket = ScrollbackOverview::kBucketLines;
+
+// 第 i 行的特征只由 i 决定，便于逐行重算
+LineSignature lineAt(int64_t i) {
+  LineSignature line;
+  line.cells = 80;
+  line.nonBlank = static_cast<uint32_t>(i % 81);
+  line.colorCounts[(i / 7) % kOverviewColorClasses] = line.nonBlank;
+  line.error = i % 97 == 0;
+  line.warning = i % 89 == 0;
+  line.prompt = i % kBucket == 5;
+  return line;
+}
+
+// 逐行累加 [start, start + count) 的统计
+OverviewBucket expected(int64_t start, uint32_t count) {
+  static const uint32_t kColors[kOverviewColorClasses] = {
+      0xFF000000, 0xFF0000CD, 0xFF00CD00, 0xFF00CDCD,
+      0xFFCD0000, 0xFFCD00CD, 0xFFCDCD00, 0xFFE5E5E5,
+  };
+  OverviewBucket bucket{start, count, 0, 0, 0, 0, 0};
+  uint64_t cells = 0, nonBlank = 0;
+  uint64_t colors[kOverviewColorClasses] = {};
+  for (int64_t i = start; i < start + count; ++i) {
+    LineSignature line = lineAt(i);
+    cells += line.cells;
+    nonBlank += line.nonBlank;
+    for (int c = 0; c < kOverviewColorClasses; ++c)
+      colors[c] += line.colorCounts[c];
+    bucket.errorLines += line.error;
+    bucket.warningLines += line.warning;
+    bucket.promptMarks += line.prompt;
+  }
+  bucket.density =
+      cells ? static_cast<float>(nonBlank) / static_cast<float>(cells) : 0;
+  uint64_t best = 0;
+  for (int c = 0; c < kOverviewColorClasses; ++c) {
+    if (colors[c] > best) {
+      best = colors[c];
+      bucket.dominantColor = kColors[c];
+    }
+  }
+  return bucket;
+}
+
+bool matches(const OverviewBucket &got) {
+  OverviewBucket want = expected(got.startLine, got.lineCount);
+  return got.density == want.density &&
+         got.dominantColor == want.dominantColor &&
+         got.errorLines == want.errorLines &&
+         got.warningLines == want.warningLines &&
+         got.promptMarks == want.promptMarks;
+}
+
+void fill(ScrollbackOverview &overview, int64_t lines) {
+  for (int64_t i = overview.endLine(); i < lines; ++i)
+    overview.addLine(lineAt(i));
+}
+
+void testEmpty() {
+  ScrollbackOverview overview;
+  std::vector<OverviewBucket> out(3);
+  overview.query(16, out);
+  CHECK(out.empty());
+  CHECK(overview.firstLine() == 0 && overview.endLine() == 0);
+
+  fill(overview, 1);
+  overview.query(0, out);
+  CHECK(out.empty());
+  overview.query(16, out);
+  CHECK(out.size() == 1 && out[0].startLine == 0 && out[0].lineCount == 1);
+}
+
+// 10 个整桶加 20 行：共 11 个可用桶，按 a = i * 11 / n 均分
+void testSlicing() {
+  ScrollbackOverview overview;
+  fill(overview, 10 * kBucket + 20);
+  CHECK(overview.endLine() == 10 * kBucket + 20);
+
+  std::vector<OverviewBucket> out;
+  overview.query(4, out);
+  CHECK(out.size() == 4);
+  const int64_t starts[] = {0, 2 * kBucket, 5 * kBucket, 8 * kBucket};
+  const uint32_t counts[] = {2 * kBucket, 3 * kBucket, 3 * kBucket,
+                             2 * kBucket + 20};
+  for (size_t i = 0; i < out.size() && i < 4; ++i) {
+    CHECK(out[i].startLine == starts[i] && out[i].lineCount == counts[i]);
+    CHECK(matches(out[i]));
+  }
+
+  // 格数多于可用桶：每格一个桶，最后一格是未满的 20 行
+  overview.query(100, out);
+  CHECK(out.size() == 11);
+  for (size_t i = 0; i < out.size(); ++i) {
+    CHECK(out[i].startLine == static_cast<int64_t>(i) * kBucket);
+    CHECK(out[i].lineCount == (i == 10 ? 20u : uint32_t(kBucket)));
+    CHECK(matches(out[i]));
+  }
+
+  // 一格覆盖全部
+  overview.query(1, out);
+  CHECK(out.size() == 1 && out[0].startLine == 0 &&
+        out[0].lineCount == 10 * kBucket + 20 && matches(out[0]));
+
+  // 恰好填满一个桶时没有未满的桶
+  fill(overview, 11 * kBucket);
+  overview.query(100, out);
+  CHECK(out.size() == 11 && out.back().lineCount == uint32_t(kBucket));
+}
+
+// 超出 kMaxBuckets 个整桶后丢弃最旧的桶，起始行随之前移
+void testEviction() {
+  const int64_t maxBuckets = ScrollbackOverview::kMaxBuckets;
+  ScrollbackOverview overview;
+  fill(overview, maxBuckets * kBucket);
+  CHECK(overview.firstLine() == 0);
+
+  fill(overview, (maxBuckets + 3) * kBucket + 10);
+  CHECK(overview.firstLine() == 3 * kBucket);
+  CHECK(overview.endLine() == (maxBuckets + 3) * kBucket + 10);
+
+  std::vector<OverviewBucket> out;
+  overview.query(maxBuckets + 10, out);
+  CHECK(out.size() == static_cast<size_t>(maxBuckets) + 1);
+  CHECK(out.front().startLine == 3 * kBucket && matches(out.front()));
+  CHECK(out.back().startLine == (maxBuckets + 3) * kBucket &&
+        out.back().lineCount == 10 && matches(out.back()));
+
+  overview.query(1, out);
+  CHECK(out.size() == 1 && out[0].startLine == 3 * kBucket &&
+        out[0].lineCount == maxBuckets * kBucket + 10 && matches(out[0]));
+
+  overview.query(7, out);
+  int64_t next = overview.firstLine();
+  for (const OverviewBucket &bucket : out) {
+    CHECK(bucket.startLine == next && matches(bucket));
+    next += bucket.lineCount;
+  }
+  CHECK(next == overview.endLine());
+}
+
+void testClassify() {
+  CHECK(ScrollbackOverview::colorClass(0xFFCD0000) == 4);
+  CHECK(ScrollbackOverview::colorClass(0xFF7F80FF) == 3);
+  CHECK(ScrollbackOverview::looksLikeWarning("npm WARN deprecated foo"));
+  CHECK(ScrollbackOverview::looksLikeWarning("Warning: unused variable"));
+  CHECK(!ScrollbackOverview::looksLikeWarning("all good"));
+}
+
+} // namespace
+
+int main() {
+  testEmpty();
+  testSlicing();
+  testEviction();
+  testClassify();
+  return pocket::test::finish("scrollback_overview");
+}
@@ -0,0 +1,100 @@
+// 历史存储：去掉行尾空白、样式驻留后，取出的行应与屏幕上的格子完全一致
+#include "pocket_terminal.h"
+#include "test_util.h"
+#include <string>
+
+using namespace pocket::terminal;
+
+namespace {
+
+const ScrollbackStyle kBlank = {kColorDefaultFg, kColorDefaultBg, 1u << 8};
+
+bool isBlank(const TerminalCell &cell) {
+  return cell.ch == 0 && cell.fg == kBlank.fg && cell.bg == kBlank.bg &&
+         cell.flags == kBlank.flags;
+}
+
+// 推入历史的行按原行宽取出，行尾补默认空白，带背景色的擦除保留
+void testPushedRows() {
+  PocketTerminal term(4, 20);
+  std::string input = "\x1b[31mred\x1b[0m plain\r\n"
+                      "\x1b[44mblue bg\x1b[K\x1b[0m\r\n"
+                      "wide \xe4\xb8\xad!\r\n"
+                      "\r\n"
+                      "\x1b[1;4munder\x1b[0m\r\n"
+                      "x\r\ny\r\nz\r\n";
+  term.writeInput(input.data(), input.size());
+
+  std::vector<TerminalCell> cells;
+  std::vector<int> lengths;
+  term.pullScrollback(cells, lengths);
+  CHECK(lengths.size() == 5);
+  CHECK(cells.size() == lengths.size() * 20);
+  if (cells.size() != 100)
+    return;
+
+  const TerminalCell *row = cells.data();
+  CHECK(row[0].ch == 'r' && row[0].fg == (kColorIndexed | 1));
+  CHECK(row[4].ch == 'p' && row[4].fg == kBlank.fg);
+  CHECK(isBlank(row[9]) && isBlank(row[19]));
+
+  row += 20;
+  CHECK(row[0].ch == 'b' && row[0].bg == (kColorIndexed | 4));
+  CHECK(row[19].ch == 0 && row[19].bg == row[0].bg);
+
+  row += 20;
+  CHECK(row[5].ch == 0x4E2D && (row[5].flags >> 8) == 2);
+  CHECK(row[6].ch == 0xFFFFFFFF);
+  CHECK(row[7].ch == '!');
+
+  row += 20;
+  for (int col = 0; col < 20; ++col)
+    CHECK(isBlank(row[col]));
+
+  row += 20;
+  CHECK(row[0].ch == 'u' && (row[0].flags & 0x3) == 0x3);
+  CHECK(isBlank(row[5]));
+
+  term.pullScrollback(cells, lengths);
+  CHECK(lengths.empty());
+}
+
+// 超过上限丢弃最旧的行；样式表整理后内容不变
+void testEvictionAndCompaction() {
+  ScrollbackStore store(100, kBlank);
+  for (uint32_t line = 0; line < 3000; ++line) {
+    // 每行 3 种新样式，累计远超整理阈值
+    for (uint32_t col = 0; col < 3; ++col) {
+      uint32_t style =
+          store.internStyle({0xFF000000 | (line * 3 + col), kBlank.bg, 0});
+      store.appendCell('a' + col, style);
+    }
+    store.commitLine(8, line);
+  }
+  CHECK(store.size() == 100);
+  CHECK(store.memoryBytes() < 300 * 1024);
+
+  std::vector<TerminalCell> out;
+  for (size_t i = 0; i < store.size(); ++i) {
+    out.clear();
+    store.appendLine(i, out);
+    uint32_t line = 2900 + static_cast<uint32_t>(i);
+    CHECK(out.size() == 8 && store.lineCols(i) == 8);
+    CHECK(store.lineId(i) == line);
+    if (out.size() != 8)
+      continue;
+    for (uint32_t col = 0; col < 3; ++col) {
+      CHECK(out[col].ch == 'a' + col);
+      CHECK(out[col].fg == (0xFF000000 | (line * 3 + col)));
+    }
+    CHECK(isBlank(out[3]) && isBlank(out[7]));
+  }
+}
+
+} // namespace
+
+int main() {
+  testPushedRows();
+  testEvictionAndCompaction();
+  return pocket::test::finish("scrollback_store");
+}
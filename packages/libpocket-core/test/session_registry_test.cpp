@@ -0,0 +1,93 @@
+// 会话表：按 id 登记与查找，移除后已取到的引用仍有效；另一线程按帧序号轮询取帧
+#include "pocket_terminal.h"
+#include "session_registry.h"
+#include "test_util.h"
+#include <atomic>
+#include <string>
+#include <thread>
+
+using namespace pocket::terminal;
+
+namespace {
+
+void testAddFindRemove() {
+  SessionRegistry &registry = SessionRegistry::instance();
+  auto first = std::make_shared<PocketTerminal>(4, 10);
+  auto second = std::make_shared<PocketTerminal>(4, 10);
+  uint32_t a = registry.add(first);
+  uint32_t b = registry.add(second);
+  CHECK(a != 0 && b > a);
+  CHECK(registry.find(a) == first && registry.find(b) == second);
+  CHECK(registry.ids() == std::vector<uint32_t>({a, b}));
+
+  // 移除后查不到，已取到的引用继续可用；id 不复用
+  std::shared_ptr<PocketTerminal> held = registry.find(a);
+  first.reset();
+  CHECK(registry.remove(a));
+  CHECK(!registry.remove(a));
+  CHECK(registry.find(a) == nullptr);
+  CHECK(held->writeInput("ok", 2) == 2);
+  CHECK(registry.add(std::make_shared<PocketTerminal>(2, 2)) > b);
+  for (uint32_t id : registry.ids())
+    registry.remove(id);
+  CHECK(registry.ids().empty());
+}
+
+void testFrameSeq() {
+  PocketTerminal term(4, 10);
+  uint64_t seq = term.getFrameSeq();
+  term.writeInput("x", 1);
+  CHECK(term.getFrameSeq() > seq);
+  seq = term.getFrameSeq();
+  term.writeInput("\x1b[3;3H", 6); // 只移动光标
+  CHECK(term.getFrameSeq() > seq);
+  seq = term.getFrameSeq();
+  term.writeInput("\x1b[?25l", 6); // 不影响屏幕与光标位置
+  CHECK(term.getFrameSeq() == seq);
+}
+
+// 写入线程不停写，读取线程只按 id 找会话、序号变了才取帧
+void testReaderThread() {
+  SessionRegistry &registry = SessionRegistry::instance();
+  uint32_t id = registry.add(std::make_shared<PocketTerminal>(24, 80));
+  std::atomic<bool> done{false};
+  std::atomic<int> frames{0};
+
+  std::thread reader([&] {
+    std::vector<TerminalCell> cells(24 * 80);
+    uint64_t seen = 0;
+    while (!done) {
+      std::shared_ptr<PocketTerminal> term = registry.find(id);
+      if (!term)
+        break;
+      uint64_t seq = term->getFrameSeq();
+      if (seq == seen) {
+        std::this_thread::yield();
+        continue;
+      }
+      seen = seq;
+      term->copyBufferOut(cells.data(), cells.size() * sizeof(TerminalCell));
+      frames++;
+    }
+  });
+
+  std::shared_ptr<PocketTerminal> writer = registry.find(id);
+  for (int i = 0; i < 2000; ++i) {
+    std::string line = "\x1b[32mline " + std::to_string(i) + "\x1b[0m\r\n";
+    writer->writeInput(line.data(), line.size());
+  }
+  registry.remove(id);
+  done = true;
+  reader.join();
+  CHECK(frames > 0);
+  CHECK(registry.find(id) == nullptr);
+}
+
+} // namespace
+
+int main() {
+  testAddFindRemove();
+  testFrameSeq();
+  testReaderThread();
+  return pocket::test::finish("session_registry");
+}
@@ -0,0 +1,407 @@
+// 用 StaticScreen 实现 libvterm 的 vterm_screen_* 公共 API，
+// 与 libvterm 自带的 t/harness.c 链接 (替换 screen.c) 后跑 t/6x 屏幕测试，
+// 以此校验 StaticScreen 与 screen.c 的行为一致
+#include "static_screen.h"
+
+extern "C" {
+#include "vterm_internal.h"
+}
+
+#include <new>
+
+using pocket::terminal::StaticScreen;
+using pocket::terminal::ScreenSinkBase;
+using pocket::terminal::TerminalCell;
+namespace term = pocket::terminal;
+
+namespace {
+
+// 把 VTermScreenCallbacks 接到 StaticScreen 的 Sink 上
+struct CallbackSink : ScreenSinkBase {
+  static constexpr bool kHandlesMoveRect = true;
+  static constexpr bool kHasScrollback = true;
+
+  VTermScreen *screen{nullptr};
+  const VTermScreenCallbacks *callbacks{nullptr};
+  void *cbdata{nullptr};
+  bool hasPushline4{false};
+
+  void damage(VTermRect rect) {
+    if (callbacks && callbacks->damage)
+      callbacks->damage(rect, cbdata);
+  }
+
+  bool moveRect(VTermRect dest, VTermRect src) {
+    return callbacks && callbacks->moverect &&
+           callbacks->moverect(dest, src, cbdata);
+  }
+
+  void moveCursor(VTermPos pos, VTermPos oldpos, bool visible) {
+    if (callbacks && callbacks->movecursor)
+      callbacks->movecursor(pos, oldpos, visible, cbdata);
+  }
+
+  bool setTermProp(VTermProp prop, VTermValue *val) {
+    if (callbacks && callbacks->settermprop)
+      return callbacks->settermprop(prop, val, cbdata);
+    return true;
+  }
+
+  void bell() {
+    if (callbacks && callbacks->bell)
+      callbacks->bell(cbdata);
+  }
+
+  void resize(int rows, int cols) {
+    if (callbacks && callbacks->resize)
+      callbacks->resize(rows, cols, cbdata);
+  }
+
+  void pushLine(const TerminalCell *cells, int cols, bool continuation);
+  bool popLine(TerminalCell *cells, int cols);
+
+  bool clearScrollback() {
+    return callbacks && callbacks->sb_clear && callbacks->sb_clear(cbdata);
+  }
+
+  std::vector<VTermScreenCell> line;
+};
+
+} // namespace
+
+struct VTermScreen {
+  VTermScreen(VTerm *vt) : vt(vt), screen(vt, sink) { sink.screen = this; }
+
+  VTerm *vt;
+  CallbackSink sink;
+  StaticScreen<CallbackSink> screen;
+};
+
+namespace {
+
+// colorCode 的逆变换：默认色取 state 当前的默认色 (带默认标记)，
+// 调色板下标还原为 indexed，由 harness 按当前调色板转成 RGB
+VTermColor toColor(const VTermScreen *screen, uint32_t code) {
+  VTermColor color;
+  if (code == term::kColorDefaultFg || code == term::kColorDefaultBg) {
+    VTermColor fg, bg;
+    vterm_state_get_default_colors(screen->screen.state(), &fg, &bg);
+    return code == term::kColorDefaultFg ? fg : bg;
+  }
+  if (term::isIndexedColor(code))
+    vterm_color_indexed(&color, code & 0xFF);
+  else
+    vterm_color_rgb(&color, (code >> 16) & 0xFF, (code >> 8) & 0xFF,
+                    code & 0xFF);
+  return color;
+}
+
+void toScreenCell(const VTermScreen *screen, const TerminalCell &in,
+                  const uint32_t *combining, int width,
+                  VTermScreenCell *out) {
+  uint32_t flags = in.flags;
+
+  out->chars[0] = in.ch;
+  int i = 1;
+  if (combining) {
+    for (; i < VTERM_MAX_CHARS_PER_CELL && combining[i - 1]; i++)
+      out->chars[i] = combining[i - 1];
+  }
+  if (i < VTERM_MAX_CHARS_PER_CELL)
+    out->chars[i] = 0;
+
+  out->width = width;
+
+  out->attrs = VTermScreenCellAttrs{};
+  out->attrs.bold = (flags & term::kCellBold) != 0;
+  out->attrs.underline = (flags >> term::kCellUnderlineShift) & 3;
+  out->attrs.italic = (flags & term::kCellItalic) != 0;
+  out->attrs.blink = (flags & term::kCellBlink) != 0;
+  out->attrs.reverse =
+      ((flags & term::kCellReverse) != 0) ^ screen->screen.globalReverse();
+  out->attrs.conceal = (flags & term::kCellConceal) != 0;
+  out->attrs.strike = (flags & term::kCellStrike) != 0;
+  out->attrs.font = (flags >> term::kCellFontShift) & 0xF;
+  out->attrs.small = (flags & term::kCellSmall) != 0;
+  out->attrs.baseline = (flags >> term::kCellBaselineShift) & 3;
+  out->attrs.dwl = (flags & term::kCellDwl) != 0;
+  out->attrs.dhl = (flags >> term::kCellDhlShift) & 3;
+
+  out->fg = toColor(screen, in.fg);
+  out->bg = toColor(screen, in.bg);
+}
+
+void CallbackSink::pushLine(const TerminalCell *cells, int cols,
+                            bool continuation) {
+  if (!callbacks)
+    return;
+  if (!(hasPushline4 && callbacks->sb_pushline4) && !callbacks->sb_pushline)
+    return;
+
+  line.resize(cols);
+  for (int col = 0; col < cols; col++) {
+    int width = (col + 1 < cols && cells[col + 1].ch == term::kWideContinuation)
+                    ? 2
+                    : 1;
+    toScreenCell(screen, cells[col], nullptr, width, &line[col]);
+  }
+
+  if (hasPushline4 && callbacks->sb_pushline4)
+    callbacks->sb_pushline4(cols, line.data(), continuation, cbdata);
+  else
+    callbacks->sb_pushline(cols, line.data(), cbdata);
+}
+
+bool CallbackSink::popLine(TerminalCell *cells, int cols) {
+  if (!callbacks || !callbacks->sb_popline)
+    return false;
+
+  line.resize(cols);
+  if (!callbacks->sb_popline(cols, line.data(), cbdata))
+    return false;
+
+  for (int col = 0; col < cols; col++) {
+    const VTermScreenCell &src = line[col];
+    const VTermScreenCellAttrs &a = src.attrs;
+    uint32_t flags =
+        (a.bold ? term::kCellBold : 0) |
+        (a.underline ? term::kCellUnderline : 0) |
+        (static_cast<uint32_t>(a.underline) << term::kCellUnderlineShift) |
+        (a.italic ? term::kCellItalic : 0) | (a.blink ? term::kCellBlink : 0) |
+        (a.reverse ? term::kCellReverse : 0) |
+        (a.conceal ? term::kCellConceal : 0) |
+        (a.strike ? term::kCellStrike : 0) |
+        (static_cast<uint32_t>(a.font) << term::kCellFontShift) |
+        (a.small ? term::kCellSmall : 0) |
+        (static_cast<uint32_t>(a.baseline) << term::kCellBaselineShift) |
+        (static_cast<uint32_t>(src.width & 0xFF) << term::kCellWidthShift);
+
+    cells[col] = TerminalCell{src.chars[0], term::colorCode(src.fg),
+                              term::colorCode(src.bg), flags};
+  }
+  return true;
+}
+
+} // namespace
+
+// ============== vterm_screen_* ==============
+
+VTermScreen *vterm_obtain_screen(VTerm *vt) {
+  if (vt->screen)
+    return vt->screen;
+
+  vt->screen = new (std::nothrow) VTermScreen(vt);
+  return vt->screen;
+}
+
+void vterm_screen_free(VTermScreen *screen) { delete screen; }
+
+void vterm_screen_reset(VTermScreen *screen, int hard) {
+  screen->screen.reset(hard);
+}
+
+static size_t getChars(const VTermScreen *screen, bool utf8, void *buffer,
+                       size_t len, const VTermRect rect) {
+  size_t outpos = 0;
+  int padding = 0;
+
+  auto put = [&](uint32_t c) {
+    if (utf8) {
+      char tmp[6];
+      size_t thislen;
+      if (c < 0x80)
+        tmp[0] = c, thislen = 1;
+      else if (c < 0x800)
+        tmp[0] = 0xC0 | (c >> 6), tmp[1] = 0x80 | (c & 0x3F), thislen = 2;
+      else if (c < 0x10000)
+        tmp[0] = 0xE0 | (c >> 12), tmp[1] = 0x80 | ((c >> 6) & 0x3F),
+        tmp[2] = 0x80 | (c & 0x3F), thislen = 3;
+      else
+        tmp[0] = 0xF0 | (c >> 18), tmp[1] = 0x80 | ((c >> 12) & 0x3F),
+        tmp[2] = 0x80 | ((c >> 6) & 0x3F), tmp[3] = 0x80 | (c & 0x3F),
+        thislen = 4;
+      if (buffer && outpos + thislen <= len)
+        std::memcpy(static_cast<char *>(buffer) + outpos, tmp, thislen);
+      outpos += thislen;
+    } else {
+      if (buffer && outpos + 1 <= len)
+        static_cast<uint32_t *>(buffer)[outpos] = c;
+      outpos++;
+    }
+  };
+
+  for (int row = rect.start_row; row < rect.end_row; row++) {
+    for (int col = rect.start_col; col < rect.end_col; col++) {
+      const TerminalCell *cell = screen->screen.cell(row, col);
+
+      if (cell->ch == 0) {
+        padding++;
+      } else if (cell->ch != term::kWideContinuation) {
+        while (padding) {
+          put(0x20);
+          padding--;
+        }
+        put(cell->ch);
+        if (const uint32_t *extra = screen->screen.combining(row, col)) {
+          for (int i = 0; i < VTERM_MAX_CHARS_PER_CELL - 1 && extra[i]; i++)
+            put(extra[i]);
+        }
+      }
+    }
+
+    if (row < rect.end_row - 1) {
+      put(0x0A);
+      padding = 0;
+    }
+  }
+
+  return outpos;
+}
+
+size_t vterm_screen_get_chars(const VTermScreen *screen, uint32_t *chars,
+                              size_t len, const VTermRect rect) {
+  return getChars(screen, false, chars, len, rect);
+}
+
+size_t vterm_screen_get_text(const VTermScreen *screen, char *str, size_t len,
+                             const VTermRect rect) {
+  return getChars(screen, true, str, len, rect);
+}
+
+int vterm_screen_get_cell(const VTermScreen *screen, VTermPos pos,
+                          VTermScreenCell *cell) {
+  const TerminalCell *in = screen->screen.cell(pos.row, pos.col);
+  if (!in)
+    return 0;
+
+  toScreenCell(screen, *in, screen->screen.combining(pos.row, pos.col),
+               screen->screen.cellWidth(pos.row, pos.col), cell);
+  return 1;
+}
+
+int vterm_screen_is_eol(const VTermScreen *screen, VTermPos pos) {
+  for (; pos.col < screen->screen.cols(); pos.col++) {
+    if (screen->screen.cell(pos.row, pos.col)->ch != 0)
+      return 0;
+  }
+  return 1;
+}
+
+void vterm_screen_enable_reflow(VTermScreen *screen, bool reflow) {
+  screen->screen.enableReflow(reflow);
+}
+
+#undef vterm_screen_set_reflow
+void vterm_screen_set_reflow(VTermScreen *screen, bool reflow) {
+  vterm_screen_enable_reflow(screen, reflow);
+}
+
+void vterm_screen_enable_altscreen(VTermScreen *screen, int altscreen) {
+  screen->screen.enableAltscreen(altscreen != 0);
+}
+
+void vterm_screen_set_callbacks(VTermScreen *screen,
+                                const VTermScreenCallbacks *callbacks,
+                                void *user) {
+  screen->sink.callbacks = callbacks;
+  screen->sink.cbdata = user;
+}
+
+void *vterm_screen_get_cbdata(VTermScreen *screen) {
+  return screen->sink.cbdata;
+}
+
+void vterm_screen_callbacks_has_pushline4(VTermScreen *screen) {
+  screen->sink.hasPushline4 = true;
+}
+
+void vterm_screen_set_unrecognised_fallbacks(
+    VTermScreen *screen, const VTermStateFallbacks *fallbacks, void *user) {
+  vterm_state_set_unrecognised_fallbacks(screen->screen.state(), fallbacks,
+                                         user);
+}
+
+void *vterm_screen_get_unrecognised_fbdata(VTermScreen *screen) {
+  return vterm_state_get_unrecognised_fbdata(screen->screen.state());
+}
+
+void vterm_screen_flush_damage(VTermScreen *screen) {
+  screen->screen.flushDamage();
+}
+
+void vterm_screen_set_damage_merge(VTermScreen *screen,
+                                   VTermDamageSize size) {
+  screen->screen.setDamageMerge(size);
+}
+
+static bool attrsDiffer(VTermAttrMask attrs, const TerminalCell *a,
+                        const TerminalCell *b) {
+  uint32_t mask = 0;
+  if (attrs & VTERM_ATTR_BOLD_MASK)
+    mask |= term::kCellBold;
+  if (attrs & VTERM_ATTR_UNDERLINE_MASK)
+    mask |= term::kCellUnderline | (3u << term::kCellUnderlineShift);
+  if (attrs & VTERM_ATTR_ITALIC_MASK)
+    mask |= term::kCellItalic;
+  if (attrs & VTERM_ATTR_BLINK_MASK)
+    mask |= term::kCellBlink;
+  if (attrs & VTERM_ATTR_REVERSE_MASK)
+    mask |= term::kCellReverse;
+  if (attrs & VTERM_ATTR_CONCEAL_MASK)
+    mask |= term::kCellConceal;
+  if (attrs & VTERM_ATTR_STRIKE_MASK)
+    mask |= term::kCellStrike;
+  if (attrs & VTERM_ATTR_FONT_MASK)
+    mask |= 0xFu << term::kCellFontShift;
+  if (attrs & VTERM_ATTR_SMALL_MASK)
+    mask |= term::kCellSmall;
+  if (attrs & VTERM_ATTR_BASELINE_MASK)
+    mask |= 3u << term::kCellBaselineShift;
+
+  if ((a->flags ^ b->flags) & mask)
+    return true;
+  if ((attrs & VTERM_ATTR_FOREGROUND_MASK) && a->fg != b->fg)
+    return true;
+  if ((attrs & VTERM_ATTR_BACKGROUND_MASK) && a->bg != b->bg)
+    return true;
+  return false;
+}
+
+int vterm_screen_get_attrs_extent(const VTermScreen *screen,
+                                  VTermRect *extent, VTermPos pos,
+                                  VTermAttrMask attrs) {
+  const TerminalCell *target = screen->screen.cell(pos.row, pos.col);
+
+  extent->start_row = pos.row;
+  extent->end_row = pos.row + 1;
+
+  if (extent->start_col < 0)
+    extent->start_col = 0;
+  if (extent->end_col < 0)
+    extent->end_col = screen->screen.cols();
+
+  int col;
+
+  for (col = pos.col - 1; col >= extent->start_col; col--)
+    if (attrsDiffer(attrs, target, screen->screen.cell(pos.row, col)))
+      break;
+  extent->start_col = col + 1;
+
+  for (col = pos.col + 1; col < extent->end_col; col++)
+    if (attrsDiffer(attrs, target, screen->screen.cell(pos.row, col)))
+      break;
+  extent->end_col = col - 1;
+
+  return 1;
+}
+
+void vterm_screen_convert_color_to_rgb(const VTermScreen *screen,
+                                       VTermColor *col) {
+  vterm_state_convert_color_to_rgb(screen->screen.state(), col);
+}
+
+void vterm_screen_set_default_colors(VTermScreen *screen,
+                                     const VTermColor *default_fg,
+                                     const VTermColor *default_bg) {
+  screen->screen.setDefaultColors(default_fg, default_bg);
+}
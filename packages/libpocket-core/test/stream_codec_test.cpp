@@ -0,0 +1,172 @@
+// 流式压缩：任意切分输入与压缩流、任意时机空闲刷新，解出的字节都与原文一致
+#include "stream_codec.h"
+#include "test_util.h"
+#include <string>
+
+using namespace pocket::terminal;
+
+namespace {
+
+uint32_t g_seed = 1;
+
+uint32_t nextRandom() {
+  g_seed = g_seed * 1103515245u + 12345u;
+  return g_seed >> 8;
+}
+
+std::string coloredLog(int lines) {
+  std::string out;
+  for (int i = 0; i < lines; ++i) {
+    out += "\x1b[3" + std::to_string(i % 8) + "m[" + std::to_string(i) +
+           "] compiling module_" + std::to_string(nextRandom() % 50) +
+           ".cpp\x1b[0m\r\n";
+  }
+  return out;
+}
+
+std::string randomBytes(size_t len) {
+  std::string out(len, '\0');
+  for (char &c : out)
+    c = static_cast<char>(nextRandom());
+  return out;
+}
+
+// 按随机大小写入，随机空闲；压缩流再按随机大小喂给解码端
+std::string roundTrip(const std::string &input,
+                      const StreamCodecOptions &options, size_t maxChunk,
+                      size_t maxSplit) {
+  StreamCompressor compressor(options);
+  std::string packed;
+  for (size_t pos = 0; pos < input.size();) {
+    size_t len = std::min(input.size() - pos, 1 + nextRandom() % maxChunk);
+    compressor.write(input.data() + pos, len, packed);
+    if (nextRandom() % 4 == 0)
+      compressor.idle(packed);
+    pos += len;
+  }
+  compressor.flush(packed);
+  CHECK(!compressor.hasPending());
+  CHECK(compressor.bytesIn() == input.size());
+  CHECK(compressor.bytesOut() == packed.size());
+
+  StreamDecompressor decompressor;
+  std::string out;
+  for (size_t pos = 0; pos < packed.size();) {
+    size_t len = std::min(packed.size() - pos, 1 + nextRandom() % maxSplit);
+    CHECK(decompressor.write(packed.data() + pos, len, out));
+    pos += len;
+  }
+  CHECK(decompressor.idle());
+  return out;
+}
+
+void testRoundTrip() {
+  StreamCodecOptions block;
+  StreamCodecOptions interactive;
+  interactive.flushOnIdle = true;
+  StreamCodecOptions small;
+  small.windowBytes = 1024;
+  small.blockBytes = 100;
+  small.searchDepth = 1;
+
+  std::string log = coloredLog(5000);
+  std::string corpora[] = {
+      std::string(),
+      "x",
+      log,
+      randomBytes(100000),
+      std::string(200000, 'a'),                  // 长匹配的扩展长度
+      randomBytes(300) + randomBytes(5000),      // 长字面量
+      log.substr(0, 1000) + randomBytes(70000) + // 超出窗口后再出现
+          log.substr(0, 1000),
+  };
+  for (const std::string &input : corpora) {
+    CHECK(roundTrip(input, block, 5000, 7000) == input);
+    CHECK(roundTrip(input, interactive, 64, 3) == input);
+    CHECK(roundTrip(input, small, 300, 1) == input);
+  }
+}
+
+// 日志与字典中的序列应压得很小
+void testRatio() {
+  std::string log = coloredLog(5000);
+  StreamCompressor compressor;
+  std::string packed;
+  compressor.write(log.data(), log.size(), packed);
+  compressor.flush(packed);
+  CHECK(packed.size() * 4 < log.size());
+
+  // 只有字典里的序列：空闲刷新的短片段也能匹配
+  StreamCodecOptions options;
+  options.flushOnIdle = true;
+  StreamCompressor fresh(options);
+  std::string sgr = "\x1b[0m\x1b[K\r\n";
+  packed.clear();
+  fresh.write(sgr.data(), sgr.size(), packed);
+  fresh.idle(packed);
+  CHECK(packed.size() < 4 + sgr.size());
+}
+
+// 交互模式下 idle 立即输出；块模式只在攒满或 flush 时输出
+void testIdleFlush() {
+  StreamCodecOptions options;
+  options.flushOnIdle = true;
+  StreamCompressor interactive(options);
+  StreamDecompressor decompressor;
+  std::string packed, out;
+  interactive.write("ls\r\n", 4, packed);
+  CHECK(packed.empty() && interactive.hasPending());
+  interactive.idle(packed);
+  CHECK(!interactive.hasPending());
+  CHECK(decompressor.write(packed.data(), packed.size(), out));
+  CHECK(out == "ls\r\n");
+
+  StreamCompressor recording;
+  packed.clear();
+  recording.write("ls\r\n", 4, packed);
+  recording.idle(packed);
+  CHECK(packed.empty() && recording.hasPending());
+  recording.flush(packed);
+  CHECK(!packed.empty());
+}
+
+void testCorrupt() {
+  std::string out;
+  StreamDecompressor badMagic;
+  CHECK(!badMagic.write("PKZ\x09", 4, out));
+  CHECK(badMagic.failed());
+  CHECK(!badMagic.write("PKZ\x01", 4, out));
+
+  // 偏移超出历史 (字典 + 已解出的字节)
+  StreamDecompressor badOffset;
+  std::string stream("PKZ\x01\x00\xff\xff", 7);
+  CHECK(!badOffset.write(stream.data(), stream.size(), out));
+
+  // 没有匹配的序列不能带匹配长度
+  StreamDecompressor badToken;
+  stream = std::string("PKZ\x01\x13xyz\x00\x00", 10);
+  CHECK(!badToken.write(stream.data(), stream.size(), out));
+
+  // 截断：不算错误，只是还没解完
+  StreamCompressor compressor;
+  std::string packed;
+  std::string log = coloredLog(100);
+  compressor.write(log.data(), log.size(), packed);
+  compressor.flush(packed);
+  StreamDecompressor truncated;
+  out.clear();
+  CHECK(truncated.write(packed.data(), packed.size() - 1, out));
+  CHECK(!truncated.idle() && out.size() < log.size());
+  CHECK(truncated.write(packed.data() + packed.size() - 1, 1, out));
+  CHECK(truncated.idle() && out == log);
+}
+
+} // namespace
+
+int main() {
+  testRoundTrip();
+  testRatio();
+  testIdleFlush();
+  testCorrupt();
+  return pocket::test::finish("stream_codec");
+}
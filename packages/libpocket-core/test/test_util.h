@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdio>
+
+namespace pocket {
+namespace test {
+
+// 失败的 CHECK 次数
+inline int g_failures = 0;
+
+// 放在 main 末尾：打印汇总，返回进程退出码
+inline int finish(const char *name) {
+  if (g_failures) {
+    std::fprintf(stderr, "%d check(s) failed\n", g_failures);
+    return 1;
+  }
+  std::printf("%s: all passed\n", name);
+  return 0;
+}
+
+} // namespace test
+} // namespace pocket
+
+// 条件不成立时打印位置并计数，不中断后续检查
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__,   \
+                   #cond);                                                     \
+      ::pocket::test::g_failures++;                                            \
+    }                                                                          \
+  } while (0)
@@ -0,0 +1,132 @@
+// 纯文本摘要：重复行 / 相似行合并、空行折叠、超预算时优先保留错误行，
+// 省略标记按原始行数计
+#include "pocket_terminal.h"
+#include "test_util.h"
+#include "text_summary.h"
+#include <string>
+
+using namespace pocket::terminal;
+
+namespace {
+
+bool contains(const std::string &text, const std::string &part) {
+  return text.find(part) != std::string::npos;
+}
+
+// 只由字母区分的行：数字会被相似度折叠，这样每行都互不相似
+std::string uniqueLine(const char *prefix, int i) {
+  std::string word;
+  for (int n = i + 26; n > 0; n /= 26)
+    word += static_cast<char>('a' + n % 26);
+  return std::string(prefix) + word;
+}
+
+std::string compact(const std::vector<std::string> &lines,
+                    size_t maxBytes = 4096) {
+  TextCompactor compactor(maxBytes);
+  for (const std::string &line : lines)
+    compactor.addLine(line, false);
+  return compactor.finish();
+}
+
+void testRuns() {
+  CHECK(compact({"hello", "hello", "hello", "hello", "hello"}) ==
+        "hello [x5]\n");
+  CHECK(compact({"a", "hello", "hello", "b"}) == "a\nhello [x2]\nb\n");
+
+  // 只有数字 / 进度条不同：保留首尾两行
+  std::vector<std::string> progress;
+  for (int i = 1; i <= 10; ++i)
+    progress.push_back("[" + std::string(i, '=') + ">] " +
+                       std::to_string(i * 10) + "% done");
+  CHECK(compact(progress) == "[=>] 10% done\n[... 8 similar lines]\n"
+                             "[==========>] 100% done\n");
+  CHECK(compact({"took 1ms", "took 25ms"}) == "took 1ms\ntook 25ms\n");
+
+  // 首尾空行去掉，中间连续空行只留一个
+  CHECK(compact({"", "", "a", "", "", "", "b", "", ""}) == "a\n\nb\n");
+}
+
+void testErrorDetection() {
+  CHECK(TextCompactor::looksLikeError("Segmentation Fault (core dumped)"));
+  CHECK(TextCompactor::looksLikeError("ld: undefined reference to `main'"));
+  CHECK(TextCompactor::looksLikeError("bash: foo: No such file or directory"));
+  CHECK(!TextCompactor::looksLikeError("all 12 tests passed"));
+}
+
+// 超出预算：保留最新的内容与较早的错误行，总长不超过预算
+void testBudget() {
+  std::vector<std::string> lines;
+  for (int i = 0; i < 200; ++i)
+    lines.push_back(uniqueLine("output line ", i));
+  lines[10] = "fatal: cannot open config";
+  TextCompactor compactor(512);
+  for (size_t i = 0; i < lines.size(); ++i)
+    compactor.addLine(lines[i], i == 20); // 第 20 行以颜色标为错误
+  std::string out = compactor.finish();
+  CHECK(out.size() <= 512);
+  CHECK(contains(out, "fatal: cannot open config"));
+  CHECK(contains(out, lines[20]));
+  CHECK(contains(out, lines.back()));
+  CHECK(!contains(out, lines[0] + "\n"));
+  CHECK(contains(out, "[... 10 lines omitted]\n" + lines[10]));
+
+  // 单行超长按半个预算截断，截断不拆开 UTF-8 字符
+  std::string wide;
+  for (int i = 0; i < 1000; ++i)
+    wide += "中";
+  out = compact({wide}, 100);
+  CHECK(out.size() <= 100 && (out.size() - 1) % 3 == 0);
+  CHECK(out.compare(0, out.size() - 1, wide, 0, out.size() - 1) == 0);
+
+  for (size_t budget : {0, 1, 16, 64, 300}) {
+    out = compact(lines, budget);
+    CHECK(out.size() <= budget);
+  }
+}
+
+// 省略标记按被丢弃的原始行数计，不是合并后的条目数
+void testOmittedCount() {
+  std::string spam = "spam";
+  for (int i = 0; i < 20; ++i)
+    spam += " spam";
+  std::vector<std::string> lines = {"first unique line"};
+  for (int i = 0; i < 100; ++i)
+    lines.push_back(spam);
+  for (int i = 1; i <= 10; ++i)
+    lines.push_back("step " + std::to_string(i) + " of 10 running");
+  const char *tail = "tail line padded out to about sixty bytes of text ";
+  for (int i = 0; i < 3; ++i)
+    lines.push_back(uniqueLine(tail, i));
+
+  // 只放得下最后三行：前面 1 + 100 + 10 行都算作省略
+  std::string out = compact(lines, 300);
+  CHECK(out.size() <= 300);
+  CHECK(out.compare(0, 24, "[... 111 lines omitted]\n") == 0);
+  CHECK(contains(out, uniqueLine(tail, 0)) &&
+        contains(out, uniqueLine(tail, 2)));
+  CHECK(!contains(out, "spam") && !contains(out, "step"));
+}
+
+// 走 exportSummary：历史与屏幕连成一段，跨边界的重复行照样合并
+void testExportSummary() {
+  PocketTerminal term(5, 20);
+  for (int i = 0; i < 20; ++i)
+    term.writeInput("same\r\n", 6);
+  term.writeInput("\x1b[31mboom\x1b[0m", 13);
+  SummaryOptions options;
+  CHECK(term.exportSummary(options) == "same [x20]\nboom\n");
+  options.lastLines = 3;
+  CHECK(term.exportSummary(options) == "same [x2]\nboom\n");
+}
+
+} // namespace
+
+int main() {
+  testRuns();
+  testErrorDetection();
+  testBudget();
+  testOmittedCount();
+  testExportSummary();
+  return pocket::test::finish("text_summary");
+}
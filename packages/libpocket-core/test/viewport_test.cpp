@@ -0,0 +1,127 @@
+// 可见区域：只转换区域 (含边) 内的格子，区域移动后补上，结果与整屏转换一致
+#include "pocket_terminal.h"
+#include "test_util.h"
+#include <cstring>
+#include <string>
+
+using namespace pocket::terminal;
+
+namespace {
+
+std::vector<TerminalCell> screenOf(PocketTerminal &term) {
+  std::vector<TerminalCell> cells(term.getRows() * term.getCols());
+  term.copyBufferOut(cells.data(), cells.size() * sizeof(TerminalCell));
+  return cells;
+}
+
+bool sameCells(const std::vector<TerminalCell> &a,
+               const std::vector<TerminalCell> &b) {
+  return a.size() == b.size() &&
+         std::memcmp(a.data(), b.data(), a.size() * sizeof(TerminalCell)) == 0;
+}
+
+void feed(PocketTerminal &term, const std::string &bytes) {
+  term.writeInput(bytes.data(), bytes.size());
+}
+
+// 每行铺满 row 对应的字母，带颜色
+std::string fillScreen(int rows, int cols, char base) {
+  std::string out = "\x1b[H";
+  for (int row = 0; row < rows; ++row) {
+    out += "\x1b[" + std::to_string(row + 1) + ";1H\x1b[3" +
+           std::to_string(row % 8) + "m";
+    out += std::string(cols, static_cast<char>(base + row % 26));
+  }
+  return out + "\x1b[0m";
+}
+
+// 区域外的格子保持旧内容，移过去后与整屏转换的终端一致
+void testLazyOutsideViewport() {
+  PocketTerminal clipped(20, 40);
+  PocketTerminal full(20, 40);
+  screenOf(clipped);
+  clipped.setViewport(0, 0, 5, 10, 2);
+
+  std::string bytes = fillScreen(20, 40, 'a');
+  feed(clipped, bytes);
+  feed(full, bytes);
+  std::vector<TerminalCell> expected = screenOf(full);
+
+  std::vector<TerminalCell> cells = screenOf(clipped);
+  CHECK(cells[0].ch == 'a' && cells[6 * 40 + 11].ch == 'g'); // 含边
+  CHECK(cells[7 * 40].ch != 'h');                            // 区域外
+  CHECK(cells[40 + 12].ch != 'b');
+
+  std::vector<TerminalCell> viewport(50);
+  CHECK(clipped.copyViewportOut(viewport.data(), 50 * sizeof(TerminalCell)) ==
+        50);
+  for (int row = 0; row < 5; ++row)
+    CHECK(std::memcmp(&viewport[row * 10], &expected[row * 40],
+                      10 * sizeof(TerminalCell)) == 0);
+
+  // 移到右下角：新区域转换，旧区域已转换的保留，两者之外的仍未转换
+  clipped.setViewport(10, 20, 10, 20, 0);
+  cells = screenOf(clipped);
+  CHECK(std::memcmp(&cells[15 * 40 + 20], &expected[15 * 40 + 20],
+                    20 * sizeof(TerminalCell)) == 0);
+  CHECK(cells[5 * 40].ch == 'f');
+  CHECK(cells[8 * 40].ch != 'i');
+
+  clipped.clearViewport();
+  CHECK(sameCells(screenOf(clipped), expected));
+}
+
+// 区域与过期区间部分相交 (左、右、中间)，多次更新后仍与整屏一致
+void testPartialSpans() {
+  PocketTerminal clipped(10, 30);
+  PocketTerminal full(10, 30);
+  const int lefts[] = {0, 20, 10, 5};
+  for (int round = 0; round < 4; ++round) {
+    clipped.setViewport(2, lefts[round], 4, 8, 1);
+    std::string bytes = fillScreen(10, 30, static_cast<char>('A' + round));
+    bytes += "\x1b[3;5Hxyz\x1b[8;1H\x1b[K";
+    feed(clipped, bytes);
+    feed(full, bytes);
+    screenOf(clipped);
+  }
+  clipped.clearViewport();
+  CHECK(sameCells(screenOf(clipped), screenOf(full)));
+}
+
+// 区域裁到屏幕；导出不受区域影响
+void testClipAndExport() {
+  PocketTerminal term(6, 20);
+  term.setViewport(4, 15, 10, 10, 0);
+  feed(term, fillScreen(6, 20, 'k'));
+
+  std::vector<TerminalCell> viewport(120);
+  CHECK(term.copyViewportOut(viewport.data(), 120 * sizeof(TerminalCell)) ==
+        10);
+  CHECK(viewport[0].ch == 'o' && viewport[5].ch == 'p');
+  // 缓冲不够时只复制放得下的部分
+  CHECK(term.copyViewportOut(viewport.data(), 3 * sizeof(TerminalCell)) == 3);
+
+  SummaryOptions options;
+  std::string summary = term.exportSummary(options);
+  CHECK(summary.find(std::string(20, 'k')) != std::string::npos);
+  CHECK(summary.find(std::string(20, 'p')) != std::string::npos);
+
+  // resize 后区域保持坐标，按新尺寸裁剪
+  term.resize(5, 16);
+  CHECK(term.copyViewportOut(viewport.data(), 120 * sizeof(TerminalCell)) ==
+        1);
+
+  // 区域整个在屏幕外：什么也不复制
+  term.setViewport(30, 30, 4, 4);
+  CHECK(term.copyViewportOut(viewport.data(), 120 * sizeof(TerminalCell)) ==
+        0);
+}
+
+} // namespace
+
+int main() {
+  testLazyOutsideViewport();
+  testPartialSpans();
+  testClipAndExport();
+  return pocket::test::finish("viewport");
+}